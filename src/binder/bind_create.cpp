@@ -32,6 +32,7 @@
 #include "binder/expressions/bound_constant.h"
 #include "binder/expressions/bound_star.h"
 #include "binder/expressions/bound_unary_op.h"
+#include "binder/statement/analyze_statement.h"
 #include "binder/statement/create_statement.h"
 #include "binder/statement/index_statement.h"
 #include "binder/statement/select_statement.h"
@@ -132,4 +133,17 @@ auto Binder::BindIndex(duckdb_libpgquery::PGIndexStmt *stmt) -> std::unique_ptr<
   return std::make_unique<IndexStatement>(stmt->idxname, std::move(table), std::move(cols));
 }
 
+auto Binder::BindAnalyze(duckdb_libpgquery::PGVacuumStmt *stmt) -> std::unique_ptr<AnalyzeStatement> {
+  if ((stmt->options & duckdb_libpgquery::PG_VACOPT_ANALYZE) == 0) {
+    throw NotImplementedException("VACUUM is not supported");
+  }
+  if (stmt->va_cols != nullptr) {
+    throw NotImplementedException("ANALYZE on a subset of the columns is not supported");
+  }
+  if (stmt->relation == nullptr) {
+    return std::make_unique<AnalyzeStatement>(nullptr);
+  }
+  return std::make_unique<AnalyzeStatement>(BindBaseTableRef(stmt->relation->relname, std::nullopt));
+}
+
 }  // namespace bustub
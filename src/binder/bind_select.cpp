@@ -14,6 +14,7 @@
 #include "binder/expressions/bound_column_ref.h"
 #include "binder/expressions/bound_constant.h"
 #include "binder/expressions/bound_star.h"
+#include "binder/expressions/bound_subquery_expr.h"
 #include "binder/expressions/bound_unary_op.h"
 #include "binder/statement/explain_statement.h"
 #include "binder/statement/select_statement.h"
@@ -697,6 +698,12 @@ auto Binder::ResolveColumn(const BoundTableRef &scope, const std::vector<std::st
     -> std::unique_ptr<BoundExpression> {
   BUSTUB_ASSERT(!scope.IsInvalid(), "invalid scope");
   auto expr = ResolveColumnInternal(scope, col_name);
+  // A column not found in a subquery is resolved in the enclosing queries, innermost first (correlated subquery).
+  for (auto it = outer_scopes_.rbegin(); expr == nullptr && it != outer_scopes_.rend(); ++it) {
+    if ((*it)->type_ != TableReferenceType::EMPTY) {
+      expr = ResolveColumnInternal(**it, col_name);
+    }
+  }
   if (!expr) {
     throw bustub::Exception(fmt::format("column {} not found", fmt::join(col_name, ".")));
   }
@@ -719,6 +726,19 @@ auto Binder::BindAExpr(duckdb_libpgquery::PGAExpr *root) -> std::unique_ptr<Boun
   BUSTUB_ASSERT(root, "nullptr");
   auto name = std::string((reinterpret_cast<duckdb_libpgquery::PGValue *>(root->name->head->data.ptr_value))->val.str);
 
+  if (root->kind == duckdb_libpgquery::PG_AEXPR_IN) {
+    // `x IN (a, b)` is bound as `x = a OR x = b`, and `x NOT IN (a, b)` (name `<>`) as `x <> a AND x <> b`.
+    auto logic_op = name == "=" ? "or" : "and";
+    auto values = BindExpressionList(reinterpret_cast<duckdb_libpgquery::PGList *>(root->rexpr));
+    std::unique_ptr<BoundExpression> expr = nullptr;
+    for (auto &value : values) {
+      auto cmp = std::make_unique<BoundBinaryOp>(name, BindExpression(root->lexpr), std::move(value));
+      expr = expr == nullptr ? std::move(cmp)
+                             : std::make_unique<BoundBinaryOp>(logic_op, std::move(expr), std::move(cmp));
+    }
+    return expr;
+  }
+
   if (root->kind != duckdb_libpgquery::PG_AEXPR_OP) {
     throw bustub::Exception("unsupported op in AExpr");
   }
@@ -780,6 +800,40 @@ auto Binder::BindBoolExpr(duckdb_libpgquery::PGBoolExpr *root) -> std::unique_pt
   UNREACHABLE("We should have handled all cases!");
 }
 
+auto Binder::BindSubLink(duckdb_libpgquery::PGSubLink *root) -> std::unique_ptr<BoundExpression> {
+  BUSTUB_ASSERT(root, "nullptr");
+  auto subquery_type = SubqueryType::EXISTS;
+  std::unique_ptr<BoundExpression> child = nullptr;
+  switch (root->subLinkType) {
+    case duckdb_libpgquery::PG_EXISTS_SUBLINK:
+      break;
+    case duckdb_libpgquery::PG_ANY_SUBLINK: {
+      // `x IN (SELECT ...)` is parsed as `x = ANY (SELECT ...)`, the operator name is omitted for IN.
+      if (root->operName != nullptr) {
+        auto op_name =
+            std::string(reinterpret_cast<duckdb_libpgquery::PGValue *>(root->operName->head->data.ptr_value)->val.str);
+        if (op_name != "=") {
+          throw NotImplementedException(fmt::format("{} ANY subquery is not supported", op_name));
+        }
+      }
+      subquery_type = SubqueryType::IN;
+      child = BindExpression(root->testexpr);
+      break;
+    }
+    default:
+      throw NotImplementedException("only IN and EXISTS subqueries are supported");
+  }
+
+  outer_scopes_.push_back(scope_);
+  auto subquery = BindSelect(reinterpret_cast<duckdb_libpgquery::PGSelectStmt *>(root->subselect));
+  outer_scopes_.pop_back();
+
+  if (subquery_type == SubqueryType::IN && subquery->select_list_.size() != 1) {
+    throw bustub::Exception("subquery of IN must return exactly one column");
+  }
+  return std::make_unique<BoundSubqueryExpr>(subquery_type, std::move(subquery), std::move(child));
+}
+
 auto Binder::BindExpression(duckdb_libpgquery::PGNode *node) -> std::unique_ptr<BoundExpression> {
   BUSTUB_ASSERT(node, "nullptr");
   switch (node->type) {
@@ -797,6 +851,8 @@ auto Binder::BindExpression(duckdb_libpgquery::PGNode *node) -> std::unique_ptr<
       return BindAExpr(reinterpret_cast<duckdb_libpgquery::PGAExpr *>(node));
     case duckdb_libpgquery::T_PGBoolExpr:
       return BindBoolExpr(reinterpret_cast<duckdb_libpgquery::PGBoolExpr *>(node));
+    case duckdb_libpgquery::T_PGSubLink:
+      return BindSubLink(reinterpret_cast<duckdb_libpgquery::PGSubLink *>(node));
     default:
       break;
   }
@@ -830,6 +886,9 @@ auto Binder::BindExplain(duckdb_libpgquery::PGExplainStmt *stmt) -> std::unique_
       if (strcmp(temp->defname, "schema") == 0 || strcmp(temp->defname, "s") == 0) {
         explain_options |= ExplainOptions::SCHEMA;
       }
+      if (strcmp(temp->defname, "analyze") == 0 || strcmp(temp->defname, "a") == 0) {
+        explain_options |= ExplainOptions::ANALYZE;
+      }
     }
   }
   return std::make_unique<ExplainStatement>(BindStatement(stmt->query), explain_options);
@@ -72,6 +72,7 @@ auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
 
 auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
   std::lock_guard<std::mutex> lk(latch_);
+  fetch_count_++;
   frame_id_t frame_id = -1;
   // 如果当前页面在buffer中直接返回
   if (page_table_->Find(page_id, frame_id)) {
@@ -82,6 +83,7 @@ auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
     return &pages_[frame_id];
   }
   // 需要从磁盘上将page读入到bufferpool
+  miss_count_++;
   // 1. 可以找到一个空闲的frame
   if (!free_list_.empty()) {
     frame_id = free_list_.back();
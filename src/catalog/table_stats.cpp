@@ -0,0 +1,226 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_stats.cpp
+//
+// Identification: src/catalog/table_stats.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "catalog/table_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string_view>
+#include <unordered_set>
+
+#include "common/config.h"
+#include "fmt/format.h"
+#include "fmt/ranges.h"
+#include "storage/table/table_heap.h"
+
+namespace bustub {
+
+namespace {
+// murmur3 的 finalizer，把 HashUtil 的 hash 打散，HyperLogLog 需要每一位都均匀分布
+auto MixHash(uint64_t hash) -> uint64_t {
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdULL;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ULL;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+/**
+ * 给 sketch 用的 hash。HashUtil::HashBytes 对有符号的字节做异或，不同的整数很容易冲突，
+ * 会让 HyperLogLog 严重低估，所以定长类型直接使用原始的值，varchar 使用 std::hash
+ */
+auto SketchHash(const Value &value) -> hash_t {
+  switch (value.GetTypeId()) {
+    case TypeId::TINYINT:
+      return static_cast<hash_t>(value.GetAs<int8_t>());
+    case TypeId::SMALLINT:
+      return static_cast<hash_t>(value.GetAs<int16_t>());
+    case TypeId::INTEGER:
+      return static_cast<hash_t>(value.GetAs<int32_t>());
+    case TypeId::BIGINT:
+    case TypeId::TIMESTAMP:
+      return static_cast<hash_t>(value.GetAs<int64_t>());
+    case TypeId::VARCHAR:
+      return std::hash<std::string_view>{}(std::string_view(value.GetData(), value.GetLength()));
+    default:
+      return HashUtil::HashValue(&value);
+  }
+}
+
+auto ValueLess(const Value &a, const Value &b) -> bool { return a.CompareLessThan(b) == CmpBool::CmpTrue; }
+
+/**
+ * 由采样计算一列的统计信息
+ * @param sample 采样的行
+ * @param row_count 表的总行数，采样覆盖全表时 NDV 直接取精确值
+ */
+auto BuildColumnStats(const std::vector<Tuple> &sample, const Schema &schema, uint32_t col_idx,
+                      const HyperLogLog &sketch, size_t row_count) -> ColumnStats {
+  ColumnStats stats;
+  if (sample.empty()) {
+    return stats;
+  }
+  std::vector<Value> values;
+  values.reserve(sample.size());
+  for (const auto &tuple : sample) {
+    auto value = tuple.GetValue(&schema, col_idx);
+    if (!value.IsNull()) {
+      values.push_back(std::move(value));
+    }
+  }
+  auto sample_size = static_cast<double>(sample.size());
+  stats.null_fraction_ = static_cast<double>(sample.size() - values.size()) / sample_size;
+  std::sort(values.begin(), values.end(), ValueLess);
+
+  // 相同的值在排好序之后相邻，统计每个值出现的次数
+  std::vector<std::pair<size_t, size_t>> runs;  // (第一次出现的下标, 次数)
+  for (size_t i = 0; i < values.size(); i++) {
+    if (runs.empty() || values[runs.back().first].CompareEquals(values[i]) != CmpBool::CmpTrue) {
+      runs.emplace_back(i, 0);
+    }
+    runs.back().second++;
+  }
+  stats.ndv_ = sample.size() == row_count ? runs.size() : std::max(sketch.Estimate(), runs.size());
+
+  // 值的种类足够少时全部作为 MCV，否则只保留出现次数高于平均值的
+  std::vector<size_t> candidates;
+  for (size_t i = 0; i < runs.size(); i++) {
+    if (runs.size() <= static_cast<size_t>(STATS_MCV_COUNT) ||
+        (runs[i].second >= 2 && runs[i].second * runs.size() > values.size())) {
+      candidates.push_back(i);
+    }
+  }
+  std::stable_sort(candidates.begin(), candidates.end(),
+                   [&runs](size_t a, size_t b) { return runs[a].second > runs[b].second; });
+  candidates.resize(std::min(candidates.size(), static_cast<size_t>(STATS_MCV_COUNT)));
+  std::vector<bool> is_mcv(runs.size(), false);
+  for (auto i : candidates) {
+    is_mcv[i] = true;
+    stats.mcvs_.emplace_back(values[runs[i].first], static_cast<double>(runs[i].second) / sample_size);
+  }
+
+  // 剩下的值构建等深直方图
+  std::vector<const Value *> rest;
+  for (size_t i = 0; i < runs.size(); i++) {
+    if (!is_mcv[i]) {
+      for (size_t j = 0; j < runs[i].second; j++) {
+        rest.push_back(&values[runs[i].first + j]);
+      }
+    }
+  }
+  stats.histogram_fraction_ = static_cast<double>(rest.size()) / sample_size;
+  if (rest.size() >= 2) {
+    auto buckets = std::min(rest.size() - 1, static_cast<size_t>(STATS_HISTOGRAM_BUCKETS));
+    for (size_t i = 0; i <= buckets; i++) {
+      stats.histogram_.push_back(*rest[i * (rest.size() - 1) / buckets]);
+    }
+  } else if (rest.size() == 1) {
+    stats.histogram_.push_back(*rest[0]);
+  }
+  return stats;
+}
+}  // namespace
+
+void HyperLogLog::Add(hash_t hash) {
+  auto mixed = MixHash(hash);
+  auto index = mixed >> (64 - PRECISION);
+  auto rest = mixed << PRECISION;
+  auto rank = static_cast<uint8_t>(rest == 0 ? 64 - PRECISION + 1 : __builtin_clzll(rest) + 1);
+  registers_[index] = std::max(registers_[index], rank);
+}
+
+auto HyperLogLog::Estimate() const -> size_t {
+  const double m = NUM_REGISTERS;
+  double sum = 0;
+  size_t zeros = 0;
+  for (auto reg : registers_) {
+    sum += std::ldexp(1.0, -reg);
+    zeros += reg == 0 ? 1 : 0;
+  }
+  double estimate = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+  // 基数较小时使用 linear counting 修正
+  if (estimate <= 2.5 * m && zeros != 0) {
+    estimate = m * std::log(m / static_cast<double>(zeros));
+  }
+  return static_cast<size_t>(std::llround(estimate));
+}
+
+auto ColumnStats::ToString() const -> std::string {
+  std::vector<std::string> mcvs;
+  mcvs.reserve(mcvs_.size());
+  for (const auto &[value, frequency] : mcvs_) {
+    mcvs.push_back(fmt::format("{}:{:.3f}", value, frequency));
+  }
+  return fmt::format("ndv={}, null_frac={:.3f}, mcv=[{}], histogram={}", ndv_, null_fraction_, fmt::join(mcvs, ", "),
+                     histogram_);
+}
+
+auto TableStats::Collect(TableHeap *heap, const Schema &schema, Transaction *txn) -> CollectedStats {
+  auto column_count = schema.GetColumnCount();
+  auto pair_columns = std::min(column_count, static_cast<uint32_t>(STATS_MAX_PAIR_COLUMNS));
+  std::vector<HyperLogLog> sketches(column_count);
+  std::map<std::pair<uint32_t, uint32_t>, HyperLogLog> pair_sketches;
+  for (uint32_t a = 0; a < pair_columns; a++) {
+    for (uint32_t b = a + 1; b < pair_columns; b++) {
+      pair_sketches[{a, b}];
+    }
+  }
+  std::vector<Tuple> sample;
+  // 固定种子，同样的数据得到同样的统计信息
+  std::mt19937_64 rng(15445);
+  size_t row_count = 0;
+  std::vector<hash_t> hashes(column_count);
+  for (auto iter = heap->Begin(txn); iter != heap->End(); ++iter) {
+    for (uint32_t i = 0; i < column_count; i++) {
+      auto value = iter->GetValue(&schema, i);
+      hashes[i] = value.IsNull() ? 0 : SketchHash(value);
+      if (!value.IsNull()) {
+        sketches[i].Add(hashes[i]);
+      }
+    }
+    // null 也算作一种取值，两列的组合用两个 hash 拼成一个
+    for (auto &[columns, sketch] : pair_sketches) {
+      sketch.Add(MixHash(hashes[columns.first]) ^ hashes[columns.second]);
+    }
+    // reservoir sampling：第 n 行以 STATS_SAMPLE_SIZE / n 的概率替换样本中的一行
+    if (sample.size() < static_cast<size_t>(STATS_SAMPLE_SIZE)) {
+      sample.push_back(*iter);
+    } else if (auto slot = rng() % (row_count + 1); slot < sample.size()) {
+      sample[slot] = *iter;
+    }
+    row_count++;
+  }
+
+  CollectedStats stats;
+  stats.row_count_ = row_count;
+  stats.columns_.reserve(column_count);
+  for (uint32_t i = 0; i < column_count; i++) {
+    stats.columns_.push_back(BuildColumnStats(sample, schema, i, sketches[i], row_count));
+  }
+  for (const auto &[columns, sketch] : pair_sketches) {
+    // 采样覆盖全表时直接数出精确值
+    if (sample.size() == row_count) {
+      std::unordered_set<hash_t> combinations;
+      for (const auto &tuple : sample) {
+        auto a = tuple.GetValue(&schema, columns.first);
+        auto b = tuple.GetValue(&schema, columns.second);
+        combinations.insert(MixHash(a.IsNull() ? 0 : SketchHash(a)) ^ (b.IsNull() ? 0 : SketchHash(b)));
+      }
+      stats.pair_ndv_[columns] = combinations.size();
+    } else {
+      stats.pair_ndv_[columns] = sketch.Estimate();
+    }
+  }
+  return stats;
+}
+
+}  // namespace bustub
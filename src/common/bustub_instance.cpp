@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <optional>
 #include <shared_mutex>
 #include <string>
@@ -6,6 +7,7 @@
 #include "binder/binder.h"
 #include "binder/bound_expression.h"
 #include "binder/bound_statement.h"
+#include "binder/statement/analyze_statement.h"
 #include "binder/statement/create_statement.h"
 #include "binder/statement/explain_statement.h"
 #include "binder/statement/index_statement.h"
@@ -38,7 +40,9 @@
 namespace bustub {
 
 auto BustubInstance::MakeExecutorContext(Transaction *txn) -> std::unique_ptr<ExecutorContext> {
-  return std::make_unique<ExecutorContext>(txn, catalog_, buffer_pool_manager_, txn_manager_, lock_manager_);
+  memory_tracker_->SetLimit(GetMemoryLimit("global_memory_limit"));
+  return std::make_unique<ExecutorContext>(txn, catalog_, buffer_pool_manager_, txn_manager_, lock_manager_,
+                                           GetMemoryLimit("query_memory_limit"), memory_tracker_);
 }
 
 BustubInstance::BustubInstance(const std::string &db_file_name) {
@@ -71,6 +75,9 @@ BustubInstance::BustubInstance(const std::string &db_file_name) {
 
   // Execution engine.
   execution_engine_ = new ExecutionEngine(buffer_pool_manager_, txn_manager_, catalog_);
+
+  // Memory budget shared by all the queries.
+  memory_tracker_ = new MemoryTracker("global");
 }
 
 BustubInstance::BustubInstance() {
@@ -103,6 +110,9 @@ BustubInstance::BustubInstance() {
 
   // Execution engine.
   execution_engine_ = new ExecutionEngine(buffer_pool_manager_, txn_manager_, catalog_);
+
+  // Memory budget shared by all the queries.
+  memory_tracker_ = new MemoryTracker("global");
 }
 
 void BustubInstance::CmdDisplayTables(ResultWriter &writer) {
@@ -146,6 +156,54 @@ void BustubInstance::CmdDisplayIndices(ResultWriter &writer) {
   writer.EndTable();
 }
 
+void BustubInstance::ExecuteAnalyze(const AnalyzeStatement &stmt, Transaction *txn, ResultWriter &writer) {
+  std::shared_lock<std::shared_mutex> l(catalog_lock_);
+  std::vector<TableInfo *> tables;
+  if (stmt.table_ != nullptr) {
+    tables.push_back(catalog_->GetTable(stmt.table_->oid_));
+  } else {
+    for (const auto &name : catalog_->GetTableNames()) {
+      tables.push_back(catalog_->GetTable(name));
+    }
+    std::sort(tables.begin(), tables.end(), [](auto *a, auto *b) { return a->oid_ < b->oid_; });
+  }
+  l.unlock();
+
+  writer.BeginTable(false);
+  writer.BeginHeader();
+  writer.WriteHeaderCell("table_name");
+  writer.WriteHeaderCell("column");
+  writer.WriteHeaderCell("rows");
+  writer.WriteHeaderCell("stats");
+  writer.EndHeader();
+  for (auto *table_info : tables) {
+    // Mock tables have no table heap to scan.
+    if (table_info->table_ == nullptr) {
+      continue;
+    }
+    auto stats = TableStats::Collect(table_info->table_.get(), table_info->schema_, txn);
+    auto write_row = [&](const std::string &column, const std::string &column_stats) {
+      writer.BeginRow();
+      writer.WriteCell(table_info->name_);
+      writer.WriteCell(column);
+      writer.WriteCell(fmt::format("{}", stats.row_count_));
+      writer.WriteCell(column_stats);
+      writer.EndRow();
+    };
+    for (uint32_t i = 0; i < stats.columns_.size(); i++) {
+      write_row(table_info->schema_.GetColumn(i).GetName(), stats.columns_[i].ToString());
+    }
+    for (const auto &[columns, ndv] : stats.pair_ndv_) {
+      write_row(fmt::format("{},{}", table_info->schema_.GetColumn(columns.first).GetName(),
+                            table_info->schema_.GetColumn(columns.second).GetName()),
+                fmt::format("ndv={}", ndv));
+    }
+    std::unique_lock<std::shared_mutex> l(catalog_lock_);
+    table_info->stats_.Install(std::move(stats));
+  }
+  writer.EndTable();
+}
+
 void BustubInstance::WriteOneCell(const std::string &cell, ResultWriter &writer) {
   writer.BeginTable(true);
   writer.BeginRow();
@@ -167,7 +225,8 @@ of the query, so it's normal that you'll get a wrong result when executing
 unsupported SQL queries. This shell will be able to run `create table` only
 after you have completed the buffer pool manager. It will be able to execute SQL
 queries after you have implemented necessary query executors. Use `explain` to
-see the execution plan of your query.
+see the execution plan of your query, and `explain analyze` to run it and see
+the rows, time, page fetches and lock waits of every plan node.
 )";
   WriteOneCell(help, writer);
 }
@@ -232,15 +291,16 @@ auto BustubInstance::ExecuteSqlTxn(const std::string &sql, ResultWriter &writer,
             throw NotImplementedException("only support creating index on integer column");
           }
         }
-        if (col_ids.size() != 1) {
-          throw NotImplementedException("only support creating index with exactly one column");
+        if (col_ids.size() > MAX_INTEGER_KEY_COLUMNS) {
+          throw NotImplementedException(
+              fmt::format("only support creating index with at most {} columns", MAX_INTEGER_KEY_COLUMNS));
         }
         auto key_schema = Schema::CopySchema(&index_stmt.table_->schema_, col_ids);
 
         std::unique_lock<std::shared_mutex> l(catalog_lock_);
         auto info = catalog_->CreateIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>(
             txn, index_stmt.index_name_, index_stmt.table_->table_, index_stmt.table_->schema_, key_schema, col_ids,
-            INTEGER_SIZE, IntegerHashFunctionType{});
+            INTEGER_KEY_SIZE, IntegerHashFunctionType{});
         l.unlock();
 
         if (info == nullptr) {
@@ -249,6 +309,11 @@ auto BustubInstance::ExecuteSqlTxn(const std::string &sql, ResultWriter &writer,
         WriteOneCell(fmt::format("Index created with id = {}", info->index_oid_), writer);
         continue;
       }
+      case StatementType::ANALYZE_STATEMENT: {
+        const auto &analyze_stmt = dynamic_cast<const AnalyzeStatement &>(*statement);
+        ExecuteAnalyze(analyze_stmt, txn, writer);
+        continue;
+      }
       case StatementType::VARIABLE_SHOW_STATEMENT: {
         const auto &show_stmt = dynamic_cast<const VariableShowStatement &>(*statement);
         auto content = GetSessionVariable(show_stmt.variable_);
@@ -290,13 +355,51 @@ auto BustubInstance::ExecuteSqlTxn(const std::string &sql, ResultWriter &writer,
         // Print optimizer result.
         bustub::Optimizer optimizer(*catalog_, IsForceStarterRule());
         auto optimized_plan = optimizer.Optimize(planner.plan_);
+        // 估计值依赖表的统计信息，需要在持有 catalog 锁的时候计算
+        auto estimated_rows = optimizer.EstimatePlanRows(optimized_plan);
 
         l.unlock();
 
         if ((explain_stmt.options_ & ExplainOptions::OPTIMIZER) != 0) {
           output += "=== OPTIMIZER ===";
           output += "\n";
-          output += optimized_plan->ToString(show_schema);
+          output += optimized_plan->ToString([&](const AbstractPlanNode &plan) -> std::string {
+            auto annotation = fmt::format(" (est. rows={:.0f})", estimated_rows.at(&plan));
+            return show_schema ? fmt::format("{} | {}", annotation, plan.OutputSchema()) : annotation;
+          });
+          output += "\n";
+        }
+
+        // Run the optimized plan and print what every plan node did.
+        if ((explain_stmt.options_ & ExplainOptions::ANALYZE) != 0) {
+          auto exec_ctx = MakeExecutorContext(txn);
+          exec_ctx->EnableAnalyze();
+          std::vector<Tuple> result_set{};
+          is_successful &= execution_engine_->Execute(optimized_plan, &result_set, txn, exec_ctx.get());
+
+          output += "=== ANALYZE ===";
+          output += "\n";
+          output += optimized_plan->ToString([&](const AbstractPlanNode &plan) -> std::string {
+            const auto *stats = exec_ctx->FindExecutorStats(&plan);
+            if (stats == nullptr) {
+              return fmt::format(" (est. rows={:.0f}, never executed)", estimated_rows.at(&plan));
+            }
+            auto annotation = fmt::format(
+                " (est. rows={:.0f}, rows={}, loops={}, init={:.3f}ms, next={:.3f}ms, page fetches={}, page misses={}",
+                estimated_rows.at(&plan), stats->rows_, stats->loops_, stats->init_us_ / 1000.0,
+                stats->next_us_ / 1000.0, stats->page_fetches_, stats->page_misses_);
+            if (stats->lock_waits_ != 0) {
+              annotation +=
+                  fmt::format(", lock waits={} ({:.3f}ms)", stats->lock_waits_, stats->lock_wait_us_ / 1000.0);
+            }
+            if (stats->swaps_ != 0) {
+              annotation += fmt::format(", build/probe swaps={}", stats->swaps_);
+            }
+            return annotation + ")";
+          });
+          output += "\n";
+          output += fmt::format("peak memory={} bytes{}", exec_ctx->GetMemoryTracker()->GetPeakUsage(),
+                                is_successful ? "" : ", execution failed");
           output += "\n";
         }
 
@@ -392,6 +495,7 @@ BustubInstance::~BustubInstance() {
     log_manager_->StopFlushThread();
   }
   delete execution_engine_;
+  delete memory_tracker_;
   delete catalog_;
   delete checkpoint_manager_;
   delete log_manager_;
@@ -12,12 +12,103 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <chrono>  // NOLINT
+#include <iterator>
+
 #include "common/config.h"
 #include "concurrency/transaction.h"
 #include "concurrency/transaction_manager.h"
 
 namespace bustub {
 
+namespace {
+/**
+ * LockWaitTimer 记录一次加锁请求阻塞的时间，析构时如果确实等待过则计入事务的统计信息
+ */
+class LockWaitTimer {
+ public:
+  explicit LockWaitTimer(Transaction *txn) : txn_(txn), start_(std::chrono::steady_clock::now()) {}
+  ~LockWaitTimer() {
+    if (waited_) {
+      auto elapsed = std::chrono::steady_clock::now() - start_;
+      txn_->AddLockWait(std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count());
+    }
+  }
+  void Waited() { waited_ = true; }
+  auto HasWaited() const -> bool { return waited_; }
+  /** @return when a request under the TIMEOUT deadlock policy gives up */
+  auto Deadline() const -> std::chrono::steady_clock::time_point { return start_ + lock_wait_timeout; }
+
+ private:
+  Transaction *txn_;
+  std::chrono::steady_clock::time_point start_;
+  bool waited_{false};
+};
+
+/**
+ * 每个线程缓存一些用完的 LockRequest，加锁时从这里取，不用每次都 new。
+ * 请求从队列中删除之后才会放回来，这时已经没有别的线程能看到它了，所以不需要加锁
+ */
+class LockRequestCache {
+ public:
+  using LockRequest = LockManager::LockRequest;
+  using LockMode = LockManager::LockMode;
+
+  LockRequestCache() = default;
+  DISALLOW_COPY_AND_MOVE(LockRequestCache);
+  ~LockRequestCache() {
+    while (free_list_ != nullptr) {
+      auto *next = free_list_->next_;
+      delete free_list_;
+      free_list_ = next;
+    }
+  }
+
+  auto Acquire(txn_id_t txn_id, LockMode lock_mode, table_oid_t oid, RID rid = RID()) -> LockRequest * {
+    if (free_list_ == nullptr) {
+      return new LockRequest(txn_id, lock_mode, oid, rid);
+    }
+    auto *request = free_list_;
+    free_list_ = request->next_;
+    size_--;
+    request->txn_id_ = txn_id;
+    request->lock_mode_ = lock_mode;
+    request->oid_ = oid;
+    request->rid_ = rid;
+    request->granted_ = false;
+    request->next_ = nullptr;
+    return request;
+  }
+
+  void Release(LockRequest *request) {
+    if (size_ >= MAX_SIZE) {
+      delete request;
+      return;
+    }
+    request->next_ = free_list_;
+    free_list_ = request;
+    size_++;
+  }
+
+ private:
+  static constexpr size_t MAX_SIZE = 1024;
+  LockRequest *free_list_{nullptr};
+  size_t size_{0};
+};
+
+thread_local LockRequestCache lock_request_cache;
+
+/** @return the first request in the queue that is not granted yet */
+auto FirstWaiting(const std::shared_ptr<LockManager::LockRequestQueue> &lock_request_queue)
+    -> LockManager::LockRequestList::Iterator {
+  auto iter = lock_request_queue->request_queue_.begin();
+  while (iter != lock_request_queue->request_queue_.end() && (*iter)->granted_) {
+    ++iter;
+  }
+  return iter;
+}
+}  // namespace
+
 /**
  * 这个状态转移矩阵没有给出在commit，abort状态下的数据，存在一些bug
  * 暂时先不用
@@ -59,12 +150,12 @@ static int lock_compatible_matrix[][5] = {
     {0, 0, 1, 0, 0},  // SIX
 };
 
-static int unlock_change_state_matrix[][3] = {
-    {0, 1, 0},  // S
-    {1, 1, 1},  // X
-    {0, 0, 0},  // IS
-    {0, 0, 0},  // IX
-    {0, 0, 0},  // SIX
+static int unlock_change_state_matrix[][5] = {
+    {0, 1, 0, 1, 1},  // S
+    {1, 1, 1, 1, 1},  // X
+    {0, 0, 0, 0, 0},  // IS
+    {0, 0, 0, 0, 0},  // IX
+    {0, 0, 0, 0, 0},  // SIX
 };
 
 static inline void TransctionThrowAbort(Transaction *txn, AbortReason reason) {
@@ -99,8 +190,10 @@ auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oi
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
     }
   }
-  // 可重复读
-  if (txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ) {
+  // 可重复读，快照隔离和乐观并发控制只有写操作加锁，也要持有到提交
+  if (txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ ||
+      txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT_ISOLATION ||
+      txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC) {
     if (txn->GetState() == TransactionState::SHRINKING) {
       txn->SetState(TransactionState::ABORTED);
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
@@ -119,7 +212,7 @@ auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oi
    * 如果以前这个事务已经给这个表加过锁，
    * 那么尝试对锁进行升级
    */
-  for (auto request : lock_request_queue->request_queue_) {  // NOLINT
+  for (auto *request : lock_request_queue->request_queue_) {
     if (request->txn_id_ == txn->GetTransactionId()) {
       /**
        * 当前事务尝试上的锁与之前上的锁相同，直接返回即可
@@ -151,80 +244,97 @@ auto LockManager::LockTable(Transaction *txn, LockMode lock_mode, const table_oi
         TransctionThrowAbort(txn, AbortReason::INCOMPATIBLE_UPGRADE);
       }
 
-      lock_request_queue->request_queue_.remove(request);
+      lock_request_queue->request_queue_.Remove(request);
       InsertOrDeleteTableLockSet(txn, request, false);
-      auto upgrade_lock_request = std::make_shared<LockRequest>(txn->GetTransactionId(), lock_mode, oid);
+      lock_request_cache.Release(request);
+      auto *upgrade_lock_request = lock_request_cache.Acquire(txn->GetTransactionId(), lock_mode, oid);
 
       // 找到第一个未加锁的位置，将当前请求插入进去，因为当前锁升级的优先级最高
-      std::list<std::shared_ptr<LockRequest>>::iterator lr_iter;
-      for (lr_iter = lock_request_queue->request_queue_.begin(); lr_iter != lock_request_queue->request_queue_.end();
-           lr_iter++) {
-        if (!(*lr_iter)->granted_) {
-          break;
-        }
-      }
-      lock_request_queue->request_queue_.insert(lr_iter, upgrade_lock_request);
+      lock_request_queue->request_queue_.Insert(FirstWaiting(lock_request_queue), upgrade_lock_request);
       lock_request_queue->upgrading_ = txn->GetTransactionId();
       /**
        * 这里使用条件变量的编程模型来判断当前的锁是否授予成功
        * 如果没有授予成功的话则一直等待
        */
       std::unique_lock<std::mutex> lock(lock_request_queue->latch_, std::adopt_lock);
+      LockWaitTimer wait_timer(txn);
       while (!GrantLock(upgrade_lock_request, lock_request_queue)) {
-        lock_request_queue->cv_.wait(lock);
+        if (!wait_timer.HasWaited()) {
+          // 开始等待，把等待关系加入等待图
+          UpdateWaitsFor(lock_request_queue);
+        }
+        wait_timer.Waited();
+        WaitForGrant(txn, upgrade_lock_request, lock_request_queue, &lock, wait_timer.Deadline());
         // 唤醒之后发现当前事务被abort了，那么应当删除该事务的request
         if (txn->GetState() == TransactionState::ABORTED) {
           lock_request_queue->upgrading_ = INVALID_TXN_ID;
-          lock_request_queue->request_queue_.remove(upgrade_lock_request);
-          lock_request_queue->cv_.notify_all();
+          lock_request_queue->request_queue_.Remove(upgrade_lock_request);
+          lock_request_cache.Release(upgrade_lock_request);
+          RemoveWaiter(txn->GetTransactionId());
+          UpdateWaitsFor(lock_request_queue);
+          NotifyGrantable(lock_request_queue);
           return false;
         }
       }
 
+      if (wait_timer.HasWaited()) {
+        UpdateWaitsFor(lock_request_queue);
+      }
       lock_request_queue->upgrading_ = INVALID_TXN_ID;
       upgrade_lock_request->granted_ = true;
       InsertOrDeleteTableLockSet(txn, upgrade_lock_request, true);
       /**
-       * 如果当前加的锁不是排它锁，那么可以通知其他线程来加锁了
-       * 因为排它锁不和任何锁兼容，索引没必要通知
+       * 如果当前加的锁不是排它锁，那么后面的请求可能也可以授予了，唤醒下一个请求
+       * 因为排它锁不和任何锁兼容，所以没必要通知
        */
       if (lock_mode != LockMode::EXCLUSIVE) {
-        lock_request_queue->cv_.notify_all();
+        NotifyGrantable(lock_request_queue);
       }
       return true;
     }
   }
 
   // 如果当前事务之前没有申请过锁，那么直接添加到队列末尾，等待授权
-  auto lock_request = std::make_shared<LockRequest>(txn->GetTransactionId(), lock_mode, oid);
-  lock_request_queue->request_queue_.push_back(lock_request);
+  auto *lock_request = lock_request_cache.Acquire(txn->GetTransactionId(), lock_mode, oid);
+  lock_request_queue->request_queue_.PushBack(lock_request);
 
   std::unique_lock<std::mutex> lock(lock_request_queue->latch_, std::adopt_lock);
+  LockWaitTimer wait_timer(txn);
   while (!GrantLock(lock_request, lock_request_queue)) {
-    lock_request_queue->cv_.wait(lock);
+    if (!wait_timer.HasWaited()) {
+      UpdateWaitsFor(lock_request_queue);
+    }
+    wait_timer.Waited();
+    WaitForGrant(txn, lock_request, lock_request_queue, &lock, wait_timer.Deadline());
     /**
-     * 这里检测事务是否abort是因为后台死锁检测线程
+     * 这里检测事务是否abort是因为后台死锁检测线程或者死锁预防策略
      * 可能会因为这个事务死锁将其abort了
      * 因此我们要在他abort之后去唤醒等待他的事务
      */
     if (txn->GetState() == TransactionState::ABORTED) {
-      lock_request_queue->request_queue_.remove(lock_request);
-      lock_request_queue->cv_.notify_all();
+      lock_request_queue->request_queue_.Remove(lock_request);
+      lock_request_cache.Release(lock_request);
+      RemoveWaiter(txn->GetTransactionId());
+      UpdateWaitsFor(lock_request_queue);
+      NotifyGrantable(lock_request_queue);
       return false;
     }
   }
 
   lock_request->granted_ = true;
+  if (wait_timer.HasWaited()) {
+    UpdateWaitsFor(lock_request_queue);
+  }
   InsertOrDeleteTableLockSet(txn, lock_request, true);
 
   if (lock_mode != LockMode::EXCLUSIVE) {
-    lock_request_queue->cv_.notify_all();
+    NotifyGrantable(lock_request_queue);
   }
   return true;
 }
 
-auto LockManager::GrantLock(const std::shared_ptr<LockRequest> &lock_request,
-                            const std::shared_ptr<LockRequestQueue> &lock_request_queue) -> bool {
+auto LockManager::GrantLock(LockRequest *lock_request, const std::shared_ptr<LockRequestQueue> &lock_request_queue)
+    -> bool {
   // 授予锁的条件
   // 1. 前面事务都加锁
   // 2. 前面事务都兼容
@@ -234,13 +344,13 @@ auto LockManager::GrantLock(const std::shared_ptr<LockRequest> &lock_request,
    * 根据设计，前面没有授权的锁拥有优先授权权，因此这里当找到一个
    * 没有授权的请求时，如果发现不是自己，那么应该立即返回false
    */
-  for (auto &lr : lock_request_queue->request_queue_) {
+  for (auto *lr : lock_request_queue->request_queue_) {
     if (lr->granted_) {
       if (!static_cast<bool>(
               lock_compatible_matrix[static_cast<int>(lr->lock_mode_)][static_cast<int>(lock_request->lock_mode_)])) {
         return false;
       }
-    } else if (lock_request.get() != lr.get()) {
+    } else if (lock_request != lr) {
       return false;
     } else {
       return true;
@@ -249,8 +359,7 @@ auto LockManager::GrantLock(const std::shared_ptr<LockRequest> &lock_request,
   return false;
 }
 
-void LockManager::InsertOrDeleteTableLockSet(Transaction *txn, const std::shared_ptr<LockRequest> &lock_request,
-                                             bool insert) {
+void LockManager::InsertOrDeleteTableLockSet(Transaction *txn, LockRequest *lock_request, bool insert) {
   // TODO(yao): 这个要我们自己实现吗？这个函数的目的和作用是什么？插入或者删除表锁集合！
   // 从哪儿删和从哪儿插？从事务本身的集合中。
   // 要根据锁模式做区分...
@@ -294,11 +403,14 @@ auto LockManager::UnlockTable(Transaction *txn, const table_oid_t &oid) -> bool
   lock_request_queue->latch_.lock();
   table_lock_map_latch_.unlock();
 
-  for (auto request : lock_request_queue->request_queue_) {  // NOLINT
+  for (auto *request : lock_request_queue->request_queue_) {
     if (request->txn_id_ == txn->GetTransactionId() && request->granted_) {
-      // 将请求从请求队列中移除，并唤醒其他被阻塞的线程
-      lock_request_queue->request_queue_.remove(request);
-      lock_request_queue->cv_.notify_all();
+      // 将请求从请求队列中移除，并唤醒可以授予的请求，等待它的事务不再等它
+      lock_request_queue->request_queue_.Remove(request);
+      if (HasWaiters(lock_request_queue)) {
+        UpdateWaitsFor(lock_request_queue);
+        NotifyGrantable(lock_request_queue);
+      }
       lock_request_queue->latch_.unlock();
 
       /**
@@ -308,14 +420,13 @@ auto LockManager::UnlockTable(Transaction *txn, const table_oid_t &oid) -> bool
        * */
       if (static_cast<bool>(unlock_change_state_matrix[static_cast<int>(request->lock_mode_)]
                                                       [static_cast<int>(txn->GetIsolationLevel())])) {
-        // 如果事务状态不为COMMITTED和ABORTED，则修改为SHRINKING收缩
-        if (txn->GetState() != TransactionState::COMMITTED && txn->GetState() != TransactionState::ABORTED) {
-          txn->SetState(TransactionState::SHRINKING);
-          // 把锁状态设置为shrinking
-        }
+        // 如果事务状态不为COMMITTED和ABORTED，则修改为SHRINKING收缩。别的事务可能同时 wound 它，用一次 CAS 完成
+        txn->TryShrink();
       }
       // 解锁成功，返回true，并且更新事务的lockset
       InsertOrDeleteTableLockSet(txn, request, false);
+      lock_request_cache.Release(request);
+      txn->SetTableLockEscalated(oid, false);
       return true;
     }
   }
@@ -357,8 +468,10 @@ auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
     }
   }
-  // 可重复读 shrinking阶段不能加任何锁
-  if (txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ) {
+  // 可重复读、快照隔离和乐观并发控制 shrinking阶段不能加任何锁
+  if (txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ ||
+      txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT_ISOLATION ||
+      txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC) {
     if (txn->GetState() == TransactionState::SHRINKING) {
       txn->SetState(TransactionState::ABORTED);
       throw TransactionAbortException(txn->GetTransactionId(), AbortReason::LOCK_ON_SHRINKING);
@@ -397,17 +510,31 @@ auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_
     }
   }
 
-  // 前置判断条件都符合了，可以尝试给行加锁了
-  row_lock_map_latch_.lock();
-  if (row_lock_map_.count(rid) == 0) {
-    row_lock_map_.emplace(rid, std::make_shared<LockRequestQueue>());
+  // 4. 行锁已经升级成了表锁，并且表锁覆盖了这一行，不需要单独的行锁
+  if (txn->IsTableLockEscalated(oid) && IsRowCoveredByTableLock(txn, lock_mode, oid)) {
+    return true;
+  }
+
+  // 5. 事务在这张表上持有的行锁太多时，尝试把它们升级成一个表锁。读已提交的 S 行锁读完就释放，不需要升级
+  if (txn->GetIsolationLevel() != IsolationLevel::READ_COMMITTED &&
+      CountRowLocks(txn, oid) >= static_cast<size_t>(LOCK_ESCALATION_THRESHOLD) &&
+      EscalateRowLocks(txn, lock_mode, oid)) {
+    return true;
+  }
+
+  // 前置判断条件都符合了，可以尝试给行加锁了，只需要锁住这一行所在的分区
+  auto &shard = GetRowLockShard(rid);
+  shard.latch_.lock();
+  auto &slot = shard.row_lock_map_[rid];
+  if (slot == nullptr) {
+    slot = std::make_shared<LockRequestQueue>();
   }
-  auto lock_request_queue = row_lock_map_[rid];
+  auto lock_request_queue = slot;
   lock_request_queue->latch_.lock();
-  row_lock_map_latch_.unlock();
+  shard.latch_.unlock();
 
   bool is_upgrade = false;
-  for (auto request : lock_request_queue->request_queue_) {  // NOLINT
+  for (auto *request : lock_request_queue->request_queue_) {
     if (request->txn_id_ == txn->GetTransactionId()) {
       if (request->lock_mode_ == lock_mode) {
         lock_request_queue->latch_.unlock();
@@ -425,36 +552,44 @@ auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_
         TransctionThrowAbort(txn, AbortReason::INCOMPATIBLE_UPGRADE);
       }
       // 如果是锁升级，则把原来的事务请求先删了，
-      lock_request_queue->request_queue_.remove(request);
+      lock_request_queue->request_queue_.Remove(request);
       InsertOrDeleteRowLockSet(txn, request, false);
+      lock_request_cache.Release(request);
       // 创建一个锁升级请求
       is_upgrade = true;
       break;
     }
   }
   // 如果lock table中没有有重复的txn_id
-  auto lock_request = std::make_shared<LockRequest>(txn->GetTransactionId(), lock_mode, oid, rid);
+  auto *lock_request = lock_request_cache.Acquire(txn->GetTransactionId(), lock_mode, oid, rid);
   if (is_upgrade) {
-    std::list<std::shared_ptr<LockRequest>>::iterator lr_iter;
-    for (lr_iter = lock_request_queue->request_queue_.begin(); lr_iter != lock_request_queue->request_queue_.end();
-         lr_iter++) {
-      if (!(*lr_iter)->granted_) {
-        break;  // 找到第一个没授权的事务
-      }
-    }
     // 插入第一个没授权的事务之前，表示正在锁升级
-    lock_request_queue->request_queue_.insert(lr_iter, lock_request);
+    lock_request_queue->request_queue_.Insert(FirstWaiting(lock_request_queue), lock_request);
     lock_request_queue->upgrading_ = txn->GetTransactionId();
   } else {
-    lock_request_queue->request_queue_.push_back(lock_request);
+    lock_request_queue->request_queue_.PushBack(lock_request);
   }
 
   std::unique_lock<std::mutex> lock(lock_request_queue->latch_, std::adopt_lock);
+  LockWaitTimer wait_timer(txn);
   while (!GrantLock(lock_request, lock_request_queue)) {
-    lock_request_queue->cv_.wait(lock);
+    if (!wait_timer.HasWaited()) {
+      UpdateWaitsFor(lock_request_queue);
+    }
+    wait_timer.Waited();
+    WaitForGrant(txn, lock_request, lock_request_queue, &lock, wait_timer.Deadline());
     if (txn->GetState() == TransactionState::ABORTED) {
-      lock_request_queue->request_queue_.remove(lock_request);
-      lock_request_queue->cv_.notify_all();
+      if (is_upgrade) {
+        lock_request_queue->upgrading_ = INVALID_TXN_ID;
+      }
+      lock_request_queue->request_queue_.Remove(lock_request);
+      lock_request_cache.Release(lock_request);
+      RemoveWaiter(txn->GetTransactionId());
+      UpdateWaitsFor(lock_request_queue);
+      NotifyGrantable(lock_request_queue);
+      lock.unlock();
+      // 被abort的请求可能是队列里的最后一个请求
+      ReclaimRowLockQueue(rid, lock_request_queue);
       return false;
     }
   }
@@ -463,54 +598,290 @@ auto LockManager::LockRow(Transaction *txn, LockMode lock_mode, const table_oid_
     lock_request_queue->upgrading_ = INVALID_TXN_ID;
   }
   lock_request->granted_ = true;
+  if (wait_timer.HasWaited()) {
+    UpdateWaitsFor(lock_request_queue);
+  }
   InsertOrDeleteRowLockSet(txn, lock_request, true);
 
   if (lock_mode != LockMode::EXCLUSIVE) {
-    lock_request_queue->cv_.notify_all();
+    NotifyGrantable(lock_request_queue);
   }
 
   return true;
 }
 
 auto LockManager::UnlockRow(Transaction *txn, const table_oid_t &oid, const RID &rid) -> bool {
-  row_lock_map_latch_.lock();
-
-  if (row_lock_map_.count(rid) == 0) {
-    row_lock_map_latch_.unlock();
+  auto mode = ReleaseRowLock(txn, rid);
+  if (!mode.has_value()) {
+    // 锁升级之后被表锁覆盖的行没有单独的行锁
+    if (txn->IsTableLockEscalated(oid)) {
+      return true;
+    }
     TransctionThrowAbort(txn, AbortReason::ATTEMPTED_UNLOCK_BUT_NO_LOCK_HELD);
   }
 
-  auto lock_request_queue = row_lock_map_[rid];
-  lock_request_queue->latch_.lock();
-  row_lock_map_latch_.unlock();
+  if (static_cast<bool>(unlock_change_state_matrix[static_cast<int>(*mode)]
+                                                  [static_cast<int>(txn->GetIsolationLevel())])) {
+    // 如果事务状态不为COMMITTED和ABORTED，则修改为SHRINKING收缩。别的事务可能同时 wound 它，用一次 CAS 完成
+    txn->TryShrink();
+  }
+  return true;
+}
+
+auto LockManager::ReleaseRowLock(Transaction *txn, const RID &rid) -> std::optional<LockMode> {
+  auto &shard = GetRowLockShard(rid);
+  std::scoped_lock shard_lock(shard.latch_);
+
+  auto queue_iter = shard.row_lock_map_.find(rid);
+  if (queue_iter == shard.row_lock_map_.end()) {
+    return std::nullopt;
+  }
+
+  /**
+   * 解锁时一直持有分区的锁，这样队列空了之后可以直接从分区中删除:
+   * 其他事务只能在持有分区锁的时候拿到队列，拿到之后在释放分区锁之前就会锁住队列并加入请求，
+   * 所以持有分区锁时看到空队列，说明没有别的事务还会使用它
+   */
+  auto lock_request_queue = queue_iter->second;
+  std::unique_lock<std::mutex> queue_lock(lock_request_queue->latch_);
 
-  for (auto request : lock_request_queue->request_queue_) {  // NOLINT
+  for (auto *request : lock_request_queue->request_queue_) {
     if (request->txn_id_ == txn->GetTransactionId() && request->granted_) {
-      lock_request_queue->request_queue_.remove(request);
-      lock_request_queue->cv_.notify_all();
-      lock_request_queue->latch_.unlock();
+      lock_request_queue->request_queue_.Remove(request);
+      if (HasWaiters(lock_request_queue)) {
+        UpdateWaitsFor(lock_request_queue);
+        NotifyGrantable(lock_request_queue);
+      }
+      bool reclaim = lock_request_queue->request_queue_.Empty();
+      queue_lock.unlock();
+      if (reclaim) {
+        shard.row_lock_map_.erase(queue_iter);
+      }
+      auto mode = request->lock_mode_;
+      InsertOrDeleteRowLockSet(txn, request, false);
+      lock_request_cache.Release(request);
+      return mode;
+    }
+  }
+  return std::nullopt;
+}
 
-      if (static_cast<bool>(unlock_change_state_matrix[static_cast<int>(request->lock_mode_)]
-                                                      [static_cast<int>(txn->GetIsolationLevel())])) {
-        // 如果事务状态不为COMMITTED和ABORTED，则修改为SHRINKING收缩
-        if (txn->GetState() != TransactionState::COMMITTED && txn->GetState() != TransactionState::ABORTED) {
-          txn->SetState(TransactionState::SHRINKING);
-          // 把锁状态设置为shrinking
-        }
+auto LockManager::CountRowLocks(Transaction *txn, const table_oid_t &oid) -> size_t {
+  size_t count = 0;
+  for (const auto &row_lock_set : {txn->GetSharedRowLockSet(), txn->GetExclusiveRowLockSet()}) {
+    if (auto iter = row_lock_set->find(oid); iter != row_lock_set->end()) {
+      count += iter->second.size();
+    }
+  }
+  return count;
+}
+
+auto LockManager::IsRowCoveredByTableLock(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool {
+  if (txn->IsTableExclusiveLocked(oid)) {
+    return true;
+  }
+  return lock_mode == LockMode::SHARED &&
+         (txn->IsTableSharedLocked(oid) || txn->IsTableSharedIntentionExclusiveLocked(oid));
+}
+
+auto LockManager::EscalateRowLocks(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool {
+  // 持有 IX 的事务读多了升级为 SIX，保留写过的行的 X 锁；写多了升级为 X
+  LockMode table_lock_mode = LockMode::SHARED;
+  if (lock_mode == LockMode::EXCLUSIVE) {
+    table_lock_mode = LockMode::EXCLUSIVE;
+  } else if (txn->IsTableIntentionExclusiveLocked(oid)) {
+    table_lock_mode = LockMode::SHARED_INTENTION_EXCLUSIVE;
+  }
+  if (!TryUpgradeTableLock(txn, table_lock_mode, oid)) {
+    return false;
+  }
+  txn->SetTableLockEscalated(oid, true);
+
+  // 释放被表锁覆盖的行锁，这不是 2PL 的收缩阶段，事务状态不变
+  std::vector<std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>>> row_lock_sets{
+      txn->GetSharedRowLockSet()};
+  if (table_lock_mode == LockMode::EXCLUSIVE) {
+    row_lock_sets.push_back(txn->GetExclusiveRowLockSet());
+  }
+  for (const auto &row_lock_set : row_lock_sets) {
+    auto iter = row_lock_set->find(oid);
+    if (iter == row_lock_set->end()) {
+      continue;
+    }
+    auto rids = iter->second;
+    for (const auto &rid : rids) {
+      ReleaseRowLock(txn, rid);
+    }
+  }
+  return true;
+}
+
+auto LockManager::TryUpgradeTableLock(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool {
+  std::shared_ptr<LockRequestQueue> lock_request_queue;
+  {
+    std::scoped_lock map_lock(table_lock_map_latch_);
+    auto iter = table_lock_map_.find(oid);
+    if (iter == table_lock_map_.end()) {
+      return false;
+    }
+    lock_request_queue = iter->second;
+  }
+
+  // 只在不需要等待的时候升级，锁升级本身不会让事务阻塞或者被 abort
+  std::scoped_lock queue_lock(lock_request_queue->latch_);
+  if (lock_request_queue->upgrading_ != INVALID_TXN_ID) {
+    return false;
+  }
+  LockRequest *held = nullptr;
+  for (auto *request : lock_request_queue->request_queue_) {
+    if (request->txn_id_ == txn->GetTransactionId()) {
+      held = request;
+    } else if (request->granted_ && !static_cast<bool>(lock_compatible_matrix[static_cast<int>(request->lock_mode_)]
+                                                                             [static_cast<int>(lock_mode)])) {
+      return false;
+    }
+  }
+  if (held == nullptr || !held->granted_ ||
+      !static_cast<bool>(lock_update_state_martrix[static_cast<int>(held->lock_mode_)][static_cast<int>(lock_mode)])) {
+    return false;
+  }
+  // 原地修改已授予的请求，排在后面的请求和等待图都不受影响
+  InsertOrDeleteTableLockSet(txn, held, false);
+  held->lock_mode_ = lock_mode;
+  InsertOrDeleteTableLockSet(txn, held, true);
+  return true;
+}
+
+auto LockManager::LockKeyRange(Transaction *txn, LockMode lock_mode, const index_oid_t &index_oid, const RID &rid)
+    -> bool {
+  BUSTUB_ASSERT(lock_mode == LockMode::SHARED || lock_mode == LockMode::INTENTION_EXCLUSIVE ||
+                    lock_mode == LockMode::EXCLUSIVE,
+                "key range locks are S, IX or X");
+  // 键区间锁一直持有到事务结束，shrinking 阶段不能再加
+  if (txn->GetState() == TransactionState::SHRINKING) {
+    TransctionThrowAbort(txn, AbortReason::LOCK_ON_SHRINKING);
+  }
+
+  key_range_lock_map_latch_.lock();
+  auto &slot = key_range_lock_map_[index_oid][rid];
+  if (slot == nullptr) {
+    slot = std::make_shared<LockRequestQueue>();
+  }
+  auto lock_request_queue = slot;
+  lock_request_queue->latch_.lock();
+  key_range_lock_map_latch_.unlock();
+
+  bool is_upgrade = false;
+  for (auto *request : lock_request_queue->request_queue_) {
+    if (request->txn_id_ == txn->GetTransactionId()) {
+      // 已经持有的锁覆盖了请求的模式，否则升级成两者的组合，比如扫描过的间隙再插入时 S + IX = SIX
+      auto combined = CombineKeyRangeLockMode(request->lock_mode_, lock_mode);
+      if (combined == request->lock_mode_) {
+        lock_request_queue->latch_.unlock();
+        return true;
       }
+      if (lock_request_queue->upgrading_ != INVALID_TXN_ID) {
+        lock_request_queue->latch_.unlock();
+        TransctionThrowAbort(txn, AbortReason::UPGRADE_CONFLICT);
+      }
+      lock_mode = combined;
+      lock_request_queue->request_queue_.Remove(request);
+      (*txn->GetKeyRangeLockSet())[index_oid].erase(rid);
+      lock_request_cache.Release(request);
+      is_upgrade = true;
+      break;
+    }
+  }
+  auto *lock_request = lock_request_cache.Acquire(txn->GetTransactionId(), lock_mode, index_oid, rid);
+  if (is_upgrade) {
+    lock_request_queue->request_queue_.Insert(FirstWaiting(lock_request_queue), lock_request);
+    lock_request_queue->upgrading_ = txn->GetTransactionId();
+  } else {
+    lock_request_queue->request_queue_.PushBack(lock_request);
+  }
 
-      InsertOrDeleteRowLockSet(txn, request, false);
-      return true;
+  std::unique_lock<std::mutex> lock(lock_request_queue->latch_, std::adopt_lock);
+  LockWaitTimer wait_timer(txn);
+  while (!GrantLock(lock_request, lock_request_queue)) {
+    if (!wait_timer.HasWaited()) {
+      UpdateWaitsFor(lock_request_queue);
+    }
+    wait_timer.Waited();
+    WaitForGrant(txn, lock_request, lock_request_queue, &lock, wait_timer.Deadline());
+    if (txn->GetState() == TransactionState::ABORTED) {
+      if (is_upgrade) {
+        lock_request_queue->upgrading_ = INVALID_TXN_ID;
+      }
+      lock_request_queue->request_queue_.Remove(lock_request);
+      lock_request_cache.Release(lock_request);
+      RemoveWaiter(txn->GetTransactionId());
+      UpdateWaitsFor(lock_request_queue);
+      NotifyGrantable(lock_request_queue);
+      lock.unlock();
+      ReclaimKeyRangeLockQueue(index_oid, rid, lock_request_queue);
+      return false;
     }
   }
 
-  lock_request_queue->latch_.unlock();
+  if (is_upgrade) {
+    lock_request_queue->upgrading_ = INVALID_TXN_ID;
+  }
+  lock_request->granted_ = true;
+  if (wait_timer.HasWaited()) {
+    UpdateWaitsFor(lock_request_queue);
+  }
+  (*txn->GetKeyRangeLockSet())[index_oid].insert(rid);
+
+  if (lock_mode != LockMode::EXCLUSIVE) {
+    NotifyGrantable(lock_request_queue);
+  }
+  return true;
+}
+
+auto LockManager::UnlockKeyRange(Transaction *txn, const index_oid_t &index_oid, const RID &rid) -> bool {
+  std::scoped_lock map_lock(key_range_lock_map_latch_);
+  auto index_iter = key_range_lock_map_.find(index_oid);
+  if (index_iter != key_range_lock_map_.end()) {
+    auto queue_iter = index_iter->second.find(rid);
+    if (queue_iter != index_iter->second.end()) {
+      // 和行锁一样，持有锁表的锁时看到空队列就可以直接删除
+      auto lock_request_queue = queue_iter->second;
+      std::unique_lock<std::mutex> queue_lock(lock_request_queue->latch_);
+      for (auto *request : lock_request_queue->request_queue_) {
+        if (request->txn_id_ == txn->GetTransactionId() && request->granted_) {
+          lock_request_queue->request_queue_.Remove(request);
+          if (HasWaiters(lock_request_queue)) {
+            UpdateWaitsFor(lock_request_queue);
+            NotifyGrantable(lock_request_queue);
+          }
+          bool reclaim = lock_request_queue->request_queue_.Empty();
+          queue_lock.unlock();
+          if (reclaim) {
+            index_iter->second.erase(queue_iter);
+          }
+          (*txn->GetKeyRangeLockSet())[index_oid].erase(rid);
+          lock_request_cache.Release(request);
+          return true;
+        }
+      }
+    }
+  }
   TransctionThrowAbort(txn, AbortReason::ATTEMPTED_UNLOCK_BUT_NO_LOCK_HELD);
   return false;
 }
 
-void LockManager::InsertOrDeleteRowLockSet(Transaction *txn, const std::shared_ptr<LockRequest> &lock_request,
-                                           bool insert) {
+auto LockManager::CombineKeyRangeLockMode(LockMode held, LockMode requested) -> LockMode {
+  if (held == requested || held == LockMode::EXCLUSIVE) {
+    return held;
+  }
+  if (requested == LockMode::EXCLUSIVE) {
+    return requested;
+  }
+  // S 和 IX 的组合，或者其中一个已经是 SIX
+  return LockMode::SHARED_INTENTION_EXCLUSIVE;
+}
+
+void LockManager::InsertOrDeleteRowLockSet(Transaction *txn, LockRequest *lock_request, bool insert) {
   auto s_row_lock_set = txn->GetSharedRowLockSet();
   auto x_row_lock_set = txn->GetExclusiveRowLockSet();
   // std::vector<std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>>> row_lock_set = {
@@ -545,68 +916,75 @@ void LockManager::InsertOrDeleteRowLockSet(Transaction *txn, const std::shared_p
 }
 
 void LockManager::AddEdge(txn_id_t t1, txn_id_t t2) {
-  txn_set_.insert(t1);
-  txn_set_.insert(t2);
-  waits_for_[t1].push_back(t2);
+  std::scoped_lock lock(waits_for_latch_);
+  auto &edges = waits_for_[t1];
+  auto iter = std::lower_bound(edges.begin(), edges.end(), t2);
+  if (iter == edges.end() || *iter != t2) {
+    edges.insert(iter, t2);
+  }
 }
 
 void LockManager::RemoveEdge(txn_id_t t1, txn_id_t t2) {
-  auto iter = std::find(waits_for_[t1].begin(), waits_for_[t1].end(), t2);
-  if (iter != waits_for_[t1].end()) {
-    waits_for_[t1].erase(iter);
+  std::scoped_lock lock(waits_for_latch_);
+  auto edges = waits_for_.find(t1);
+  if (edges == waits_for_.end()) {
+    return;
+  }
+  auto iter = std::find(edges->second.begin(), edges->second.end(), t2);
+  if (iter != edges->second.end()) {
+    edges->second.erase(iter);
+  }
+  if (edges->second.empty()) {
+    waits_for_.erase(edges);
   }
 }
 
 auto LockManager::HasCycle(txn_id_t *txn_id) -> bool {
-  for (auto start_txn_id : txn_set_) {
-    if (Dfs(start_txn_id)) {
-      // 这里要设初值，不然可能会出错
-      *txn_id = *active_set_.begin();
-      auto &res = *txn_id;
-      for (auto active_txn_id : active_set_) {
-        // 每次检测到死锁时，返回环上一个最新的事务id进行abort
-        res = std::max(res, active_txn_id);
-      }
-      active_set_.clear();
+  std::scoped_lock lock(waits_for_latch_);
+  std::vector<txn_id_t> starts;
+  starts.reserve(waits_for_.size());
+  for (const auto &[from, _] : waits_for_) {
+    starts.push_back(from);
+  }
+  // 按照事务id从小到大搜索，结果是确定的
+  std::sort(starts.begin(), starts.end());
+  return std::any_of(starts.begin(), starts.end(), [&](txn_id_t start) { return FindCycle(start, txn_id); });
+}
+
+auto LockManager::FindCycle(txn_id_t start, txn_id_t *txn_id) -> bool {
+  std::vector<txn_id_t> path;
+  std::unordered_set<txn_id_t> visited;
+  return Dfs(start, &path, &visited, txn_id);
+}
+
+auto LockManager::Dfs(txn_id_t txn, std::vector<txn_id_t> *path, std::unordered_set<txn_id_t> *visited,
+                      txn_id_t *txn_id) -> bool {
+  // 回到了当前路径上的事务，路径上从它开始的部分就是环，返回环上最新的事务
+  if (auto iter = std::find(path->begin(), path->end(), txn); iter != path->end()) {
+    *txn_id = *std::max_element(iter, path->end());
+    return true;
+  }
+  // 已经搜索过的事务不在任何环上
+  if (!visited->insert(txn).second) {
+    return false;
+  }
+  auto edges = waits_for_.find(txn);
+  if (edges == waits_for_.end()) {
+    return false;
+  }
+  path->push_back(txn);
+  // 出边是有序的，搜索的顺序是确定的
+  for (auto next : edges->second) {
+    if (Dfs(next, path, visited, txn_id)) {
       return true;
     }
   }
-  active_set_.clear();
+  path->pop_back();
   return false;
 }
 
-// auto LockManager::Dfs(txn_id_t start_id) -> bool {
-//   // 记忆化搜索，将已经确定不在环上的事务记录下来
-//   if (safe_set_.count(start_id)) {
-//     return false;
-//   }
-
-//   if (waits_for_.count(start_id) == 0) {
-//     safe_set_.insert(start_id);
-//     return false;
-//   }
-
-//   active_set_.insert(start_id);
-//   std::vector<txn_id_t> &next_node_set = waits_for_[start_id];
-//   // 按照文档要求，DFS判环算法需要具有稳定性，因此需要对出边节点进行排序
-//   std::sort(next_node_set.begin(), next_node_set.end());
-//   for (auto next_node : next_node_set) {
-//     // 当前节点在活跃节点集合出现过，说明出现了环
-//     if (active_set_.count(next_node)) {
-//       return true;
-//     }
-
-//     if (Dfs(next_node)) {
-//       return true;
-//     }
-//   }
-
-//   active_set_.erase(start_id);
-//   safe_set_.insert(start_id);
-//   return false;
-// }
-
 auto LockManager::GetEdgeList() -> std::vector<std::pair<txn_id_t, txn_id_t>> {
+  std::scoped_lock lock(waits_for_latch_);
   std::vector<std::pair<txn_id_t, txn_id_t>> edges(0);
   for (auto &[from, tos] : waits_for_) {
     for (auto to : tos) {
@@ -616,94 +994,216 @@ auto LockManager::GetEdgeList() -> std::vector<std::pair<txn_id_t, txn_id_t>> {
   return edges;
 }
 
-void LockManager::RunCycleDetection() {
-  // 判环检测代码比较多
-  while (enable_cycle_detection_) {
-    std::this_thread::sleep_for(cycle_detection_interval);
-    /* TODO(yao)：为什么要睡眠一段时间呢？*/
-    {
-      table_lock_map_latch_.lock();
-      row_lock_map_latch_.lock();
-      /*行和表都要加锁*/
-
-      for (auto &[oid, request_queue] : table_lock_map_) {
-        /*注意：这个无序集合，是局部变量，每次处理一个数据项*/
-        std::vector<txn_id_t> granted_set;
-        request_queue->latch_.lock();                              // 请求队列先加锁
-        for (auto lock_request : request_queue->request_queue_) {  // NOLINT
-          if (lock_request->granted_) {                            // 如果这个事务被授权了
-            granted_set.push_back(lock_request->txn_id_);          // 加入授权集合中
-          } else {
-            // 请求的事务id---> 当前事务id
-            /*TODO(yao)：为什么要把当前的事务ID，和表的关系建立起来呢？*/
-            map_txn_oid_.emplace(lock_request->txn_id_, lock_request->oid_);
-            for (auto txn_id : granted_set) {  // 如果是没授权的事务，那么遍历已经授权的事务，
-              // lock_request---> 表id
-
-              // 有向图，箭头指向依赖方？
-              AddEdge(lock_request->txn_id_, txn_id);
-            }
-          }
-        }
-        // 解锁当前资源的请求队列
-        request_queue->latch_.unlock();
+void LockManager::UpdateWaitsFor(const std::shared_ptr<LockRequestQueue> &lock_request_queue) {
+  // 调用者持有队列的锁，队列里的请求不会变化。一个等待的请求要等它前面的请求，不管前面的请求有没有被授予
+  std::vector<txn_id_t> ahead;
+  std::scoped_lock lock(waits_for_latch_);
+  for (auto *request : lock_request_queue->request_queue_) {
+    auto txn_id = request->txn_id_;
+    if (request->granted_) {
+      // 刚被授予锁的事务不再等待这个队列
+      if (auto iter = waiting_on_.find(txn_id); iter != waiting_on_.end() && iter->second == lock_request_queue) {
+        waiting_on_.erase(iter);
+        waits_for_.erase(txn_id);
       }
-
-      /*对于行map*/
-      for (auto &[rid, request_queue] : row_lock_map_) {
-        std::vector<txn_id_t> granted_set;
-        request_queue->latch_.lock();
-        for (auto lock_request : request_queue->request_queue_) {  // NOLINT
-          if (lock_request->granted_) {
-            granted_set.push_back(lock_request->txn_id_);
-          } else {
-            map_txn_rid_.emplace(lock_request->txn_id_, lock_request->rid_);
-            for (auto txn_id : granted_set) {
-              AddEdge(lock_request->txn_id_, txn_id);
-            }
-          }
-        }
-        request_queue->latch_.unlock();
+    } else if (TransactionManager::GetTransaction(txn_id)->GetDeadlockPolicy() != DeadlockPolicy::DETECTION) {
+      // 用死锁预防策略的事务不参与死锁检测，只记录它在等哪个队列，wound 的时候用来唤醒它
+      waiting_on_[txn_id] = lock_request_queue;
+    } else {
+      std::vector<txn_id_t> blockers;
+      std::copy_if(ahead.begin(), ahead.end(), std::back_inserter(blockers), [&](txn_id_t t) { return t != txn_id; });
+      std::sort(blockers.begin(), blockers.end());
+      blockers.erase(std::unique(blockers.begin(), blockers.end()), blockers.end());
+      auto &edges = waits_for_[txn_id];
+      if (edges != blockers) {
+        edges = std::move(blockers);
+        changed_txns_.insert(txn_id);
       }
+      waiting_on_[txn_id] = lock_request_queue;
+    }
+    ahead.push_back(txn_id);
+  }
+}
 
-      row_lock_map_latch_.unlock();
-      table_lock_map_latch_.unlock();
+void LockManager::RemoveWaiter(txn_id_t txn_id) {
+  std::scoped_lock lock(waits_for_latch_);
+  waits_for_.erase(txn_id);
+  waiting_on_.erase(txn_id);
+}
 
-      txn_id_t txn_id;
-      while (HasCycle(&txn_id)) {  // 只要有环
-        // LOG_DEBUG("txn_id = %d\n", txn_id);
-        Transaction *txn = TransactionManager::GetTransaction(txn_id);
-        txn->SetState(TransactionState::ABORTED);  // 终止这个事务
-        DeleteNode(txn_id);                        // 删除节点
+auto LockManager::GetBlockers(LockRequest *lock_request,
+                              const std::shared_ptr<LockRequestQueue> &lock_request_queue) -> std::vector<txn_id_t> {
+  std::vector<txn_id_t> blockers;
+  for (auto *request : lock_request_queue->request_queue_) {
+    if (request == lock_request) {
+      break;
+    }
+    if (!request->granted_ || !static_cast<bool>(lock_compatible_matrix[static_cast<int>(request->lock_mode_)]
+                                                                       [static_cast<int>(lock_request->lock_mode_)])) {
+      blockers.push_back(request->txn_id_);
+    }
+  }
+  return blockers;
+}
 
-        if (map_txn_oid_.count(txn_id) > 0) {  // 如果表还有事务 则通知 该数据项上的所有其他线程
-          table_lock_map_[map_txn_oid_[txn_id]]->latch_.lock();
-          table_lock_map_[map_txn_oid_[txn_id]]->cv_.notify_all();
-          table_lock_map_[map_txn_oid_[txn_id]]->latch_.unlock();
+void LockManager::WaitForGrant(Transaction *txn, LockRequest *lock_request,
+                               const std::shared_ptr<LockRequestQueue> &lock_request_queue,
+                               std::unique_lock<std::mutex> *lock, std::chrono::steady_clock::time_point deadline) {
+  // 已经被 wound 的事务在需要等待时直接退出
+  if (txn->GetState() == TransactionState::ABORTED) {
+    return;
+  }
+  auto txn_id = txn->GetTransactionId();
+  switch (txn->GetDeadlockPolicy()) {
+    case DeadlockPolicy::DETECTION:
+      lock_request->cv_.wait(*lock);
+      return;
+    case DeadlockPolicy::NO_WAIT:
+      txn->SetState(TransactionState::ABORTED);
+      return;
+    case DeadlockPolicy::TIMEOUT:
+      if (lock_request->cv_.wait_until(*lock, deadline) == std::cv_status::timeout &&
+          !GrantLock(lock_request, lock_request_queue)) {
+        txn->SetState(TransactionState::ABORTED);
+      }
+      return;
+    case DeadlockPolicy::WAIT_DIE: {
+      // 事务 id 就是时间戳，只有比挡住自己的事务都老才能等待，否则 die
+      auto blockers = GetBlockers(lock_request, lock_request_queue);
+      if (std::any_of(blockers.begin(), blockers.end(), [&](txn_id_t blocker) { return blocker < txn_id; })) {
+        txn->SetState(TransactionState::ABORTED);
+        return;
+      }
+      lock_request->cv_.wait(*lock);
+      return;
+    }
+    case DeadlockPolicy::WOUND_WAIT: {
+      // abort 挡住自己的更年轻的事务，持有锁的事务在提交或者下一次等待时退出，正在等待的事务需要唤醒
+      std::vector<std::pair<std::shared_ptr<LockRequestQueue>, txn_id_t>> wounded_queues;
+      for (auto blocker : GetBlockers(lock_request, lock_request_queue)) {
+        if (blocker < txn_id) {
+          continue;
         }
-
-        if (map_txn_rid_.count(txn_id) > 0) {  // 如果行还有事务 则通知 该数据项上的所有其他线程
-          row_lock_map_[map_txn_rid_[txn_id]]->latch_.lock();
-          row_lock_map_[map_txn_rid_[txn_id]]->cv_.notify_all();
-          row_lock_map_[map_txn_rid_[txn_id]]->latch_.unlock();
+        // 检查状态和 abort 是一次 CAS，持有锁的事务可能正在提交，已经提交或者 abort 的事务不能再被改掉
+        if (!TransactionManager::GetTransaction(blocker)->TryWound()) {
+          continue;
         }
+        std::scoped_lock graph_lock(waits_for_latch_);
+        if (auto iter = waiting_on_.find(blocker); iter != waiting_on_.end()) {
+          wounded_queues.emplace_back(iter->second, blocker);
+        }
+      }
+      if (wounded_queues.empty()) {
+        lock_request->cv_.wait(*lock);
+        return;
+      }
+      // 同时持有两个队列的锁可能死锁，先放开自己的队列再唤醒，回来之后由调用者重新检查能否授予
+      lock->unlock();
+      for (const auto &[queue, wounded_txn_id] : wounded_queues) {
+        std::scoped_lock queue_lock(queue->latch_);
+        NotifyWaiter(queue, wounded_txn_id);
       }
-      // 清空数据
-      waits_for_.clear();
-      safe_set_.clear();
-      txn_set_.clear();
-      map_txn_oid_.clear();
-      map_txn_rid_.clear();
+      lock->lock();
+      return;
     }
   }
 }
 
-auto LockManager::DeleteNode(txn_id_t txn_id) -> void {
-  waits_for_.erase(txn_id);
-  // 这种循环遍历的方式是不是太低效了
-  for (auto a_txn_id : txn_set_) {
-    if (a_txn_id != txn_id) {
-      RemoveEdge(a_txn_id, txn_id);
+auto LockManager::HasWaiters(const std::shared_ptr<LockRequestQueue> &lock_request_queue) -> bool {
+  return FirstWaiting(lock_request_queue) != lock_request_queue->request_queue_.end();
+}
+
+void LockManager::NotifyGrantable(const std::shared_ptr<LockRequestQueue> &lock_request_queue) {
+  // 只有第一个等待的请求可能被授予，它被授予之后再唤醒下一个
+  auto iter = FirstWaiting(lock_request_queue);
+  if (iter != lock_request_queue->request_queue_.end() && GrantLock(*iter, lock_request_queue)) {
+    (*iter)->cv_.notify_one();
+  }
+}
+
+void LockManager::NotifyWaiter(const std::shared_ptr<LockRequestQueue> &lock_request_queue, txn_id_t txn_id) {
+  for (auto *request : lock_request_queue->request_queue_) {
+    if (request->txn_id_ == txn_id && !request->granted_) {
+      request->cv_.notify_one();
+      return;
+    }
+  }
+}
+
+void LockManager::ReclaimRowLockQueue(const RID &rid, const std::shared_ptr<LockRequestQueue> &lock_request_queue) {
+  // 和加锁一样先锁分区再锁队列，队列还是空的并且没有被替换时才删除
+  auto &shard = GetRowLockShard(rid);
+  std::scoped_lock shard_lock(shard.latch_);
+  auto iter = shard.row_lock_map_.find(rid);
+  if (iter == shard.row_lock_map_.end() || iter->second != lock_request_queue) {
+    return;
+  }
+  std::scoped_lock queue_lock(lock_request_queue->latch_);
+  if (lock_request_queue->request_queue_.Empty()) {
+    shard.row_lock_map_.erase(iter);
+  }
+}
+
+void LockManager::ReclaimKeyRangeLockQueue(const index_oid_t &index_oid, const RID &rid,
+                                           const std::shared_ptr<LockRequestQueue> &lock_request_queue) {
+  std::scoped_lock map_lock(key_range_lock_map_latch_);
+  auto &index_lock_map = key_range_lock_map_[index_oid];
+  auto iter = index_lock_map.find(rid);
+  if (iter == index_lock_map.end() || iter->second != lock_request_queue) {
+    return;
+  }
+  std::scoped_lock queue_lock(lock_request_queue->latch_);
+  if (lock_request_queue->request_queue_.Empty()) {
+    index_lock_map.erase(iter);
+  }
+}
+
+auto LockManager::GetRowLockQueueCount() -> size_t {
+  size_t count = 0;
+  for (auto &shard : row_lock_shards_) {
+    std::scoped_lock lock(shard.latch_);
+    count += shard.row_lock_map_.size();
+  }
+  return count;
+}
+
+auto LockManager::GetKeyRangeLockQueueCount() -> size_t {
+  std::scoped_lock lock(key_range_lock_map_latch_);
+  size_t count = 0;
+  for (const auto &[index_oid, index_lock_map] : key_range_lock_map_) {
+    count += index_lock_map.size();
+  }
+  return count;
+}
+
+void LockManager::RunCycleDetection() {
+  while (enable_cycle_detection_) {
+    std::this_thread::sleep_for(cycle_detection_interval);
+    /**
+     * 等待图是在加锁和解锁时增量维护的，这里不需要遍历锁表，也不需要锁住任何锁表。
+     * 新出现的环一定经过出边有变化的事务，只从这些事务出发搜索它们能到达的子图
+     */
+    std::vector<std::pair<std::shared_ptr<LockRequestQueue>, txn_id_t>> victim_queues;
+    {
+      std::scoped_lock lock(waits_for_latch_);
+      for (auto start : changed_txns_) {
+        txn_id_t victim;
+        while (FindCycle(start, &victim)) {
+          // 每次检测到死锁时，abort 环上最新的事务，删除它的出边之后继续检查
+          TransactionManager::GetTransaction(victim)->SetState(TransactionState::ABORTED);
+          waits_for_.erase(victim);
+          if (auto iter = waiting_on_.find(victim); iter != waiting_on_.end()) {
+            victim_queues.emplace_back(std::move(iter->second), victim);
+            waiting_on_.erase(iter);
+          }
+        }
+      }
+      changed_txns_.clear();
+    }
+    // 等待的线程先锁队列再锁等待图，所以唤醒它们要在放开等待图的锁之后
+    for (const auto &[lock_request_queue, victim] : victim_queues) {
+      std::scoped_lock lock(lock_request_queue->latch_);
+      NotifyWaiter(lock_request_queue, victim);
     }
   }
 }
@@ -13,23 +13,30 @@
 #include "concurrency/transaction_manager.h"
 
 #include <mutex>  // NOLINT
-#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 #include "catalog/catalog.h"
+#include "storage/index/index.h"
 #include "storage/table/table_heap.h"
 namespace bustub {
 
-std::unordered_map<txn_id_t, Transaction *> TransactionManager::txn_map = {};
-std::shared_mutex TransactionManager::txn_map_mutex = {};
+std::array<TransactionManager::TxnMapShard, TransactionManager::TXN_SHARDS> TransactionManager::txn_map_shards = {};
 
 auto TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level) -> Transaction * {
-  // Acquire the global transaction latch in shared mode.
-  global_txn_latch_.RLock();
-
   if (txn == nullptr) {
     txn = new Transaction(next_txn_id_++, isolation_level);
+    txn->SetDeadlockPolicy(deadlock_policy_);
+  }
+  // Acquire the global transaction latch in shared mode.
+  global_txn_latches_[txn->GetTransactionId() % TXN_SHARDS].RLock();
+
+  if (HasSnapshot(txn)) {
+    std::scoped_lock lock(commit_latch_);
+    txn->SetReadTs(last_commit_ts_);
+    running_snapshots_.insert(last_commit_ts_);
   }
 
   if (enable_logging) {
@@ -38,39 +45,89 @@ auto TransactionManager::Begin(Transaction *txn, IsolationLevel isolation_level)
     txn->SetPrevLSN(lsn);
   }
 
-  std::unique_lock<std::shared_mutex> l(txn_map_mutex);
-  txn_map[txn->GetTransactionId()] = txn;
+  auto &shard = GetTxnMapShard(txn->GetTransactionId());
+  std::scoped_lock lock(shard.latch_);
+  shard.txn_map_[txn->GetTransactionId()] = txn;
   return txn;
 }
 
-void TransactionManager::Commit(Transaction *txn) {
-  txn->SetState(TransactionState::COMMITTED);
-
-  // Perform all deletes before we commit.
+auto TransactionManager::Commit(Transaction *txn) -> bool {
+  // Stamp the versions written by the transaction. The commit timestamp is published only after all of them are
+  // stamped, so a snapshot either sees all of the writes or none of them.
   auto write_set = txn->GetWriteSet();
-  while (!write_set->empty()) {
-    auto &item = write_set->back();
-    auto *table = item.table_;
-    if (item.wtype_ == WType::DELETE) {
-      // Note that this also releases the lock when holding the page latch.
-      table->ApplyDelete(item.rid_, txn);
+  timestamp_t commit_ts = 0;
+  lsn_t commit_lsn = INVALID_LSN;
+  bool is_valid = true;
+  bool is_visible_to_all = false;
+  {
+    std::scoped_lock lock(commit_latch_);
+    // A read-only OPTIMISTIC transaction read a committed snapshot and needs no validation. A writing one is validated
+    // under the commit latch, so no other transaction commits between the validation and its commit timestamp.
+    is_valid = txn->GetIsolationLevel() != IsolationLevel::OPTIMISTIC || write_set->empty() || Validate(txn);
+    // A WOUND_WAIT transaction may be wounded by an older one up to this point, it keeps its locks until the commit
+    // record is durable. Whichever of the two state changes comes first wins, a wounded transaction is aborted.
+    is_valid = is_valid && txn->TryCommit();
+    if (is_valid) {
+      EndSnapshot(txn);
+      if (!write_set->empty()) {
+        commit_ts = last_commit_ts_ + 1;
+        for (const auto &item : *write_set) {
+          item.table_->CommitVersion(item.rid_, txn->GetTransactionId(), commit_ts);
+        }
+        last_commit_ts_ = commit_ts;
+      }
+      // The commit record is appended in the order the commits become visible, so a transaction that read the writes
+      // never has its commit record before the one of the writer in the log.
+      if (enable_logging) {
+        LogRecord record = LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::COMMIT);
+        commit_lsn = log_manager_->AppendLogRecord(&record);
+        txn->SetPrevLSN(commit_lsn);
+      }
+      // Snapshots taken from now on already see the writes.
+      is_visible_to_all = running_snapshots_.empty();
+    }
+  }
+  if (!is_valid) {
+    Abort(txn);
+    return false;
+  }
+
+  // The durable commit point. The log is flushed for a group of commits at once, the wait happens outside of the
+  // commit latch so that the commits behind this one can join the group. Read-only transactions have nothing to
+  // make durable.
+  if (commit_lsn != INVALID_LSN && !write_set->empty()) {
+    log_manager_->WaitForCommit(commit_lsn);
+  }
+
+  // Without running snapshots the older versions are dropped and the deletes applied right away, otherwise the
+  // garbage collection does it once the snapshots that may read them are finished.
+  if (is_visible_to_all) {
+    for (const auto &item : *write_set) {
+      item.table_->PruneVersions(item.rid_, commit_ts);
+    }
+  } else if (!write_set->empty()) {
+    std::scoped_lock lock(gc_latch_);
+    for (const auto &item : *write_set) {
+      gc_queue_.emplace_back(item.table_, item.rid_, commit_ts);
     }
-    write_set->pop_back();
   }
   write_set->clear();
 
   // Release all the locks.
   ReleaseLocks(txn);
+  UnregisterTransaction(txn);
+  GarbageCollect();
   // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  global_txn_latches_[txn->GetTransactionId() % TXN_SHARDS].RUnlock();
+  return true;
 }
 
 void TransactionManager::Abort(Transaction *txn) {
   txn->SetState(TransactionState::ABORTED);
   // Rollback before releasing the lock.
   auto table_write_set = txn->GetWriteSet();
-  while (!table_write_set->empty()) {
-    auto &item = table_write_set->back();
+  for (auto iter = table_write_set->rbegin(); iter != table_write_set->rend(); ++iter) {
+    auto &item = *iter;
     auto *table = item.table_;
     if (item.wtype_ == WType::DELETE) {
       table->RollbackDelete(item.rid_, txn);
@@ -80,7 +137,10 @@ void TransactionManager::Abort(Transaction *txn) {
     } else if (item.wtype_ == WType::UPDATE) {
       table->UpdateTuple(item.tuple_, item.rid_, txn);
     }
-    table_write_set->pop_back();
+  }
+  // The versions are dropped after the tuples are rolled back, until then snapshots read the older versions.
+  for (const auto &item : *table_write_set) {
+    item.table_->RollbackVersion(item.rid_, txn->GetTransactionId());
   }
   table_write_set->clear();
   // Rollback index updates
@@ -109,14 +169,89 @@ void TransactionManager::Abort(Transaction *txn) {
   table_write_set->clear();
   index_write_set->clear();
 
+  if (enable_logging) {
+    LogRecord record = LogRecord(txn->GetTransactionId(), txn->GetPrevLSN(), LogRecordType::ABORT);
+    txn->SetPrevLSN(log_manager_->AppendLogRecord(&record));
+  }
+
+  {
+    std::scoped_lock lock(commit_latch_);
+    EndSnapshot(txn);
+  }
   // Release all the locks.
   ReleaseLocks(txn);
+  UnregisterTransaction(txn);
+  GarbageCollect();
   // Release the global transaction latch.
-  global_txn_latch_.RUnlock();
+  global_txn_latches_[txn->GetTransactionId() % TXN_SHARDS].RUnlock();
 }
 
-void TransactionManager::BlockAllTransactions() { global_txn_latch_.WLock(); }
+auto TransactionManager::Validate(Transaction *txn) -> bool {
+  // 整张表扫描过的表，快照之后不能有别的事务提交过写
+  for (auto *table : *txn->GetTableScanSet()) {
+    if (table->GetLastCommitTs() > txn->GetReadTs()) {
+      return false;
+    }
+  }
+  // 通过索引读到的元组，快照之后不能有别的事务提交过新的版本
+  auto read_set = txn->GetReadSet();
+  for (const auto &[table, rids] : *read_set) {
+    for (const auto &rid : rids) {
+      if (!table->ValidateRead(rid, txn)) {
+        return false;
+      }
+    }
+  }
+  // 重新查一遍索引，查找时没有读到的元组不能出现在快照之后提交的状态里
+  for (const auto &record : *txn->GetIndexScanSet()) {
+    std::vector<RID> rids;
+    record.index_->ScanKey(record.key_, &rids, txn);
+    const auto &read_rids = (*read_set)[record.table_];
+    for (const auto &rid : rids) {
+      if (read_rids.count(rid) == 0 && record.table_->IsPhantom(rid, txn)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
 
-void TransactionManager::ResumeTransactions() { global_txn_latch_.WUnlock(); }
+void TransactionManager::GarbageCollect() {
+  auto watermark = GetWatermark();
+  std::vector<std::pair<TableHeap *, RID>> reclaimable;
+  {
+    std::scoped_lock lock(gc_latch_);
+    while (!gc_queue_.empty() && std::get<2>(gc_queue_.front()) <= watermark) {
+      reclaimable.emplace_back(std::get<0>(gc_queue_.front()), std::get<1>(gc_queue_.front()));
+      gc_queue_.pop_front();
+    }
+  }
+  for (const auto &[table, rid] : reclaimable) {
+    table->PruneVersions(rid, watermark);
+  }
+}
+
+void TransactionManager::UnregisterTransaction(Transaction *txn) {
+  auto &shard = GetTxnMapShard(txn->GetTransactionId());
+  std::scoped_lock lock(shard.latch_);
+  // 每个 TransactionManager 的事务 id 都从 0 开始，同一个 id 可能已经被另一个事务重新注册
+  auto iter = shard.txn_map_.find(txn->GetTransactionId());
+  if (iter != shard.txn_map_.end() && iter->second == txn) {
+    shard.txn_map_.erase(iter);
+  }
+}
+
+void TransactionManager::BlockAllTransactions() {
+  // 按固定的顺序加锁，两个同时做 checkpoint 的线程不会死锁
+  for (auto &latch : global_txn_latches_) {
+    latch.WLock();
+  }
+}
+
+void TransactionManager::ResumeTransactions() {
+  for (auto &latch : global_txn_latches_) {
+    latch.WUnlock();
+  }
+}
 
 }  // namespace bustub
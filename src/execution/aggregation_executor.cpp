@@ -18,10 +18,14 @@ AggregationExecutor::AggregationExecutor(ExecutorContext *exec_ctx, const Aggreg
        * */
       aht_(plan->GetAggregates(), plan->GetAggregateTypes()),
       /*这里仅仅是为了不报错*/
-      aht_iterator_(aht_.Begin()) {}
+      aht_iterator_(aht_.Begin()),
+      reservation_(exec_ctx->GetMemoryTracker()) {}
 
 void AggregationExecutor::Init() {
   child_->Init();
+  aht_.Clear();
+  reservation_.Reset();
+  successful_ = false;
   Tuple tuple;
   RID rid;
   /*从子节点获取tuple和rid的数据*/
@@ -31,7 +35,13 @@ void AggregationExecutor::Init() {
      **/
     auto aggregate_key = MakeAggregateKey(&tuple);
     auto aggregate_value = MakeAggregateValue(&tuple);
-    aht_.InsertCombine(aggregate_key, aggregate_value);
+    // 每个新的分组都要计入内存预算，哈希表不能落盘，超出预算时查询失败
+    const auto group_bytes =
+        sizeof(AggregateKey) + sizeof(AggregateValue) +
+        (aggregate_key.group_bys_.size() + aggregate_value.aggregates_.size()) * sizeof(Value);
+    if (aht_.InsertCombine(aggregate_key, aggregate_value)) {
+      reservation_.Grow(group_bytes);
+    }
   }
   aht_iterator_ = aht_.Begin();  // 插入后需要重新指定 aht_iterator_ 因为哈希表是无序的
 }
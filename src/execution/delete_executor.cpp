@@ -10,7 +10,11 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <memory>
+#include <numeric>
+#include <utility>
+#include <vector>
 
 #include "execution/executors/delete_executor.h"
 
@@ -26,10 +30,15 @@ void DeleteExecutor::Init() {
   child_executor_->Init();
   try {
     // 获取表锁 意向排它锁IX
-    bool is_locked = exec_ctx_->GetLockManager()->LockTable(
-        exec_ctx_->GetTransaction(), LockManager::LockMode::INTENTION_EXCLUSIVE, table_info_->oid_);
-    if (!is_locked) {
-      throw ExecutionException("Delete Executor Get Table Lock Failed");
+    auto *txn = exec_ctx_->GetTransaction();
+    const auto oid = table_info_->oid_;
+    // 行锁升级之后事务可能已经持有 S 或者 X 表锁，S 表锁要升级成 SIX
+    if (!txn->IsTableExclusiveLocked(oid) && !txn->IsTableSharedIntentionExclusiveLocked(oid)) {
+      auto lock_mode = txn->IsTableSharedLocked(oid) ? LockManager::LockMode::SHARED_INTENTION_EXCLUSIVE
+                                                     : LockManager::LockMode::INTENTION_EXCLUSIVE;
+      if (!exec_ctx_->GetLockManager()->LockTable(txn, lock_mode, oid)) {
+        throw ExecutionException("Delete Executor Get Table Lock Failed");
+      }
     }
   } catch (TransactionAbortException const &e) {
     throw ExecutionException("Delete Executor Get Table Lock Failed");
@@ -37,38 +46,114 @@ void DeleteExecutor::Init() {
   table_indexes_ = exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->name_);
 }
 
-auto DeleteExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool {
-  if (is_end_) {
-    return false;
+auto DeleteExecutor::DeleteBatch(std::vector<std::pair<Tuple, RID>> *batch) -> int32_t {
+  // 按rid排序, 同一页面上的tuple相邻; Tuple没有移动构造, 所以排序下标而不是tuple本身
+  std::vector<size_t> order(batch->size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(),
+            [batch](size_t lhs, size_t rhs) { return (*batch)[lhs].second.Get() < (*batch)[rhs].second.Get(); });
+  std::vector<RID> rids;
+  rids.reserve(order.size());
+  for (auto i : order) {
+    rids.push_back((*batch)[i].second);
   }
-  Tuple to_delete_tuple{};
-  RID emit_rid;
-  int32_t delete_count = 0;
 
-  while (child_executor_->Next(&to_delete_tuple, &emit_rid)) {
+  // 获取行锁 排它锁X 为什么不用解锁呢？在哪儿解锁的 事务提交的时候解锁
+  for (const auto &rid : rids) {
     try {
-      // 获取行锁 排它锁X 为什么不用解锁呢？在哪儿解锁的 事务提交的时候解锁
-      bool is_locked = exec_ctx_->GetLockManager()->LockRow(
-          exec_ctx_->GetTransaction(), LockManager::LockMode::EXCLUSIVE, table_info_->oid_, emit_rid);
+      bool is_locked = exec_ctx_->GetLockManager()->LockRow(exec_ctx_->GetTransaction(),
+                                                            LockManager::LockMode::EXCLUSIVE, table_info_->oid_, rid);
       if (!is_locked) {
         throw ExecutionException("Delete Executor Get Row Lock Failed");
       }
     } catch (TransactionAbortException const &e) {
       throw ExecutionException("Delete Executor Get Row Lock Failed");
     }
+  }
+
+  const auto deleted = table_info_->table_->MarkDeletes(rids, exec_ctx_->GetTransaction());
+  // 快照隔离下元组在事务开始之后被别的事务修改过，先写的事务获胜
+  if (exec_ctx_->GetTransaction()->GetState() == TransactionState::ABORTED) {
+    throw ExecutionException("Delete Executor write-write conflict");
+  }
+  table_info_->stats_.RecordDelete(deleted);
+
+  // 持有 X 表锁时别的事务不能扫描这张表，不需要键区间锁
+  const bool lock_key_range = !exec_ctx_->GetTransaction()->IsTableExclusiveLocked(table_info_->oid_);
+  for (auto *index : table_indexes_) {
+    std::vector<std::pair<Tuple, RID>> entries;
+    entries.reserve(deleted);
+    for (size_t i = 0; i < deleted; i++) {
+      const auto &[to_delete_tuple, rid] = (*batch)[order[i]];
+      entries.emplace_back(
+          to_delete_tuple.KeyFromTuple(table_info_->schema_, index->key_schema_, index->index_->GetKeyAttrs()), rid);
+    }
+    std::vector<RID> next_rids;
+    if (lock_key_range) {
+      LockKeyRanges(index, entries, &next_rids);
+    }
+    index->index_->DeleteEntries(entries, exec_ctx_->GetTransaction());
+    if (lock_key_range) {
+      LockKeyRanges(index, entries, &next_rids);
+    }
+  }
+  return static_cast<int32_t>(deleted);
+}
+
+void DeleteExecutor::LockKeyRanges(const IndexInfo *index, const std::vector<std::pair<Tuple, RID>> &entries,
+                                   std::vector<RID> *next_rids) {
+  auto *tree = dynamic_cast<BPlusTreeIndexForIntegerColumns *>(index->index_.get());
+  if (tree == nullptr) {
+    return;
+  }
+  auto *txn = exec_ctx_->GetTransaction();
+  auto lock = [&](LockManager::LockMode lock_mode, const RID &rid) {
+    try {
+      if (!exec_ctx_->GetLockManager()->LockKeyRange(txn, lock_mode, index->index_oid_, rid)) {
+        throw ExecutionException("Delete Executor Get Key Range Lock Failed");
+      }
+    } catch (TransactionAbortException const &e) {
+      throw ExecutionException("Delete Executor Get Key Range Lock Failed");
+    }
+  };
+  const bool first = next_rids->empty();
+  next_rids->resize(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (first) {
+      lock(LockManager::LockMode::EXCLUSIVE, entries[i].second);
+    }
+    auto next_rid = tree->GetNextRid(entries[i].first);
+    if (!first && next_rid == (*next_rids)[i]) {
+      continue;
+    }
+    (*next_rids)[i] = next_rid;
+    lock(LockManager::LockMode::INTENTION_EXCLUSIVE, next_rid);
+  }
+}
 
-    bool deleted = table_info_->table_->MarkDelete(emit_rid, exec_ctx_->GetTransaction());
+auto DeleteExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool {
+  if (is_end_) {
+    return false;
+  }
+  std::vector<std::pair<Tuple, RID>> batch;
+  batch.reserve(DML_BATCH_SIZE);
+  int32_t delete_count = 0;
 
-    if (deleted) {
-      std::for_each(table_indexes_.begin(), table_indexes_.end(),
-                    [&to_delete_tuple, &rid, &table_info = table_info_, &exec_ctx = exec_ctx_](IndexInfo *index) {
-                      index->index_->DeleteEntry(to_delete_tuple.KeyFromTuple(table_info->schema_, index->key_schema_,
-                                                                              index->index_->GetKeyAttrs()),
-                                                 *rid, exec_ctx->GetTransaction());
-                    });
-      delete_count++;
+  while (true) {
+    batch.emplace_back();
+    if (!child_executor_->Next(&batch.back().first, &batch.back().second)) {
+      batch.pop_back();
+      break;
+    }
+    if (batch.size() == DML_BATCH_SIZE) {
+      delete_count += DeleteBatch(&batch);
+      batch.clear();
     }
   }
+  if (!batch.empty()) {
+    delete_count += DeleteBatch(&batch);
+  }
+
   std::vector<Value> values{};
   values.reserve(GetOutputSchema().GetColumnCount());
   values.emplace_back(TypeId::INTEGER, delete_count);
@@ -22,6 +22,7 @@
 #include "execution/executors/hash_join_executor.h"
 #include "execution/executors/index_scan_executor.h"
 #include "execution/executors/insert_executor.h"
+#include "execution/executors/instrumented_executor.h"
 #include "execution/executors/limit_executor.h"
 #include "execution/executors/mock_scan_executor.h"
 #include "execution/executors/nested_index_join_executor.h"
@@ -44,6 +45,15 @@ namespace bustub {
 
 auto ExecutorFactory::CreateExecutor(ExecutorContext *exec_ctx, const AbstractPlanNodeRef &plan)
     -> std::unique_ptr<AbstractExecutor> {
+  auto executor = CreatePlainExecutor(exec_ctx, plan);
+  if (exec_ctx->IsAnalyze()) {
+    return std::make_unique<InstrumentedExecutor>(exec_ctx, plan.get(), std::move(executor));
+  }
+  return executor;
+}
+
+auto ExecutorFactory::CreatePlainExecutor(ExecutorContext *exec_ctx, const AbstractPlanNodeRef &plan)
+    -> std::unique_ptr<AbstractExecutor> {
   switch (plan->GetType()) {
     // Create a new sequential scan executor
     case PlanType::SeqScan: {
@@ -31,6 +31,18 @@ auto AbstractPlanNode::ChildrenToString(int indent, bool with_schema) const -> s
   return fmt::format("\n{}", fmt::join(children_str, "\n"));
 }
 
+auto AbstractPlanNode::ToString(const std::function<std::string(const AbstractPlanNode &)> &annotate) const
+    -> std::string {
+  std::vector<std::string> lines{fmt::format("{}{}", PlanNodeToString(), annotate(*this))};
+  auto indent_str = StringUtil::Indent(2);
+  for (const auto &child : children_) {
+    for (auto &line : StringUtil::Split(child->ToString(annotate), '\n')) {
+      lines.push_back(fmt::format("{}{}", indent_str, line));
+    }
+  }
+  return fmt::format("{}", fmt::join(lines, "\n"));
+}
+
 auto AggregationPlanNode::PlanNodeToString() const -> std::string {
   return fmt::format("Agg {{ types={}, aggregates={}, group_by={} }}", agg_types_, aggregates_, group_bys_);
 }
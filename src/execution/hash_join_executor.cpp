@@ -11,7 +11,9 @@
 //===----------------------------------------------------------------------===//
 
 #include "execution/executors/hash_join_executor.h"
-#include "type/value_factory.h"
+
+#include <algorithm>
+#include <iterator>
 
 // Note for 2022 Fall: You don't need to implement HashJoinExecutor to pass all tests. You ONLY need to implement it
 // if you want to get faster in leaderboard tests.
@@ -24,76 +26,187 @@ HashJoinExecutor::HashJoinExecutor(ExecutorContext *exec_ctx, const HashJoinPlan
     : AbstractExecutor(exec_ctx),
       plan_(plan),
       left_executor_(std::move(left_child)),
-      right_executor_(std::move(right_child)) {
-  if (!(plan->GetJoinType() == JoinType::LEFT || plan->GetJoinType() == JoinType::INNER)) {
+      right_executor_(std::move(right_child)),
+      null_right_tuple_(TupleBuilder::NullTuple(&plan->GetRightPlan()->OutputSchema())),
+      reservation_(exec_ctx->GetMemoryTracker()) {
+  if (!(plan->GetJoinType() == JoinType::LEFT || plan->GetJoinType() == JoinType::INNER ||
+        IsSemiOrAntiJoin(plan->GetJoinType()))) {
     // Note for 2022 Fall: You ONLY need to implement left join and inner join.
     throw bustub::NotImplementedException(fmt::format("join type {} not supported", plan->GetJoinType()));
   }
+  if (!IsSemiOrAntiJoin(plan->GetJoinType())) {
+    builder_.emplace(TupleBuilder::ForJoin(&plan->OutputSchema(), &plan->GetLeftPlan()->OutputSchema(),
+                                           &plan->GetRightPlan()->OutputSchema()));
+  }
 }
 
 void HashJoinExecutor::Init() {
   left_executor_->Init();
   right_executor_->Init();
+  hash_join_table_.clear();
+  output_tuples_.clear();
+  output_tuples_iter_ = output_tuples_.begin();
+  reservation_.Reset();
+  swapped_ = false;
+  probe_exhausted_ = false;
+  probe_buffer_.clear();
+  probe_buffer_cursor_ = 0;
 
   Tuple tmp_tuple{};
   RID rid;
   /**
    * 初始化哈希表，注意这里只把右表的key value存入哈希表
    * 因为左表需要遍历，并且保证顺序
+   * 哈希表计入内存预算，超出预算时查询失败
    */
   auto &right_output_schema = plan_->GetRightPlan()->OutputSchema();
-  auto &left_output_schema = plan_->GetLeftPlan()->OutputSchema();
+  bool semi_or_anti = IsSemiOrAntiJoin(plan_->GetJoinType());
+  size_t build_rows = 0;
+  auto checkpoint = FirstCheckpoint();
   while (right_executor_->Next(&tmp_tuple, &rid)) {
     auto key = plan_->RightJoinKeyExpression().Evaluate(&tmp_tuple, right_output_schema);
+    // 半连接和反连接只关心某个key是否存在, NULL和重复的key不用存
+    if (semi_or_anti && (key.IsNull() || HasMatch(key))) {
+      continue;
+    }
+    reservation_.Grow(sizeof(Tuple) + tmp_tuple.GetLength());
     hash_join_table_[HashUtil::HashValue(&key)].push_back(tmp_tuple);
+    build_rows++;
+    // 自适应检查点: 右表比预期大得多，看看左表是不是其实更小
+    if (checkpoint.has_value() && build_rows == *checkpoint) {
+      if (IsProbeSideSmaller(build_rows)) {
+        SwapSides();
+        return;
+      }
+      checkpoint = *checkpoint * 2;
+    }
   }
+}
 
-  while (left_executor_->Next(&tmp_tuple, &rid)) {
-    // 计算左表的key
-    auto join_key = plan_->LeftJoinKeyExpression().Evaluate(&tmp_tuple, left_output_schema);
-    auto left_col_count = left_output_schema.GetColumnCount();
-    auto right_col_count = right_output_schema.GetColumnCount();
-
-    if (hash_join_table_.count(HashUtil::HashValue(&join_key)) > 0) {
-      auto &right_tuples = hash_join_table_[HashUtil::HashValue(&join_key)];
-      for (const auto &tuple : right_tuples) {
-        auto right_join_key = plan_->RightJoinKeyExpression().Evaluate(&tuple, right_output_schema);
-        // 防止出现hash相同，值不同的情况
-        if (right_join_key.CompareEquals(join_key) == CmpBool::CmpTrue) {
-          std::vector<Value> values;
-          values.reserve(left_col_count + right_col_count);
-          for (uint32_t i = 0; i < left_col_count; i++) {
-            values.push_back(tmp_tuple.GetValue(&left_output_schema, i));
-          }
-          for (uint32_t i = 0; i < right_col_count; i++) {
-            values.push_back(tuple.GetValue(&right_output_schema, i));
-          }
-          output_tuples_.emplace_back(values, &GetOutputSchema());
-        }
-      }
-    } else if (plan_->GetJoinType() == JoinType::LEFT) {
-      std::vector<Value> values;
-      values.reserve(left_col_count + right_col_count);
-      for (uint32_t i = 0; i < left_col_count; i++) {
-        values.push_back(tmp_tuple.GetValue(&left_output_schema, i));
-      }
-      for (uint32_t i = 0; i < right_col_count; i++) {
-        values.push_back(ValueFactory::GetNullValueByType(right_output_schema.GetColumn(i).GetType()));
-      }
-      output_tuples_.emplace_back(values, &GetOutputSchema());
+auto HashJoinExecutor::FirstCheckpoint() const -> std::optional<size_t> {
+  // 只有内连接的两侧是对称的，左连接、半连接和反连接必须在右表上建哈希表
+  if (plan_->GetJoinType() != JoinType::INNER || !plan_->estimated_build_rows_.has_value()) {
+    return std::nullopt;
+  }
+  // 计划本来就认为左表更小时(例如由嵌套循环连接改写而来)，右表超过左表的估计值就该检查
+  auto expected = *plan_->estimated_build_rows_;
+  if (plan_->estimated_probe_rows_.has_value()) {
+    expected = std::min(expected, *plan_->estimated_probe_rows_);
+  }
+  auto rows = MISESTIMATE_RATIO * std::max(expected, 1.0);
+  return std::max(ADAPTIVE_MIN_BUILD_ROWS, static_cast<size_t>(rows) + 1);
+}
+
+auto HashJoinExecutor::IsProbeSideSmaller(size_t build_rows) -> bool {
+  // 左表最多比右表已读的部分多读一行就能知道哪一侧更小，读出来的左表tuple缓存起来，之后先探测它们
+  Tuple tuple{};
+  RID rid;
+  while (!probe_exhausted_ && probe_buffer_.size() <= build_rows) {
+    if (!left_executor_->Next(&tuple, &rid)) {
+      probe_exhausted_ = true;
+      break;
     }
+    reservation_.Grow(sizeof(Tuple) + tuple.GetLength());
+    probe_buffer_.push_back(tuple);
   }
+  return probe_exhausted_ && probe_buffer_.size() < build_rows;
+}
 
-  output_tuples_iter_ = output_tuples_.cbegin();
+void HashJoinExecutor::SwapSides() {
+  // 在左表上重建哈希表，已经读出的右表tuple先探测，右表剩下的部分不再物化，直接逐条探测
+  std::vector<Tuple> left_tuples = std::move(probe_buffer_);
+  probe_buffer_.clear();
+  for (auto &[_, bucket] : hash_join_table_) {
+    std::move(bucket.begin(), bucket.end(), std::back_inserter(probe_buffer_));
+  }
+  hash_join_table_.clear();
+  auto &left_output_schema = plan_->GetLeftPlan()->OutputSchema();
+  for (auto &left_tuple : left_tuples) {
+    auto key = plan_->LeftJoinKeyExpression().Evaluate(&left_tuple, left_output_schema);
+    hash_join_table_[HashUtil::HashValue(&key)].push_back(std::move(left_tuple));
+  }
+  swapped_ = true;
+  probe_exhausted_ = false;
+  if (GetExecutorContext()->IsAnalyze()) {
+    GetExecutorContext()->GetExecutorStats(plan_)->swaps_++;
+  }
 }
 
-auto HashJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
-  if (output_tuples_iter_ != output_tuples_.cend()) {
-    *tuple = *output_tuples_iter_;
-    output_tuples_iter_++;
+auto HashJoinExecutor::HasMatch(const Value &key) const -> bool {
+  auto bucket = hash_join_table_.find(HashUtil::HashValue(&key));
+  if (bucket == hash_join_table_.end()) {
+    return false;
+  }
+  auto &right_output_schema = plan_->GetRightPlan()->OutputSchema();
+  return std::any_of(bucket->second.begin(), bucket->second.end(), [&](const Tuple &tuple) {
+    auto right_join_key = plan_->RightJoinKeyExpression().Evaluate(&tuple, right_output_schema);
+    return right_join_key.CompareEquals(key) == CmpBool::CmpTrue;
+  });
+}
+
+auto HashJoinExecutor::NextProbeTuple(Tuple *tuple) -> bool {
+  if (probe_buffer_cursor_ < probe_buffer_.size()) {
+    *tuple = probe_buffer_[probe_buffer_cursor_++];
     return true;
   }
-  return false;
+  if (probe_exhausted_) {
+    return false;
+  }
+  RID rid;
+  return swapped_ ? right_executor_->Next(tuple, &rid) : left_executor_->Next(tuple, &rid);
+}
+
+void HashJoinExecutor::ProbeTuple(const Tuple &probe_tuple) {
+  auto &right_output_schema = plan_->GetRightPlan()->OutputSchema();
+  auto &left_output_schema = plan_->GetLeftPlan()->OutputSchema();
+  const auto &probe_key_expr = swapped_ ? plan_->RightJoinKeyExpression() : plan_->LeftJoinKeyExpression();
+  const auto &build_key_expr = swapped_ ? plan_->LeftJoinKeyExpression() : plan_->RightJoinKeyExpression();
+  const auto &probe_schema = swapped_ ? right_output_schema : left_output_schema;
+  const auto &build_schema = swapped_ ? left_output_schema : right_output_schema;
+  // 计算探测侧的key
+  auto join_key = probe_key_expr.Evaluate(&probe_tuple, probe_schema);
+
+  output_tuples_.clear();
+  if (auto bucket = hash_join_table_.find(HashUtil::HashValue(&join_key)); bucket != hash_join_table_.end()) {
+    for (const auto &tuple : bucket->second) {
+      auto build_join_key = build_key_expr.Evaluate(&tuple, build_schema);
+      // 防止出现hash相同，值不同的情况
+      if (build_join_key.CompareEquals(join_key) == CmpBool::CmpTrue) {
+        output_tuples_.push_back(swapped_ ? builder_->Build(tuple, probe_tuple) : builder_->Build(probe_tuple, tuple));
+      }
+    }
+  }
+  if (output_tuples_.empty() && plan_->GetJoinType() == JoinType::LEFT) {
+    output_tuples_.push_back(builder_->Build(probe_tuple, null_right_tuple_));
+  }
+  output_tuples_iter_ = output_tuples_.begin();
+}
+
+auto HashJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  if (IsSemiOrAntiJoin(plan_->GetJoinType())) {
+    // 半连接输出有匹配的左表tuple, 反连接输出没有匹配的, 左表tuple原样输出
+    bool emit_matched = plan_->GetJoinType() == JoinType::SEMI;
+    auto &left_output_schema = plan_->GetLeftPlan()->OutputSchema();
+    RID left_rid;
+    while (left_executor_->Next(tuple, &left_rid)) {
+      auto join_key = plan_->LeftJoinKeyExpression().Evaluate(tuple, left_output_schema);
+      if ((!join_key.IsNull() && HasMatch(join_key)) == emit_matched) {
+        return true;
+      }
+    }
+    return false;
+  }
+  // 探测侧按需逐条探测，只缓存当前探测tuple的匹配结果
+  while (output_tuples_iter_ == output_tuples_.end()) {
+    Tuple probe_tuple{};
+    if (!NextProbeTuple(&probe_tuple)) {
+      return false;
+    }
+    ProbeTuple(probe_tuple);
+  }
+  *tuple = std::move(*output_tuples_iter_);
+  output_tuples_iter_++;
+  return true;
 }
 
 }  // namespace bustub
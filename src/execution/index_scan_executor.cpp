@@ -10,7 +10,18 @@
 //
 //===----------------------------------------------------------------------===//
 #include "execution/executors/index_scan_executor.h"
+
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
 #include "execution/expressions/constant_value_expression.h"
+#include "execution/expressions/logic_expression.h"
+#include "type/limits.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanPlanNode *plan)
@@ -18,16 +29,27 @@ IndexScanExecutor::IndexScanExecutor(ExecutorContext *exec_ctx, const IndexScanP
       plan_{plan},
       index_info_{this->exec_ctx_->GetCatalog()->GetIndex(plan_->index_oid_)},
       table_info_{this->exec_ctx_->GetCatalog()->GetTable(index_info_->table_name_)},
-      tree_{dynamic_cast<BPlusTreeIndexForOneIntegerColumn *>(index_info_->index_.get())},
-      iter_{plan_->filter_predicate_ != nullptr ? BPlusTreeIndexIteratorForOneIntegerColumn(nullptr, nullptr)
+      tree_{dynamic_cast<BPlusTreeIndexForIntegerColumns *>(index_info_->index_.get())},
+      iter_{plan_->filter_predicate_ != nullptr ? BPlusTreeIndexIteratorForIntegerColumns(nullptr, nullptr)
                                                 : tree_->GetBeginIterator()} {}
 
 void IndexScanExecutor::Init() {
+  // 不带过滤条件的索引扫描读整张表
+  if (plan_->filter_predicate_ == nullptr &&
+      exec_ctx_->GetTransaction()->GetIsolationLevel() == IsolationLevel::OPTIMISTIC) {
+    exec_ctx_->GetTransaction()->GetTableScanSet()->insert(table_info_->table_.get());
+  }
   if (plan_->filter_predicate_ != nullptr) {
-    if (exec_ctx_->GetTransaction()->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED) {
+    auto *txn = exec_ctx_->GetTransaction();
+    const auto oid = table_info_->oid_;
+    // 已经持有的表锁（包括行锁升级得到的 S 或者 X 锁）覆盖了 IS 时不再加锁，快照读和乐观读不加锁
+    if (txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+        txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT_ISOLATION &&
+        txn->GetIsolationLevel() != IsolationLevel::OPTIMISTIC && !txn->IsTableIntentionExclusiveLocked(oid) &&
+        !txn->IsTableSharedIntentionExclusiveLocked(oid) && !txn->IsTableSharedLocked(oid) &&
+        !txn->IsTableExclusiveLocked(oid)) {
       try {
-        bool is_locked = exec_ctx_->GetLockManager()->LockTable(
-            exec_ctx_->GetTransaction(), LockManager::LockMode::INTENTION_SHARED, table_info_->oid_);
+        bool is_locked = exec_ctx_->GetLockManager()->LockTable(txn, LockManager::LockMode::INTENTION_SHARED, oid);
         if (!is_locked) {
           throw ExecutionException("IndexScan Executor Get Table Lock Failed");
         }
@@ -35,35 +57,259 @@ void IndexScanExecutor::Init() {
         throw ExecutionException("IndexScan Executor Get Table Lock Failed");
       }
     }
-    const auto *right_expr =
-        dynamic_cast<const ConstantValueExpression *>(plan_->filter_predicate_->children_[1].get());
-    Value v = right_expr->val_;
-    tree_->ScanKey(Tuple{{v}, index_info_->index_->GetKeySchema()}, &rids_, exec_ctx_->GetTransaction());
+    BuildRidBitmap();
     rid_iter_ = rids_.begin();
+    page_tuples_.clear();
+    page_iter_ = page_tuples_.begin();
   }
 }
 
-auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
-  if (plan_->filter_predicate_ != nullptr) {
-    if (rid_iter_ != rids_.end()) {
-      *rid = *rid_iter_;
-      if (exec_ctx_->GetTransaction()->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED) {
-        try {
-          bool is_locked = exec_ctx_->GetLockManager()->LockRow(exec_ctx_->GetTransaction(),
-                                                                LockManager::LockMode::SHARED, table_info_->oid_, *rid);
-          if (!is_locked) {
-            throw ExecutionException("IndexScan Executor Get Table Lock Failed");
-          }
-        } catch (TransactionAbortException const &e) {
+auto IndexScanExecutor::CollectKeyRange() const -> KeyRange {
+  // 每一列上的上下界
+  std::unordered_map<uint32_t, std::pair<std::optional<Value>, std::optional<Value>>> bounds;
+  std::vector<const AbstractExpression *> stack{plan_->filter_predicate_.get()};
+  while (!stack.empty()) {
+    const auto *expr = stack.back();
+    stack.pop_back();
+    if (const auto *logic_expr = dynamic_cast<const LogicExpression *>(expr); logic_expr != nullptr) {
+      if (logic_expr->logic_type_ == LogicType::And) {
+        stack.push_back(logic_expr->GetChildAt(0).get());
+        stack.push_back(logic_expr->GetChildAt(1).get());
+      }
+      continue;
+    }
+    const auto *cmp_expr = dynamic_cast<const ComparisonExpression *>(expr);
+    if (cmp_expr == nullptr) {
+      continue;
+    }
+    const auto *column_expr = dynamic_cast<const ColumnValueExpression *>(cmp_expr->GetChildAt(0).get());
+    const auto *const_expr = dynamic_cast<const ConstantValueExpression *>(cmp_expr->GetChildAt(1).get());
+    if (column_expr == nullptr || const_expr == nullptr || const_expr->val_.IsNull()) {
+      continue;
+    }
+    auto &[low, high] = bounds[column_expr->GetColIdx()];
+    const auto &v = const_expr->val_;
+    const bool bound_low = cmp_expr->comp_type_ == ComparisonType::Equal ||
+                           cmp_expr->comp_type_ == ComparisonType::GreaterThan ||
+                           cmp_expr->comp_type_ == ComparisonType::GreaterThanOrEqual;
+    const bool bound_high = cmp_expr->comp_type_ == ComparisonType::Equal ||
+                            cmp_expr->comp_type_ == ComparisonType::LessThan ||
+                            cmp_expr->comp_type_ == ComparisonType::LessThanOrEqual;
+    if (bound_low && (!low.has_value() || v.CompareGreaterThan(low.value()) == CmpBool::CmpTrue)) {
+      low = v;
+    }
+    if (bound_high && (!high.has_value() || v.CompareLessThan(high.value()) == CmpBool::CmpTrue)) {
+      high = v;
+    }
+  }
+
+  KeyRange range;
+  for (auto key_attr : index_info_->index_->GetKeyAttrs()) {
+    auto iter = bounds.find(key_attr);
+    if (iter == bounds.end()) {
+      break;
+    }
+    const auto &[low, high] = iter->second;
+    if (low.has_value() && high.has_value() && low->CompareEquals(high.value()) == CmpBool::CmpTrue) {
+      range.prefix_.push_back(low.value());
+      continue;
+    }
+    range.low_ = low;
+    range.high_ = high;
+    break;
+  }
+  return range;
+}
+
+auto IndexScanExecutor::CompareWithRange(const IntegerKeyType &key, const KeyRange &range) const -> int {
+  auto *key_schema = index_info_->index_->GetKeySchema();
+  for (uint32_t i = 0; i < range.prefix_.size(); i++) {
+    auto value = key.ToValue(key_schema, i);
+    if (value.CompareLessThan(range.prefix_[i]) == CmpBool::CmpTrue) {
+      return -1;
+    }
+    if (value.CompareGreaterThan(range.prefix_[i]) == CmpBool::CmpTrue) {
+      return 1;
+    }
+  }
+  if (range.prefix_.size() == key_schema->GetColumnCount()) {
+    return 0;
+  }
+  auto value = key.ToValue(key_schema, range.prefix_.size());
+  if (range.low_.has_value() && value.CompareLessThan(range.low_.value()) == CmpBool::CmpTrue) {
+    return -1;
+  }
+  if (range.high_.has_value() && value.CompareGreaterThan(range.high_.value()) == CmpBool::CmpTrue) {
+    return 1;
+  }
+  return 0;
+}
+
+void IndexScanExecutor::BuildRidBitmap() {
+  rids_.clear();
+  auto range = CollectKeyRange();
+
+  auto *key_schema = index_info_->index_->GetKeySchema();
+  auto *txn = exec_ctx_->GetTransaction();
+  const auto oid = table_info_->oid_;
+  const bool is_point_lookup = range.prefix_.size() == key_schema->GetColumnCount();
+  if (!is_point_lookup && range.low_.has_value() && range.high_.has_value() &&
+      range.low_->CompareGreaterThan(range.high_.value()) == CmpBool::CmpTrue) {
+    return;
+  }
+  if (txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC) {
+    // an optimistic transaction repeats a point lookup on commit to find phantoms, and validates a range scan like a
+    // whole table scan
+    if (is_point_lookup) {
+      txn->AppendIndexScanRecord(
+          {index_info_->index_.get(), Tuple{range.prefix_, key_schema}, table_info_->table_.get()});
+    } else {
+      txn->GetTableScanSet()->insert(table_info_->table_.get());
+    }
+  }
+
+  RID next_rid;
+  ScanIndex(range, &next_rid);
+  // 可重复读还要锁住扫描过的键区间防止幻读，持有 S、SIX 或者 X 表锁时别的事务本来就不能插入
+  if (txn->GetIsolationLevel() == IsolationLevel::REPEATABLE_READ && !txn->IsTableSharedLocked(oid) &&
+      !txn->IsTableSharedIntentionExclusiveLocked(oid) && !txn->IsTableExclusiveLocked(oid)) {
+    // 加锁之前区间里可能插入或者删除了索引项，重新扫描直到扫到的就是已经锁住的
+    while (true) {
+      auto locked_rids = rids_;
+      auto locked_next_rid = next_rid;
+      bool is_locked = LockKeyRanges(is_point_lookup, next_rid);
+      ScanIndex(range, &next_rid);
+      if (!is_locked || (rids_ == locked_rids && next_rid == locked_next_rid)) {
+        break;
+      }
+    }
+  }
+
+  if (!plan_->ordered_) {
+    // turn the rids into a bitmap over the heap: sorted by page, then by slot
+    std::sort(rids_.begin(), rids_.end(), [](const RID &a, const RID &b) { return a.Get() < b.Get(); });
+    rids_.erase(std::unique(rids_.begin(), rids_.end()), rids_.end());
+  }
+}
+
+void IndexScanExecutor::ScanIndex(const KeyRange &range, RID *next_rid) {
+  rids_.clear();
+  *next_rid = RID();
+  auto *key_schema = index_info_->index_->GetKeySchema();
+  if (range.prefix_.size() == key_schema->GetColumnCount()) {
+    Tuple key{range.prefix_, key_schema};
+    tree_->ScanKey(key, &rids_, exec_ctx_->GetTransaction());
+    if (rids_.empty()) {
+      *next_rid = tree_->GetNextRid(key);
+    }
+    return;
+  }
+  // the leaf iterator is destroyed before touching the heap or the lock manager so no leaf latch is held across it
+  auto scan = [&](BPlusTreeIndexIteratorForIntegerColumns iter) {
+    for (; !iter.IsEnd(); ++iter) {
+      const auto &[key, rid] = *iter;
+      auto cmp = CompareWithRange(key, range);
+      if (cmp > 0) {
+        *next_rid = rid;
+        break;
+      }
+      if (cmp == 0) {
+        rids_.push_back(rid);
+      }
+    }
+  };
+  if (range.prefix_.empty() && !range.low_.has_value()) {
+    scan(tree_->GetBeginIterator());
+  } else {
+    // the smallest key in the range: the prefix, the low bound and the smallest integer for the remaining columns
+    std::vector<Value> begin = range.prefix_;
+    begin.push_back(range.low_.value_or(ValueFactory::GetIntegerValue(BUSTUB_INT32_MIN)));
+    while (begin.size() < key_schema->GetColumnCount()) {
+      begin.push_back(ValueFactory::GetIntegerValue(BUSTUB_INT32_MIN));
+    }
+    IntegerKeyType begin_key;
+    begin_key.SetFromKey(Tuple{begin, key_schema});
+    scan(tree_->GetBeginIterator(begin_key));
+  }
+}
+
+auto IndexScanExecutor::LockKeyRanges(bool is_point_lookup, const RID &next_rid) -> bool {
+  auto *txn = exec_ctx_->GetTransaction();
+  const auto oid = table_info_->oid_;
+  try {
+    // 锁太多时和行锁一样升级成表锁
+    if (rids_.size() >= static_cast<size_t>(LOCK_ESCALATION_THRESHOLD)) {
+      auto lock_mode = txn->IsTableIntentionExclusiveLocked(oid) ? LockManager::LockMode::SHARED_INTENTION_EXCLUSIVE
+                                                                 : LockManager::LockMode::SHARED;
+      if (!exec_ctx_->GetLockManager()->LockTable(txn, lock_mode, oid)) {
+        throw ExecutionException("IndexScan Executor Get Table Lock Failed");
+      }
+      return false;
+    }
+    // 唯一索引上的点查找到了这个键就只锁它自己，否则锁住区间里的每一项和区间后面的一项
+    for (const auto &rid : rids_) {
+      if (!exec_ctx_->GetLockManager()->LockKeyRange(txn, LockManager::LockMode::SHARED, index_info_->index_oid_,
+                                                     rid)) {
+        throw ExecutionException("IndexScan Executor Get Key Range Lock Failed");
+      }
+    }
+    if ((!is_point_lookup || rids_.empty()) &&
+        !exec_ctx_->GetLockManager()->LockKeyRange(txn, LockManager::LockMode::SHARED, index_info_->index_oid_,
+                                                   next_rid)) {
+      throw ExecutionException("IndexScan Executor Get Key Range Lock Failed");
+    }
+  } catch (TransactionAbortException const &e) {
+    throw ExecutionException("IndexScan Executor Get Key Range Lock Failed");
+  }
+  return true;
+}
+
+void IndexScanExecutor::FetchNextPage() {
+  auto *txn = exec_ctx_->GetTransaction();
+  const auto page_id = rid_iter_->GetPageId();
+  auto page_end = rid_iter_;
+  while (page_end != rids_.end() && page_end->GetPageId() == page_id) {
+    if (txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+        txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT_ISOLATION &&
+        txn->GetIsolationLevel() != IsolationLevel::OPTIMISTIC &&
+        !txn->IsRowExclusiveLocked(table_info_->oid_, *page_end)) {
+      try {
+        bool is_locked =
+            exec_ctx_->GetLockManager()->LockRow(txn, LockManager::LockMode::SHARED, table_info_->oid_, *page_end);
+        if (!is_locked) {
           throw ExecutionException("IndexScan Executor Get Row Lock Failed");
         }
+      } catch (TransactionAbortException const &e) {
+        throw ExecutionException("IndexScan Executor Get Row Lock Failed");
       }
+    }
+    page_end++;
+  }
 
-      auto result = table_info_->table_->GetTuple(*rid, tuple, exec_ctx_->GetTransaction());
-      rid_iter_++;
-      return result;
+  page_tuples_.clear();
+  table_info_->table_->GetTuples(std::vector<RID>(rid_iter_, page_end), &page_tuples_, txn);
+  page_iter_ = page_tuples_.begin();
+  rid_iter_ = page_end;
+}
+
+auto IndexScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  if (plan_->filter_predicate_ != nullptr) {
+    while (true) {
+      while (page_iter_ == page_tuples_.end()) {
+        if (rid_iter_ == rids_.end()) {
+          return false;
+        }
+        FetchNextPage();
+      }
+      *tuple = *page_iter_;
+      *rid = tuple->GetRid();
+      page_iter_++;
+      // the range only bounds the key column, the rest of the predicate is checked here
+      const auto value = plan_->filter_predicate_->Evaluate(tuple, GetOutputSchema());
+      if (!value.IsNull() && value.GetAs<bool>()) {
+        return true;
+      }
     }
-    return false;
   }
   /**
    * 这里判断条件改成iter_.IsEnd()会出现段错误问题，因为如果把表里面所有内容删除完的话，
@@ -11,6 +11,8 @@
 //===----------------------------------------------------------------------===//
 
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "execution/executors/insert_executor.h"
 
@@ -27,10 +29,15 @@ void InsertExecutor::Init() {
   try {
     // 插入tuple
     // 先锁表 用意向排它锁IX 为什么这里不区分隔离级别
-    bool is_locked = exec_ctx_->GetLockManager()->LockTable(
-        exec_ctx_->GetTransaction(), LockManager::LockMode::INTENTION_EXCLUSIVE, table_info_->oid_);
-    if (!is_locked) {
-      throw ExecutionException("Insert Executor Get Table Lock Failed");
+    auto *txn = exec_ctx_->GetTransaction();
+    const auto oid = table_info_->oid_;
+    // 行锁升级之后事务可能已经持有 S 或者 X 表锁，S 表锁要升级成 SIX
+    if (!txn->IsTableExclusiveLocked(oid) && !txn->IsTableSharedIntentionExclusiveLocked(oid)) {
+      auto lock_mode = txn->IsTableSharedLocked(oid) ? LockManager::LockMode::SHARED_INTENTION_EXCLUSIVE
+                                                     : LockManager::LockMode::INTENTION_EXCLUSIVE;
+      if (!exec_ctx_->GetLockManager()->LockTable(txn, lock_mode, oid)) {
+        throw ExecutionException("Insert Executor Get Table Lock Failed");
+      }
     }
   } catch (TransactionAbortException const &e) {
     throw ExecutionException("Insert Executor Get Table Lock Failed");
@@ -38,42 +45,101 @@ void InsertExecutor::Init() {
   table_indexes_ = exec_ctx_->GetCatalog()->GetTableIndexes(table_info_->name_);
 }
 
+auto InsertExecutor::InsertBatch(const std::vector<Tuple> &batch) -> int32_t {
+  std::vector<RID> rids;
+  rids.reserve(batch.size());
+  table_info_->table_->InsertTuples(batch, &rids, exec_ctx_->GetTransaction());
+  table_info_->stats_.RecordInsert(rids.size());
+
+  // 获取行锁 排它锁X, rids按页面顺序排列, 一次性加锁
+  for (const auto &rid : rids) {
+    try {
+      bool is_locked = exec_ctx_->GetLockManager()->LockRow(exec_ctx_->GetTransaction(),
+                                                            LockManager::LockMode::EXCLUSIVE, table_info_->oid_, rid);
+      if (!is_locked) {
+        throw ExecutionException("Insert Executor Get Row Lock Failed");
+      }
+    } catch (TransactionAbortException const &e) {
+      throw ExecutionException("Insert Executor Get Row Lock Failed");
+    }
+  }
+
+  /**
+   * 插入一条新的数据需要更新所有的索引，这里的索引指的是一张
+   * 表的多个索引，一张表可能会创建多个索引，比如B+树索引，哈希表索引等
+   * 因此需要对所有的索引进行更新, 每个索引按key排序后批量插入
+   * 持有 X 表锁时别的事务不能扫描这张表，不需要键区间锁
+   */
+  const bool lock_key_range = !exec_ctx_->GetTransaction()->IsTableExclusiveLocked(table_info_->oid_);
+  for (auto *index : table_indexes_) {
+    std::vector<std::pair<Tuple, RID>> entries;
+    entries.reserve(rids.size());
+    for (size_t i = 0; i < rids.size(); i++) {
+      entries.emplace_back(
+          batch[i].KeyFromTuple(table_info_->schema_, index->key_schema_, index->index_->GetKeyAttrs()), rids[i]);
+    }
+    std::vector<RID> next_rids;
+    if (lock_key_range) {
+      LockNextKeys(index, entries, &next_rids);
+    }
+    index->index_->InsertEntries(entries, exec_ctx_->GetTransaction());
+    if (lock_key_range) {
+      LockNextKeys(index, entries, &next_rids);
+    }
+  }
+  return static_cast<int32_t>(rids.size());
+}
+
+void InsertExecutor::LockNextKeys(const IndexInfo *index, const std::vector<std::pair<Tuple, RID>> &entries,
+                                  std::vector<RID> *next_rids) {
+  auto *tree = dynamic_cast<BPlusTreeIndexForIntegerColumns *>(index->index_.get());
+  if (tree == nullptr) {
+    return;
+  }
+  const bool first = next_rids->empty();
+  next_rids->resize(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    auto next_rid = tree->GetNextRid(entries[i].first);
+    if (!first && next_rid == (*next_rids)[i]) {
+      continue;
+    }
+    (*next_rids)[i] = next_rid;
+    try {
+      if (!exec_ctx_->GetLockManager()->LockKeyRange(exec_ctx_->GetTransaction(),
+                                                     LockManager::LockMode::INTENTION_EXCLUSIVE, index->index_oid_,
+                                                     next_rid)) {
+        throw ExecutionException("Insert Executor Get Key Range Lock Failed");
+      }
+    } catch (TransactionAbortException const &e) {
+      throw ExecutionException("Insert Executor Get Key Range Lock Failed");
+    }
+  }
+}
+
 auto InsertExecutor::Next([[maybe_unused]] Tuple *tuple, RID *rid) -> bool {
   if (is_end_) {
     return false;
   }
-  Tuple to_insert_tuple{};
+  std::vector<Tuple> batch;
+  batch.reserve(DML_BATCH_SIZE);
   RID emit_rid;
   int32_t insert_count = 0;
 
-  while (child_executor_->Next(&to_insert_tuple, &emit_rid)) {
-    bool inserted = table_info_->table_->InsertTuple(to_insert_tuple, rid, exec_ctx_->GetTransaction());
-
-    if (inserted) {
-      try {
-        // 获取行锁 排它锁X 传入rid
-        bool is_locked = exec_ctx_->GetLockManager()->LockRow(
-            exec_ctx_->GetTransaction(), LockManager::LockMode::EXCLUSIVE, table_info_->oid_, *rid);
-        if (!is_locked) {
-          throw ExecutionException("Insert Executor Get Row Lock Failed");
-        }
-      } catch (TransactionAbortException const &e) {
-        throw ExecutionException("Insert Executor Get Row Lock Failed");
-      }
-      /**
-       * 插入一条新的数据需要更新所有的索引，这里的索引指的是一张
-       * 表的多个索引，一张表可能会创建多个索引，比如B+树索引，哈希表索引等
-       * 因此需要对所有的索引进行更新
-       */
-      std::for_each(table_indexes_.begin(), table_indexes_.end(),
-                    [&to_insert_tuple, &rid, &table_info = table_info_, &exec_ctx = exec_ctx_](IndexInfo *index) {
-                      index->index_->InsertEntry(to_insert_tuple.KeyFromTuple(table_info->schema_, index->key_schema_,
-                                                                              index->index_->GetKeyAttrs()),
-                                                 *rid, exec_ctx->GetTransaction());
-                    });
-      insert_count++;
+  while (true) {
+    batch.emplace_back();
+    if (!child_executor_->Next(&batch.back(), &emit_rid)) {
+      batch.pop_back();
+      break;
     }
+    if (batch.size() == DML_BATCH_SIZE) {
+      insert_count += InsertBatch(batch);
+      batch.clear();
+    }
+  }
+  if (!batch.empty()) {
+    insert_count += InsertBatch(batch);
   }
+
   std::vector<Value> values{};
   values.reserve(GetOutputSchema().GetColumnCount());
   values.emplace_back(TypeId::INTEGER, insert_count);
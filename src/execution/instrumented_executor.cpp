@@ -0,0 +1,72 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// instrumented_executor.cpp
+//
+// Identification: src/execution/instrumented_executor.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "execution/executors/instrumented_executor.h"
+
+#include <chrono>  // NOLINT
+
+namespace bustub {
+
+namespace {
+auto ElapsedMicros(std::chrono::steady_clock::time_point start) -> uint64_t {
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+}  // namespace
+
+InstrumentedExecutor::InstrumentedExecutor(ExecutorContext *exec_ctx, const AbstractPlanNode *plan,
+                                           std::unique_ptr<AbstractExecutor> &&child_executor)
+    : AbstractExecutor(exec_ctx),
+      child_executor_(std::move(child_executor)),
+      stats_(exec_ctx->GetExecutorStats(plan)) {}
+
+void InstrumentedExecutor::Init() {
+  auto counters = ReadCounters();
+  auto start = std::chrono::steady_clock::now();
+  child_executor_->Init();
+  stats_->init_us_ += ElapsedMicros(start);
+  stats_->loops_++;
+  Accumulate(counters);
+}
+
+auto InstrumentedExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  auto counters = ReadCounters();
+  auto start = std::chrono::steady_clock::now();
+  auto has_next = child_executor_->Next(tuple, rid);
+  stats_->next_us_ += ElapsedMicros(start);
+  if (has_next) {
+    stats_->rows_++;
+  }
+  Accumulate(counters);
+  return has_next;
+}
+
+auto InstrumentedExecutor::ReadCounters() const -> Counters {
+  Counters counters;
+  if (auto *bpm = exec_ctx_->GetBufferPoolManager(); bpm != nullptr) {
+    counters.page_fetches_ = bpm->GetFetchCount();
+    counters.page_misses_ = bpm->GetMissCount();
+  }
+  if (auto *txn = exec_ctx_->GetTransaction(); txn != nullptr) {
+    counters.lock_waits_ = txn->GetLockWaitCount();
+    counters.lock_wait_us_ = txn->GetLockWaitMicros();
+  }
+  return counters;
+}
+
+void InstrumentedExecutor::Accumulate(const Counters &begin) {
+  auto end = ReadCounters();
+  stats_->page_fetches_ += end.page_fetches_ - begin.page_fetches_;
+  stats_->page_misses_ += end.page_misses_ - begin.page_misses_;
+  stats_->lock_waits_ += end.lock_waits_ - begin.lock_waits_;
+  stats_->lock_wait_us_ += end.lock_wait_us_ - begin.lock_wait_us_;
+}
+
+}  // namespace bustub
@@ -11,21 +11,48 @@
 //===----------------------------------------------------------------------===//
 
 #include "execution/executors/nested_index_join_executor.h"
-#include "type/value_factory.h"
+
+#include <algorithm>
 
 namespace bustub {
 
+namespace {
+/** 输出外表的全部列，以及内表中列裁剪之后留下的列。半连接和反连接直接输出外表的tuple */
+auto MakeBuilder(const NestedIndexJoinPlanNode *plan, const Schema *outer_schema, const Schema *inner_schema)
+    -> std::optional<TupleBuilder> {
+  if (IsSemiOrAntiJoin(plan->GetJoinType())) {
+    return std::nullopt;
+  }
+  if (plan->inner_column_ids_.empty()) {
+    return TupleBuilder::ForJoin(&plan->OutputSchema(), outer_schema, inner_schema);
+  }
+  std::vector<TupleBuilder::ColumnSource> sources;
+  for (uint32_t i = 0; i < outer_schema->GetColumnCount(); i++) {
+    sources.push_back({0, i});
+  }
+  for (auto column_id : plan->inner_column_ids_) {
+    sources.push_back({1, column_id});
+  }
+  return TupleBuilder(&plan->OutputSchema(), {outer_schema, inner_schema}, sources);
+}
+}  // namespace
+
 NestIndexJoinExecutor::NestIndexJoinExecutor(ExecutorContext *exec_ctx, const NestedIndexJoinPlanNode *plan,
                                              std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {
-  if (!(plan->GetJoinType() == JoinType::LEFT || plan->GetJoinType() == JoinType::INNER)) {
+    : AbstractExecutor(exec_ctx),
+      plan_(plan),
+      child_executor_(std::move(child_executor)),
+      /*索引信息和表信息，child是左表，右表是当前，并且有索引*/
+      index_info_(exec_ctx->GetCatalog()->GetIndex(plan->GetIndexOid())),
+      table_info_(exec_ctx->GetCatalog()->GetTable(plan->GetInnerTableOid())),
+      builder_(MakeBuilder(plan, &child_executor_->GetOutputSchema(), &table_info_->schema_)),
+      null_right_tuple_(TupleBuilder::NullTuple(&table_info_->schema_)) {
+  if (!(plan->GetJoinType() == JoinType::LEFT || plan->GetJoinType() == JoinType::INNER ||
+        IsSemiOrAntiJoin(plan->GetJoinType()))) {
     // Note for 2022 Fall: You ONLY need to implement left join and inner join.
     throw bustub::NotImplementedException(fmt::format("join type {} not supported", plan->GetJoinType()));
   }
   is_left_ = (plan_->GetJoinType() == JoinType::LEFT);
-  /*索引信息和表信息，child是左表，右表是当前，并且有索引*/
-  index_info_ = exec_ctx_->GetCatalog()->GetIndex(plan_->GetIndexOid());
-  table_info_ = exec_ctx_->GetCatalog()->GetTable(plan_->GetInnerTableOid());
 }
 
 void NestIndexJoinExecutor::Init() { child_executor_->Init(); }
@@ -48,19 +75,28 @@ auto NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
     Tuple key(values, key_schema);
     std::vector<RID> results;
     index_info_->index_->ScanKey(key, &results, exec_ctx_->GetTransaction());
+    /*乐观并发控制的事务提交时重新查一遍索引，检查幻读*/
+    if (exec_ctx_->GetTransaction()->GetIsolationLevel() == IsolationLevel::OPTIMISTIC) {
+      exec_ctx_->GetTransaction()->AppendIndexScanRecord({index_info_->index_.get(), key, table_info_->table_.get()});
+    }
+    if (IsSemiOrAntiJoin(plan_->GetJoinType())) {
+      /*半连接找到第一个还存在的tuple就停止, 反连接在没有任何匹配时输出外表tuple*/
+      Tuple right_tuple;
+      bool matched = !value.IsNull() && std::any_of(results.begin(), results.end(), [&](const RID &rid_b) {
+        return table_info_->table_->GetTuple(rid_b, &right_tuple, exec_ctx_->GetTransaction());
+      });
+      if (matched == (plan_->GetJoinType() == JoinType::SEMI)) {
+        *tuple = std::move(left_tuple);
+        return true;
+      }
+      continue;
+    }
     /*如果匹配上了因为keyB不存在重复，所以如果能匹配，肯定匹配一次就结束。inner*/
     if (!results.empty()) {
       for (auto rid_b : results) {
         Tuple right_tuple;  // 对于每个rid，可以通过catalog获得对应的tuple，如果tuple存在
         if (table_info_->table_->GetTuple(rid_b, &right_tuple, exec_ctx_->GetTransaction())) {
-          std::vector<Value> tuple_values;
-          for (uint32_t i = 0; i < child_executor_->GetOutputSchema().GetColumnCount(); i++) {
-            tuple_values.push_back(left_tuple.GetValue(&child_executor_->GetOutputSchema(), i));
-          }
-          for (uint32_t i = 0; i < table_info_->schema_.GetColumnCount(); i++) {
-            tuple_values.push_back(right_tuple.GetValue(&table_info_->schema_, i));
-          }
-          *tuple = {tuple_values, &plan_->OutputSchema()};
+          *tuple = builder_->Build(left_tuple, right_tuple);
           return true;
         }
       }
@@ -69,14 +105,7 @@ auto NestIndexJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
      * 如果是inner join，没有任何行匹配，则不用管，直接忽略
      * */
     if (is_left_) {
-      std::vector<Value> tuple_values;
-      for (uint32_t i = 0; i < child_executor_->GetOutputSchema().GetColumnCount(); i++) {
-        tuple_values.push_back(left_tuple.GetValue(&child_executor_->GetOutputSchema(), i));
-      }
-      for (uint32_t i = 0; i < table_info_->schema_.GetColumnCount(); i++) {
-        tuple_values.push_back(ValueFactory::GetNullValueByType(table_info_->schema_.GetColumn(i).GetType()));
-      }
-      *tuple = {tuple_values, &plan_->OutputSchema()};
+      *tuple = builder_->Build(left_tuple, null_right_tuple_);
       return true;
     }
   }
@@ -1,7 +1,7 @@
 #include "execution/executors/nested_loop_join_executor.h"
+#include <algorithm>
 #include "binder/table_ref/bound_join_ref.h"
 #include "common/exception.h"
-#include "type/value_factory.h"
 
 namespace bustub {
 
@@ -13,12 +13,18 @@ NestedLoopJoinExecutor::NestedLoopJoinExecutor(ExecutorContext *exec_ctx, const
       left_executor_(std::move(left_executor)),
       right_executor_(std::move(right_executor)),
       left_schema_(left_executor_->GetOutputSchema()),
-      right_schema_(right_executor_->GetOutputSchema()) {
-  if (plan->GetJoinType() != JoinType::LEFT && plan->GetJoinType() != JoinType::INNER) {
+      right_schema_(right_executor_->GetOutputSchema()),
+      null_right_tuple_(TupleBuilder::NullTuple(&right_schema_)),
+      reservation_(exec_ctx->GetMemoryTracker()) {
+  if (plan->GetJoinType() != JoinType::LEFT && plan->GetJoinType() != JoinType::INNER &&
+      !IsSemiOrAntiJoin(plan->GetJoinType())) {
     // Note for 2022 Fall: You ONLY need to implement left join and inner join.
     throw bustub::NotImplementedException(fmt::format("join type {} not supported", plan->GetJoinType()));
   }
   is_ineer_ = (plan_->GetJoinType() == JoinType::INNER);
+  if (!IsSemiOrAntiJoin(plan->GetJoinType())) {
+    builder_.emplace(TupleBuilder::ForJoin(&plan->OutputSchema(), &left_schema_, &right_schema_));
+  }
 }
 
 void NestedLoopJoinExecutor::Init() {
@@ -26,26 +32,44 @@ void NestedLoopJoinExecutor::Init() {
   RID rid;
   left_executor_->Init();
   right_executor_->Init();
-  /*先把右边的tuple缓存起来*/
+  right_tuples_.clear();
+  reservation_.Reset();
+  index_ = 0;
+  /*先把右边的tuple缓存起来, 缓存计入内存预算*/
   while (right_executor_->Next(&tuple, &rid)) {
+    reservation_.Grow(sizeof(Tuple) + tuple.GetLength());
     right_tuples_.push_back(tuple);
   }
 }
 
 auto NestedLoopJoinExecutor::Next(Tuple *tuple, RID *rid) -> bool {
-  std::vector<Column> columns(left_schema_.GetColumns());
-  for (const auto &column : right_schema_.GetColumns()) {
-    columns.push_back(column);
+  /*总的属性是两个表的属性水平拼接起来, 由builder_直接拷贝两边的数据*/
+  if (IsSemiOrAntiJoin(plan_->GetJoinType())) {
+    return SemiJoin(tuple);
   }
-  /*总的属性是两个表的属性水平拼接起来*/
-  Schema schema(columns);
   if (is_ineer_) {
-    return InnerJoin(schema, tuple);
+    return InnerJoin(tuple);
   }
-  return LeftJoin(schema, tuple);
+  return LeftJoin(tuple);
 }
 
-auto NestedLoopJoinExecutor::InnerJoin(const Schema &schema, Tuple *tuple) -> bool {
+auto NestedLoopJoinExecutor::SemiJoin(Tuple *tuple) -> bool {
+  /*半连接输出有匹配的左表tuple, 反连接输出没有匹配的, 每个左表tuple最多输出一次*/
+  bool emit_matched = plan_->GetJoinType() == JoinType::SEMI;
+  while (left_executor_->Next(&left_tuple_, &left_rid_)) {
+    bool matched = std::any_of(right_tuples_.begin(), right_tuples_.end(), [&](const Tuple &right_tuple) {
+      auto value = plan_->Predicate().EvaluateJoin(&left_tuple_, left_schema_, &right_tuple, right_schema_);
+      return !value.IsNull() && value.GetAs<bool>();
+    });
+    if (matched == emit_matched) {
+      *tuple = left_tuple_;
+      return true;
+    }
+  }
+  return false;
+}
+
+auto NestedLoopJoinExecutor::InnerJoin(Tuple *tuple) -> bool {
   if (index_ > right_tuples_.size()) {
     return false;
   }
@@ -58,14 +82,7 @@ auto NestedLoopJoinExecutor::InnerJoin(const Schema &schema, Tuple *tuple) -> bo
     for (uint32_t j = index_; j < right_tuples_.size(); j++) {
       index_ = (index_ + 1) % right_tuples_.size();
       if (plan_->Predicate().EvaluateJoin(&left_tuple_, left_schema_, &right_tuples_[j], right_schema_).GetAs<bool>()) {
-        std::vector<Value> value;
-        for (uint32_t i = 0; i < left_schema_.GetColumnCount(); i++) {
-          value.push_back(left_tuple_.GetValue(&left_schema_, i));
-        }
-        for (uint32_t i = 0; i < right_schema_.GetColumnCount(); i++) {
-          value.push_back(right_tuples_[j].GetValue(&right_schema_, i));
-        }
-        *tuple = {value, &schema};
+        *tuple = builder_->Build(left_tuple_, right_tuples_[j]);
         return true;
       }
     }
@@ -77,17 +94,10 @@ auto NestedLoopJoinExecutor::InnerJoin(const Schema &schema, Tuple *tuple) -> bo
         /*索引*/
         index_ = (index_ + 1) % right_tuples_.size();
         if (plan_->Predicate().EvaluateJoin(&left_tuple_, left_schema_, &right_tuple, right_schema_).GetAs<bool>()) {
-          std::vector<Value> value;
-          for (uint32_t i = 0; i < left_schema_.GetColumnCount(); i++) {
-            value.push_back(left_tuple_.GetValue(&left_schema_, i));
-          }
-          for (uint32_t i = 0; i < right_schema_.GetColumnCount(); i++) {
-            value.push_back(right_tuple.GetValue(&right_schema_, i));
-          }
+          *tuple = builder_->Build(left_tuple_, right_tuple);
           /*注意：这里是在for循环内部返回的合并后的tuple信息，确实没有遍历完，
           可能for循环right_tuple有10条，但是只合并了一条，就返回了，这个时候剩下的九条，
           就需要在下次进入函数时，先返回*/
-          *tuple = {value, &schema};
           return true;
         }
       }
@@ -98,7 +108,7 @@ auto NestedLoopJoinExecutor::InnerJoin(const Schema &schema, Tuple *tuple) -> bo
   return false;
 }
 
-auto NestedLoopJoinExecutor::LeftJoin(const Schema &schema, Tuple *tuple) -> bool {
+auto NestedLoopJoinExecutor::LeftJoin(Tuple *tuple) -> bool {
   if (index_ > right_tuples_.size()) {
     return false;
   }
@@ -106,15 +116,8 @@ auto NestedLoopJoinExecutor::LeftJoin(const Schema &schema, Tuple *tuple) -> boo
     for (uint32_t j = index_; j < right_tuples_.size(); j++) {
       index_ = (index_ + 1) % right_tuples_.size();
       if (plan_->Predicate().EvaluateJoin(&left_tuple_, left_schema_, &right_tuples_[j], right_schema_).GetAs<bool>()) {
-        std::vector<Value> value;
-        for (uint32_t i = 0; i < left_schema_.GetColumnCount(); i++) {
-          value.push_back(left_tuple_.GetValue(&left_schema_, i));
-        }
-        for (uint32_t i = 0; i < right_schema_.GetColumnCount(); i++) {
-          value.push_back(right_tuples_[j].GetValue(&right_schema_, i));
-        }
+        *tuple = builder_->Build(left_tuple_, right_tuples_[j]);
         is_match_ = true;
-        *tuple = {value, &schema};
         return true;
       }
     }
@@ -125,31 +128,15 @@ auto NestedLoopJoinExecutor::LeftJoin(const Schema &schema, Tuple *tuple) -> boo
       for (const auto &right_tuple : right_tuples_) {
         index_ = (index_ + 1) % right_tuples_.size();
         if (plan_->Predicate().EvaluateJoin(&left_tuple_, left_schema_, &right_tuple, right_schema_).GetAs<bool>()) {
-          std::vector<Value> value;
-          for (uint32_t i = 0; i < left_schema_.GetColumnCount(); i++) {
-            value.push_back(left_tuple_.GetValue(&left_schema_, i));
-          }
-          for (uint32_t i = 0; i < right_schema_.GetColumnCount(); i++) {
-            value.push_back(right_tuple.GetValue(&right_schema_, i));
-          }
+          *tuple = builder_->Build(left_tuple_, right_tuple);
           is_match_ = true;
-          *tuple = {value, &schema};
           return true;
         }
       }
       /*右表为空和没有任何匹配的情况*/
       /*如果跟右边没有任何一行能匹配，则需要构造一个空tuple来join*/
       if (!is_match_) {
-        std::vector<Value> value;
-
-        for (uint32_t i = 0; i < left_schema_.GetColumnCount(); i++) {
-          value.push_back(left_tuple_.GetValue(&left_schema_, i));
-        }
-        /*右边全部填空值*/
-        for (uint32_t i = 0; i < right_schema_.GetColumnCount(); i++) {
-          value.push_back(ValueFactory::GetNullValueByType(right_schema_.GetColumn(i).GetType()));
-        }
-        *tuple = {value, &schema};
+        *tuple = builder_->Build(left_tuple_, null_right_tuple_);
         is_match_ = true;
         return true;
       }
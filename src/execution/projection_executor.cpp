@@ -1,11 +1,24 @@
 #include "execution/executors/projection_executor.h"
+#include "execution/expressions/column_value_expression.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
 
 ProjectionExecutor::ProjectionExecutor(ExecutorContext *exec_ctx, const ProjectionPlanNode *plan,
                                        std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {}
+    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {
+  const auto &child_schema = child_executor_->GetOutputSchema();
+  std::vector<TupleBuilder::ColumnSource> sources;
+  for (uint32_t i = 0; i < plan_->GetExpressions().size(); i++) {
+    const auto *column_expr = dynamic_cast<const ColumnValueExpression *>(plan_->GetExpressions()[i].get());
+    if (column_expr == nullptr || column_expr->GetTupleIdx() != 0 ||
+        !TupleBuilder::CanCopy(GetOutputSchema().GetColumn(i), child_schema.GetColumn(column_expr->GetColIdx()))) {
+      return;
+    }
+    sources.push_back({0, column_expr->GetColIdx()});
+  }
+  builder_.emplace(&GetOutputSchema(), std::vector<const Schema *>{&child_schema}, sources);
+}
 
 void ProjectionExecutor::Init() {
   // Initialize the child executor
@@ -22,6 +35,11 @@ auto ProjectionExecutor::Next(Tuple *tuple, RID *rid) -> bool {
     return false;
   }
 
+  if (builder_.has_value()) {
+    *tuple = builder_->Build(child_tuple);
+    return true;
+  }
+
   // Compute expressions
   std::vector<Value> values{};
   values.reserve(GetOutputSchema().GetColumnCount());
@@ -24,7 +24,16 @@ SeqScanExecutor::SeqScanExecutor(ExecutorContext *exec_ctx, const SeqScanPlanNod
     : AbstractExecutor(exec_ctx),
       plan_(plan),
       table_info_(exec_ctx->GetCatalog()->GetTable(plan->GetTableOid())),
-      cur_(nullptr, {}, nullptr) {}
+      cur_(nullptr, {}, nullptr) {
+  if (!plan_->column_ids_.empty()) {
+    std::vector<TupleBuilder::ColumnSource> sources;
+    sources.reserve(plan_->column_ids_.size());
+    for (auto column_id : plan_->column_ids_) {
+      sources.push_back({0, column_id});
+    }
+    builder_.emplace(&GetOutputSchema(), std::vector<const Schema *>{&table_info_->schema_}, sources);
+  }
+}
 
 void SeqScanExecutor::Init() {
   cur_ = table_info_->table_->Begin(exec_ctx_->GetTransaction());
@@ -43,11 +52,14 @@ auto SeqScanExecutor::Next(Tuple *tuple, RID *rid) -> bool {
 
     cur_++;
     if (plan_->filter_predicate_ != nullptr) {
-      const auto value = plan_->filter_predicate_->Evaluate(tuple, plan_->OutputSchema());
+      const auto value = plan_->filter_predicate_->Evaluate(tuple, table_info_->schema_);
       if (value.IsNull() || !value.GetAs<bool>()) {
         continue;
       }
     }
+    if (builder_.has_value()) {
+      *tuple = builder_->Build(*tuple);
+    }
     // fmt::print("SeqScanExecutor::Next {}\n", tuple->ToString(&plan_->OutputSchema()));
 
     return true;
@@ -65,8 +77,13 @@ void SeqScanExecutor::LockTable() {
   bool res = true;
 
   try {
-    if (txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED) {
-      if (!txn->IsTableIntentionExclusiveLocked(oid) && !txn->IsTableSharedIntentionExclusiveLocked(oid)) {
+    // 快照读不加锁，乐观并发控制在提交时验证
+    if (txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+        txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT_ISOLATION &&
+        txn->GetIsolationLevel() != IsolationLevel::OPTIMISTIC) {
+      // 已经持有的表锁（包括行锁升级得到的 S 或者 X 锁）覆盖了 IS 时不再加锁
+      if (!txn->IsTableIntentionExclusiveLocked(oid) && !txn->IsTableSharedIntentionExclusiveLocked(oid) &&
+          !txn->IsTableSharedLocked(oid) && !txn->IsTableExclusiveLocked(oid)) {
         res = lock_mgr->LockTable(txn, LockManager::LockMode::INTENTION_SHARED, oid);
       }
     }
@@ -100,7 +117,9 @@ void SeqScanExecutor::LockRow(const RID &rid) {
   const auto &lock_mgr = exec_ctx_->GetLockManager();
   const auto &oid = plan_->GetTableOid();
   bool res = true;
-  if (txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED) {
+  if (txn->GetIsolationLevel() != IsolationLevel::READ_UNCOMMITTED &&
+      txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT_ISOLATION &&
+      txn->GetIsolationLevel() != IsolationLevel::OPTIMISTIC) {
     if (!txn->IsRowExclusiveLocked(oid, rid)) {
       res = lock_mgr->LockRow(txn, LockManager::LockMode::SHARED, oid, rid);
     }
@@ -1,59 +1,172 @@
 #include "execution/executors/sort_executor.h"
 
+#include <algorithm>
+
 namespace bustub {
 
 SortExecutor::SortExecutor(ExecutorContext *exec_ctx, const SortPlanNode *plan,
                            std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {}
+    : AbstractExecutor(exec_ctx),
+      plan_(plan),
+      child_executor_(std::move(child_executor)),
+      reservation_(exec_ctx->GetMemoryTracker()) {}
+
+SortExecutor::~SortExecutor() { DropRuns(); }
 
 void SortExecutor::Init() {
   child_executor_->Init();
   sorted_tuples_.clear();
+  reservation_.Reset();
+  DropRuns();
   RID rid;
   Tuple tuple;
   while (child_executor_->Next(&tuple, &rid)) {
+    const auto bytes = sizeof(Tuple) + tuple.GetLength();
+    if (!reservation_.TryGrow(bytes)) {
+      // 超出内存预算时，把已经缓存的tuple排序后写到临时页面上，作为一个有序的run
+      if (!sorted_tuples_.empty()) {
+        SpillRun();
+      }
+      reservation_.Grow(bytes);
+    }
     sorted_tuples_.push_back(tuple);
   }
 
-  sort(sorted_tuples_.begin(), sorted_tuples_.end(), [this](const Tuple &a, const Tuple &b) {
-    for (auto [type, expr] : plan_->GetOrderBy()) {
-      // 判断是否为升序
-      bool asc_group_by = (type == OrderByType::DEFAULT || type == OrderByType::ASC);
-      Value value_a = expr->Evaluate(&a, child_executor_->GetOutputSchema());
-      Value value_b = expr->Evaluate(&b, child_executor_->GetOutputSchema());
-      /**
-       * 注意这里相等的情况不处理，因为可能有多个比较条件，
-       * 留到下个比较条件处理
-       */
-      if (asc_group_by) {
-        if (value_a.CompareLessThan(value_b) == CmpBool::CmpTrue) {
-          return true;
-        }
-        if (value_a.CompareGreaterThan(value_b) == CmpBool::CmpTrue) {
-          return false;
-        }
-      } else {
-        if (value_a.CompareGreaterThan(value_b) == CmpBool::CmpTrue) {
-          return true;
-        }
-        if (value_a.CompareLessThan(value_b) == CmpBool::CmpTrue) {
-          return false;
-        }
-      }
+  if (runs_.empty()) {
+    std::sort(sorted_tuples_.begin(), sorted_tuples_.end(),
+              [this](const Tuple &a, const Tuple &b) { return Less(a, b); });
+    iterator_ = sorted_tuples_.begin();
+    return;
+  }
+
+  // 所有数据都写成run，在Next中做多路归并
+  if (!sorted_tuples_.empty()) {
+    SpillRun();
+  }
+  for (auto &run : runs_) {
+    LoadRunPage(&run);
+  }
+}
+
+auto SortExecutor::Next(Tuple *tuple, RID *rid) -> bool {
+  if (runs_.empty()) {
+    if (iterator_ != sorted_tuples_.end()) {
+      *tuple = *iterator_;
+      iterator_++;
+      return true;
     }
-    // 全部相等的时候返回false，这样不改变原本的数组
     return false;
-  });
+  }
 
-  iterator_ = sorted_tuples_.begin();
+  // k-way merge, on ties the earlier run wins so equal tuples keep their input order across runs
+  SortRun *min_run = nullptr;
+  for (auto &run : runs_) {
+    if (run.pos_ < run.tuples_.size() &&
+        (min_run == nullptr || Less(run.tuples_[run.pos_], min_run->tuples_[min_run->pos_]))) {
+      min_run = &run;
+    }
+  }
+  if (min_run == nullptr) {
+    return false;
+  }
+  *tuple = min_run->tuples_[min_run->pos_++];
+  if (min_run->pos_ == min_run->tuples_.size()) {
+    LoadRunPage(min_run);
+  }
+  return true;
 }
 
-auto SortExecutor::Next(Tuple *tuple, RID *rid) -> bool {
-  if (iterator_ != sorted_tuples_.end()) {
-    *tuple = *iterator_;
-    iterator_++;
-    return true;
+auto SortExecutor::Less(const Tuple &a, const Tuple &b) const -> bool {
+  for (auto [type, expr] : plan_->GetOrderBy()) {
+    // 判断是否为升序
+    bool asc_group_by = (type == OrderByType::DEFAULT || type == OrderByType::ASC);
+    Value value_a = expr->Evaluate(&a, child_executor_->GetOutputSchema());
+    Value value_b = expr->Evaluate(&b, child_executor_->GetOutputSchema());
+    /**
+     * 注意这里相等的情况不处理，因为可能有多个比较条件，
+     * 留到下个比较条件处理
+     */
+    if (asc_group_by) {
+      if (value_a.CompareLessThan(value_b) == CmpBool::CmpTrue) {
+        return true;
+      }
+      if (value_a.CompareGreaterThan(value_b) == CmpBool::CmpTrue) {
+        return false;
+      }
+    } else {
+      if (value_a.CompareGreaterThan(value_b) == CmpBool::CmpTrue) {
+        return true;
+      }
+      if (value_a.CompareLessThan(value_b) == CmpBool::CmpTrue) {
+        return false;
+      }
+    }
   }
+  // 全部相等的时候返回false，这样不改变原本的数组
   return false;
 }
+
+void SortExecutor::SpillRun() {
+  std::sort(sorted_tuples_.begin(), sorted_tuples_.end(),
+            [this](const Tuple &a, const Tuple &b) { return Less(a, b); });
+
+  auto *bpm = exec_ctx_->GetBufferPoolManager();
+  auto &run = runs_.emplace_back();
+  TmpTuplePage *page = nullptr;
+  TmpTuple tmp_tuple(INVALID_PAGE_ID, 0);
+  for (const auto &tuple : sorted_tuples_) {
+    if (page != nullptr && page->Insert(tuple, &tmp_tuple)) {
+      continue;
+    }
+    if (page != nullptr) {
+      bpm->UnpinPage(run.pages_.back(), true);
+    }
+    page_id_t page_id;
+    page = reinterpret_cast<TmpTuplePage *>(bpm->NewPage(&page_id));
+    if (page == nullptr) {
+      throw ExecutionException("Sort Executor can not allocate a page to spill");
+    }
+    page->Init(page_id, BUSTUB_PAGE_SIZE);
+    run.pages_.push_back(page_id);
+    if (!page->Insert(tuple, &tmp_tuple)) {
+      bpm->UnpinPage(page_id, false);
+      throw ExecutionException("Sort Executor can not spill a tuple larger than a page");
+    }
+  }
+  if (page != nullptr) {
+    bpm->UnpinPage(run.pages_.back(), true);
+  }
+
+  sorted_tuples_.clear();
+  reservation_.Reset();
+}
+
+void SortExecutor::LoadRunPage(SortRun *run) {
+  run->tuples_.clear();
+  run->pos_ = 0;
+  if (run->next_page_ == run->pages_.size()) {
+    return;
+  }
+  auto *bpm = exec_ctx_->GetBufferPoolManager();
+  const auto page_id = run->pages_[run->next_page_];
+  auto *page = reinterpret_cast<TmpTuplePage *>(bpm->FetchPage(page_id));
+  if (page == nullptr) {
+    throw ExecutionException("Sort Executor can not read back a spilled page");
+  }
+  page->GetTuples(&run->tuples_);
+  bpm->UnpinPage(page_id, false);
+  bpm->DeletePage(page_id);
+  run->next_page_++;
+}
+
+void SortExecutor::DropRuns() {
+  auto *bpm = exec_ctx_->GetBufferPoolManager();
+  for (const auto &run : runs_) {
+    for (auto i = run.next_page_; i < run.pages_.size(); i++) {
+      bpm->DeletePage(run.pages_[i]);
+    }
+  }
+  runs_.clear();
+}
+
 }  // namespace bustub
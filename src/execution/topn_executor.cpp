@@ -5,7 +5,10 @@ namespace bustub {
 
 TopNExecutor::TopNExecutor(ExecutorContext *exec_ctx, const TopNPlanNode *plan,
                            std::unique_ptr<AbstractExecutor> &&child_executor)
-    : AbstractExecutor(exec_ctx), plan_(plan), child_executor_(std::move(child_executor)) {}
+    : AbstractExecutor(exec_ctx),
+      plan_(plan),
+      child_executor_(std::move(child_executor)),
+      reservation_(exec_ctx->GetMemoryTracker()) {}
 
 void TopNExecutor::Init() {
   child_executor_->Init();
@@ -46,9 +49,14 @@ void TopNExecutor::Init() {
   std::priority_queue<Tuple, std::vector<Tuple>, decltype(cmp)> q(cmp);
   Tuple tuple;
   RID rid;
+  // 堆中最多保留N+1个tuple，按堆中tuple的大小计入内存预算
+  child_tuples_ = {};
+  reservation_.Reset();
   while (child_executor_->Next(&tuple, &rid)) {
+    reservation_.Grow(sizeof(Tuple) + tuple.GetLength());
     q.push(tuple);
     if (q.size() > plan_->GetN()) {
+      reservation_.Shrink(sizeof(Tuple) + q.top().GetLength());
       q.pop();
     }
   }
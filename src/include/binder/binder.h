@@ -63,6 +63,7 @@ struct PGColumnRef;
 struct PGResTarget;
 struct PGAExpr;
 struct PGJoinExpr;
+struct PGSubLink;
 }  // namespace duckdb_libpgquery
 
 namespace bustub {
@@ -77,6 +78,7 @@ class BoundExpressionListRef;
 class BoundOrderBy;
 class BoundSubqueryRef;
 class CreateStatement;
+class AnalyzeStatement;
 class ExplainStatement;
 class IndexStatement;
 class DeleteStatement;
@@ -155,6 +157,8 @@ class Binder {
 
   auto BindBoolExpr(duckdb_libpgquery::PGBoolExpr *root) -> std::unique_ptr<BoundExpression>;
 
+  auto BindSubLink(duckdb_libpgquery::PGSubLink *root) -> std::unique_ptr<BoundExpression>;
+
   auto BindFrom(duckdb_libpgquery::PGList *list) -> std::unique_ptr<BoundTableRef>;
 
   auto BindBaseTableRef(std::string table_name, std::optional<std::string> alias) -> std::unique_ptr<BoundBaseTableRef>;
@@ -194,6 +198,8 @@ class Binder {
 
   auto BindIndex(duckdb_libpgquery::PGIndexStmt *stmt) -> std::unique_ptr<IndexStatement>;
 
+  auto BindAnalyze(duckdb_libpgquery::PGVacuumStmt *stmt) -> std::unique_ptr<AnalyzeStatement>;
+
   auto BindDelete(duckdb_libpgquery::PGDeleteStmt *stmt) -> std::unique_ptr<DeleteStatement>;
 
   auto BindUpdate(duckdb_libpgquery::PGUpdateStmt *stmt) -> std::unique_ptr<UpdateStatement>;
@@ -249,6 +255,11 @@ class Binder {
   /** The current scope for resolving tables in CTEs, used in binding tables */
   const CTEList *cte_scope_{nullptr};
 
+  /** The scopes of the queries enclosing the subquery being bound, innermost last. Columns not found in `scope_`
+   * are resolved in these scopes, which makes the subquery correlated.
+   */
+  std::vector<const BoundTableRef *> outer_scopes_;
+
   /** Sometimes we will need to assign a name to some unnamed items. This variable gives them a universal ID. */
   size_t universal_id_{0};
 
@@ -21,6 +21,7 @@ enum class ExpressionType : uint8_t {
   UNARY_OP = 8,   /**< Unary expression type. */
   BINARY_OP = 9,  /**< Binary expression type. */
   ALIAS = 10,     /**< Alias expression type. */
+  SUBQUERY = 11,  /**< IN / EXISTS subquery expression type, will be planned as a semi or an anti join. */
 };
 
 /**
@@ -98,6 +99,9 @@ struct fmt::formatter<bustub::ExpressionType> : formatter<string_view> {
       case bustub::ExpressionType::ALIAS:
         name = "Alias";
         break;
+      case bustub::ExpressionType::SUBQUERY:
+        name = "Subquery";
+        break;
     }
     return formatter<string_view>::format(name, ctx);
   }
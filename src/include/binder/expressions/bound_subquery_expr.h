@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <utility>
+
+#include "binder/bound_expression.h"
+#include "binder/statement/select_statement.h"
+#include "common/util/string_util.h"
+
+namespace bustub {
+
+/**
+ * Subquery predicate types.
+ */
+enum class SubqueryType : uint8_t {
+  EXISTS = 0, /**< `EXISTS (SELECT ...)`. */
+  IN = 1,     /**< `x IN (SELECT ...)`, i.e. `x = ANY (SELECT ...)`. */
+};
+
+/**
+ * A subquery used as a predicate, e.g., `EXISTS (SELECT * FROM y WHERE y.a = x.a)`. The subquery may read the
+ * columns of the outer query, such a correlated subquery is decorrelated into a join by the planner.
+ */
+class BoundSubqueryExpr : public BoundExpression {
+ public:
+  explicit BoundSubqueryExpr(SubqueryType subquery_type, std::unique_ptr<SelectStatement> subquery,
+                             std::unique_ptr<BoundExpression> child)
+      : BoundExpression(ExpressionType::SUBQUERY),
+        subquery_type_(subquery_type),
+        subquery_(std::move(subquery)),
+        child_(std::move(child)) {}
+
+  auto ToString() const -> std::string override {
+    auto subquery = StringUtil::IndentAllLines(subquery_->ToString(), 2, true);
+    if (subquery_type_ == SubqueryType::IN) {
+      return fmt::format("({} IN {})", child_, subquery);
+    }
+    return fmt::format("(EXISTS {})", subquery);
+  }
+
+  /** The aggregations in the subquery belong to the subquery. */
+  auto HasAggregation() const -> bool override { return false; }
+
+  /** Type of the subquery predicate. */
+  SubqueryType subquery_type_;
+
+  /** The subquery. */
+  std::unique_ptr<SelectStatement> subquery_;
+
+  /** The value searched in the subquery for IN, nullptr for EXISTS. */
+  std::unique_ptr<BoundExpression> child_;
+};
+}  // namespace bustub
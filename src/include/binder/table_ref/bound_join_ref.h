@@ -18,9 +18,16 @@ enum class JoinType : uint8_t {
   LEFT = 1,    /**< Left join. */
   RIGHT = 3,   /**< Right join. */
   INNER = 4,   /**< Inner join. */
-  OUTER = 5    /**< Outer join. */
+  OUTER = 5,   /**< Outer join. */
+  SEMI = 6,    /**< Semi join, planned from IN / EXISTS subqueries. Outputs the left tuples that have a match. */
+  ANTI = 7     /**< Anti join, planned from NOT EXISTS subqueries. Outputs the left tuples that have no match. */
 };
 
+/** @return whether the join outputs only the columns of its left input, i.e. it is a semi or an anti join */
+inline auto IsSemiOrAntiJoin(JoinType join_type) -> bool {
+  return join_type == JoinType::SEMI || join_type == JoinType::ANTI;
+}
+
 /**
  * A join. e.g., `SELECT * FROM x INNER JOIN y ON ...`, where `x INNER JOIN y ON ...` is `BoundJoinRef`.
  */
@@ -74,6 +81,12 @@ struct fmt::formatter<bustub::JoinType> : formatter<string_view> {
       case bustub::JoinType::OUTER:
         name = "Outer";
         break;
+      case bustub::JoinType::SEMI:
+        name = "Semi";
+        break;
+      case bustub::JoinType::ANTI:
+        name = "Anti";
+        break;
       default:
         name = "Unknown";
         break;
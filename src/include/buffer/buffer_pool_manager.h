@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <atomic>
 #include <list>
 #include <mutex>  // NOLINT
 #include <unordered_map>
@@ -87,6 +88,12 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   virtual auto GetPoolSize() -> size_t = 0;
 
+  /** @return the number of FetchPage calls served so far */
+  auto GetFetchCount() const -> uint64_t { return fetch_count_; }
+
+  /** @return the number of fetched pages that were not in the pool and had to be read from disk */
+  auto GetMissCount() const -> uint64_t { return miss_count_; }
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -141,5 +148,9 @@ class BufferPoolManager {
    * Flushes all the pages in the buffer pool to disk.
    */
   virtual void FlushAllPgsImp() = 0;
+
+  /** Counters read by EXPLAIN ANALYZE, they are shared by all the queries running on the pool. */
+  std::atomic<uint64_t> fetch_count_{0};
+  std::atomic<uint64_t> miss_count_{0};
 };
 }  // namespace bustub
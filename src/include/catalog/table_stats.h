@@ -0,0 +1,155 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_stats.h
+//
+// Identification: src/include/catalog/table_stats.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "common/util/hash_util.h"
+#include "type/value.h"
+
+namespace bustub {
+
+class TableHeap;
+class Transaction;
+
+/**
+ * HyperLogLog estimates the number of distinct values of a stream in constant memory.
+ * The standard error is about 1.04 / sqrt(2^PRECISION), i.e. 3% with 1024 registers.
+ */
+class HyperLogLog {
+ public:
+  static constexpr uint32_t PRECISION = 10;
+  static constexpr uint32_t NUM_REGISTERS = 1 << PRECISION;
+
+  HyperLogLog() : registers_(NUM_REGISTERS, 0) {}
+
+  /** Add a hashed value, the hash is mixed again first so that any injective hash of the value works. */
+  void Add(hash_t hash);
+
+  /** @return the estimated number of distinct values added */
+  auto Estimate() const -> size_t;
+
+ private:
+  std::vector<uint8_t> registers_;
+};
+
+/**
+ * ColumnStats describes the value distribution of one column, as of the last ANALYZE.
+ */
+struct ColumnStats {
+  /** Estimated number of distinct non-null values */
+  size_t ndv_{0};
+  /** Fraction of the rows whose value is null */
+  double null_fraction_{0};
+  /** The most common values and the fraction of the rows holding each of them, most common first */
+  std::vector<std::pair<Value, double>> mcvs_;
+  /**
+   * Bounds of the equi-depth histogram over the non-null values that are not among the most common values.
+   * Bucket i holds the values in [histogram_[i], histogram_[i + 1]], every bucket holds about the same number of rows.
+   */
+  std::vector<Value> histogram_;
+  /** Fraction of the rows covered by the histogram, i.e. neither null nor a most common value */
+  double histogram_fraction_{0};
+
+  auto ToString() const -> std::string;
+};
+
+/**
+ * CollectedStats is what one ANALYZE computes for a table.
+ */
+struct CollectedStats {
+  size_t row_count_{0};
+  /** Statistics of every column of the schema */
+  std::vector<ColumnStats> columns_;
+  /**
+   * Estimated number of distinct (a, b) combinations for the pairs a < b of the first STATS_MAX_PAIR_COLUMNS
+   * columns. Compared with ndv(a) * ndv(b) it tells how correlated the two columns are.
+   */
+  std::map<std::pair<uint32_t, uint32_t>, size_t> pair_ndv_;
+};
+
+/**
+ * TableStats is the statistics store of one table kept in its TableInfo.
+ *
+ * ANALYZE scans the table once: every row feeds the row count and the HyperLogLog sketches, and a fixed-size
+ * reservoir sample feeds the null fractions, most common values and histograms. Between two ANALYZE runs the insert
+ * and delete executors report the rows they modify, so the row count stays approximately current.
+ * New column statistics are installed while holding the catalog lock exclusively.
+ */
+class TableStats {
+ public:
+  /**
+   * Scan a table and compute its statistics.
+   * @param heap the table to scan
+   * @param schema the schema of the table
+   * @param txn the transaction performing the scan
+   * @return the row count, the statistics of every column of schema and the pairwise distinct counts
+   */
+  static auto Collect(TableHeap *heap, const Schema &schema, Transaction *txn) -> CollectedStats;
+
+  /** Replace the statistics by the ones computed by Collect, the DML counters restart from zero. */
+  void Install(CollectedStats stats) {
+    analyzed_row_count_ = stats.row_count_;
+    inserted_ = 0;
+    deleted_ = 0;
+    columns_ = std::move(stats.columns_);
+    pair_ndv_ = std::move(stats.pair_ndv_);
+  }
+
+  /** Report rows inserted into the table. */
+  void RecordInsert(size_t rows) { inserted_ += rows; }
+
+  /** Report rows deleted from the table. */
+  void RecordDelete(size_t rows) { deleted_ += rows; }
+
+  /** @return the estimated number of rows: the count of the last ANALYZE corrected by the DML since */
+  auto GetRowCount() const -> size_t {
+    size_t added = analyzed_row_count_ + inserted_;
+    size_t removed = deleted_;
+    return added > removed ? added - removed : 0;
+  }
+
+  /** @return the number of rows inserted or deleted since the last ANALYZE */
+  auto GetModifiedRowCount() const -> size_t { return inserted_ + deleted_; }
+
+  /** @return true if ANALYZE has computed the column statistics */
+  auto IsAnalyzed() const -> bool { return !columns_.empty(); }
+
+  /** @return the statistics of a column, or nullptr if the table was not analyzed */
+  auto GetColumnStats(uint32_t col_idx) const -> const ColumnStats * {
+    return col_idx < columns_.size() ? &columns_[col_idx] : nullptr;
+  }
+
+  /** @return the number of distinct combinations of two columns, if ANALYZE collected it */
+  auto GetPairDistinct(uint32_t col_a, uint32_t col_b) const -> std::optional<size_t> {
+    auto iter = pair_ndv_.find(std::minmax(col_a, col_b));
+    if (iter == pair_ndv_.end()) {
+      return std::nullopt;
+    }
+    return iter->second;
+  }
+
+ private:
+  size_t analyzed_row_count_{0};
+  std::atomic<size_t> inserted_{0};
+  std::atomic<size_t> deleted_{0};
+  std::vector<ColumnStats> columns_;
+  std::map<std::pair<uint32_t, uint32_t>, size_t> pair_ndv_;
+};
+
+}  // namespace bustub
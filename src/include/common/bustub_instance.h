@@ -17,6 +17,7 @@
 #include <optional>
 #include <shared_mutex>
 #include <sstream>
+#include <stdexcept>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -40,6 +41,8 @@ class LogManager;
 class CheckpointManager;
 class Catalog;
 class ExecutionEngine;
+class MemoryTracker;
+class AnalyzeStatement;
 
 class ResultWriter {
  public:
@@ -252,6 +255,8 @@ class BustubInstance {
   CheckpointManager *checkpoint_manager_;
   Catalog *catalog_;
   ExecutionEngine *execution_engine_;
+  /** The memory every running query is charged against, limited by `global_memory_limit`. */
+  MemoryTracker *memory_tracker_;
   std::shared_mutex catalog_lock_;
 
   auto GetSessionVariable(const std::string &key) -> std::string {
@@ -261,6 +266,15 @@ class BustubInstance {
     return "";
   }
 
+  /** @return the size in bytes held by a session variable, 0 (unlimited) if it is unset or not a number */
+  auto GetMemoryLimit(const std::string &key) -> size_t {
+    try {
+      return std::stoull(GetSessionVariable(key));
+    } catch (const std::logic_error &e) {
+      return 0;
+    }
+  }
+
   auto IsForceStarterRule() -> bool {
     auto variable = StringUtil::Lower(GetSessionVariable("force_optimizer_starter_rule"));
     return variable == "1" || variable == "true" || variable == "yes";
@@ -270,6 +284,7 @@ class BustubInstance {
   void CmdDisplayTables(ResultWriter &writer);
   void CmdDisplayIndices(ResultWriter &writer);
   void CmdDisplayHelp(ResultWriter &writer);
+  void ExecuteAnalyze(const AnalyzeStatement &stmt, Transaction *txn, ResultWriter &writer);
   void WriteOneCell(const std::string &cell, ResultWriter &writer);
   std::unordered_map<std::string, std::string> session_variables_;
 };
@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <chrono>  // NOLINT
+#include <cstddef>
 #include <cstdint>
 
 namespace bustub {
@@ -21,12 +22,21 @@ namespace bustub {
 /** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
 extern std::chrono::milliseconds cycle_detection_interval;
 
+/** Under the TIMEOUT deadlock policy, a lock request aborts its transaction after waiting for LOCK_WAIT_TIMEOUT. */
+extern std::chrono::milliseconds lock_wait_timeout;
+
 /** True if logging should be enabled, false otherwise. */
 extern std::atomic<bool> enable_logging;
 
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** A committing transaction waits at most GROUP_COMMIT_DELAY for other commits to share its log flush. */
+extern std::chrono::microseconds group_commit_delay;
+
+/** The log is flushed without waiting out GROUP_COMMIT_DELAY once GROUP_COMMIT_BATCH_SIZE commits wait for it. */
+extern size_t group_commit_batch_size;
+
 static constexpr int INVALID_PAGE_ID = -1;                                           // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                            // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                               // invalid log sequence number
@@ -36,11 +46,18 @@ static constexpr int BUFFER_POOL_SIZE = 10;
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * BUSTUB_PAGE_SIZE);  // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                               // size of extendible hash bucket
 static constexpr int LRUK_REPLACER_K = 10;  // lookback window for lru-k replacer
+static constexpr int DML_BATCH_SIZE = 1024;  // number of tuples an insert / delete executor modifies at once
+static constexpr int STATS_SAMPLE_SIZE = 30000;     // rows sampled by ANALYZE for histograms and most common values
+static constexpr int STATS_HISTOGRAM_BUCKETS = 16;  // buckets of the equi-depth histogram of a column
+static constexpr int STATS_MCV_COUNT = 8;           // most common values kept per column
+static constexpr int STATS_MAX_PAIR_COLUMNS = 8;    // columns whose pairwise distinct counts ANALYZE collects
+static constexpr int LOCK_ESCALATION_THRESHOLD = 1000;  // row locks on a table before escalating to a table lock
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
 using txn_id_t = int32_t;      // transaction id type
 using lsn_t = int32_t;         // log sequence number type
+using timestamp_t = int64_t;   // commit timestamp type
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
 
@@ -13,10 +13,12 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <chrono>              // NOLINT
 #include <condition_variable>  // NOLINT
-#include <list>
 #include <memory>
 #include <mutex>  // NOLINT
+#include <optional>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -24,7 +26,9 @@
 #include <vector>
 
 #include "common/config.h"
+#include "common/macros.h"
 #include "common/rid.h"
+#include "common/util/hash_util.h"
 #include "concurrency/transaction.h"
 
 namespace bustub {
@@ -60,17 +64,78 @@ class LockManager {
     RID rid_;
     /** Whether the lock has been granted or not */
     bool granted_{false};
+    /** Notified when the request may be granted now, or when its transaction was aborted while it waits */
+    std::condition_variable cv_;
+    /** Neighbours in the queue of the resource, the queue is intrusive so enqueueing a request allocates nothing */
+    LockRequest *prev_{nullptr};
+    LockRequest *next_{nullptr};
+  };
+
+  /**
+   * Intrusive doubly linked list of the lock requests on a resource, in FIFO order. Requests are owned by the lock
+   * manager: they come from a per-thread pool and go back to it once removed. The list deletes the requests that
+   * are still queued when it is destroyed.
+   */
+  class LockRequestList {
+   public:
+    class Iterator {
+     public:
+      explicit Iterator(LockRequest *request) : request_(request) {}
+      auto operator*() const -> LockRequest * { return request_; }
+      auto operator++() -> Iterator & {
+        request_ = request_->next_;
+        return *this;
+      }
+      auto operator==(const Iterator &other) const -> bool { return request_ == other.request_; }
+      auto operator!=(const Iterator &other) const -> bool { return request_ != other.request_; }
+
+     private:
+      friend class LockRequestList;
+      LockRequest *request_;
+    };
+
+    LockRequestList() = default;
+    DISALLOW_COPY_AND_MOVE(LockRequestList);
+    ~LockRequestList() {
+      while (head_ != nullptr) {
+        auto *next = head_->next_;
+        delete head_;
+        head_ = next;
+      }
+    }
+
+    auto begin() const -> Iterator { return Iterator(head_); }  // NOLINT
+    auto end() const -> Iterator { return Iterator(nullptr); }  // NOLINT
+    auto Empty() const -> bool { return head_ == nullptr; }
+
+    void PushBack(LockRequest *request) { Insert(end(), request); }
+
+    /** Insert request in front of pos */
+    void Insert(Iterator pos, LockRequest *request) {
+      auto *next = pos.request_;
+      auto *prev = next == nullptr ? tail_ : next->prev_;
+      request->prev_ = prev;
+      request->next_ = next;
+      (prev == nullptr ? head_ : prev->next_) = request;
+      (next == nullptr ? tail_ : next->prev_) = request;
+    }
+
+    void Remove(LockRequest *request) {
+      (request->prev_ == nullptr ? head_ : request->prev_->next_) = request->next_;
+      (request->next_ == nullptr ? tail_ : request->next_->prev_) = request->prev_;
+      request->prev_ = nullptr;
+      request->next_ = nullptr;
+    }
+
+   private:
+    LockRequest *head_{nullptr};
+    LockRequest *tail_{nullptr};
   };
 
   class LockRequestQueue {
    public:
-    /**
-     *  List of lock requests for the same resource (table or row)
-     *  这里修改了request_queue_的定义，使用智能指针管理lock_request，自动释放资源，避免手动改释放
-     * */
-    std::list<std::shared_ptr<LockRequest>> request_queue_;
-    /** For notifying blocked transactions on this rid */
-    std::condition_variable cv_;
+    /** List of lock requests for the same resource (table or row) */
+    LockRequestList request_queue_;
     /** txn_id of an upgrading transaction (if any) */
     txn_id_t upgrading_ = INVALID_TXN_ID;
     /** coordination */
@@ -78,7 +143,8 @@ class LockManager {
   };
 
   /**
-   * Creates a new lock manager configured for the deadlock detection policy.
+   * Creates a new lock manager. Transactions under the DETECTION deadlock policy are handled by the background cycle
+   * detection, the other policies are applied when a request has to block (see DeadlockPolicy).
    */
   LockManager() {
     enable_cycle_detection_ = true;
@@ -136,6 +202,14 @@ class LockManager {
    *        X, IX locks are allowed in the GROWING state.
    *        S, IS, SIX locks are never allowed
    *
+   *    SNAPSHOT_ISOLATION:
+   *        Reads take no locks, writes take IX, X locks.
+   *        All locks are allowed in the GROWING state
+   *        No locks are allowed in the SHRINKING state
+   *
+   *    OPTIMISTIC:
+   *        Same as SNAPSHOT_ISOLATION, the reads are validated on commit instead.
+   *
    *
    * MULTILEVEL LOCKING:
    *    While locking rows, Lock() should ensure that the transaction has an appropriate lock on the table which the row
@@ -168,6 +242,27 @@ class LockManager {
    * BOOK KEEPING:
    *    If a lock is granted to a transaction, lock manager should update its
    *    lock sets appropriately (check transaction.h)
+   *
+   *
+   * LOCK ESCALATION:
+   *    Once a transaction outside READ_COMMITTED holds LOCK_ESCALATION_THRESHOLD row locks on a table, LockRow()
+   *    upgrades its table lock to cover the rows (S, SIX or X) and releases the row locks, if the upgrade can be
+   *    granted without waiting. From then on rows covered by the table lock are not locked on their own, and
+   *    unlocking them succeeds without effect.
+   *
+   *
+   * KEY RANGE LOCKING:
+   *    Row locks only cover the rows a scan returned, so REPEATABLE_READ range scans over an index also lock the
+   *    gaps between the keys they read (next-key locking). LockKeyRange() locks an entry of an index, named by the
+   *    RID it points to, together with the gap between it and the previous key; an invalid RID names the gap after
+   *    the last key. Entries and gaps are locked in the following modes:
+   *        S   a scan read the key and the gap in front of it
+   *        IX  the transaction inserts a key into the gap, or may put one back there when it rolls back a delete.
+   *            IX locks are compatible with each other, so inserts into the same gap do not block each other
+   *        X   the transaction deletes the key
+   *    A transaction asking for another mode on an entry it already locked gets the combination of both modes
+   *    (S and IX make SIX). Key range locks are held until the transaction commits or aborts. They do not replace
+   *    the locks on the table and the rows, a transaction holding S, SIX or X on the table needs none.
    */
 
   /**
@@ -201,6 +296,9 @@ class LockManager {
    *        S locks are not permitted under READ_UNCOMMITTED.
    *            The behaviour upon unlocking an S lock under this isolation level is undefined.
    *
+   *    SNAPSHOT_ISOLATION, OPTIMISTIC:
+   *        Unlocking S/X locks should set the transaction state to SHRINKING
+   *
    *
    * BOOK KEEPING:
    *    After a resource is unlocked, lock manager should update the transaction's lock sets
@@ -268,6 +366,29 @@ class LockManager {
    */
   auto UnlockRow(Transaction *txn, const table_oid_t &oid, const RID &rid) -> bool;
 
+  /**
+   * Acquire a key range lock on an index entry and the gap in front of it, see KEY RANGE LOCKING in [LOCK_NOTE].
+   * If the transaction already holds a key range lock on the entry, upgrade it to cover lock_mode as well.
+   *
+   * @param txn the transaction requesting the lock
+   * @param lock_mode SHARED, INTENTION_EXCLUSIVE or EXCLUSIVE
+   * @param index_oid the index
+   * @param rid the RID of the entry, an invalid RID for the gap after the last key
+   * @return true if the lock is granted, false if the transaction was aborted while waiting
+   */
+  auto LockKeyRange(Transaction *txn, LockMode lock_mode, const index_oid_t &index_oid, const RID &rid) -> bool;
+
+  /**
+   * Release a key range lock held by the transaction, without changing its state: key range locks are only released
+   * when the transaction ends.
+   *
+   * @param txn the transaction releasing the lock
+   * @param index_oid the index
+   * @param rid the RID of the locked entry
+   * @return true if the unlock is successful
+   */
+  auto UnlockKeyRange(Transaction *txn, const index_oid_t &index_oid, const RID &rid) -> bool;
+
   /*** Graph API ***/
 
   /**
@@ -296,24 +417,31 @@ class LockManager {
    */
   auto GetEdgeList() -> std::vector<std::pair<txn_id_t, txn_id_t>>;
 
+  /**
+   * @return the number of row lock queues in the row lock table, queues without requests are reclaimed
+   */
+  auto GetRowLockQueueCount() -> size_t;
+
+  /**
+   * @return the number of key range lock queues, queues without requests are reclaimed
+   */
+  auto GetKeyRangeLockQueueCount() -> size_t;
+
   /**
    * Runs cycle detection in the background.
    */
   auto RunCycleDetection() -> void;
 
-  auto GrantLock(const std::shared_ptr<LockRequest> &lock_request,
-                 const std::shared_ptr<LockRequestQueue> &lock_request_queue) -> bool;
+  auto GrantLock(LockRequest *lock_request, const std::shared_ptr<LockRequestQueue> &lock_request_queue) -> bool;
   /**
    * 当一个事务加上一把锁时，需要维护事务内部的锁集合
    * @param t1 需要维护的事务
    * @param t2 锁请求
    * @param t3 插入还是删除
    */
-  auto InsertOrDeleteTableLockSet(Transaction *txn, const std::shared_ptr<LockRequest> &lock_request, bool insert)
-      -> void;
+  auto InsertOrDeleteTableLockSet(Transaction *txn, LockRequest *lock_request, bool insert) -> void;
 
-  auto InsertOrDeleteRowLockSet(Transaction *txn, const std::shared_ptr<LockRequest> &lock_request, bool insert)
-      -> void;
+  auto InsertOrDeleteRowLockSet(Transaction *txn, LockRequest *lock_request, bool insert) -> void;
 
   auto InsertRowLockSet(const std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> &lock_set,
                         const table_oid_t &oid, const RID &rid) -> void {
@@ -335,35 +463,84 @@ class LockManager {
   }
 
  private:
-  auto Dfs(txn_id_t txn_id) -> bool {
-    // 如果这个txn_id在安全的集合中找到了，说明不存在环
-    if (safe_set_.find(txn_id) != safe_set_.end()) {
-      return false;
-    }
-    // 将自己事务id加入到死锁集合
-    active_set_.insert(txn_id);
-    // 取得该事务txn_id所有的依赖事务
-    std::vector<txn_id_t> &next_node_vector = waits_for_[txn_id];
-    // 排序 为啥要排序呢？
-    std::sort(next_node_vector.begin(), next_node_vector.end());
-    for (txn_id_t const next_node : next_node_vector) {
-      // 如果这个节点是死锁节点
-      if (active_set_.find(next_node) != active_set_.end()) {
-        return true;
-      }
-      // 如果不在死锁节点则继续查找
-      if (Dfs(next_node)) {
-        return true;
-      }
-    }
+  /**
+   * Search the waits-for graph from start for a cycle. Callers hold waits_for_latch_.
+   * @param[out] txn_id if a cycle is reachable from start, will contain the newest transaction ID on it
+   */
+  auto FindCycle(txn_id_t start, txn_id_t *txn_id) -> bool;
 
-    // 删除
-    active_set_.erase(txn_id);
-    // 插入安全集合
-    safe_set_.insert(txn_id);
-    return false;
-  }
-  auto DeleteNode(txn_id_t txn_id) -> void;
+  auto Dfs(txn_id_t txn, std::vector<txn_id_t> *path, std::unordered_set<txn_id_t> *visited, txn_id_t *txn_id)
+      -> bool;
+
+  /**
+   * Recompute the waits-for edges of the transactions waiting in a queue: a waiting request waits for every request
+   * in front of it. Transactions granted since the last update lose their edges. Callers hold the latch of the queue.
+   */
+  void UpdateWaitsFor(const std::shared_ptr<LockRequestQueue> &lock_request_queue);
+
+  /**
+   * Release the row lock txn holds on rid without changing the state of txn.
+   * @return the mode of the released lock, std::nullopt if txn does not hold a lock on rid
+   */
+  auto ReleaseRowLock(Transaction *txn, const RID &rid) -> std::optional<LockMode>;
+
+  /** @return the number of rows of a table txn holds locks on */
+  static auto CountRowLocks(Transaction *txn, const table_oid_t &oid) -> size_t;
+
+  /** @return whether the table lock txn holds on oid already grants lock_mode on every row of the table */
+  static auto IsRowCoveredByTableLock(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool;
+
+  /**
+   * Escalate the row locks txn holds on a table to a table lock covering lock_mode, and release the covered row
+   * locks. S row locks escalate to S (or SIX when txn holds IX), X row locks escalate to X.
+   * @return false if the table lock can not be upgraded without waiting, nothing changes then
+   */
+  auto EscalateRowLocks(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool;
+
+  /** Upgrade the granted table lock txn holds on oid to lock_mode in place, only if that needs no waiting */
+  auto TryUpgradeTableLock(Transaction *txn, LockMode lock_mode, const table_oid_t &oid) -> bool;
+
+  /**
+   * Block a request that can not be granted yet as the deadlock policy of txn says. Callers hold the latch of the
+   * queue through lock. If txn is ABORTED on return it has to withdraw the request, otherwise the caller retries.
+   * @param deadline when the request gives up under the TIMEOUT policy
+   */
+  void WaitForGrant(Transaction *txn, LockRequest *lock_request,
+                    const std::shared_ptr<LockRequestQueue> &lock_request_queue, std::unique_lock<std::mutex> *lock,
+                    std::chrono::steady_clock::time_point deadline);
+
+  /**
+   * @return the transactions a waiting request is blocked by: the incompatible granted requests and the waiting
+   * requests in front of it. Callers hold the latch of the queue.
+   */
+  static auto GetBlockers(LockRequest *lock_request, const std::shared_ptr<LockRequestQueue> &lock_request_queue)
+      -> std::vector<txn_id_t>;
+
+  /**
+   * Wake the first waiting request of a queue if it can be granted now. Only that request can be granted next, so
+   * the other waiters keep sleeping; a request that gets granted wakes the one after it. Callers hold the latch of
+   * the queue.
+   */
+  void NotifyGrantable(const std::shared_ptr<LockRequestQueue> &lock_request_queue);
+
+  /** Wake the waiting request of an aborted transaction in a queue. Callers hold the latch of the queue. */
+  static void NotifyWaiter(const std::shared_ptr<LockRequestQueue> &lock_request_queue, txn_id_t txn_id);
+
+  /** Remove the edges of a transaction that stopped waiting because it was aborted */
+  void RemoveWaiter(txn_id_t txn_id);
+
+  /** @return whether a queue has requests that are not granted yet. Callers hold the latch of the queue. */
+  static auto HasWaiters(const std::shared_ptr<LockRequestQueue> &lock_request_queue) -> bool;
+
+  /** Erase the queue of rid from the row lock table if it is still empty */
+  void ReclaimRowLockQueue(const RID &rid, const std::shared_ptr<LockRequestQueue> &lock_request_queue);
+
+  /** Erase the queue of an index entry from the key range lock table if it is still empty */
+  void ReclaimKeyRangeLockQueue(const index_oid_t &index_oid, const RID &rid,
+                                const std::shared_ptr<LockRequestQueue> &lock_request_queue);
+
+  /** @return the mode of a key range lock that grants both held and requested */
+  static auto CombineKeyRangeLockMode(LockMode held, LockMode requested) -> LockMode;
 
  private:
   /** Fall 2022 */
@@ -372,23 +549,44 @@ class LockManager {
   /** Coordination */
   std::mutex table_lock_map_latch_;
 
-  /** Structure that holds lock requests for a given RID */
-  std::unordered_map<RID, std::shared_ptr<LockRequestQueue>> row_lock_map_;
+  /**
+   * One partition of the row lock table. A row lock only latches the partition its RID hashes to, so transactions
+   * locking different rows rarely contend on the same latch. Queues that become empty are erased from the partition.
+   */
+  struct RowLockShard {
+    /** Structure that holds lock requests for the RIDs of this partition */
+    std::unordered_map<RID, std::shared_ptr<LockRequestQueue>> row_lock_map_;
+    /** Coordination */
+    std::mutex latch_;
+  };
+
+  /** @return the partition of the row lock table rid belongs to */
+  auto GetRowLockShard(const RID &rid) -> RowLockShard & {
+    auto key = rid.Get();
+    return row_lock_shards_[HashUtil::Hash(&key) % ROW_LOCK_SHARDS];
+  }
+
+  static constexpr size_t ROW_LOCK_SHARDS = 16;
+  std::array<RowLockShard, ROW_LOCK_SHARDS> row_lock_shards_;
+
+  /** Structure that holds lock requests for the entries of each index, see KEY RANGE LOCKING */
+  std::unordered_map<index_oid_t, std::unordered_map<RID, std::shared_ptr<LockRequestQueue>>> key_range_lock_map_;
   /** Coordination */
-  std::mutex row_lock_map_latch_;
+  std::mutex key_range_lock_map_latch_;
 
   std::atomic<bool> enable_cycle_detection_;
   std::thread *cycle_detection_thread_;
-  /** Waits-for graph representation. */
+  /**
+   * Waits-for graph representation, maintained when requests start waiting, are granted, or leave a queue. Out-edges
+   * are sorted.
+   */
   std::unordered_map<txn_id_t, std::vector<txn_id_t>> waits_for_;
+  /** The queue every waiting transaction is blocked on, to wake it up when it is aborted */
+  std::unordered_map<txn_id_t, std::shared_ptr<LockRequestQueue>> waiting_on_;
+  /** Transactions whose out-edges changed since the last cycle detection, any new cycle goes through one of them */
+  std::set<txn_id_t> changed_txns_;
+  /** Coordination, always taken after the latch of a queue */
   std::mutex waits_for_latch_;
-
-  std::set<txn_id_t> safe_set_;              // 已经安全的事务集合
-  std::set<txn_id_t> txn_set_;               // 所有的事务集合
-  std::unordered_set<txn_id_t> active_set_;  // 活跃的事务集合
-
-  std::unordered_map<txn_id_t, RID> map_txn_rid_;
-  std::unordered_map<txn_id_t, table_oid_t> map_txn_oid_;
 };
 
 }  // namespace bustub
@@ -46,8 +46,29 @@ enum class TransactionState { GROWING, SHRINKING, COMMITTED, ABORTED };
 
 /**
  * Transaction isolation level.
+ *
+ * SNAPSHOT_ISOLATION: reads take no lock and see the versions committed before the transaction began, writes take
+ * exclusive locks and abort the transaction if the tuple was written by a transaction that committed after it began
+ * (first writer wins).
+ *
+ * OPTIMISTIC: serializable optimistic concurrency control for short transactions. Reads take no lock and see the
+ * snapshot like SNAPSHOT_ISOLATION, but are recorded in the read set. When a transaction that wrote commits, it
+ * validates that no other transaction committed a newer version of what it read since its snapshot, otherwise it
+ * aborts instead. Writes take IX, X locks like SNAPSHOT_ISOLATION, so it runs side by side with the 2PL levels.
  */
-enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED };
+enum class IsolationLevel { READ_UNCOMMITTED, REPEATABLE_READ, READ_COMMITTED, SNAPSHOT_ISOLATION, OPTIMISTIC };
+
+/**
+ * How the lock manager handles a lock request that has to block. Transaction ids are used as timestamps, a smaller
+ * id is an older transaction.
+ *
+ * DETECTION:  wait, the background cycle detection aborts the newest transaction of a deadlock.
+ * WAIT_DIE:   an older requester waits, a younger requester aborts itself.
+ * WOUND_WAIT: an older requester aborts (wounds) the younger transactions in front of it, a younger requester waits.
+ * NO_WAIT:    abort instead of waiting.
+ * TIMEOUT:    wait for at most lock_wait_timeout, then abort.
+ */
+enum class DeadlockPolicy { DETECTION, WAIT_DIE, WOUND_WAIT, NO_WAIT, TIMEOUT };
 
 /**
  * Type of write operation.
@@ -56,6 +77,7 @@ enum class WType { INSERT = 0, DELETE, UPDATE };
 
 class TableHeap;
 class Catalog;
+class Index;
 using table_oid_t = uint32_t;
 using index_oid_t = uint32_t;
 
@@ -100,6 +122,21 @@ class IndexWriteRecord {
   Catalog *catalog_;
 };
 
+/**
+ * IndexScanRecord tracks a point lookup of an OPTIMISTIC transaction, it is repeated on commit to find the tuples
+ * inserted under the key since the snapshot (phantoms).
+ */
+class IndexScanRecord {
+ public:
+  IndexScanRecord(Index *index, const Tuple &key, TableHeap *table) : index_(index), key_(key), table_(table) {}
+
+  Index *index_;
+  /** The key looked up, in the key schema of the index. */
+  Tuple key_;
+  /** The table heap the index points into. */
+  TableHeap *table_;
+};
+
 /**
  * Reason to a transaction abortion
  */
@@ -171,10 +208,14 @@ class Transaction {
         ix_table_lock_set_{new std::unordered_set<table_oid_t>},
         six_table_lock_set_{new std::unordered_set<table_oid_t>},
         s_row_lock_set_{new std::unordered_map<table_oid_t, std::unordered_set<RID>>},
-        x_row_lock_set_{new std::unordered_map<table_oid_t, std::unordered_set<RID>>} {
+        x_row_lock_set_{new std::unordered_map<table_oid_t, std::unordered_set<RID>>},
+        key_range_lock_set_{new std::unordered_map<index_oid_t, std::unordered_set<RID>>} {
     // Initialize the sets that will be tracked.
     table_write_set_ = std::make_shared<std::deque<TableWriteRecord>>();
     index_write_set_ = std::make_shared<std::deque<IndexWriteRecord>>();
+    table_read_set_ = std::make_shared<std::unordered_map<TableHeap *, std::unordered_set<RID>>>();
+    table_scan_set_ = std::make_shared<std::unordered_set<TableHeap *>>();
+    index_scan_set_ = std::make_shared<std::deque<IndexScanRecord>>();
     page_set_ = std::make_shared<std::deque<bustub::Page *>>();
     deleted_page_set_ = std::make_shared<std::unordered_set<page_id_t>>();
   }
@@ -192,12 +233,41 @@ class Transaction {
   /** @return the isolation level of this transaction */
   inline auto GetIsolationLevel() const -> IsolationLevel { return isolation_level_; }
 
+  /** @return how the lock manager handles the lock requests of this transaction that have to block */
+  inline auto GetDeadlockPolicy() const -> DeadlockPolicy { return deadlock_policy_; }
+
+  /**
+   * Set the deadlock policy, overriding the default of the transaction manager.
+   * @param deadlock_policy new deadlock policy
+   */
+  inline void SetDeadlockPolicy(DeadlockPolicy deadlock_policy) { deadlock_policy_ = deadlock_policy; }
+
+  /** @return the commit timestamp of the snapshot this transaction reads, under SNAPSHOT_ISOLATION and OPTIMISTIC */
+  inline auto GetReadTs() const -> timestamp_t { return read_ts_; }
+
+  /**
+   * Set the snapshot of the transaction, called by the transaction manager when it begins.
+   * @param read_ts the last commit timestamp when the transaction began
+   */
+  inline void SetReadTs(timestamp_t read_ts) { read_ts_ = read_ts; }
+
   /** @return the list of table write records of this transaction */
   inline auto GetWriteSet() -> std::shared_ptr<std::deque<TableWriteRecord>> { return table_write_set_; }
 
   /** @return the list of index write records of this transaction */
   inline auto GetIndexWriteSet() -> std::shared_ptr<std::deque<IndexWriteRecord>> { return index_write_set_; }
 
+  /** @return the tuples read by this OPTIMISTIC transaction, per table */
+  inline auto GetReadSet() -> std::shared_ptr<std::unordered_map<TableHeap *, std::unordered_set<RID>>> {
+    return table_read_set_;
+  }
+
+  /** @return the tables this OPTIMISTIC transaction scanned as a whole, validated at table granularity */
+  inline auto GetTableScanSet() -> std::shared_ptr<std::unordered_set<TableHeap *>> { return table_scan_set_; }
+
+  /** @return the index point lookups of this OPTIMISTIC transaction */
+  inline auto GetIndexScanSet() -> std::shared_ptr<std::deque<IndexScanRecord>> { return index_scan_set_; }
+
   /** @return the page set */
   inline auto GetPageSet() -> std::shared_ptr<std::deque<Page *>> { return page_set_; }
 
@@ -217,6 +287,12 @@ class Transaction {
     index_write_set_->push_back(write_record);
   }
 
+  /**
+   * Adds an index point lookup into the index scan set.
+   * @param scan_record scan record to be added
+   */
+  inline void AppendIndexScanRecord(const IndexScanRecord &scan_record) { index_scan_set_->push_back(scan_record); }
+
   /**
    * Adds a page into the page set.
    * @param page page to be added
@@ -301,6 +377,29 @@ class Transaction {
     return six_table_lock_set_->find(oid) != six_table_lock_set_->end();
   }
 
+  /** @return the index entries this transaction holds key range locks on, per index */
+  inline auto GetKeyRangeLockSet() -> std::shared_ptr<std::unordered_map<index_oid_t, std::unordered_set<RID>>> {
+    return key_range_lock_set_;
+  }
+
+  /** @return true if the row locks of table oid were escalated to a table lock, rows it covers are not locked */
+  auto IsTableLockEscalated(const table_oid_t &oid) -> bool {
+    return escalated_table_set_.find(oid) != escalated_table_set_.end();
+  }
+
+  /**
+   * Mark whether the row locks of a table were escalated to a table lock, called by the lock manager.
+   * @param oid the table
+   * @param escalated whether the table lock now stands in for row locks
+   */
+  inline void SetTableLockEscalated(const table_oid_t &oid, bool escalated) {
+    if (escalated) {
+      escalated_table_set_.insert(oid);
+    } else {
+      escalated_table_set_.erase(oid);
+    }
+  }
+
   /** @return the current state of the transaction */
   inline auto GetState() -> TransactionState { return state_; }
 
@@ -314,6 +413,25 @@ class Transaction {
    */
   inline void SetState(TransactionState state) { state_ = state; }
 
+  /** Move the transaction from GROWING to SHRINKING, a transaction that already ended keeps its state. */
+  inline void TryShrink() {
+    auto expected = TransactionState::GROWING;
+    state_.compare_exchange_strong(expected, TransactionState::SHRINKING);
+  }
+
+  /**
+   * Abort the transaction on behalf of another one, e.g. wounded by an older transaction. The check and the write are
+   * one atomic step, so a transaction that commits concurrently is never turned back into ABORTED.
+   * @return true if the transaction was still GROWING or SHRINKING and is now ABORTED
+   */
+  inline auto TryWound() -> bool { return EndIfActive(TransactionState::ABORTED); }
+
+  /**
+   * Mark the transaction as COMMITTED, called by the transaction manager on commit.
+   * @return false if the transaction was aborted before it could commit
+   */
+  inline auto TryCommit() -> bool { return EndIfActive(TransactionState::COMMITTED); }
+
   /** @return the previous LSN */
   inline auto GetPrevLSN() -> lsn_t { return prev_lsn_; }
 
@@ -323,11 +441,41 @@ class Transaction {
    */
   inline void SetPrevLSN(lsn_t prev_lsn) { prev_lsn_ = prev_lsn; }
 
+  /** @return how many lock requests of this transaction had to block before being granted or aborted */
+  inline auto GetLockWaitCount() const -> uint64_t { return lock_wait_count_; }
+
+  /** @return the total time in microseconds this transaction spent blocked on lock requests */
+  inline auto GetLockWaitMicros() const -> uint64_t { return lock_wait_us_; }
+
+  /**
+   * Record one blocked lock request, called by the lock manager.
+   * @param micros how long the request was blocked
+   */
+  inline void AddLockWait(uint64_t micros) {
+    lock_wait_count_++;
+    lock_wait_us_ += micros;
+  }
+
  private:
-  /** The current transaction state. */
-  TransactionState state_{TransactionState::GROWING};
+  /** Move the transaction into state if it is GROWING or SHRINKING. */
+  inline auto EndIfActive(TransactionState state) -> bool {
+    auto expected = state_.load();
+    while (expected == TransactionState::GROWING || expected == TransactionState::SHRINKING) {
+      if (state_.compare_exchange_weak(expected, state)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /** The current transaction state, other transactions may abort it concurrently. */
+  std::atomic<TransactionState> state_{TransactionState::GROWING};
   /** The isolation level of the transaction. */
   IsolationLevel isolation_level_;
+  /** The deadlock policy of the transaction. */
+  DeadlockPolicy deadlock_policy_{DeadlockPolicy::DETECTION};
+  /** The snapshot read by the transaction under SNAPSHOT_ISOLATION and OPTIMISTIC. */
+  timestamp_t read_ts_{0};
   /** The thread ID, used in single-threaded transactions. */
   std::thread::id thread_id_;
   /** The ID of this transaction. */
@@ -337,8 +485,15 @@ class Transaction {
   std::shared_ptr<std::deque<TableWriteRecord>> table_write_set_;
   /** The undo set of indexes. */
   std::shared_ptr<std::deque<IndexWriteRecord>> index_write_set_;
+  /** The read set of an OPTIMISTIC transaction: tuples, whole tables and index point lookups. */
+  std::shared_ptr<std::unordered_map<TableHeap *, std::unordered_set<RID>>> table_read_set_;
+  std::shared_ptr<std::unordered_set<TableHeap *>> table_scan_set_;
+  std::shared_ptr<std::deque<IndexScanRecord>> index_scan_set_;
   /** The LSN of the last record written by the transaction. */
   lsn_t prev_lsn_;
+  /** Lock wait statistics, reported by EXPLAIN ANALYZE. */
+  uint64_t lock_wait_count_{0};
+  uint64_t lock_wait_us_{0};
 
   std::mutex latch_;
 
@@ -358,10 +513,14 @@ class Transaction {
   std::shared_ptr<std::unordered_set<table_oid_t>> is_table_lock_set_;
   std::shared_ptr<std::unordered_set<table_oid_t>> ix_table_lock_set_;
   std::shared_ptr<std::unordered_set<table_oid_t>> six_table_lock_set_;
+  /** LockManager: the tables whose row locks were escalated to the table lock. */
+  std::unordered_set<table_oid_t> escalated_table_set_;
 
   /** LockManager: the set of row locks held by this transaction. */
   std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> s_row_lock_set_;
   std::shared_ptr<std::unordered_map<table_oid_t, std::unordered_set<RID>>> x_row_lock_set_;
+  /** LockManager: the set of key range locks held by this transaction. */
+  std::shared_ptr<std::unordered_map<index_oid_t, std::unordered_set<RID>>> key_range_lock_set_;
 };
 
 }  // namespace bustub
@@ -12,8 +12,12 @@
 
 #pragma once
 
+#include <array>
 #include <atomic>
-#include <shared_mutex>
+#include <deque>
+#include <mutex>  // NOLINT
+#include <set>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -45,10 +49,13 @@ class TransactionManager {
       -> Transaction *;
 
   /**
-   * Commits a transaction.
+   * Commits a transaction. An OPTIMISTIC transaction that wrote is validated first, and aborted instead if another
+   * transaction committed a newer version of what it read since its snapshot. With logging enabled, a transaction
+   * that wrote returns once its commit record is durable, sharing the log flush with the commits around it.
    * @param txn the transaction to commit
+   * @return false if the validation failed and the transaction was aborted
    */
-  void Commit(Transaction *txn);
+  auto Commit(Transaction *txn) -> bool;
 
   /**
    * Aborts a transaction
@@ -57,12 +64,25 @@ class TransactionManager {
   void Abort(Transaction *txn);
 
   /**
-   * Global list of running transactions
+   * Set the deadlock policy of the transactions created by Begin from now on.
+   * @param deadlock_policy the default deadlock policy
    */
+  void SetDeadlockPolicy(DeadlockPolicy deadlock_policy) { deadlock_policy_ = deadlock_policy; }
 
-  /** The transaction map is a global list of all the running transactions in the system. */
-  static std::unordered_map<txn_id_t, Transaction *> txn_map;
-  static std::shared_mutex txn_map_mutex;
+  /** @return the deadlock policy of the transactions created by Begin */
+  auto GetDeadlockPolicy() const -> DeadlockPolicy { return deadlock_policy_; }
+
+  /**
+   * Reclaim the tuple versions that no running snapshot can see anymore. Commit and Abort call it, so it only
+   * needs to be called directly to reclaim the versions right away.
+   */
+  void GarbageCollect();
+
+  /** @return the oldest snapshot still running, or the last commit timestamp if there is none */
+  auto GetWatermark() -> timestamp_t {
+    std::scoped_lock lock(commit_latch_);
+    return running_snapshots_.empty() ? last_commit_ts_ : *running_snapshots_.begin();
+  }
 
   /**
    * Locates and returns the transaction with the given transaction ID.
@@ -70,9 +90,11 @@ class TransactionManager {
    * @return the transaction with the given transaction id
    */
   static auto GetTransaction(txn_id_t txn_id) -> Transaction * {
-    std::shared_lock<std::shared_mutex> l(TransactionManager::txn_map_mutex);
-    assert(TransactionManager::txn_map.find(txn_id) != TransactionManager::txn_map.end());
-    auto *res = TransactionManager::txn_map[txn_id];
+    auto &shard = GetTxnMapShard(txn_id);
+    std::scoped_lock lock(shard.latch_);
+    auto iter = shard.txn_map_.find(txn_id);
+    assert(iter != shard.txn_map_.end());
+    auto *res = iter->second;
     assert(res != nullptr);
     return res;
   }
@@ -120,8 +142,17 @@ class TransactionManager {
     for (auto oid : *txn->GetSharedIntentionExclusiveTableLockSet()) {
       table_lock_set.emplace(oid);
     }
+
+    /** Drop all key range locks */
+    auto key_range_lock_set = *txn->GetKeyRangeLockSet();
     txn->UnlockTxn();
 
+    for (const auto &[index_oid, rids] : key_range_lock_set) {
+      for (const auto &rid : rids) {
+        lock_manager_->UnlockKeyRange(txn, index_oid, rid);
+      }
+    }
+
     for (const auto &locked_table_row_set : row_lock_set) {
       table_oid_t oid = locked_table_row_set.first;
       for (auto rid : locked_table_row_set.second) {
@@ -134,12 +165,68 @@ class TransactionManager {
     }
   }
 
+  /** @return true if txn reads a snapshot, which keeps the versions committed after it from being reclaimed */
+  static auto HasSnapshot(Transaction *txn) -> bool {
+    return txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT_ISOLATION ||
+           txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC;
+  }
+
+  /** Stop tracking the snapshot of a finished transaction, the caller holds commit_latch_ */
+  void EndSnapshot(Transaction *txn) {
+    if (HasSnapshot(txn)) {
+      if (auto iter = running_snapshots_.find(txn->GetReadTs()); iter != running_snapshots_.end()) {
+        running_snapshots_.erase(iter);
+      }
+    }
+  }
+
+  /**
+   * Validate the read set of a committing OPTIMISTIC transaction, the caller holds commit_latch_ so that no other
+   * transaction commits in between.
+   * @return true if everything txn read is still the newest committed version
+   */
+  auto Validate(Transaction *txn) -> bool;
+
   std::atomic<txn_id_t> next_txn_id_{0};
+  /** Guards the commit timestamps and the snapshots of the running transactions. */
+  std::mutex commit_latch_;
+  timestamp_t last_commit_ts_{0};
+  std::multiset<timestamp_t> running_snapshots_;
+  /** Tuples whose older versions wait for the snapshots that may read them, in commit timestamp order. */
+  std::mutex gc_latch_;
+  std::deque<std::tuple<TableHeap *, RID, timestamp_t>> gc_queue_;
+  std::atomic<DeadlockPolicy> deadlock_policy_{DeadlockPolicy::DETECTION};
   LockManager *lock_manager_ __attribute__((__unused__));
   LogManager *log_manager_ __attribute__((__unused__));
 
-  /** The global transaction latch is used for checkpointing. */
-  ReaderWriterLatch global_txn_latch_;
+  /**
+   * The transaction map is a global list of all the running transactions in the system, partitioned by transaction id
+   * so that beginning and ending transactions on different cores do not contend on one latch. A transaction is
+   * removed when it ends, before its owner may delete it, and the lock manager only looks up transactions that still
+   * hold or wait for a lock.
+   */
+  struct TxnMapShard {
+    std::unordered_map<txn_id_t, Transaction *> txn_map_;
+    /** Coordination */
+    std::mutex latch_;
+  };
+
+  /** @return the partition of the transaction map txn_id belongs to */
+  static auto GetTxnMapShard(txn_id_t txn_id) -> TxnMapShard & {
+    return txn_map_shards[static_cast<size_t>(txn_id) % TXN_SHARDS];
+  }
+
+  /** Remove txn from the transaction map, unless a transaction with the same id was registered after it. */
+  static void UnregisterTransaction(Transaction *txn);
+
+  static constexpr size_t TXN_SHARDS = 16;
+  static std::array<TxnMapShard, TXN_SHARDS> txn_map_shards;
+
+  /**
+   * The global transaction latch is used for checkpointing. A running transaction holds the partition of its id in
+   * shared mode, a checkpoint takes all of them in exclusive mode.
+   */
+  std::array<ReaderWriterLatch, TXN_SHARDS> global_txn_latches_;
 };
 
 }  // namespace bustub
@@ -12,15 +12,42 @@
 
 #pragma once
 
+#include <cstdint>
+#include <unordered_map>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "catalog/catalog.h"
 #include "concurrency/transaction.h"
+#include "execution/memory_tracker.h"
 #include "storage/page/tmp_tuple_page.h"
 
 namespace bustub {
+
+class AbstractPlanNode;
+
+/**
+ * ExecutorStats is what EXPLAIN ANALYZE reports for one plan node. Time and page counters are inclusive,
+ * i.e. they contain the work done by the children of the node as well.
+ */
+struct ExecutorStats {
+  /** Number of Init calls, a join re-initializes its inner side once per outer tuple */
+  uint64_t loops_{0};
+  /** Number of tuples emitted */
+  uint64_t rows_{0};
+  uint64_t init_us_{0};
+  uint64_t next_us_{0};
+  /** Buffer pool fetches and the ones among them that read from disk */
+  uint64_t page_fetches_{0};
+  uint64_t page_misses_{0};
+  /** Lock requests that blocked, and how long they blocked */
+  uint64_t lock_waits_{0};
+  uint64_t lock_wait_us_{0};
+  /** Number of times a hash join swapped its build and probe sides at run time */
+  uint64_t swaps_{0};
+};
+
 /**
  * ExecutorContext stores all the context necessary to run an executor.
  */
@@ -33,10 +60,17 @@ class ExecutorContext {
    * @param bpm The buffer pool manager that the executor uses
    * @param txn_mgr The transaction manager that the executor uses
    * @param lock_mgr The lock manager that the executor uses
+   * @param memory_limit The memory budget of the query in bytes, 0 for unlimited
+   * @param global_memory_tracker The tracker of the whole instance the query is charged against as well
    */
   ExecutorContext(Transaction *transaction, Catalog *catalog, BufferPoolManager *bpm, TransactionManager *txn_mgr,
-                  LockManager *lock_mgr)
-      : transaction_(transaction), catalog_{catalog}, bpm_{bpm}, txn_mgr_(txn_mgr), lock_mgr_(lock_mgr) {}
+                  LockManager *lock_mgr, size_t memory_limit = 0, MemoryTracker *global_memory_tracker = nullptr)
+      : transaction_(transaction),
+        catalog_{catalog},
+        bpm_{bpm},
+        txn_mgr_(txn_mgr),
+        lock_mgr_(lock_mgr),
+        memory_tracker_("query", memory_limit, global_memory_tracker) {}
 
   ~ExecutorContext() = default;
 
@@ -60,6 +94,24 @@ class ExecutorContext {
   /** @return the transaction manager */
   auto GetTransactionManager() -> TransactionManager * { return txn_mgr_; }
 
+  /** @return the memory tracker every buffering executor of the query charges */
+  auto GetMemoryTracker() -> MemoryTracker * { return &memory_tracker_; }
+
+  /** Make ExecutorFactory wrap every executor it creates so that per plan node statistics are collected. */
+  void EnableAnalyze() { analyze_ = true; }
+
+  /** @return true if the query is run by EXPLAIN ANALYZE */
+  auto IsAnalyze() const -> bool { return analyze_; }
+
+  /** @return the statistics of the plan node, created on the first call */
+  auto GetExecutorStats(const AbstractPlanNode *plan) -> ExecutorStats * { return &executor_stats_[plan]; }
+
+  /** @return the statistics of the plan node, or nullptr if it was never executed */
+  auto FindExecutorStats(const AbstractPlanNode *plan) const -> const ExecutorStats * {
+    auto iter = executor_stats_.find(plan);
+    return iter == executor_stats_.end() ? nullptr : &iter->second;
+  }
+
  private:
   /** The transaction context associated with this executor context */
   Transaction *transaction_;
@@ -71,6 +123,11 @@ class ExecutorContext {
   TransactionManager *txn_mgr_;
   /** The lock manager associated with this executor context */
   LockManager *lock_mgr_;
+  /** The memory tracker of the query */
+  MemoryTracker memory_tracker_;
+  /** Whether the executors are instrumented, and what they collected */
+  bool analyze_{false};
+  std::unordered_map<const AbstractPlanNode *, ExecutorStats> executor_stats_;
 };
 
 }  // namespace bustub
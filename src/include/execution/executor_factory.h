@@ -31,5 +31,13 @@ class ExecutorFactory {
    */
   static auto CreateExecutor(ExecutorContext *exec_ctx, const AbstractPlanNodeRef &plan)
       -> std::unique_ptr<AbstractExecutor>;
+
+ private:
+  /**
+   * Creates the executor of the plan node itself, without the EXPLAIN ANALYZE instrumentation.
+   * The executors of its children are still created through CreateExecutor.
+   */
+  static auto CreatePlainExecutor(ExecutorContext *exec_ctx, const AbstractPlanNodeRef &plan)
+      -> std::unique_ptr<AbstractExecutor>;
 };
 }  // namespace bustub
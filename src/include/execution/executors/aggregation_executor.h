@@ -121,15 +121,18 @@ class SimpleAggregationHashTable {
    * Inserts a value into the hash table and then combines it with the current aggregation.
    * @param agg_key the key to be inserted
    * @param agg_val the value to be inserted
+   * @return true if the key started a new group
    */
-  void InsertCombine(const AggregateKey &agg_key, const AggregateValue &agg_val) {
+  auto InsertCombine(const AggregateKey &agg_key, const AggregateValue &agg_val) -> bool {
     /*真正的哈希表unordered_map<key,value>, 如果没有数据，第一次插入，先初始化*/
-    if (ht_.count(agg_key) == 0) {
-      ht_.insert({agg_key, GenerateInitialAggregateValue()});
+    auto [iter, inserted] = ht_.try_emplace(agg_key);
+    if (inserted) {
+      iter->second = GenerateInitialAggregateValue();
     }
     /*
      * 如果哈希表中已经有数据了，那么就需要按照group的类别进行分组统计*/
-    CombineAggregateValues(&ht_[agg_key], agg_val);
+    CombineAggregateValues(&iter->second, agg_val);
+    return inserted;
   }
 
   /**
@@ -253,5 +256,7 @@ class AggregationExecutor : public AbstractExecutor {
   /** Simple aggregation hash table iterator */
   SimpleAggregationHashTable::Iterator aht_iterator_; /*迭代器*/
   bool successful_{false};
+  /** The memory charged for the groups of aht_ */
+  MemoryReservation reservation_;
 };
 }  // namespace bustub
@@ -56,12 +56,29 @@ class DeleteExecutor : public AbstractExecutor {
   auto GetOutputSchema() const -> const Schema & override { return plan_->OutputSchema(); };
 
  private:
+  /**
+   * Delete a batch of tuples: X locks on the rows in rid order, one latch per heap page to mark them,
+   * then the index entries of every index sorted by key.
+   * @param batch the tuples to delete with their rids
+   * @return the number of rows deleted
+   */
+  auto DeleteBatch(std::vector<std::pair<Tuple, RID>> *batch) -> int32_t;
+
+  /**
+   * Lock the entries of a B+ tree index against range scans: an X key range lock on each entry and an IX one on the
+   * entry following it, the gap a rollback puts the key back into. Called before the entries are deleted and again
+   * afterwards, another transaction may have inserted a key in front of the following entry in between.
+   * @param[in,out] next_rids the following entries locked by the previous call, empty before the first one
+   */
+  void LockKeyRanges(const IndexInfo *index, const std::vector<std::pair<Tuple, RID>> &entries,
+                     std::vector<RID> *next_rids);
+
   /** The delete plan node to be executed */
   const DeletePlanNode *plan_;
   /** The child executor from which RIDs for deleted tuples are pulled */
   std::unique_ptr<AbstractExecutor> child_executor_;
 
-  const TableInfo *table_info_;
+  TableInfo *table_info_;
 
   std::vector<IndexInfo *> table_indexes_;
   bool is_end_{false};
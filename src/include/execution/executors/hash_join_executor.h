@@ -13,6 +13,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <unordered_map>
 #include <utility>
 #include <vector>
@@ -22,6 +23,7 @@
 #include "execution/executors/abstract_executor.h"
 #include "execution/plans/hash_join_plan.h"
 #include "storage/table/tuple.h"
+#include "storage/table/tuple_builder.h"
 
 namespace bustub {
 
@@ -55,15 +57,65 @@ class HashJoinExecutor : public AbstractExecutor {
   auto GetOutputSchema() const -> const Schema & override { return plan_->OutputSchema(); };
 
  private:
+  /**
+   * A build side this many times larger than the optimizer expected is a misestimate, the join checks whether the
+   * probe side is the smaller one after all.
+   */
+  static constexpr double MISESTIMATE_RATIO = 4;
+  /** Build sides smaller than this are cheap enough, whatever the estimate was */
+  static constexpr size_t ADAPTIVE_MIN_BUILD_ROWS = 16;
+
+  /**
+   * @return the number of build rows at which the join first compares the build and the probe side, std::nullopt if
+   * the sides cannot be swapped. Later checkpoints are at twice the rows of the previous one.
+   */
+  auto FirstCheckpoint() const -> std::optional<size_t>;
+
+  /**
+   * Adaptive checkpoint during the build phase. Reads the left side until it has more rows than the build side so
+   * far, the tuples read are probed first later on.
+   * @return whether the left side ran out first, i.e. it is the smaller side
+   */
+  auto IsProbeSideSmaller(size_t build_rows) -> bool;
+
+  /**
+   * Build the hash table on the left tuples instead. The right tuples already in the hash table are probed first, the
+   * rest of the right side is probed without being materialized.
+   */
+  void SwapSides();
+
+  /** @return the next tuple of the probe side, buffered tuples first */
+  auto NextProbeTuple(Tuple *tuple) -> bool;
+
+  /** Join a probe tuple with its bucket of the hash table, the results are buffered in output_tuples_. */
+  void ProbeTuple(const Tuple &probe_tuple);
+
+  /** @return whether the hash table has a right tuple whose key equals key, the probe stops at the first match */
+  auto HasMatch(const Value &key) const -> bool;
+
   /** The NestedLoopJoin plan node to be executed. */
   const HashJoinPlanNode *plan_;
 
   std::unique_ptr<AbstractExecutor> left_executor_;
   std::unique_ptr<AbstractExecutor> right_executor_;
+  /** Copies the columns of the left and the right tuple into the output tuple, not used by semi and anti joins */
+  std::optional<TupleBuilder> builder_;
+  /** The right side of a left join row without match */
+  Tuple null_right_tuple_;
 
+  /** Holds the right tuples, or the left tuples after the build and probe sides were swapped */
   std::unordered_map<hash_t, std::vector<Tuple>> hash_join_table_;
+  bool swapped_{false};
+  /** Whether the probe side has no tuples left besides the ones in probe_buffer_ */
+  bool probe_exhausted_{false};
+  /** Probe tuples read by the adaptive checkpoint, they are probed before the rest of the probe side */
+  std::vector<Tuple> probe_buffer_;
+  size_t probe_buffer_cursor_{0};
+  /** The join results of the current left tuple */
   std::vector<Tuple> output_tuples_;
-  std::vector<Tuple>::const_iterator output_tuples_iter_;
+  std::vector<Tuple>::iterator output_tuples_iter_;
+  /** The memory charged for the build side in hash_join_table_ */
+  MemoryReservation reservation_;
 };
 
 }  // namespace bustub
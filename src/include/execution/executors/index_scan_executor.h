@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <optional>
 #include <vector>
 
 #include "common/rid.h"
@@ -42,13 +43,62 @@ class IndexScanExecutor : public AbstractExecutor {
   auto Next(Tuple *tuple, RID *rid) -> bool override;
 
  private:
+  /** The keys a predicate bounds the scan to. */
+  struct KeyRange {
+    /** values of the leading key columns that are fixed by equalities */
+    std::vector<Value> prefix_;
+    /** inclusive bounds of the key column after the prefix */
+    std::optional<Value> low_;
+    std::optional<Value> high_;
+  };
+
+  /**
+   * Walk the predicate and narrow the bounds of each key column with every comparison that is ANDed in. Equalities on
+   * a leading run of the key columns form the prefix of the range, and the bounds of the next key column limit it.
+   * Strict comparisons are widened to inclusive bounds, the predicate is re-checked on each fetched tuple anyway.
+   */
+  auto CollectKeyRange() const -> KeyRange;
+
+  /** @return -1 if key sorts before the range, 0 if it is inside, and 1 if it sorts after */
+  auto CompareWithRange(const IntegerKeyType &key, const KeyRange &range) const -> int;
+
+  /**
+   * Collect the rids of every key inside the range of the predicate into rids_, sorted in physical order unless the
+   * plan asks for key order. Under REPEATABLE_READ the range is key range locked first, so that it has no phantoms.
+   */
+  void BuildRidBitmap();
+
+  /**
+   * Collect the rids of the keys inside range into rids_, in key order.
+   * @param[out] next_rid the entry after the range whose key range lock covers the gap behind it, an invalid RID if
+   * there is none. A point lookup that finds its key leaves it invalid, the key itself is locked then.
+   */
+  void ScanIndex(const KeyRange &range, RID *next_rid);
+
+  /**
+   * Take the SHARED key range locks on the entries in rids_ and on next_rid, so that no other transaction inserts a
+   * key into the range until this one ends. Too many entries escalate to a S (or SIX) table lock instead.
+   * @return false if the table lock was taken instead of key range locks
+   */
+  auto LockKeyRanges(bool is_point_lookup, const RID &next_rid) -> bool;
+
+  /** Lock and fetch every qualifying slot living on the next heap page of the bitmap. */
+  void FetchNextPage();
+
   /** The index scan plan node to be executed. */
   const IndexScanPlanNode *plan_;
   const IndexInfo *index_info_;
   const TableInfo *table_info_;
-  BPlusTreeIndexForOneIntegerColumn *tree_;
-  BPlusTreeIndexIteratorForOneIntegerColumn iter_;
+  BPlusTreeIndexForIntegerColumns *tree_;
+  BPlusTreeIndexIteratorForIntegerColumns iter_;
+  /**
+   * The rids matching the index range, sorted by (page id, slot) so that each heap page is visited once. An ordered
+   * scan keeps them in key order, and visits a heap page once for each run of rids on it.
+   */
   std::vector<RID> rids_;
   std::vector<RID>::const_iterator rid_iter_{};
+  /** Tuples fetched from the current heap page, waiting to be emitted. */
+  std::vector<Tuple> page_tuples_;
+  std::vector<Tuple>::const_iterator page_iter_{};
 };
 }  // namespace bustub
@@ -56,10 +56,26 @@ class InsertExecutor : public AbstractExecutor {
   auto GetOutputSchema() const -> const Schema & override { return plan_->OutputSchema(); };
 
  private:
+  /**
+   * Insert a batch of tuples: one walk over the heap pages, X locks on the new rows, then the index entries
+   * of every index sorted by key.
+   * @return the number of rows inserted
+   */
+  auto InsertBatch(const std::vector<Tuple> &batch) -> int32_t;
+
+  /**
+   * Lock the gaps the entries of a B+ tree index go into against range scans: an IX key range lock on the entry
+   * following each key. Called before the entries are inserted and again afterwards, another transaction may have
+   * inserted a key in front of the locked entry in between.
+   * @param[in,out] next_rids the entries locked by the previous call, empty before the first one
+   */
+  void LockNextKeys(const IndexInfo *index, const std::vector<std::pair<Tuple, RID>> &entries,
+                    std::vector<RID> *next_rids);
+
   /** The insert plan node to be executed*/
   const InsertPlanNode *plan_;
   // 需要被插入的表
-  const TableInfo *table_info_;
+  TableInfo *table_info_;
   // 子执行器
   std::unique_ptr<AbstractExecutor> child_executor_;
 
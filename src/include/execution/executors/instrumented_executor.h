@@ -0,0 +1,74 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// instrumented_executor.h
+//
+// Identification: src/include/execution/executors/instrumented_executor.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <memory>
+#include <utility>
+
+#include "execution/executors/abstract_executor.h"
+#include "execution/plans/abstract_plan.h"
+
+namespace bustub {
+
+/**
+ * InstrumentedExecutor wraps the executor of one plan node when the query runs under EXPLAIN ANALYZE.
+ * It forwards Init and Next to the wrapped executor and adds the elapsed time, the emitted tuples, the buffer pool
+ * fetches and the lock waits to the ExecutorStats of the plan node kept in the executor context.
+ *
+ * The buffer pool counters are shared by the whole instance, so the page numbers also contain the pages fetched by
+ * concurrent queries.
+ */
+class InstrumentedExecutor : public AbstractExecutor {
+ public:
+  /**
+   * Construct a new InstrumentedExecutor instance.
+   * @param exec_ctx The executor context
+   * @param plan The plan node the statistics are recorded for
+   * @param child_executor The executor being measured
+   */
+  InstrumentedExecutor(ExecutorContext *exec_ctx, const AbstractPlanNode *plan,
+                       std::unique_ptr<AbstractExecutor> &&child_executor);
+
+  /** Initialize the wrapped executor */
+  void Init() override;
+
+  /**
+   * Yield the next tuple from the wrapped executor.
+   * @param[out] tuple The next tuple produced by the wrapped executor
+   * @param[out] rid The next tuple RID produced by the wrapped executor
+   * @return `true` if a tuple was produced, `false` if there are no more tuples
+   */
+  auto Next(Tuple *tuple, RID *rid) -> bool override;
+
+  /** @return The output schema of the wrapped executor */
+  auto GetOutputSchema() const -> const Schema & override { return child_executor_->GetOutputSchema(); }
+
+ private:
+  /** Snapshot of the shared counters taken before a call */
+  struct Counters {
+    uint64_t page_fetches_{0};
+    uint64_t page_misses_{0};
+    uint64_t lock_waits_{0};
+    uint64_t lock_wait_us_{0};
+  };
+
+  auto ReadCounters() const -> Counters;
+
+  /** Add what happened since begin to the statistics */
+  void Accumulate(const Counters &begin);
+
+  /** The executor being measured */
+  std::unique_ptr<AbstractExecutor> child_executor_;
+  /** Where the measurements go, owned by the executor context */
+  ExecutorStats *stats_;
+};
+
+}  // namespace bustub
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 #include <utility>
@@ -24,6 +25,7 @@
 #include "execution/plans/nested_index_join_plan.h"
 #include "storage/table/tmp_tuple.h"
 #include "storage/table/tuple.h"
+#include "storage/table/tuple_builder.h"
 
 namespace bustub {
 
@@ -56,5 +58,9 @@ class NestIndexJoinExecutor : public AbstractExecutor {
   // 右表的index和table
   IndexInfo *index_info_;
   TableInfo *table_info_;
+  /** Copies the columns of the left and the right tuple into the output tuple, not used by semi and anti joins */
+  std::optional<TupleBuilder> builder_;
+  /** The right side of a left join row without match */
+  Tuple null_right_tuple_;
 };
 }  // namespace bustub
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <utility>
 
 #include <vector>
@@ -8,6 +9,7 @@
 #include "execution/executors/abstract_executor.h"
 #include "execution/plans/nested_loop_join_plan.h"
 #include "storage/table/tuple.h"
+#include "storage/table/tuple_builder.h"
 namespace bustub {
 
 /**
@@ -41,8 +43,10 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
   auto GetOutputSchema() const -> const Schema & override { return plan_->OutputSchema(); };
 
  private:
-  auto InnerJoin(const Schema &schema, Tuple *tuple) -> bool;
-  auto LeftJoin(const Schema &schema, Tuple *tuple) -> bool;
+  auto InnerJoin(Tuple *tuple) -> bool;
+  auto LeftJoin(Tuple *tuple) -> bool;
+  /** Semi and anti joins emit the left tuple itself, the scan of the right tuples stops at the first match. */
+  auto SemiJoin(Tuple *tuple) -> bool;
   /** The NestedLoopJoin plan node to be executed. */
   const NestedLoopJoinPlanNode *plan_;
   bool is_ineer_{false};
@@ -54,7 +58,13 @@ class NestedLoopJoinExecutor : public AbstractExecutor {
   RID left_rid_;
   Schema left_schema_;
   Schema right_schema_;
+  /** Copies the columns of the left and the right tuple into the output tuple, not used by semi and anti joins */
+  std::optional<TupleBuilder> builder_;
+  /** The right side of a left join row without match */
+  Tuple null_right_tuple_;
   bool is_match_{true};
+  /** The memory charged for right_tuples_ */
+  MemoryReservation reservation_;
 };
 
 }  // namespace bustub
@@ -13,6 +13,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <vector>
 
 #include "execution/executor_context.h"
@@ -20,6 +21,7 @@
 #include "execution/plans/projection_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "storage/table/tuple.h"
+#include "storage/table/tuple_builder.h"
 
 namespace bustub {
 
@@ -56,5 +58,8 @@ class ProjectionExecutor : public AbstractExecutor {
 
   /** The child executor from which tuples are obtained */
   std::unique_ptr<AbstractExecutor> child_executor_;
+
+  /** Set if every expression is a plain column of the child, the columns are then copied without evaluation */
+  std::optional<TupleBuilder> builder_;
 };
 }  // namespace bustub
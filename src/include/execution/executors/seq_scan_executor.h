@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <optional>
 #include <vector>
 
 #include "common/config.h"
@@ -22,6 +23,7 @@
 #include "storage/table/table_heap.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "storage/table/tuple_builder.h"
 
 namespace bustub {
 
@@ -56,6 +58,8 @@ class SeqScanExecutor : public AbstractExecutor {
   const SeqScanPlanNode *plan_;
   const TableInfo *table_info_;
   TableIterator cur_;
+  /** Copies the pruned output columns out of the table tuple, unset if the scan outputs the whole tuple */
+  std::optional<TupleBuilder> builder_;
 
   void LockTable();
   void UnLockTable();
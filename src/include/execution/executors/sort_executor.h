@@ -19,6 +19,7 @@
 #include "execution/executors/abstract_executor.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/sort_plan.h"
+#include "storage/page/tmp_tuple_page.h"
 #include "storage/table/tuple.h"
 
 namespace bustub {
@@ -35,6 +36,9 @@ class SortExecutor : public AbstractExecutor {
    */
   SortExecutor(ExecutorContext *exec_ctx, const SortPlanNode *plan, std::unique_ptr<AbstractExecutor> &&child_executor);
 
+  /** Give the pages of the spilled runs back to the buffer pool */
+  ~SortExecutor() override;
+
   /** Initialize the sort */
   void Init() override;
 
@@ -50,6 +54,26 @@ class SortExecutor : public AbstractExecutor {
   auto GetOutputSchema() const -> const Schema & override { return plan_->OutputSchema(); }
 
  private:
+  /** A sorted run spilled to temporary pages, read back one page at a time while merging. */
+  struct SortRun {
+    std::vector<page_id_t> pages_;
+    size_t next_page_{0};
+    std::vector<Tuple> tuples_;
+    size_t pos_{0};
+  };
+
+  /** @return true if a goes before b under the order-by clauses of the plan */
+  auto Less(const Tuple &a, const Tuple &b) const -> bool;
+
+  /** Sort the buffered tuples, write them out as a new run and release their memory */
+  void SpillRun();
+
+  /** Read the next page of a run and drop it from the buffer pool, the run is exhausted if it has no page left */
+  void LoadRunPage(SortRun *run);
+
+  /** Delete the pages of all runs that were not read back yet */
+  void DropRuns();
+
   /** The sort plan node to be executed */
   const SortPlanNode *plan_;
   std::unique_ptr<AbstractExecutor> child_executor_;
@@ -57,5 +81,9 @@ class SortExecutor : public AbstractExecutor {
   std::vector<Tuple> sorted_tuples_;
   // 在Next函数中调用每次返回一个tuple
   std::vector<Tuple>::iterator iterator_;
+  /** The memory charged for sorted_tuples_, when it cannot grow the buffer is spilled as a run */
+  MemoryReservation reservation_;
+  /** The spilled runs, merged in Next when not empty */
+  std::vector<SortRun> runs_;
 };
 }  // namespace bustub
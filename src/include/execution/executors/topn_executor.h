@@ -60,5 +60,7 @@ class TopNExecutor : public AbstractExecutor {
    * 需要用stack存储，减少一次reverse操作
    * */
   std::stack<Tuple> child_tuples_;
+  /** The memory charged for the tuples kept by the heap */
+  MemoryReservation reservation_;
 };
 }  // namespace bustub
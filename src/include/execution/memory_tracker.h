@@ -0,0 +1,152 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// memory_tracker.h
+//
+// Identification: src/include/execution/memory_tracker.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/macros.h"
+#include "fmt/format.h"
+
+namespace bustub {
+
+/**
+ * MemoryTracker accounts the bytes buffered by executors against a budget.
+ *
+ * Trackers form a tree: every query gets its own tracker whose parent is the global tracker of the instance,
+ * so a charge only succeeds if it fits both the per-query and the global budget. A limit of 0 means unlimited.
+ */
+class MemoryTracker {
+ public:
+  /**
+   * Create a memory tracker.
+   * @param name the name printed when the budget is exceeded
+   * @param limit the budget in bytes, 0 for unlimited
+   * @param parent the tracker that is charged together with this one, may be nullptr
+   */
+  explicit MemoryTracker(std::string name, size_t limit = 0, MemoryTracker *parent = nullptr)
+      : name_(std::move(name)), limit_(limit), parent_(parent) {}
+
+  ~MemoryTracker() = default;
+
+  DISALLOW_COPY_AND_MOVE(MemoryTracker);
+
+  /**
+   * Charge bytes if they fit in this tracker and all of its ancestors. Spill-capable operators call this and
+   * write their buffer out when it fails.
+   * @return true if the bytes were charged, false if some budget would be exceeded (nothing is charged then)
+   */
+  auto TryConsume(size_t bytes) -> bool {
+    const auto usage = usage_.fetch_add(bytes) + bytes;
+    const auto limit = limit_.load();
+    if (limit != 0 && usage > limit) {
+      usage_.fetch_sub(bytes);
+      return false;
+    }
+    if (parent_ != nullptr && !parent_->TryConsume(bytes)) {
+      usage_.fetch_sub(bytes);
+      return false;
+    }
+    auto peak = peak_.load();
+    while (usage > peak && !peak_.compare_exchange_weak(peak, usage)) {
+    }
+    return true;
+  }
+
+  /**
+   * Charge bytes, operators that cannot spill call this.
+   * @throw ExecutionException if some budget would be exceeded
+   */
+  void Consume(size_t bytes) {
+    if (!TryConsume(bytes)) {
+      throw ExecutionException(fmt::format("{} memory budget exceeded while allocating {} bytes", name_, bytes));
+    }
+  }
+
+  /** Give back bytes charged before. */
+  void Release(size_t bytes) {
+    usage_.fetch_sub(bytes);
+    if (parent_ != nullptr) {
+      parent_->Release(bytes);
+    }
+  }
+
+  /** Change the budget, it takes effect for the following charges. */
+  void SetLimit(size_t limit) { limit_ = limit; }
+
+  /** @return the budget in bytes, 0 for unlimited */
+  auto GetLimit() const -> size_t { return limit_; }
+
+  /** @return the bytes currently charged */
+  auto GetUsage() const -> size_t { return usage_; }
+
+  /** @return the largest number of bytes charged at the same time */
+  auto GetPeakUsage() const -> size_t { return peak_; }
+
+ private:
+  const std::string name_;
+  std::atomic<size_t> limit_;
+  MemoryTracker *parent_;
+  std::atomic<size_t> usage_{0};
+  std::atomic<size_t> peak_{0};
+};
+
+/**
+ * MemoryReservation is the part of a tracker owned by one operator. Whatever is still reserved when it goes out
+ * of scope is released, so an executor never leaks its charge even if the query fails half way.
+ */
+class MemoryReservation {
+ public:
+  explicit MemoryReservation(MemoryTracker *tracker) : tracker_(tracker) {}
+
+  ~MemoryReservation() { Reset(); }
+
+  DISALLOW_COPY_AND_MOVE(MemoryReservation);
+
+  /** @return true if bytes were added to the reservation, false if the budget is exhausted */
+  auto TryGrow(size_t bytes) -> bool {
+    if (!tracker_->TryConsume(bytes)) {
+      return false;
+    }
+    bytes_ += bytes;
+    return true;
+  }
+
+  /** @throw ExecutionException if the budget is exhausted */
+  void Grow(size_t bytes) {
+    tracker_->Consume(bytes);
+    bytes_ += bytes;
+  }
+
+  void Shrink(size_t bytes) {
+    BUSTUB_ASSERT(bytes <= bytes_, "shrinking more than reserved");
+    tracker_->Release(bytes);
+    bytes_ -= bytes;
+  }
+
+  /** Release the whole reservation. */
+  void Reset() {
+    if (bytes_ != 0) {
+      tracker_->Release(bytes_);
+      bytes_ = 0;
+    }
+  }
+
+  auto GetBytes() const -> size_t { return bytes_; }
+
+ private:
+  MemoryTracker *tracker_;
+  size_t bytes_{0};
+};
+
+}  // namespace bustub
@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -92,6 +93,12 @@ class AbstractPlanNode {
     return fmt::format("{}{}", PlanNodeToString(), ChildrenToString(2, with_schema));
   }
 
+  /**
+   * @param annotate returns the text appended to the line of each plan node
+   * @return the string representation of the plan node and its children, e.g. with the EXPLAIN ANALYZE statistics
+   */
+  auto ToString(const std::function<std::string(const AbstractPlanNode &)> &annotate) const -> std::string;
+
   /** @return the cloned plan node with new children */
   virtual auto CloneWithChildren(std::vector<AbstractPlanNodeRef> children) const
       -> std::unique_ptr<AbstractPlanNode> = 0;
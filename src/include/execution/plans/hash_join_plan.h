@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <optional>
 #include <string>
 #include <utility>
 #include <vector>
@@ -76,6 +77,14 @@ class HashJoinPlanNode : public AbstractPlanNode {
   /** The join type */
   JoinType join_type_;
 
+  /**
+   * The rows the optimizer expects on the right side, the build side of the hash table. The executor compares it with
+   * what it actually built and may swap the build and probe sides. Unset if the plan was not estimated.
+   */
+  std::optional<double> estimated_build_rows_;
+  /** The rows the optimizer expects on the left side, the probe side */
+  std::optional<double> estimated_probe_rows_;
+
  protected:
   auto PlanNodeToString() const -> std::string override {
     return fmt::format("HashJoin {{ type={}, left_key={}, right_key={} }}", join_type_, left_key_expression_,
@@ -29,11 +29,15 @@ class IndexScanPlanNode : public AbstractPlanNode {
    * Creates a new index scan plan node.
    * @param output the output format of this scan plan node
    * @param table_oid the identifier of table to be scanned
+   * @param filter_predicate the predicate the scanned tuples must satisfy, it also bounds the scanned key range
+   * @param ordered whether the tuples of a filtered scan must be emitted in index key order
    */
-  IndexScanPlanNode(SchemaRef output, index_oid_t index_oid, AbstractExpressionRef filter_predicate = nullptr)
+  IndexScanPlanNode(SchemaRef output, index_oid_t index_oid, AbstractExpressionRef filter_predicate = nullptr,
+                    bool ordered = false)
       : AbstractPlanNode(std::move(output), {}),
         index_oid_(index_oid),
-        filter_predicate_(std::move(filter_predicate)) {}
+        filter_predicate_(std::move(filter_predicate)),
+        ordered_(ordered) {}
 
   auto GetType() const -> PlanType override { return PlanType::IndexScan; }
 
@@ -49,10 +53,17 @@ class IndexScanPlanNode : public AbstractPlanNode {
 
   AbstractExpressionRef filter_predicate_;
 
+  /**
+   * A filtered scan fetches the matching tuples in physical order by default. An ordered scan keeps the index key order
+   * instead, so that it can replace a sort on the key columns. A scan without filter is always in key order.
+   */
+  bool ordered_;
+
  protected:
   auto PlanNodeToString() const -> std::string override {
     if (filter_predicate_) {
-      return fmt::format("IndexScan {{ index_oid={}, filter={} }}", index_oid_, filter_predicate_);
+      return fmt::format("IndexScan {{ index_oid={}, filter={}{} }}", index_oid_, filter_predicate_,
+                         ordered_ ? ", ordered" : "");
     }
     return fmt::format("IndexScan {{ index_oid={} }}", index_oid_);
   }
@@ -81,10 +81,17 @@ class NestedIndexJoinPlanNode : public AbstractPlanNode {
   /** The join type */
   JoinType join_type_;
 
+  /** The columns of the inner table in the output, set by column pruning. Empty means all the columns. */
+  std::vector<uint32_t> inner_column_ids_;
+
  protected:
   auto PlanNodeToString() const -> std::string override {
-    return fmt::format("NestedIndexJoin {{ type={}, key_predicate={}, index={}, index_table={} }}", join_type_,
-                       key_predicate_, index_name_, index_table_name_);
+    std::string inner_columns;
+    if (!inner_column_ids_.empty()) {
+      inner_columns = fmt::format(", inner_columns=[{}]", fmt::join(inner_column_ids_, ", "));
+    }
+    return fmt::format("NestedIndexJoin {{ type={}, key_predicate={}, index={}, index_table={}{} }}", join_type_,
+                       key_predicate_, index_name_, index_table_name_, inner_columns);
   }
 };
 }  // namespace bustub
@@ -15,6 +15,7 @@
 #include <memory>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "binder/table_ref/bound_base_table_ref.h"
 #include "catalog/catalog.h"
@@ -33,13 +34,16 @@ class SeqScanPlanNode : public AbstractPlanNode {
    * Construct a new SeqScanPlanNode instance.
    * @param output The output schema of this sequential scan plan node
    * @param table_oid The identifier of table to be scanned
+   * @param filter_predicate The predicate evaluated on the tuples of the table, may be nullptr
+   * @param column_ids The table columns in the output, in order; empty if the output is the whole tuple
    */
   SeqScanPlanNode(SchemaRef output, table_oid_t table_oid, std::string table_name,
-                  AbstractExpressionRef filter_predicate = nullptr)
+                  AbstractExpressionRef filter_predicate = nullptr, std::vector<uint32_t> column_ids = {})
       : AbstractPlanNode(std::move(output), {}),
         table_oid_{table_oid},
         table_name_(std::move(table_name)),
-        filter_predicate_(std::move(filter_predicate)) {}
+        filter_predicate_(std::move(filter_predicate)),
+        column_ids_(std::move(column_ids)) {}
 
   /** @return The type of the plan node */
   auto GetType() const -> PlanType override { return PlanType::SeqScan; }
@@ -62,12 +66,22 @@ class SeqScanPlanNode : public AbstractPlanNode {
   */
   AbstractExpressionRef filter_predicate_;
 
+  /**
+   * The columns of the table the scan outputs, set by column pruning. The filter predicate still refers to the
+   * columns of the whole tuple, only the output is narrowed. Empty means all the columns.
+   */
+  std::vector<uint32_t> column_ids_;
+
  protected:
   auto PlanNodeToString() const -> std::string override {
+    std::string columns;
+    if (!column_ids_.empty()) {
+      columns = fmt::format(", columns=[{}]", fmt::join(column_ids_, ", "));
+    }
     if (filter_predicate_) {
-      return fmt::format("SeqScan {{ table={}, filter={} }}", table_name_, filter_predicate_);
+      return fmt::format("SeqScan {{ table={}{}, filter={} }}", table_name_, columns, filter_predicate_);
     }
-    return fmt::format("SeqScan {{ table={} }}", table_name_);
+    return fmt::format("SeqScan {{ table={}{} }}", table_name_, columns);
   }
 };
 
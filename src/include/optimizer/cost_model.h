@@ -0,0 +1,84 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// cost_model.h
+//
+// Identification: src/include/optimizer/cost_model.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <algorithm>
+
+namespace bustub {
+
+/**
+ * CostModel prices the physical operators the join enumerator chooses from. The unit is the cost of processing one
+ * tuple in memory; reading a tuple costs more, and reading it through an index (a random page access) costs more
+ * still. Only the ratios between the constants matter.
+ */
+class CostModel {
+ public:
+  /** Produce one output tuple */
+  static constexpr double CPU_TUPLE = 1.0;
+  /** Evaluate a predicate on a pair of tuples */
+  static constexpr double CPU_OPERATOR = 0.25;
+  /** Read one tuple in a sequential scan, the page I/O is shared by the tuples on the page */
+  static constexpr double SEQ_SCAN_TUPLE = 2.0;
+  /** Insert one tuple into the hash table of a hash join */
+  static constexpr double HASH_BUILD_TUPLE = 2.0;
+  /** Look up the hash table of a hash join for one tuple */
+  static constexpr double HASH_PROBE_TUPLE = 1.0;
+  /** Descend the B+ tree from the root to a leaf */
+  static constexpr double INDEX_PROBE = 8.0;
+  /** Fetch one tuple by rid, usually a random page access */
+  static constexpr double RANDOM_FETCH_TUPLE = 4.0;
+
+  /** Scan a table of rows tuples. */
+  static auto SeqScan(double rows) -> double { return rows * SEQ_SCAN_TUPLE; }
+
+  /**
+   * The index scan descends the B+ tree once and fetches the matching tuples by rid.
+   * @param output_rows rows in the index range
+   */
+  static auto IndexScan(double output_rows) -> double {
+    return INDEX_PROBE + output_rows * (RANDOM_FETCH_TUPLE + CPU_TUPLE);
+  }
+
+  /**
+   * The nested loop join materializes its right input once and compares every pair of tuples.
+   * @param left_rows rows of the outer (left) input
+   * @param right_rows rows of the inner (right) input
+   * @param output_rows rows produced by the join
+   */
+  static auto NestedLoopJoin(double left_rows, double right_rows, double output_rows) -> double {
+    return left_rows * right_rows * CPU_OPERATOR + output_rows * CPU_TUPLE;
+  }
+
+  /**
+   * The hash join builds its hash table on the right input and probes it with the left input.
+   * @param probe_rows rows of the left input
+   * @param build_rows rows of the right input
+   * @param output_rows rows produced by the join
+   */
+  static auto HashJoin(double probe_rows, double build_rows, double output_rows) -> double {
+    return build_rows * HASH_BUILD_TUPLE + probe_rows * HASH_PROBE_TUPLE + output_rows * CPU_TUPLE;
+  }
+
+  /**
+   * The nested index join probes the index of the inner table once per outer tuple and fetches the matches by rid.
+   * The inner table is never scanned, so its scan cost is not paid.
+   * @param outer_rows rows of the outer input
+   * @param output_rows rows produced by the join, i.e. the tuples fetched from the inner table
+   */
+  static auto NestedIndexJoin(double outer_rows, double output_rows) -> double {
+    return outer_rows * INDEX_PROBE + output_rows * (RANDOM_FETCH_TUPLE + CPU_TUPLE);
+  }
+
+  /** Cardinalities never go below one row, so that a bad estimate does not make every plan look free. */
+  static auto ClampRows(double rows) -> double { return std::max(rows, 1.0); }
+};
+
+}  // namespace bustub
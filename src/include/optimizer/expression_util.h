@@ -0,0 +1,51 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// expression_util.h
+//
+// Identification: src/include/optimizer/expression_util.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include "execution/expressions/abstract_expression.h"
+
+namespace bustub {
+
+/**
+ * Helpers the optimizer rules use to take predicates apart and to move expressions between plan nodes.
+ */
+
+/** @return a copy of expr where every column (tuple_idx, col_idx) is replaced by the column remap returns */
+auto RemapColumns(const AbstractExpressionRef &expr,
+                  const std::function<std::pair<uint32_t, uint32_t>(uint32_t, uint32_t)> &remap)
+    -> AbstractExpressionRef;
+
+/** Append the col_idx of every column expr reads, of any tuple_idx. */
+void CollectColumns(const AbstractExpression &expr, std::vector<uint32_t> *columns);
+
+/** Append the col_idx of every column expr reads from the tuple_idx-th input tuple. */
+void CollectColumns(const AbstractExpression &expr, uint32_t tuple_idx, std::vector<uint32_t> *columns);
+
+/** Append the conjuncts of an AND tree, a predicate that is not an AND is a single conjunct. */
+void SplitConjuncts(const AbstractExpressionRef &expr, std::vector<AbstractExpressionRef> *conjuncts);
+
+/** @return the AND of conjuncts, the constant true if there are none */
+auto MakeConjunction(const std::vector<AbstractExpressionRef> &conjuncts) -> AbstractExpressionRef;
+
+/**
+ * @return an equivalent expression that is cheaper to evaluate, expr itself if it cannot be simplified. Constant
+ * subexpressions are folded, true and false are removed from AND and OR, the range conditions on a column are merged
+ * (an empty range makes the conjunction false), and an OR of equalities on consecutive integers becomes a range.
+ * @param is_predicate whether expr decides which rows pass, e.g. a filter or join predicate, where NULL and false
+ * reject a row alike. An empty range is NULL rather than false for a NULL column, so it only folds in a predicate.
+ */
+auto SimplifyExpression(const AbstractExpressionRef &expr, bool is_predicate) -> AbstractExpressionRef;
+
+}  // namespace bustub
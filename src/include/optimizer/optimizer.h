@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <tuple>
 #include <unordered_map>
@@ -10,6 +11,7 @@
 #include "catalog/catalog.h"
 #include "concurrency/transaction.h"
 #include "execution/expressions/abstract_expression.h"
+#include "execution/expressions/comparison_expression.h"
 #include "execution/plans/abstract_plan.h"
 
 #define BUSTUB_OPTIMIZER_HACK_REMOVE_AFTER_2022_FALL
@@ -28,7 +30,41 @@ class Optimizer {
 
   auto OptimizeCustom(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
 
+  /**
+   * @brief estimate the number of rows every node of a plan produces, EXPLAIN prints them next to the plan.
+   * @return the estimated rows keyed by the plan nodes of plan
+   */
+  auto EstimatePlanRows(const AbstractPlanNodeRef &plan) -> std::unordered_map<const AbstractPlanNode *, double>;
+
  private:
+  /**
+   * A rule rewrites a single plan node whose children have already been optimized, and returns the node itself if it
+   * does not apply. Rules never recurse into the children, the rule engine walks the plan for them.
+   */
+  using Rule = auto (Optimizer::*)(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
+
+  /** A named group of rules the rule engine applies together. */
+  struct RuleSet {
+    std::string name_;
+    std::vector<Rule> rules_;
+    /** 1 applies the rules in a single pass, otherwise passes are repeated until the plan stops changing */
+    size_t max_passes_;
+  };
+
+  /** Upper bound of the passes of a fixpoint rule set, so that two rules undoing each other cannot loop forever */
+  static constexpr size_t MAX_FIXPOINT_PASSES = 16;
+
+  /**
+   * @brief apply a rule set to the plan. Every pass visits the plan bottom-up and tries all the rules on each node in
+   * order, so a rule sees the output of the rules before it on the same node, and the rules on the parent see the
+   * rewritten children. Rules that enable each other in the other direction are caught by the next pass.
+   */
+  auto ApplyRuleSet(const AbstractPlanNodeRef &plan, const RuleSet &rule_set) -> AbstractPlanNodeRef;
+
+  /** @brief one bottom-up pass of rules over the plan, sets changed to true if any rule fired */
+  auto ApplyRules(const AbstractPlanNodeRef &plan, const std::vector<Rule> &rules, bool *changed)
+      -> AbstractPlanNodeRef;
+
   /**
    * @brief merge projections that do identical project.
    * Identical projection might be produced when there's `SELECT *`, aggregation, or when we need to rename the columns
@@ -80,6 +116,7 @@ class Optimizer {
   /** @brief check if the predicate is true::boolean */
   auto IsPredicateTrue(const AbstractExpression &expr) -> bool;
 
+  /** @brief check if no row can satisfy the predicate, i.e. one of its conjuncts is false or NULL */
   auto IsPredicateFalse(const AbstractExpression &expr) -> bool;
 
   /**
@@ -96,9 +133,27 @@ class Optimizer {
    */
   auto OptimizeSortLimitAsTopN(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
 
-  auto OptimizeReorderJoinUseIndex(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
+  /**
+   * @brief choose the join order, the join algorithm and the build side of a tree of inner joins with the cost model.
+   * The tree is flattened into its inputs and conjuncts, predicates on a single input are pushed down to it, and the
+   * inputs are joined again by dynamic programming over input subsets (a greedy heuristic for very large joins).
+   * The joins are planned as hash joins, nested index joins or nested loop joins directly, and a projection restores
+   * the original column order.
+   */
+  auto OptimizeJoinOrder(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
 
-  auto OptimizePredicatePushDown(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
+  /**
+   * @brief remove the columns no operator above reads. The required columns are propagated top-down: scans output
+   * only the table columns that are read, joins carry only the needed columns of each side, and aggregates nobody
+   * reads are dropped. Runs last, since the other rules match scans and joins by their full output.
+   */
+  auto OptimizePruneColumns(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
+
+  /**
+   * @brief simplify the predicates of filters, scans and joins and the expressions of projections, see
+   * SimplifyExpression. A filter or scan whose predicate can never be true is replaced by an empty values node.
+   */
+  auto OptimizeSimplifyExpression(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
 
   auto OptimizeFalseFilter(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
 
@@ -109,14 +164,57 @@ class Optimizer {
   auto OptimizeMergeFilterIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
 
   /**
-   * @brief get the estimated cardinality for a table based on the table name. Useful when join reordering. BusTub
-   * doesn't support statistics for now, so it's the only way for you to get the table size :(
+   * @brief pick the index of a table whose key range the `col op const` conjuncts bound the most: equalities on the
+   * longest prefix of the key columns, then a range on the next key column.
+   * @return the index and its key columns the conjuncts bound, std::nullopt if no index has a bounded first column
+   */
+  auto MatchIndexPrefix(const std::string &table_name, const std::vector<const ComparisonExpression *> &conjuncts)
+      -> std::optional<std::pair<const IndexInfo *, std::vector<uint32_t>>>;
+
+  /**
+   * @brief whether scanning the index range bounded by the conjuncts on key_columns is cheaper than scanning the table.
+   */
+  auto IndexScanPays(const AbstractPlanNode &seq_scan, const std::vector<const ComparisonExpression *> &conjuncts,
+                     const std::vector<uint32_t> &key_columns, size_t table_rows) -> bool;
+
+  /**
+   * @brief get the estimated cardinality for a table. Useful when join reordering. Tables with a table heap use the
+   * row count of their statistics (see ANALYZE), mock tables are guessed from the suffix of their name.
    *
    * @param table_name
    * @return std::optional<size_t>
    */
   auto EstimatedCardinality(const std::string &table_name) -> std::optional<size_t>;
 
+  /** @brief estimate the number of rows a plan produces. */
+  auto EstimateRows(const AbstractPlanNode &plan) -> double;
+
+  /**
+   * @brief record the estimated rows of both sides in a hash join, the executor checks them against the rows it
+   * actually builds to recover from misestimates at run time.
+   */
+  auto OptimizeAnnotateHashJoin(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef;
+
+  /**
+   * @brief estimate the fraction of the rows of input that satisfy predicate.
+   * @param predicate a predicate over the output of input
+   * @param input the plan the predicate is evaluated on
+   */
+  auto EstimateSelectivity(const AbstractExpression &predicate, const AbstractPlanNode &input) -> double;
+
+  /**
+   * @brief estimate the selectivity of a conjunction. The conjuncts are assumed to be independent, except for
+   * equalities on two columns of the same table whose combined number of distinct values was collected by ANALYZE.
+   */
+  auto EstimateConjunction(const AbstractExpression &predicate, const AbstractPlanNode &input) -> double;
+
+  /** @brief find the table column (and its statistics) an output column of a plan comes from. */
+  auto ResolveColumn(const AbstractPlanNode &plan, uint32_t col_idx)
+      -> std::optional<std::pair<const TableStats *, uint32_t>>;
+
+  /** @brief the number of distinct values of an output column of a plan, if the table statistics know it. */
+  auto EstimateDistinct(const AbstractPlanNode &plan, uint32_t col_idx) -> std::optional<double>;
+
   /** Catalog will be used during the planning process. USERS SHOULD ENSURE IT OUTLIVES
    * OPTIMIZER, otherwise it's a dangling reference.
    */
@@ -35,6 +35,7 @@ class BoundJoinRef;
 class BoundExpressionListRef;
 class BoundAggCall;
 class BoundCTERef;
+class BoundSubqueryExpr;
 class ColumnValueExpression;
 
 /**
@@ -87,6 +88,24 @@ class Planner {
 
   auto PlanSelect(const SelectStatement &statement) -> AbstractPlanNodeRef;
 
+  /**
+   * @brief Plan the WHERE clause of a SELECT over child.
+   *
+   * The conjuncts of WHERE without subqueries are planned as a `FilterPlanNode`. Each IN / EXISTS / NOT EXISTS
+   * conjunct is then planned as a semi or an anti `NestedLoopJoinPlanNode` on top of it.
+   */
+  auto PlanWhere(const BoundExpression &where, AbstractPlanNodeRef child) -> AbstractPlanNodeRef;
+
+  /**
+   * @brief Plan a subquery predicate as a semi join (anti join if negated) of outer and the subquery.
+   *
+   * A subquery without aggregation, grouping or limit is decorrelated: only its FROM and the conjuncts of its WHERE
+   * that read nothing but its own columns are planned inside the subquery, the conjuncts reading the outer query
+   * become the join predicate. Other subqueries are planned as a whole and must not be correlated.
+   */
+  auto PlanSubqueryExpr(const BoundSubqueryExpr &expr, bool negated, AbstractPlanNodeRef outer)
+      -> AbstractPlanNodeRef;
+
   /**
    * @brief Plan a `BoundTableRef`
    *
@@ -13,9 +13,11 @@
 #pragma once
 
 #include <algorithm>
+#include <chrono>              // NOLINT
 #include <condition_variable>  // NOLINT
 #include <future>              // NOLINT
 #include <mutex>               // NOLINT
+#include <thread>              // NOLINT
 
 #include "recovery/log_record.h"
 #include "storage/disk/disk_manager.h"
@@ -25,6 +27,10 @@ namespace bustub {
 /**
  * LogManager maintains a separate thread that is awakened whenever the log buffer is full or whenever a timeout
  * happens. When the thread is awakened, the log buffer's content is written into the disk log file.
+ *
+ * Committing transactions do not flush the log themselves (group commit): they wait in WaitForCommit() for the flush
+ * thread, which writes the log once group_commit_batch_size commits are waiting, or group_commit_delay after the
+ * first of them arrived. One write then makes every commit of the window durable.
  */
 class LogManager {
  public:
@@ -46,29 +52,51 @@ class LogManager {
 
   auto AppendLogRecord(LogRecord *log_record) -> lsn_t;
 
+  /**
+   * Wait until the log is durable up to the commit record of a transaction, together with the other commits that
+   * arrive within group_commit_delay.
+   * @param commit_lsn the LSN of the commit record
+   */
+  void WaitForCommit(lsn_t commit_lsn);
+
   inline auto GetNextLSN() -> lsn_t { return next_lsn_; }
   inline auto GetPersistentLSN() -> lsn_t { return persistent_lsn_; }
   inline void SetPersistentLSN(lsn_t lsn) { persistent_lsn_ = lsn; }
   inline auto GetLogBuffer() -> char * { return log_buffer_; }
 
  private:
-  // TODO(students): you may add your own member variables
+  /** Body of the flush thread, see RunFlushThread() */
+  void FlushLoop();
 
   /** The atomic counter which records the next log sequence number. */
   std::atomic<lsn_t> next_lsn_;
   /** The log records before and including the persistent lsn have been written to disk. */
   std::atomic<lsn_t> persistent_lsn_;
 
+  /** Records are appended to the log buffer while the flush buffer is written out, the two are swapped on a flush. */
   char *log_buffer_;
   char *flush_buffer_;
+  /** Bytes used in the log buffer */
+  int offset_{0};
+  /** The last LSN in the flush buffer, durable once the write in progress finishes */
+  lsn_t flushing_lsn_{INVALID_LSN};
+  /** Commits waiting for the next flush, and when the first of them arrived */
+  size_t waiting_commits_{0};
+  std::chrono::steady_clock::time_point group_start_;
+  /** The log buffer is full, flush it right away */
+  bool force_flush_{false};
+  bool stop_flush_{false};
 
   std::mutex latch_;
 
-  std::thread *flush_thread_ __attribute__((__unused__));
+  std::thread *flush_thread_{nullptr};
 
+  /** Wakes the flush thread */
   std::condition_variable cv_;
+  /** Notified after each flush, wakes committing transactions and appends waiting for room */
+  std::condition_variable flushed_cv_;
 
-  DiskManager *disk_manager_ __attribute__((__unused__));
+  DiskManager *disk_manager_;
 };
 
 }  // namespace bustub
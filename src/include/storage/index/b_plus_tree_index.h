@@ -14,6 +14,7 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "container/hash/hash_function.h"
@@ -35,6 +36,16 @@ class BPlusTreeIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  void InsertEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction) override;
+
+  void DeleteEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction) override;
+
+  /**
+   * Find the entry that follows a key, key range locks of inserts and deletes go on it.
+   * @return the RID of the first entry with a key greater than key, an invalid RID if there is none
+   */
+  auto GetNextRid(const Tuple &key) -> RID;
+
   auto GetBeginIterator() -> INDEXITERATOR_TYPE;
 
   auto GetBeginIterator(const KeyType &key) -> INDEXITERATOR_TYPE;
@@ -42,21 +53,29 @@ class BPlusTreeIndex : public Index {
   auto GetEndIterator() -> INDEXITERATOR_TYPE;
 
  protected:
+  /** Convert a batch of key tuples into index keys, sorted by the key comparator. */
+  auto SortedKeys(const std::vector<std::pair<Tuple, RID>> &entries) const -> std::vector<std::pair<KeyType, RID>>;
+
   // comparator for key
   KeyComparator comparator_;
   // container
   BPlusTree<KeyType, ValueType, KeyComparator> container_;
 };
 
-/** We only support index table with one integer key for now in BusTub. Hardcode everything here. */
+/**
+ * We only support indexes on integer columns for now in BusTub. Hardcode everything here. An index has at most
+ * MAX_INTEGER_KEY_COLUMNS key columns, and all of them share one key type so that the executors handle a single kind of
+ * tree; the key of an index on fewer columns is zero padded.
+ */
 
 constexpr static const auto INTEGER_SIZE = 4;
-using IntegerKeyType = GenericKey<INTEGER_SIZE>;
+constexpr static const auto MAX_INTEGER_KEY_COLUMNS = 4;
+constexpr static const auto INTEGER_KEY_SIZE = INTEGER_SIZE * MAX_INTEGER_KEY_COLUMNS;
+using IntegerKeyType = GenericKey<INTEGER_KEY_SIZE>;
 using IntegerValueType = RID;
-using IntegerComparatorType = GenericComparator<INTEGER_SIZE>;
-using BPlusTreeIndexForOneIntegerColumn = BPlusTreeIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>;
-using BPlusTreeIndexIteratorForOneIntegerColumn =
-    IndexIterator<IntegerKeyType, IntegerValueType, IntegerComparatorType>;
+using IntegerComparatorType = GenericComparator<INTEGER_KEY_SIZE>;
+using BPlusTreeIndexForIntegerColumns = BPlusTreeIndex<IntegerKeyType, IntegerValueType, IntegerComparatorType>;
+using BPlusTreeIndexIteratorForIntegerColumns = IndexIterator<IntegerKeyType, IntegerValueType, IntegerComparatorType>;
 using IntegerHashFunctionType = HashFunction<IntegerKeyType>;
 
 }  // namespace bustub
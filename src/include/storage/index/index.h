@@ -175,6 +175,33 @@ class Index {
    */
   virtual void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) = 0;
 
+  ///////////////////////////////////////////////////////////////////
+  // Batch Modification
+  ///////////////////////////////////////////////////////////////////
+
+  /**
+   * Insert a batch of entries into the index. Ordered indexes may sort the batch by key first,
+   * so that consecutive inserts touch the same pages.
+   * @param entries The index keys and the RIDs associated with them
+   * @param transaction The transaction context
+   */
+  virtual void InsertEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction) {
+    for (const auto &[key, rid] : entries) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
+  /**
+   * Delete a batch of index entries. Ordered indexes may sort the batch by key first.
+   * @param entries The index keys and the RIDs associated with them
+   * @param transaction The transaction context
+   */
+  virtual void DeleteEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction) {
+    for (const auto &[key, rid] : entries) {
+      DeleteEntry(key, rid, transaction);
+    }
+  }
+
  private:
   /** The Index structure owns its metadata */
   std::unique_ptr<IndexMetadata> metadata_;
@@ -123,20 +123,34 @@ class TablePage : public Page {
    */
   auto GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, LockManager *lock_manager) -> bool;
 
+  /**
+   * Read a tuple even if it is marked as deleted, snapshot reads may still see it.
+   * @param rid rid of the tuple to read
+   * @param[out] tuple the tuple that was read
+   * @param[out] is_deleted whether the tuple is marked as deleted
+   * @return true if the slot holds a tuple
+   */
+  auto GetTupleVersion(const RID &rid, Tuple *tuple, bool *is_deleted) -> bool;
+
+  /** @return true if the tuple is marked as deleted and not removed by ApplyDelete yet */
+  auto IsMarkedDeleted(const RID &rid) -> bool;
+
   /** @return the rid of the first tuple in this page */
 
   /**
    * @param[out] first_rid the RID of the first tuple in this page
+   * @param include_deleted whether the tuples marked as deleted count
    * @return true if the first tuple exists, false otherwise
    */
-  auto GetFirstTupleRid(RID *first_rid) -> bool;
+  auto GetFirstTupleRid(RID *first_rid, bool include_deleted = false) -> bool;
 
   /**
    * @param cur_rid the RID of the current tuple
    * @param[out] next_rid the RID of the tuple following the current tuple
+   * @param include_deleted whether the tuples marked as deleted count
    * @return true if the next tuple exists, false otherwise
    */
-  auto GetNextTupleRid(const RID &cur_rid, RID *next_rid) -> bool;
+  auto GetNextTupleRid(const RID &cur_rid, RID *next_rid, bool include_deleted = false) -> bool;
 
  private:
   static_assert(sizeof(page_id_t) == 4);
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <algorithm>
+#include <vector>
+
 #include "storage/page/page.h"
 #include "storage/table/tmp_tuple.h"
 #include "storage/table/tuple.h"
@@ -22,15 +25,55 @@ class TmpTuplePage : public Page {
  public:
   void Init(page_id_t page_id, uint32_t page_size) {
     memcpy(GetData(), &page_id, sizeof(page_id_t));
-    memcpy(GetData() + sizeof(page_id_t), &page_size, sizeof(uint32_t));
+    SetLSN(INVALID_LSN);
+    SetFreeSpacePointer(page_size);
+  }
+
+  auto GetTablePageId() -> page_id_t { return *reinterpret_cast<page_id_t *>(GetData()); }
+
+  /**
+   * Append a tuple to the page.
+   * @param tuple the tuple to store
+   * @param[out] out where the tuple is stored
+   * @return false if the page does not have enough free space left
+   */
+  auto Insert(const Tuple &tuple, TmpTuple *out) -> bool {
+    const uint32_t size = sizeof(uint32_t) + tuple.GetLength();
+    const uint32_t free_space_pointer = GetFreeSpacePointer();
+    if (free_space_pointer < SIZE_HEADER + size) {
+      return false;
+    }
+    tuple.SerializeTo(GetData() + free_space_pointer - size);
+    SetFreeSpacePointer(free_space_pointer - size);
+    *out = TmpTuple(GetTablePageId(), free_space_pointer - size);
+    return true;
   }
 
-  auto GetTablePageId() -> page_id_t { return INVALID_PAGE_ID; }
+  /** Read back the tuple stored at the offset returned by Insert. */
+  void Get(const TmpTuple &tmp_tuple, Tuple *tuple) { tuple->DeserializeFrom(GetData() + tmp_tuple.GetOffset()); }
 
-  auto Insert(const Tuple &tuple, TmpTuple *out) -> bool { return false; }
+  /** Read back every tuple of the page, in the order they were inserted. */
+  void GetTuples(std::vector<Tuple> *tuples, uint32_t page_size = BUSTUB_PAGE_SIZE) {
+    const auto first = tuples->size();
+    for (uint32_t offset = GetFreeSpacePointer(); offset < page_size;) {
+      tuples->emplace_back();
+      tuples->back().DeserializeFrom(GetData() + offset);
+      offset += sizeof(uint32_t) + tuples->back().GetLength();
+    }
+    // tuples grow from the end of the page towards the header, the latest one is met first
+    std::reverse(tuples->begin() + first, tuples->end());
+  }
 
  private:
   static_assert(sizeof(page_id_t) == 4);
+  static constexpr uint32_t OFFSET_FREE_SPACE = sizeof(page_id_t) + sizeof(lsn_t);
+  static constexpr uint32_t SIZE_HEADER = OFFSET_FREE_SPACE + sizeof(uint32_t);
+
+  auto GetFreeSpacePointer() -> uint32_t { return *reinterpret_cast<uint32_t *>(GetData() + OFFSET_FREE_SPACE); }
+
+  void SetFreeSpacePointer(uint32_t free_space_pointer) {
+    memcpy(GetData() + OFFSET_FREE_SPACE, &free_space_pointer, sizeof(uint32_t));
+  }
 };
 
 }  // namespace bustub
@@ -12,17 +12,25 @@
 
 #pragma once
 
+#include <atomic>
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
 #include "storage/table/table_iterator.h"
 #include "storage/table/tuple.h"
+#include "storage/table/version_store.h"
 
 namespace bustub {
 
 /**
  * TableHeap represents a physical table on disk.
  * This is just a doubly-linked list of pages.
+ *
+ * Every write keeps the image it overwrites in a VersionStore, transactions under SNAPSHOT_ISOLATION and OPTIMISTIC
+ * read the version committed before they began, OPTIMISTIC transactions also record what they read. Tuples deleted
+ * by a committed transaction stay marked as deleted until PruneVersions finds that no snapshot can see them anymore.
  */
 class TableHeap {
   friend class TableIterator;
@@ -59,6 +67,16 @@ class TableHeap {
    */
   auto InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> bool;
 
+  /**
+   * Insert a batch of tuples into the table. The page chain is walked only once for the whole batch:
+   * each tuple goes to the page the previous one went to, or to a page after it.
+   * @param tuples tuples to insert
+   * @param[out] rids the rids of the inserted tuples, in the order of tuples
+   * @param txn the transaction performing the insert
+   * @return true iff all the tuples are inserted, otherwise rids holds the ones inserted before the failure
+   */
+  auto InsertTuples(const std::vector<Tuple> &tuples, std::vector<RID> *rids, Transaction *txn) -> bool;
+
   /**
    * Mark the tuple as deleted. The actual delete will occur when ApplyDelete is called.
    * @param rid resource id of the tuple of delete
@@ -67,6 +85,15 @@ class TableHeap {
    */
   auto MarkDelete(const RID &rid, Transaction *txn) -> bool;  // for delete
 
+  /**
+   * Mark a batch of tuples as deleted, fetching and latching each page only once.
+   * The rids must be sorted by page id, so that all the slots living on the same page are adjacent.
+   * @param rids resource ids of the tuples to delete, sorted by page id
+   * @param txn transaction performing the delete
+   * @return the number of leading rids marked, less than rids.size() only if a page could not be fetched
+   */
+  auto MarkDeletes(const std::vector<RID> &rids, Transaction *txn) -> size_t;
+
   /**
    * if the new tuple is too large to fit in the old page, return false (will delete and insert)
    * @param tuple new tuple
@@ -99,6 +126,60 @@ class TableHeap {
    */
   auto GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, bool acquire_read_lock = true) -> bool;
 
+  /**
+   * Read a batch of tuples from the table, fetching and latching each page only once.
+   * The rids must be sorted by page id, so that all the slots living on the same page are adjacent.
+   * @param rids rids of the tuples to read, sorted by page id
+   * @param[out] tuples the tuples that exist, in the order of rids
+   * @param txn transaction performing the read
+   */
+  void GetTuples(const std::vector<RID> &rids, std::vector<Tuple> *tuples, Transaction *txn);
+
+  /**
+   * Stamp the versions a transaction wrote with its commit timestamp, called on Commit.
+   * @param rid rid of the written tuple
+   * @param txn_id the committing transaction
+   * @param commit_ts commit timestamp of the transaction
+   */
+  void CommitVersion(const RID &rid, txn_id_t txn_id, timestamp_t commit_ts);
+
+  /**
+   * Drop the version an aborted transaction wrote, called on Abort once the tuple is rolled back.
+   * @param rid rid of the written tuple
+   * @param txn_id the aborting transaction
+   */
+  void RollbackVersion(const RID &rid, txn_id_t txn_id);
+
+  /**
+   * Drop the versions of a tuple no snapshot can see anymore, and remove the tuple if it was deleted.
+   * @param rid rid of the tuple
+   * @param watermark the oldest snapshot still running, or the last commit timestamp if there is none
+   */
+  void PruneVersions(const RID &rid, timestamp_t watermark);
+
+  /**
+   * Validate a read of an OPTIMISTIC transaction on commit.
+   * @param rid rid of the tuple txn read
+   * @param txn the committing transaction
+   * @return true if no other transaction committed a version of the tuple after the snapshot of txn
+   */
+  auto ValidateRead(const RID &rid, Transaction *txn) -> bool { return versions_.Validate(rid, txn); }
+
+  /**
+   * Check a tuple found by repeating an index lookup of an OPTIMISTIC transaction on commit, which the lookup did
+   * not return.
+   * @param rid rid of the tuple
+   * @param txn the committing transaction
+   * @return true if the tuple changes the result of the lookup
+   */
+  auto IsPhantom(const RID &rid, Transaction *txn) -> bool;
+
+  /** @return the commit timestamp of the last transaction that wrote this table, to validate whole table scans */
+  auto GetLastCommitTs() const -> timestamp_t { return last_commit_ts_; }
+
+  /** @return the number of tuples that still have older versions */
+  auto GetVersionChainCount() -> size_t { return versions_.GetChainCount(); }
+
   /** @return the begin iterator of this table */
   auto Begin(Transaction *txn) -> TableIterator;
 
@@ -113,6 +194,17 @@ class TableHeap {
   LockManager *lock_manager_;
   LogManager *log_manager_;
   page_id_t first_page_id_{};
+  VersionStore versions_;
+  std::atomic<timestamp_t> last_commit_ts_{0};
+
+  /** @return true if txn reads its snapshot instead of the newest versions */
+  static auto IsSnapshotRead(Transaction *txn) -> bool {
+    return txn != nullptr && (txn->GetIsolationLevel() == IsolationLevel::SNAPSHOT_ISOLATION ||
+                              txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC);
+  }
+
+  /** Read the version of a tuple txn sees, the caller holds the page latch */
+  auto ReadTuple(TablePage *page, const RID &rid, Tuple *tuple, Transaction *txn) -> bool;
 };
 
 }  // namespace bustub
@@ -0,0 +1,86 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tuple_builder.h
+//
+// Identification: src/include/storage/table/tuple_builder.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <vector>
+
+#include "catalog/schema.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * TupleBuilder builds output tuples whose columns are copied unchanged from input tuples, e.g. the output of a
+ * join or a projection of plain columns, without deserializing the columns into Values and serializing them again.
+ *
+ * The layout is computed once from the schemas: adjacent columns are merged into a single memcpy of the fixed-size
+ * area, so a join of two fixed-width schemas copies one block per side. Each VARCHAR column costs one more memcpy of
+ * its payload, and its offset in the fixed-size area is rewritten.
+ */
+class TupleBuilder {
+ public:
+  /** The output column is column column_idx_ of the input_idx_-th input tuple. */
+  struct ColumnSource {
+    uint32_t input_idx_;
+    uint32_t column_idx_;
+  };
+
+  /**
+   * @param output_schema the schema of the built tuples
+   * @param input_schemas the schemas of the input tuples, at most two
+   * @param sources where every column of output_schema comes from, the column types must match
+   */
+  TupleBuilder(const Schema *output_schema, const std::vector<const Schema *> &input_schemas,
+               const std::vector<ColumnSource> &sources);
+
+  /** @return a builder for a join, whose output is the columns of left followed by the columns of right */
+  static auto ForJoin(const Schema *output_schema, const Schema *left_schema, const Schema *right_schema)
+      -> TupleBuilder;
+
+  /** @return a tuple of the schema whose columns are all null, the padding of a left join row without match */
+  static auto NullTuple(const Schema *schema) -> Tuple;
+
+  /** @return true if the input column can be copied into the output column as it is */
+  static auto CanCopy(const Column &output_column, const Column &input_column) -> bool {
+    return output_column.GetType() == input_column.GetType() &&
+           output_column.GetFixedLength() == input_column.GetFixedLength();
+  }
+
+  /** Build an output tuple from a single input tuple. */
+  auto Build(const Tuple &input) const -> Tuple;
+
+  /** Build an output tuple from two input tuples, e.g. the left and the right tuple of a join. */
+  auto Build(const Tuple &left, const Tuple &right) const -> Tuple;
+
+ private:
+  /** A byte range of the fixed-size area copied from one input */
+  struct Segment {
+    uint32_t input_idx_;
+    uint32_t src_offset_;
+    uint32_t dst_offset_;
+    uint32_t length_;
+  };
+
+  /** A VARCHAR column, whose slot in the fixed-size area holds the offset of the payload */
+  struct Payload {
+    uint32_t input_idx_;
+    uint32_t src_slot_;
+    uint32_t dst_slot_;
+  };
+
+  auto Build(const Tuple *const *inputs) const -> Tuple;
+
+  uint32_t fixed_length_;
+  std::vector<Segment> segments_;
+  std::vector<Payload> payloads_;
+};
+
+}  // namespace bustub
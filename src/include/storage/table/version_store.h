@@ -0,0 +1,140 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.h
+//
+// Identification: src/include/storage/table/version_store.h
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "common/config.h"
+#include "common/rid.h"
+#include "concurrency/transaction.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/**
+ * VersionStore keeps the older versions of the tuples of a table heap for snapshot reads.
+ *
+ * The newest version of a tuple always lives in the table heap, written in place. Every write first saves the image
+ * it overwrites as an undo version, so a tuple that has a version chain has been written by a transaction that is
+ * still running, or by one that committed after some running snapshot began. Tuples without a chain are visible to
+ * every snapshot.
+ *
+ * The table heap calls the store while it holds the latch of the page of the tuple, so a snapshot read sees the
+ * heap image and its chain consistently.
+ */
+class VersionStore {
+ public:
+  VersionStore() = default;
+
+  /**
+   * Check whether txn may overwrite the current version of a tuple. Under SNAPSHOT_ISOLATION and OPTIMISTIC the newest
+   * version must have been committed before txn began, or be written by txn itself (first writer wins).
+   * @return true if txn may write the tuple
+   */
+  auto CanWrite(const RID &rid, Transaction *txn) -> bool;
+
+  /**
+   * Record that txn inserted a tuple, snapshots of other transactions do not see it until txn commits.
+   * @param rid rid of the inserted tuple
+   * @param txn the inserting transaction
+   */
+  void RecordInsert(const RID &rid, Transaction *txn);
+
+  /**
+   * Record that txn overwrote or deleted a tuple. The old image is saved only for the first write of txn.
+   * @param rid rid of the tuple
+   * @param old_tuple the image of the tuple before the write
+   * @param txn the writing transaction
+   */
+  void RecordWrite(const RID &rid, const Tuple &old_tuple, Transaction *txn);
+
+  /**
+   * Stamp the version txn wrote with its commit timestamp.
+   * @param rid rid of the tuple
+   * @param txn_id the committing transaction
+   * @param commit_ts commit timestamp of the transaction
+   */
+  void Commit(const RID &rid, txn_id_t txn_id, timestamp_t commit_ts);
+
+  /**
+   * Drop the version txn wrote, called once the table heap has been rolled back to the version before it.
+   * @param rid rid of the tuple
+   * @param txn_id the aborting transaction
+   */
+  void Rollback(const RID &rid, txn_id_t txn_id);
+
+  /**
+   * Resolve the version of a tuple the snapshot of txn sees.
+   * @param rid rid of the tuple
+   * @param txn the reading transaction
+   * @param is_deleted whether the image in the table heap is marked as deleted
+   * @param[in,out] tuple the image in the table heap, replaced by the visible version
+   * @return false if the tuple does not exist in the snapshot
+   */
+  auto GetVisible(const RID &rid, Transaction *txn, bool is_deleted, Tuple *tuple) -> bool;
+
+  /**
+   * Validate a read of an OPTIMISTIC transaction on commit.
+   * @param rid rid of the tuple txn read
+   * @param txn the committing transaction, its snapshot must still be running
+   * @return true if no other transaction committed a version of the tuple after the snapshot of txn
+   */
+  auto Validate(const RID &rid, Transaction *txn) -> bool;
+
+  /**
+   * Check whether a tuple found by repeating an index lookup of an OPTIMISTIC transaction on commit, which the
+   * lookup did not return, changes the result: it was committed after the snapshot, or it is visible to the snapshot
+   * but the lookup missed it.
+   * @param rid rid of the tuple
+   * @param txn the committing transaction
+   * @param is_deleted whether the image in the table heap is marked as deleted
+   * @return true if the tuple is a phantom of the lookup
+   */
+  auto IsPhantom(const RID &rid, Transaction *txn, bool is_deleted) -> bool;
+
+  /**
+   * Drop the versions of a tuple no snapshot at or after watermark can see.
+   * @param rid rid of the tuple
+   * @param watermark the oldest snapshot still running, or the last commit timestamp if there is none
+   * @return true if the chain is gone, so a tuple marked as deleted in the table heap can be removed
+   */
+  auto Prune(const RID &rid, timestamp_t watermark) -> bool;
+
+  /** @return the number of tuples that have a version chain */
+  auto GetChainCount() -> size_t;
+
+ private:
+  /** An image of a tuple that was overwritten */
+  struct UndoVersion {
+    /** Commit timestamp of the transaction that wrote the image */
+    timestamp_t ts_;
+    /** Whether the tuple did not exist, i.e. the image before an insert */
+    bool is_deleted_;
+    Tuple tuple_;
+  };
+
+  /** The version chain of a tuple */
+  struct VersionChain {
+    /** The transaction that wrote the image in the table heap and has not committed yet */
+    txn_id_t writer_{INVALID_TXN_ID};
+    /** Commit timestamp of the image in the table heap once its writer committed */
+    timestamp_t ts_{0};
+    /** The older images, the newest one at the back */
+    std::vector<UndoVersion> undo_;
+  };
+
+  std::mutex latch_;
+  std::unordered_map<RID, VersionChain> chains_;
+};
+
+}  // namespace bustub
@@ -0,0 +1,450 @@
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/expressions/constant_value_expression.h"
+#include "execution/expressions/logic_expression.h"
+#include "execution/plans/aggregation_plan.h"
+#include "execution/plans/filter_plan.h"
+#include "execution/plans/hash_join_plan.h"
+#include "execution/plans/index_scan_plan.h"
+#include "execution/plans/limit_plan.h"
+#include "execution/plans/mock_scan_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
+#include "execution/plans/nested_loop_join_plan.h"
+#include "execution/plans/projection_plan.h"
+#include "execution/plans/seq_scan_plan.h"
+#include "execution/plans/topn_plan.h"
+#include "execution/plans/values_plan.h"
+#include "optimizer/cost_model.h"
+#include "optimizer/optimizer.h"
+
+namespace bustub {
+
+namespace {
+/** 没有统计信息时的默认值 */
+constexpr double DEFAULT_ROWS = 1000;
+constexpr double DEFAULT_EQ_SELECTIVITY = 0.1;
+constexpr double DEFAULT_RANGE_SELECTIVITY = 1.0 / 3;
+constexpr double DEFAULT_SELECTIVITY = 0.5;
+constexpr double DEFAULT_GROUP_FRACTION = 0.1;
+
+auto IsTrue(CmpBool cmp) -> bool { return cmp == CmpBool::CmpTrue; }
+
+auto ValueLess(const Value &a, const Value &b) -> bool { return IsTrue(a.CompareLessThan(b)); }
+
+/** 数值类型转换成 double，用于在直方图的桶内做线性插值 */
+auto NumericValue(const Value &value) -> std::optional<double> {
+  switch (value.GetTypeId()) {
+    case TypeId::TINYINT:
+      return value.GetAs<int8_t>();
+    case TypeId::SMALLINT:
+      return value.GetAs<int16_t>();
+    case TypeId::INTEGER:
+      return value.GetAs<int32_t>();
+    case TypeId::BIGINT:
+      return static_cast<double>(value.GetAs<int64_t>());
+    case TypeId::DECIMAL:
+      return value.GetAs<double>();
+    default:
+      return std::nullopt;
+  }
+}
+
+/** 等于 value 的行占全部行的比例 */
+auto EqualFraction(const ColumnStats &stats, const Value &value) -> double {
+  for (const auto &[mcv, fraction] : stats.mcvs_) {
+    if (IsTrue(mcv.CompareEquals(value))) {
+      return fraction;
+    }
+  }
+  if (stats.histogram_.empty() || ValueLess(value, stats.histogram_.front()) ||
+      ValueLess(stats.histogram_.back(), value)) {
+    return 0;
+  }
+  // 不是最常见值的值平分直方图覆盖的行
+  auto rest_ndv = stats.ndv_ > stats.mcvs_.size() ? stats.ndv_ - stats.mcvs_.size() : 1;
+  return stats.histogram_fraction_ / static_cast<double>(rest_ndv);
+}
+
+/** 直方图覆盖的值中小于 value 的比例，桶内按照数值线性插值 */
+auto HistogramLessFraction(const std::vector<Value> &bounds, const Value &value) -> double {
+  if (bounds.empty() || !ValueLess(bounds.front(), value)) {
+    return 0;
+  }
+  if (ValueLess(bounds.back(), value)) {
+    return 1;
+  }
+  // value 落在桶 [bounds[i], bounds[i + 1]] 中，并且 bounds[i] < value <= bounds[i + 1]
+  auto upper = std::lower_bound(bounds.begin(), bounds.end(), value, ValueLess);
+  auto i = static_cast<size_t>(upper - bounds.begin()) - 1;
+  double within = 0.5;
+  auto low = NumericValue(bounds[i]);
+  auto high = NumericValue(bounds[i + 1]);
+  auto point = NumericValue(value);
+  if (low.has_value() && high.has_value() && point.has_value() && *high > *low) {
+    within = (*point - *low) / (*high - *low);
+  }
+  return (static_cast<double>(i) + within) / static_cast<double>(bounds.size() - 1);
+}
+
+/** 小于 value 的行占全部行的比例 */
+auto LessFraction(const ColumnStats &stats, const Value &value) -> double {
+  double fraction = 0;
+  for (const auto &[mcv, mcv_fraction] : stats.mcvs_) {
+    if (ValueLess(mcv, value)) {
+      fraction += mcv_fraction;
+    }
+  }
+  return fraction + stats.histogram_fraction_ * HistogramLessFraction(stats.histogram_, value);
+}
+
+/** `column comp_type value` 的选择率，和 null 比较永远不成立 */
+auto ComparisonSelectivity(const ColumnStats &stats, ComparisonType comp_type, const Value &value) -> double {
+  if (value.IsNull()) {
+    return 0;
+  }
+  auto non_null = 1 - stats.null_fraction_;
+  auto equal = EqualFraction(stats, value);
+  auto less = LessFraction(stats, value);
+  double selectivity = 0;
+  switch (comp_type) {
+    case ComparisonType::Equal:
+      selectivity = equal;
+      break;
+    case ComparisonType::NotEqual:
+      selectivity = non_null - equal;
+      break;
+    case ComparisonType::LessThan:
+      selectivity = less;
+      break;
+    case ComparisonType::LessThanOrEqual:
+      selectivity = less + equal;
+      break;
+    case ComparisonType::GreaterThan:
+      selectivity = non_null - less - equal;
+      break;
+    case ComparisonType::GreaterThanOrEqual:
+      selectivity = non_null - less;
+      break;
+  }
+  return std::clamp(selectivity, 0.0, 1.0);
+}
+
+/**
+ * 匹配 `column op constant` 和 `constant op column`，后者交换成前者的形式
+ * @return the column index, the comparison with the column on the left, and the constant
+ */
+auto MatchColumnConstant(const ComparisonExpression &expr)
+    -> std::optional<std::tuple<uint32_t, ComparisonType, Value>> {
+  const auto *left_column = dynamic_cast<const ColumnValueExpression *>(expr.GetChildAt(0).get());
+  const auto *right_column = dynamic_cast<const ColumnValueExpression *>(expr.GetChildAt(1).get());
+  const auto *left_constant = dynamic_cast<const ConstantValueExpression *>(expr.GetChildAt(0).get());
+  const auto *right_constant = dynamic_cast<const ConstantValueExpression *>(expr.GetChildAt(1).get());
+  if (left_column != nullptr && right_constant != nullptr) {
+    return std::make_tuple(left_column->GetColIdx(), expr.comp_type_, right_constant->val_);
+  }
+  if (left_constant == nullptr || right_column == nullptr) {
+    return std::nullopt;
+  }
+  auto comp_type = expr.comp_type_;
+  switch (comp_type) {
+    case ComparisonType::LessThan:
+      comp_type = ComparisonType::GreaterThan;
+      break;
+    case ComparisonType::LessThanOrEqual:
+      comp_type = ComparisonType::GreaterThanOrEqual;
+      break;
+    case ComparisonType::GreaterThan:
+      comp_type = ComparisonType::LessThan;
+      break;
+    case ComparisonType::GreaterThanOrEqual:
+      comp_type = ComparisonType::LessThanOrEqual;
+      break;
+    default:
+      break;
+  }
+  return std::make_tuple(right_column->GetColIdx(), comp_type, left_constant->val_);
+}
+
+/**
+ * 半连接的每个左表行最多输出一次，反连接输出没有匹配的左表行。
+ * @param inner_rows rows of the inner join of the same inputs and predicate
+ */
+auto JoinRows(JoinType join_type, double left_rows, double inner_rows) -> double {
+  switch (join_type) {
+    case JoinType::LEFT:
+      return std::max(inner_rows, left_rows);
+    case JoinType::SEMI:
+      return std::min(inner_rows, left_rows);
+    case JoinType::ANTI:
+      return CostModel::ClampRows(left_rows - std::min(inner_rows, left_rows));
+    default:
+      return inner_rows;
+  }
+}
+}  // namespace
+
+auto Optimizer::ResolveColumn(const AbstractPlanNode &plan, uint32_t col_idx)
+    -> std::optional<std::pair<const TableStats *, uint32_t>> {
+  const TableInfo *table_info = nullptr;
+  switch (plan.GetType()) {
+    case PlanType::SeqScan: {
+      const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(plan);
+      table_info = catalog_.GetTable(seq_scan.GetTableOid());
+      if (!seq_scan.column_ids_.empty()) {
+        col_idx = seq_scan.column_ids_[col_idx];
+      }
+      break;
+    }
+    case PlanType::IndexScan: {
+      const auto *index_info = catalog_.GetIndex(dynamic_cast<const IndexScanPlanNode &>(plan).GetIndexOid());
+      table_info = index_info == nullptr ? nullptr : catalog_.GetTable(index_info->table_name_);
+      break;
+    }
+    case PlanType::Filter:
+    case PlanType::Sort:
+    case PlanType::Limit:
+    case PlanType::TopN:
+      return ResolveColumn(*plan.GetChildAt(0), col_idx);
+    case PlanType::Projection: {
+      const auto &expr = dynamic_cast<const ProjectionPlanNode &>(plan).GetExpressions()[col_idx];
+      if (const auto *column = dynamic_cast<const ColumnValueExpression *>(expr.get()); column != nullptr) {
+        return ResolveColumn(*plan.GetChildAt(0), column->GetColIdx());
+      }
+      return std::nullopt;
+    }
+    default:
+      return std::nullopt;
+  }
+  if (table_info == nullptr || !table_info->stats_.IsAnalyzed()) {
+    return std::nullopt;
+  }
+  return std::make_pair(&table_info->stats_, col_idx);
+}
+
+auto Optimizer::EstimateDistinct(const AbstractPlanNode &plan, uint32_t col_idx) -> std::optional<double> {
+  if (auto column = ResolveColumn(plan, col_idx); column.has_value()) {
+    return std::max(static_cast<double>(column->first->GetColumnStats(column->second)->ndv_), 1.0);
+  }
+  return std::nullopt;
+}
+
+auto Optimizer::EstimateSelectivity(const AbstractExpression &predicate, const AbstractPlanNode &input) -> double {
+  if (const auto *logic_expr = dynamic_cast<const LogicExpression *>(&predicate); logic_expr != nullptr) {
+    if (logic_expr->logic_type_ == LogicType::And) {
+      return EstimateConjunction(predicate, input);
+    }
+    auto left = EstimateSelectivity(*logic_expr->GetChildAt(0), input);
+    auto right = EstimateSelectivity(*logic_expr->GetChildAt(1), input);
+    return left + right - left * right;
+  }
+  if (const auto *constant = dynamic_cast<const ConstantValueExpression *>(&predicate); constant != nullptr) {
+    return IsPredicateTrue(predicate) ? 1 : 0;
+  }
+  const auto *cmp_expr = dynamic_cast<const ComparisonExpression *>(&predicate);
+  if (cmp_expr == nullptr) {
+    return DEFAULT_SELECTIVITY;
+  }
+  if (auto match = MatchColumnConstant(*cmp_expr); match.has_value()) {
+    auto &[col_idx, comp_type, value] = *match;
+    if (auto column = ResolveColumn(input, col_idx); column.has_value()) {
+      return ComparisonSelectivity(*column->first->GetColumnStats(column->second), comp_type, value);
+    }
+  } else if (cmp_expr->comp_type_ == ComparisonType::Equal) {
+    // 两列相等的选择率是 1 / max(NDV)
+    const auto *left = dynamic_cast<const ColumnValueExpression *>(cmp_expr->GetChildAt(0).get());
+    const auto *right = dynamic_cast<const ColumnValueExpression *>(cmp_expr->GetChildAt(1).get());
+    if (left != nullptr && right != nullptr) {
+      auto left_ndv = EstimateDistinct(input, left->GetColIdx());
+      auto right_ndv = EstimateDistinct(input, right->GetColIdx());
+      if (left_ndv.has_value() || right_ndv.has_value()) {
+        return 1 / std::max(left_ndv.value_or(1), right_ndv.value_or(1));
+      }
+    }
+  }
+  switch (cmp_expr->comp_type_) {
+    case ComparisonType::Equal:
+      return DEFAULT_EQ_SELECTIVITY;
+    case ComparisonType::NotEqual:
+      return 1 - DEFAULT_EQ_SELECTIVITY;
+    default:
+      return DEFAULT_RANGE_SELECTIVITY;
+  }
+}
+
+auto Optimizer::EstimateConjunction(const AbstractExpression &predicate, const AbstractPlanNode &input) -> double {
+  std::vector<const AbstractExpression *> conjuncts;
+  std::vector<const AbstractExpression *> stack{&predicate};
+  while (!stack.empty()) {
+    const auto *expr = stack.back();
+    stack.pop_back();
+    if (const auto *logic_expr = dynamic_cast<const LogicExpression *>(expr);
+        logic_expr != nullptr && logic_expr->logic_type_ == LogicType::And) {
+      stack.push_back(logic_expr->GetChildAt(1).get());
+      stack.push_back(logic_expr->GetChildAt(0).get());
+    } else {
+      conjuncts.push_back(expr);
+    }
+  }
+
+  // 默认各个条件相互独立。同一张表上两列的等值条件如果有两列组合的 NDV，用它修正独立性假设：
+  // 两列完全相关时组合的 NDV 等于单列的 NDV，选择率退化为其中较小的一个
+  struct Equality {
+    const TableStats *table_;
+    uint32_t column_;
+    double selectivity_;
+  };
+  double selectivity = 1;
+  std::vector<Equality> equalities;
+  for (const auto *conjunct : conjuncts) {
+    auto conjunct_selectivity = EstimateSelectivity(*conjunct, input);
+    std::optional<std::pair<const TableStats *, uint32_t>> column;
+    if (const auto *cmp_expr = dynamic_cast<const ComparisonExpression *>(conjunct); cmp_expr != nullptr) {
+      auto match = MatchColumnConstant(*cmp_expr);
+      if (match.has_value() && std::get<1>(*match) == ComparisonType::Equal) {
+        column = ResolveColumn(input, std::get<0>(*match));
+      }
+    }
+    if (column.has_value()) {
+      equalities.push_back({column->first, column->second, conjunct_selectivity});
+    } else {
+      selectivity *= conjunct_selectivity;
+    }
+  }
+  std::vector<bool> used(equalities.size(), false);
+  for (size_t i = 0; i < equalities.size(); i++) {
+    if (used[i]) {
+      continue;
+    }
+    used[i] = true;
+    auto combined = equalities[i].selectivity_;
+    for (size_t j = i + 1; j < equalities.size(); j++) {
+      const auto &a = equalities[i];
+      const auto &b = equalities[j];
+      if (used[j] || a.table_ != b.table_ || a.column_ == b.column_) {
+        continue;
+      }
+      if (auto pair_ndv = a.table_->GetPairDistinct(a.column_, b.column_); pair_ndv.has_value()) {
+        auto independent_ndv = static_cast<double>(a.table_->GetColumnStats(a.column_)->ndv_) *
+                               static_cast<double>(a.table_->GetColumnStats(b.column_)->ndv_);
+        auto correlation = independent_ndv / std::max(static_cast<double>(*pair_ndv), 1.0);
+        combined = std::min(a.selectivity_ * b.selectivity_ * std::max(correlation, 1.0),
+                            std::min(a.selectivity_, b.selectivity_));
+        used[j] = true;
+        break;
+      }
+    }
+    selectivity *= combined;
+  }
+  return selectivity;
+}
+
+auto Optimizer::EstimateRows(const AbstractPlanNode &plan) -> double {
+  switch (plan.GetType()) {
+    case PlanType::SeqScan: {
+      const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(plan);
+      auto rows = static_cast<double>(EstimatedCardinality(seq_scan.table_name_).value_or(DEFAULT_ROWS));
+      if (seq_scan.filter_predicate_ != nullptr && seq_scan.column_ids_.empty()) {
+        rows *= EstimateSelectivity(*seq_scan.filter_predicate_, plan);
+      } else if (seq_scan.filter_predicate_ != nullptr) {
+        // 过滤条件读取的是整个 tuple 的列，在没有裁剪的扫描上估计
+        const SeqScanPlanNode whole_scan(std::make_shared<Schema>(catalog_.GetTable(seq_scan.table_oid_)->schema_),
+                                         seq_scan.table_oid_, seq_scan.table_name_);
+        rows *= EstimateSelectivity(*seq_scan.filter_predicate_, whole_scan);
+      }
+      return CostModel::ClampRows(rows);
+    }
+    case PlanType::IndexScan: {
+      const auto &index_scan = dynamic_cast<const IndexScanPlanNode &>(plan);
+      const auto *index_info = catalog_.GetIndex(index_scan.GetIndexOid());
+      auto rows = index_info == nullptr
+                      ? DEFAULT_ROWS
+                      : static_cast<double>(EstimatedCardinality(index_info->table_name_).value_or(DEFAULT_ROWS));
+      if (index_scan.filter_predicate_ != nullptr) {
+        rows *= EstimateSelectivity(*index_scan.filter_predicate_, plan);
+      }
+      return CostModel::ClampRows(rows);
+    }
+    case PlanType::MockScan: {
+      const auto &mock_scan = dynamic_cast<const MockScanPlanNode &>(plan);
+      return static_cast<double>(EstimatedCardinality(mock_scan.GetTable()).value_or(DEFAULT_ROWS));
+    }
+    case PlanType::Values:
+      return static_cast<double>(dynamic_cast<const ValuesPlanNode &>(plan).GetValues().size());
+    case PlanType::Filter: {
+      const auto &filter = dynamic_cast<const FilterPlanNode &>(plan);
+      return CostModel::ClampRows(EstimateRows(*filter.GetChildPlan()) *
+                                  EstimateSelectivity(*filter.GetPredicate(), *filter.GetChildPlan()));
+    }
+    case PlanType::Limit:
+      return std::min(EstimateRows(*plan.GetChildAt(0)),
+                      static_cast<double>(dynamic_cast<const LimitPlanNode &>(plan).GetLimit()));
+    case PlanType::TopN:
+      return std::min(EstimateRows(*plan.GetChildAt(0)),
+                      static_cast<double>(dynamic_cast<const TopNPlanNode &>(plan).GetN()));
+    case PlanType::Aggregation: {
+      if (dynamic_cast<const AggregationPlanNode &>(plan).GetGroupBys().empty()) {
+        return 1;
+      }
+      return CostModel::ClampRows(EstimateRows(*plan.GetChildAt(0)) * DEFAULT_GROUP_FRACTION);
+    }
+    case PlanType::NestedLoopJoin: {
+      const auto &nlj = dynamic_cast<const NestedLoopJoinPlanNode &>(plan);
+      auto left = EstimateRows(*nlj.GetLeftPlan());
+      auto right = EstimateRows(*nlj.GetRightPlan());
+      auto rows = IsPredicateTrue(nlj.Predicate()) ? left * right : left * right / std::max(left, right);
+      return JoinRows(nlj.GetJoinType(), left, rows);
+    }
+    case PlanType::HashJoin: {
+      // 没有 NDV 时假设连接键在较大的一侧是唯一的
+      const auto &hash_join = dynamic_cast<const HashJoinPlanNode &>(plan);
+      auto left = EstimateRows(*hash_join.GetLeftPlan());
+      auto right = EstimateRows(*hash_join.GetRightPlan());
+      auto rows = left * right / std::max(left, right);
+      return JoinRows(hash_join.GetJoinType(), left, rows);
+    }
+    case PlanType::NestedIndexJoin: {
+      auto outer = EstimateRows(*plan.GetChildAt(0));
+      return JoinRows(dynamic_cast<const NestedIndexJoinPlanNode &>(plan).GetJoinType(), outer, outer);
+    }
+    default:
+      return plan.GetChildren().empty() ? DEFAULT_ROWS : EstimateRows(*plan.GetChildAt(0));
+  }
+}
+
+auto Optimizer::EstimatePlanRows(const AbstractPlanNodeRef &plan)
+    -> std::unordered_map<const AbstractPlanNode *, double> {
+  std::unordered_map<const AbstractPlanNode *, double> estimates;
+  std::vector<const AbstractPlanNode *> stack{plan.get()};
+  while (!stack.empty()) {
+    const auto *node = stack.back();
+    stack.pop_back();
+    estimates[node] = EstimateRows(*node);
+    for (const auto &child : node->GetChildren()) {
+      stack.push_back(child.get());
+    }
+  }
+  return estimates;
+}
+
+auto Optimizer::OptimizeAnnotateHashJoin(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
+  if (plan->GetType() != PlanType::HashJoin) {
+    return plan;
+  }
+  const auto &hash_join = dynamic_cast<const HashJoinPlanNode &>(*plan);
+  if (hash_join.estimated_build_rows_.has_value()) {
+    return plan;
+  }
+  auto annotated = std::make_shared<HashJoinPlanNode>(hash_join);
+  annotated->estimated_build_rows_ = EstimateRows(*hash_join.GetRightPlan());
+  annotated->estimated_probe_rows_ = EstimateRows(*hash_join.GetLeftPlan());
+  return annotated;
+}
+
+}  // namespace bustub
@@ -0,0 +1,67 @@
+#include "optimizer/expression_util.h"
+
+#include <memory>
+
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/constant_value_expression.h"
+#include "execution/expressions/logic_expression.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+auto RemapColumns(const AbstractExpressionRef &expr,
+                  const std::function<std::pair<uint32_t, uint32_t>(uint32_t, uint32_t)> &remap)
+    -> AbstractExpressionRef {
+  if (const auto *column = dynamic_cast<const ColumnValueExpression *>(expr.get()); column != nullptr) {
+    auto [tuple_idx, col_idx] = remap(column->GetTupleIdx(), column->GetColIdx());
+    return std::make_shared<ColumnValueExpression>(tuple_idx, col_idx, column->GetReturnType());
+  }
+  std::vector<AbstractExpressionRef> children;
+  children.reserve(expr->GetChildren().size());
+  for (const auto &child : expr->GetChildren()) {
+    children.emplace_back(RemapColumns(child, remap));
+  }
+  return expr->CloneWithChildren(std::move(children));
+}
+
+void CollectColumns(const AbstractExpression &expr, std::vector<uint32_t> *columns) {
+  if (const auto *column = dynamic_cast<const ColumnValueExpression *>(&expr); column != nullptr) {
+    columns->push_back(column->GetColIdx());
+  }
+  for (const auto &child : expr.GetChildren()) {
+    CollectColumns(*child, columns);
+  }
+}
+
+void CollectColumns(const AbstractExpression &expr, uint32_t tuple_idx, std::vector<uint32_t> *columns) {
+  if (const auto *column = dynamic_cast<const ColumnValueExpression *>(&expr);
+      column != nullptr && column->GetTupleIdx() == tuple_idx) {
+    columns->push_back(column->GetColIdx());
+  }
+  for (const auto &child : expr.GetChildren()) {
+    CollectColumns(*child, tuple_idx, columns);
+  }
+}
+
+void SplitConjuncts(const AbstractExpressionRef &expr, std::vector<AbstractExpressionRef> *conjuncts) {
+  if (const auto *logic_expr = dynamic_cast<const LogicExpression *>(expr.get());
+      logic_expr != nullptr && logic_expr->logic_type_ == LogicType::And) {
+    SplitConjuncts(logic_expr->GetChildAt(0), conjuncts);
+    SplitConjuncts(logic_expr->GetChildAt(1), conjuncts);
+    return;
+  }
+  conjuncts->push_back(expr);
+}
+
+auto MakeConjunction(const std::vector<AbstractExpressionRef> &conjuncts) -> AbstractExpressionRef {
+  if (conjuncts.empty()) {
+    return std::make_shared<ConstantValueExpression>(ValueFactory::GetBooleanValue(true));
+  }
+  auto expr = conjuncts[0];
+  for (size_t i = 1; i < conjuncts.size(); i++) {
+    expr = std::make_shared<LogicExpression>(expr, conjuncts[i], LogicType::And);
+  }
+  return expr;
+}
+
+}  // namespace bustub
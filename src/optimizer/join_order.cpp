@@ -0,0 +1,578 @@
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/plans/filter_plan.h"
+#include "execution/plans/hash_join_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
+#include "execution/plans/nested_loop_join_plan.h"
+#include "execution/plans/projection_plan.h"
+#include "execution/plans/seq_scan_plan.h"
+#include "execution/plans/values_plan.h"
+#include "optimizer/cost_model.h"
+#include "optimizer/expression_util.h"
+#include "optimizer/optimizer.h"
+
+namespace bustub {
+
+namespace {
+
+/** 输入个数不超过这个值时用动态规划枚举全部连接顺序，否则用贪心算法 */
+constexpr size_t MAX_DP_JOIN_INPUTS = 12;
+/** 输入集合用 64 位的 bitmap 表示 */
+constexpr size_t MAX_JOIN_INPUTS = 64;
+
+/** 参与重排的一个输入，可以是表扫描，也可以是外连接、聚合等不参与重排的子树 */
+struct JoinInput {
+  AbstractPlanNodeRef plan_;
+  /** 第一列在原始连接输出中的下标 */
+  uint32_t offset_;
+  /** 下推的单表谓词过滤之后的行数 */
+  double rows_;
+  double cost_;
+  /** 这个输入是没有过滤条件的 SeqScan 时，可以用于 nested index join 的索引，以列下标为 key */
+  std::unordered_map<uint32_t, std::pair<index_oid_t, std::string>> indexes_;
+};
+
+/** WHERE 和 ON 中涉及多个输入的一个合取项，列都是原始连接输出中的全局下标，tuple_idx 都是 0 */
+struct JoinConjunct {
+  AbstractExpressionRef expr_;
+  /** 用到的输入的集合 */
+  uint64_t inputs_;
+  double selectivity_;
+  /** a.x = b.y 形式的等值条件，可以作为 hash join 和 nested index join 的连接键 */
+  bool is_equi_;
+};
+
+enum class JoinAlgorithm { NestedLoop, Hash, NestedIndex };
+
+/** 一组输入的最优连接方式 */
+struct JoinEntry {
+  double rows_{0};
+  double cost_{0};
+  uint64_t left_{0};
+  uint64_t right_{0};
+  JoinAlgorithm algorithm_{JoinAlgorithm::NestedLoop};
+  /** hash join 和 nested index join 的连接键在 conjuncts 中的下标 */
+  size_t key_{0};
+};
+
+auto Bit(size_t i) -> uint64_t { return uint64_t{1} << i; }
+
+/**
+ * 并查集，把 `a.x = b.y` 形式的连接条件连起来的列（原始连接输出中的全局下标）归到同一个等价类。连接的输出中同一个
+ * 等价类的列取值都相等，所以只读其中一列的谓词对类中的其他列也成立。
+ */
+class ColumnEquivalence {
+ public:
+  void Union(uint32_t a, uint32_t b) { parent_[Find(a)] = Find(b); }
+
+  auto Find(uint32_t column) -> uint32_t {
+    auto iter = parent_.find(column);
+    if (iter == parent_.end() || iter->second == column) {
+      return column;
+    }
+    auto root = Find(iter->second);
+    parent_[column] = root;
+    return root;
+  }
+
+  /** @return the other columns in the equivalence class of column */
+  auto Equivalents(uint32_t column) -> std::vector<uint32_t> {
+    std::vector<uint32_t> columns;
+    auto root = Find(column);
+    for (const auto &[other, _] : parent_) {
+      if (other != column && Find(other) == root) {
+        columns.push_back(other);
+      }
+    }
+    if (root != column && parent_.count(root) == 0) {
+      columns.push_back(root);
+    }
+    std::sort(columns.begin(), columns.end());
+    return columns;
+  }
+
+ private:
+  std::unordered_map<uint32_t, uint32_t> parent_;
+};
+
+/** @return the two columns of a `col = col` conjunct */
+auto AsColumnEquality(const AbstractExpression &expr) -> std::optional<std::pair<uint32_t, uint32_t>> {
+  const auto *cmp_expr = dynamic_cast<const ComparisonExpression *>(&expr);
+  if (cmp_expr == nullptr || cmp_expr->comp_type_ != ComparisonType::Equal) {
+    return std::nullopt;
+  }
+  const auto *left = dynamic_cast<const ColumnValueExpression *>(cmp_expr->GetChildAt(0).get());
+  const auto *right = dynamic_cast<const ColumnValueExpression *>(cmp_expr->GetChildAt(1).get());
+  if (left == nullptr || right == nullptr) {
+    return std::nullopt;
+  }
+  return std::make_pair(left->GetColIdx(), right->GetColIdx());
+}
+
+auto IsInnerJoin(const AbstractPlanNode &plan) -> bool {
+  return plan.GetType() == PlanType::NestedLoopJoin &&
+         dynamic_cast<const NestedLoopJoinPlanNode &>(plan).GetJoinType() == JoinType::INNER;
+}
+
+/**
+ * 把一棵 inner join 树拆成输入和谓词。输入按照在原始输出中的顺序排列，谓词中的列换成原始输出中的全局下标。
+ */
+void CollectJoinInputs(const AbstractPlanNodeRef &plan, uint32_t offset, std::vector<AbstractPlanNodeRef> *inputs,
+                       std::vector<uint32_t> *offsets, std::vector<AbstractExpressionRef> *predicates) {
+  if (!IsInnerJoin(*plan)) {
+    inputs->push_back(plan);
+    offsets->push_back(offset);
+    return;
+  }
+  const auto &nlj_plan = dynamic_cast<const NestedLoopJoinPlanNode &>(*plan);
+  auto left_column_cnt = static_cast<uint32_t>(nlj_plan.GetLeftPlan()->OutputSchema().GetColumnCount());
+  CollectJoinInputs(nlj_plan.GetLeftPlan(), offset, inputs, offsets, predicates);
+  CollectJoinInputs(nlj_plan.GetRightPlan(), offset + left_column_cnt, inputs, offsets, predicates);
+  predicates->push_back(RemapColumns(nlj_plan.predicate_, [&](uint32_t tuple_idx, uint32_t col_idx) {
+    return std::make_pair(0U, offset + (tuple_idx == 0 ? 0 : left_column_cnt) + col_idx);
+  }));
+}
+
+/**
+ * JoinEnumerator 为一组输入选择连接顺序、连接算法和 hash join 的 build 侧。
+ *
+ * 不超过 MAX_DP_JOIN_INPUTS 个输入时，按照集合从小到大做动态规划：每个集合的最优计划是把它拆成两个有连接条件相连的
+ * 子集合的所有方式中代价最小的一个，左右两个方向都会尝试，所以 build 侧也由代价决定。只有在连接图不连通时才允许
+ * 笛卡尔积。输入更多时使用贪心算法，每次合并连接代价最小的两棵子树。
+ */
+class JoinEnumerator {
+ public:
+  JoinEnumerator(std::vector<JoinInput> inputs, std::vector<JoinConjunct> conjuncts)
+      : inputs_(std::move(inputs)), conjuncts_(std::move(conjuncts)) {
+    for (size_t i = 0; i < inputs_.size(); i++) {
+      JoinEntry entry;
+      entry.rows_ = inputs_[i].rows_;
+      entry.cost_ = inputs_[i].cost_;
+      entries_[Bit(i)] = entry;
+    }
+  }
+
+  /** @return the joined plan, and for each of its output columns the column index in the original join output */
+  auto Run() -> std::pair<AbstractPlanNodeRef, std::vector<uint32_t>> {
+    auto all = inputs_.size() == MAX_JOIN_INPUTS ? ~uint64_t{0} : Bit(inputs_.size()) - 1;
+    if (inputs_.size() <= MAX_DP_JOIN_INPUTS) {
+      if (!EnumerateSubsets(all, false)) {
+        EnumerateSubsets(all, true);
+      }
+    } else {
+      JoinGreedily();
+    }
+    return Build(all);
+  }
+
+ private:
+  auto InputOf(uint32_t column) const -> size_t {
+    auto iter = std::upper_bound(inputs_.begin(), inputs_.end(), column,
+                                 [](uint32_t col, const JoinInput &input) { return col < input.offset_; });
+    return static_cast<size_t>(iter - inputs_.begin()) - 1;
+  }
+
+  /** 集合的行数只取决于集合本身，与连接顺序无关 */
+  auto Rows(uint64_t set) const -> double {
+    double rows = 1;
+    for (size_t i = 0; i < inputs_.size(); i++) {
+      if ((set & Bit(i)) != 0) {
+        rows *= inputs_[i].rows_;
+      }
+    }
+    for (const auto &conjunct : conjuncts_) {
+      if ((conjunct.inputs_ & set) == conjunct.inputs_) {
+        rows *= conjunct.selectivity_;
+      }
+    }
+    return CostModel::ClampRows(rows);
+  }
+
+  /** 在 left 和 right 之间生效的连接条件，即用到两侧的输入并且只用到这两侧的输入 */
+  auto Spanning(const JoinConjunct &conjunct, uint64_t left, uint64_t right) const -> bool {
+    return (conjunct.inputs_ & left) != 0 && (conjunct.inputs_ & right) != 0 &&
+           (conjunct.inputs_ & (left | right)) == conjunct.inputs_;
+  }
+
+  /**
+   * The cheapest way to join left (the outer / probe side) with right (the inner / build side).
+   * @return std::nullopt if no conjunct connects the two sides and cross products are not allowed
+   */
+  auto BestJoin(uint64_t left, uint64_t right, bool allow_cross) const -> std::optional<JoinEntry> {
+    const auto &left_entry = entries_.at(left);
+    const auto &right_entry = entries_.at(right);
+    bool connected = false;
+    for (const auto &conjunct : conjuncts_) {
+      connected = connected || Spanning(conjunct, left, right);
+    }
+    if (!connected && !allow_cross) {
+      return std::nullopt;
+    }
+
+    JoinEntry best;
+    best.rows_ = Rows(left | right);
+    best.left_ = left;
+    best.right_ = right;
+    best.algorithm_ = JoinAlgorithm::NestedLoop;
+    best.cost_ = left_entry.cost_ + right_entry.cost_ +
+                 CostModel::NestedLoopJoin(left_entry.rows_, right_entry.rows_, best.rows_);
+    auto consider = [&best](JoinAlgorithm algorithm, size_t key, double cost) {
+      if (cost < best.cost_) {
+        best.algorithm_ = algorithm;
+        best.key_ = key;
+        best.cost_ = cost;
+      }
+    };
+    for (size_t k = 0; k < conjuncts_.size(); k++) {
+      const auto &conjunct = conjuncts_[k];
+      if (!conjunct.is_equi_ || !Spanning(conjunct, left, right)) {
+        continue;
+      }
+      consider(JoinAlgorithm::Hash, k,
+               left_entry.cost_ + right_entry.cost_ +
+                   CostModel::HashJoin(left_entry.rows_, right_entry.rows_, best.rows_));
+      if (auto right_column = RightKeyColumn(conjunct, right); right_column.has_value()) {
+        const auto &input = inputs_[InputOf(*right_column)];
+        if (input.indexes_.count(*right_column - input.offset_) > 0) {
+          consider(JoinAlgorithm::NestedIndex, k,
+                   left_entry.cost_ + CostModel::NestedIndexJoin(left_entry.rows_, best.rows_));
+        }
+      }
+    }
+    return best;
+  }
+
+  /** @return the column of an equi conjunct on the right side, if the right side is a single input */
+  auto RightKeyColumn(const JoinConjunct &conjunct, uint64_t right) const -> std::optional<uint32_t> {
+    if ((right & (right - 1)) != 0) {
+      return std::nullopt;
+    }
+    for (const auto &child : conjunct.expr_->GetChildren()) {
+      auto column = dynamic_cast<const ColumnValueExpression &>(*child).GetColIdx();
+      if ((Bit(InputOf(column)) & right) != 0) {
+        return column;
+      }
+    }
+    return std::nullopt;
+  }
+
+  auto EnumerateSubsets(uint64_t all, bool allow_cross) -> bool {
+    for (uint64_t set = 1; set <= all && set != 0; set++) {
+      if ((set & (set - 1)) == 0) {
+        continue;
+      }
+      std::optional<JoinEntry> best;
+      // 子集合在数值上都比集合小，所以在这之前已经计算过了
+      for (uint64_t left = (set - 1) & set; left != 0; left = (left - 1) & set) {
+        auto right = set ^ left;
+        if (entries_.count(left) == 0 || entries_.count(right) == 0) {
+          continue;
+        }
+        if (auto candidate = BestJoin(left, right, allow_cross);
+            candidate.has_value() && (!best.has_value() || candidate->cost_ < best->cost_)) {
+          best = candidate;
+        }
+      }
+      if (best.has_value()) {
+        entries_[set] = *best;
+      }
+    }
+    return entries_.count(all) > 0;
+  }
+
+  void JoinGreedily() {
+    std::vector<uint64_t> trees;
+    for (size_t i = 0; i < inputs_.size(); i++) {
+      trees.push_back(Bit(i));
+    }
+    while (trees.size() > 1) {
+      std::optional<JoinEntry> best;
+      size_t best_left = 0;
+      size_t best_right = 0;
+      for (bool allow_cross : {false, true}) {
+        for (size_t i = 0; i < trees.size(); i++) {
+          for (size_t j = 0; j < trees.size(); j++) {
+            if (i == j) {
+              continue;
+            }
+            if (auto candidate = BestJoin(trees[i], trees[j], allow_cross);
+                candidate.has_value() && (!best.has_value() || candidate->cost_ < best->cost_)) {
+              best = candidate;
+              best_left = i;
+              best_right = j;
+            }
+          }
+        }
+        if (best.has_value()) {
+          break;
+        }
+      }
+      entries_[best->left_ | best->right_] = *best;
+      trees[best_left] = best->left_ | best->right_;
+      trees.erase(trees.begin() + static_cast<std::ptrdiff_t>(best_right));
+    }
+  }
+
+  /** 把一个连接条件中的全局列换成 join 输出中的列，左侧的列是 tuple 0，右侧的列是 tuple 1 */
+  static auto RemapForJoin(const AbstractExpressionRef &expr, const std::unordered_map<uint32_t, uint32_t> &left,
+                           const std::unordered_map<uint32_t, uint32_t> &right) -> AbstractExpressionRef {
+    return RemapColumns(expr, [&](uint32_t tuple_idx, uint32_t col_idx) {
+      if (auto iter = left.find(col_idx); iter != left.end()) {
+        return std::make_pair(0U, iter->second);
+      }
+      return std::make_pair(1U, right.at(col_idx));
+    });
+  }
+
+  auto Build(uint64_t set) -> std::pair<AbstractPlanNodeRef, std::vector<uint32_t>> {
+    if ((set & (set - 1)) == 0) {
+      const auto &input = inputs_[__builtin_ctzll(set)];
+      std::vector<uint32_t> layout(input.plan_->OutputSchema().GetColumnCount());
+      for (uint32_t i = 0; i < layout.size(); i++) {
+        layout[i] = input.offset_ + i;
+      }
+      return {input.plan_, std::move(layout)};
+    }
+    const auto entry = entries_.at(set);
+    auto [left_plan, layout] = Build(entry.left_);
+    auto [right_plan, right_layout] = Build(entry.right_);
+
+    std::unordered_map<uint32_t, uint32_t> left_positions;
+    std::unordered_map<uint32_t, uint32_t> right_positions;
+    for (uint32_t i = 0; i < layout.size(); i++) {
+      left_positions[layout[i]] = i;
+    }
+    for (uint32_t i = 0; i < right_layout.size(); i++) {
+      right_positions[right_layout[i]] = i;
+    }
+    std::vector<Column> columns = left_plan->OutputSchema().GetColumns();
+    for (const auto &column : right_plan->OutputSchema().GetColumns()) {
+      columns.push_back(column);
+    }
+    auto output_schema = std::make_shared<Schema>(columns);
+    layout.insert(layout.end(), right_layout.begin(), right_layout.end());
+
+    std::vector<AbstractExpressionRef> predicates;
+    std::vector<AbstractExpressionRef> residual;
+    for (size_t k = 0; k < conjuncts_.size(); k++) {
+      if (!Spanning(conjuncts_[k], entry.left_, entry.right_)) {
+        continue;
+      }
+      auto predicate = RemapForJoin(conjuncts_[k].expr_, left_positions, right_positions);
+      if (entry.algorithm_ == JoinAlgorithm::NestedLoop || k != entry.key_) {
+        predicates.push_back(std::move(predicate));
+      }
+    }
+
+    AbstractPlanNodeRef plan;
+    if (entry.algorithm_ == JoinAlgorithm::NestedLoop) {
+      return {std::make_shared<NestedLoopJoinPlanNode>(output_schema, left_plan, right_plan,
+                                                       MakeConjunction(predicates), JoinType::INNER),
+              std::move(layout)};
+    }
+
+    // hash join 和 nested index join 只处理连接键，其余的条件放在连接之上的 Filter 中，列都属于 tuple 0
+    auto key = RemapForJoin(conjuncts_[entry.key_].expr_, left_positions, right_positions);
+    auto as_tuple_0 = [&left_positions](const AbstractExpressionRef &expr) {
+      return RemapColumns(expr, [&left_positions](uint32_t tuple_idx, uint32_t col_idx) {
+        return std::make_pair(0U, tuple_idx == 0 ? col_idx : static_cast<uint32_t>(left_positions.size()) + col_idx);
+      });
+    };
+    auto left_key = key->GetChildAt(0);
+    auto right_key = key->GetChildAt(1);
+    if (dynamic_cast<const ColumnValueExpression &>(*left_key).GetTupleIdx() != 0) {
+      std::swap(left_key, right_key);
+    }
+    left_key = as_tuple_0(left_key);
+    right_key =
+        RemapColumns(right_key, [](uint32_t tuple_idx, uint32_t col_idx) { return std::make_pair(0U, col_idx); });
+    if (entry.algorithm_ == JoinAlgorithm::Hash) {
+      plan = std::make_shared<HashJoinPlanNode>(output_schema, left_plan, right_plan, std::move(left_key),
+                                                std::move(right_key), JoinType::INNER);
+    } else {
+      const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(*right_plan);
+      const auto &input = inputs_[__builtin_ctzll(entry.right_)];
+      const auto &[index_oid, index_name] =
+          input.indexes_.at(dynamic_cast<const ColumnValueExpression &>(*right_key).GetColIdx());
+      plan = std::make_shared<NestedIndexJoinPlanNode>(output_schema, left_plan, std::move(left_key),
+                                                       seq_scan.GetTableOid(), index_oid, index_name,
+                                                       seq_scan.table_name_, seq_scan.output_schema_, JoinType::INNER);
+    }
+    if (!predicates.empty()) {
+      for (auto &predicate : predicates) {
+        predicate = as_tuple_0(predicate);
+      }
+      plan = std::make_shared<FilterPlanNode>(output_schema, MakeConjunction(predicates), plan);
+    }
+    return {plan, std::move(layout)};
+  }
+
+  std::vector<JoinInput> inputs_;
+  std::vector<JoinConjunct> conjuncts_;
+  std::unordered_map<uint64_t, JoinEntry> entries_;
+};
+
+}  // namespace
+
+auto Optimizer::OptimizeJoinOrder(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
+  std::vector<AbstractPlanNodeRef> plans;
+  std::vector<uint32_t> offsets;
+  std::vector<AbstractExpressionRef> predicates;
+  if (IsInnerJoin(*plan)) {
+    CollectJoinInputs(plan, 0, &plans, &offsets, &predicates);
+  }
+  if (plans.size() < 2 || plans.size() > MAX_JOIN_INPUTS) {
+    std::vector<AbstractPlanNodeRef> children;
+    for (const auto &child : plan->GetChildren()) {
+      children.emplace_back(OptimizeJoinOrder(child));
+    }
+    return plan->CloneWithChildren(std::move(children));
+  }
+
+  // 只用到一个输入的谓词下推到这个输入上，不用到任何输入的谓词放在最上面
+  std::vector<AbstractExpressionRef> conjuncts;
+  for (const auto &predicate : predicates) {
+    SplitConjuncts(predicate, &conjuncts);
+  }
+  auto input_of = [&offsets](uint32_t column) {
+    return static_cast<size_t>(std::upper_bound(offsets.begin(), offsets.end(), column) - offsets.begin()) - 1;
+  };
+  std::vector<std::vector<AbstractExpressionRef>> local_predicates(plans.size());
+  std::vector<AbstractExpressionRef> constant_predicates;
+  std::vector<std::pair<AbstractExpressionRef, uint64_t>> join_predicates;
+  // 只读一列的单表谓词，保留全局下标，用于在等价类中推导
+  std::vector<std::pair<AbstractExpressionRef, uint32_t>> column_predicates;
+  for (const auto &conjunct : conjuncts) {
+    if (IsPredicateTrue(*conjunct)) {
+      continue;
+    }
+    std::vector<uint32_t> columns;
+    CollectColumns(*conjunct, &columns);
+    uint64_t inputs = 0;
+    for (auto column : columns) {
+      inputs |= Bit(input_of(column));
+    }
+    if (inputs == 0) {
+      constant_predicates.push_back(conjunct);
+    } else if ((inputs & (inputs - 1)) == 0) {
+      if (std::all_of(columns.begin(), columns.end(), [&](uint32_t column) { return column == columns[0]; })) {
+        column_predicates.emplace_back(conjunct, columns[0]);
+      }
+      auto offset = offsets[__builtin_ctzll(inputs)];
+      local_predicates[__builtin_ctzll(inputs)].push_back(
+          RemapColumns(conjunct, [offset](uint32_t tuple_idx, uint32_t col_idx) {
+            return std::make_pair(0U, col_idx - offset);
+          }));
+    } else {
+      join_predicates.emplace_back(conjunct, inputs);
+    }
+  }
+
+  // 传递推导：a.x = b.y 并且 a.x < 100 时 b.y < 100 也成立，推导出的谓词同样下推，b 也能用索引或者少输出一些行
+  ColumnEquivalence equivalence;
+  for (const auto &[expr, _] : join_predicates) {
+    if (auto columns = AsColumnEquality(*expr); columns.has_value()) {
+      equivalence.Union(columns->first, columns->second);
+    }
+  }
+  for (const auto &[conjunct, column] : column_predicates) {
+    for (auto other : equivalence.Equivalents(column)) {
+      auto input = input_of(other);
+      if (input == input_of(column) ||
+          plan->OutputSchema().GetColumn(other).GetType() != plan->OutputSchema().GetColumn(column).GetType()) {
+        continue;
+      }
+      auto derived = RemapColumns(conjunct, [other, offset = offsets[input]](uint32_t tuple_idx, uint32_t col_idx) {
+        return std::make_pair(0U, other - offset);
+      });
+      auto &predicates_of_input = local_predicates[input];
+      if (std::none_of(predicates_of_input.begin(), predicates_of_input.end(),
+                       [&](const AbstractExpressionRef &expr) { return expr->ToString() == derived->ToString(); })) {
+        predicates_of_input.push_back(std::move(derived));
+      }
+    }
+  }
+
+  std::vector<JoinInput> inputs;
+  inputs.reserve(plans.size());
+  for (size_t i = 0; i < plans.size(); i++) {
+    auto input_plan = OptimizeJoinOrder(plans[i]);
+    auto cost = CostModel::SeqScan(EstimateRows(*input_plan));
+    if (!local_predicates[i].empty()) {
+      // 推导出的谓词可能和已有的谓词重叠或者矛盾，再化简一次
+      auto predicate = SimplifyExpression(MakeConjunction(local_predicates[i]), true);
+      if (IsPredicateFalse(*predicate)) {
+        input_plan = std::make_shared<ValuesPlanNode>(input_plan->output_schema_,
+                                                      std::vector<std::vector<AbstractExpressionRef>>{});
+      } else {
+        input_plan = std::make_shared<FilterPlanNode>(input_plan->output_schema_, predicate, input_plan);
+        input_plan = OptimizeMergeFilterScan(OptimizeMergeFilterIndexScan(input_plan));
+      }
+    }
+    JoinInput input{input_plan, offsets[i], EstimateRows(*input_plan), cost, {}};
+    if (const auto *seq_scan = dynamic_cast<const SeqScanPlanNode *>(input_plan.get());
+        seq_scan != nullptr && seq_scan->filter_predicate_ == nullptr) {
+      for (uint32_t col = 0; col < seq_scan->OutputSchema().GetColumnCount(); col++) {
+        if (auto index = MatchIndex(seq_scan->table_name_, col); index.has_value()) {
+          input.indexes_.emplace(col, std::make_pair(std::get<0>(*index), std::get<1>(*index)));
+        }
+      }
+    }
+    inputs.push_back(std::move(input));
+  }
+
+  // 等值连接的选择率是 1 / max(NDV)，没有统计信息时假设连接列在它所在的输入中是唯一的
+  std::vector<JoinConjunct> join_conjuncts;
+  for (auto &[expr, join_inputs] : join_predicates) {
+    JoinConjunct conjunct{expr, join_inputs, 0, false};
+    const auto *cmp_expr = dynamic_cast<const ComparisonExpression *>(expr.get());
+    const auto *left = cmp_expr == nullptr ? nullptr
+                                           : dynamic_cast<const ColumnValueExpression *>(cmp_expr->GetChildAt(0).get());
+    const auto *right = cmp_expr == nullptr
+                            ? nullptr
+                            : dynamic_cast<const ColumnValueExpression *>(cmp_expr->GetChildAt(1).get());
+    if (cmp_expr != nullptr && cmp_expr->comp_type_ == ComparisonType::Equal && left != nullptr && right != nullptr) {
+      conjunct.is_equi_ = true;
+      auto ndv = [&](const ColumnValueExpression *column) {
+        const auto &input = inputs[input_of(column->GetColIdx())];
+        return EstimateDistinct(*input.plan_, column->GetColIdx() - input.offset_).value_or(input.rows_);
+      };
+      conjunct.selectivity_ = 1 / std::max({ndv(left), ndv(right), 1.0});
+    } else {
+      conjunct.selectivity_ = EstimateSelectivity(*expr, *plan);
+    }
+    join_conjuncts.push_back(std::move(conjunct));
+  }
+
+  auto [joined, layout] = JoinEnumerator(std::move(inputs), std::move(join_conjuncts)).Run();
+  if (!constant_predicates.empty()) {
+    joined = std::make_shared<FilterPlanNode>(joined->output_schema_, MakeConjunction(constant_predicates), joined);
+  }
+  // 恢复原始的列顺序
+  std::vector<uint32_t> positions(layout.size());
+  bool reordered = false;
+  for (uint32_t i = 0; i < layout.size(); i++) {
+    positions[layout[i]] = i;
+    reordered = reordered || layout[i] != i;
+  }
+  if (!reordered) {
+    return joined;
+  }
+  std::vector<AbstractExpressionRef> exprs;
+  exprs.reserve(positions.size());
+  for (uint32_t i = 0; i < positions.size(); i++) {
+    exprs.push_back(
+        std::make_shared<ColumnValueExpression>(0, positions[i], plan->OutputSchema().GetColumn(i).GetType()));
+  }
+  return std::make_shared<ProjectionPlanNode>(plan->output_schema_, std::move(exprs), joined);
+}
+
+}  // namespace bustub
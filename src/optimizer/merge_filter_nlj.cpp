@@ -38,29 +38,24 @@ auto Optimizer::RewriteExpressionForJoin(const AbstractExpressionRef &expr, size
 
 auto Optimizer::IsPredicateTrue(const AbstractExpression &expr) -> bool {
   if (const auto *const_expr = dynamic_cast<const ConstantValueExpression *>(&expr); const_expr != nullptr) {
-    return const_expr->val_.CastAs(TypeId::BOOLEAN).GetAs<bool>();
+    return !const_expr->val_.IsNull() && const_expr->val_.CastAs(TypeId::BOOLEAN).GetAs<bool>();
   }
   return false;
 }
 
 auto Optimizer::OptimizeMergeFilterNLJ(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeMergeFilterNLJ(child));
-  }
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-
-  if (optimized_plan->GetType() == PlanType::Filter) {
-    const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*optimized_plan);
+  if (plan->GetType() == PlanType::Filter) {
+    const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*plan);
     // Has exactly one child
-    BUSTUB_ENSURE(optimized_plan->children_.size() == 1, "Filter with multiple children?? Impossible!");
-    const auto &child_plan = optimized_plan->children_[0];
+    BUSTUB_ENSURE(plan->children_.size() == 1, "Filter with multiple children?? Impossible!");
+    const auto &child_plan = plan->children_[0];
     if (child_plan->GetType() == PlanType::NestedLoopJoin) {
       const auto &nlj_plan = dynamic_cast<const NestedLoopJoinPlanNode &>(*child_plan);
       // Has exactly two children
       BUSTUB_ENSURE(child_plan->GetChildren().size() == 2, "NLJ should have exactly 2 children.");
 
-      if (IsPredicateTrue(nlj_plan.Predicate())) {
+      // An anti join emits the left tuples without a match, a filter above it cannot become part of its predicate.
+      if (IsPredicateTrue(nlj_plan.Predicate()) && nlj_plan.GetJoinType() != JoinType::ANTI) {
         // Only rewrite when NLJ has always true predicate.
         return std::make_shared<NestedLoopJoinPlanNode>(
             filter_plan.output_schema_, nlj_plan.GetLeftPlan(), nlj_plan.GetRightPlan(),
@@ -71,7 +66,7 @@ auto Optimizer::OptimizeMergeFilterNLJ(const AbstractPlanNodeRef &plan) -> Abstr
       }
     }
   }
-  return optimized_plan;
+  return plan;
 }
 
 }  // namespace bustub
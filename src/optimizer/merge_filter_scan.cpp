@@ -13,17 +13,10 @@ namespace bustub {
 #ifdef BUSTUB_OPTIMIZER_HACK_REMOVE_AFTER_2022_FALL
 
 auto Optimizer::OptimizeMergeFilterScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeMergeFilterScan(child));
-  }
-
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-
-  if (optimized_plan->GetType() == PlanType::Filter) {
-    const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*optimized_plan);
-    BUSTUB_ASSERT(optimized_plan->children_.size() == 1, "must have exactly one children");
-    const auto &child_plan = *optimized_plan->children_[0];
+  if (plan->GetType() == PlanType::Filter) {
+    const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*plan);
+    BUSTUB_ASSERT(plan->children_.size() == 1, "must have exactly one children");
+    const auto &child_plan = *plan->children_[0];
     if (child_plan.GetType() == PlanType::SeqScan) {
       const auto &seq_scan_plan = dynamic_cast<const SeqScanPlanNode &>(child_plan);
       if (seq_scan_plan.filter_predicate_ == nullptr) {
@@ -33,7 +26,7 @@ auto Optimizer::OptimizeMergeFilterScan(const AbstractPlanNodeRef &plan) -> Abst
     }
   }
 
-  return optimized_plan;
+  return plan;
 }
 
 #endif
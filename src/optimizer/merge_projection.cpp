@@ -10,18 +10,12 @@
 namespace bustub {
 
 auto Optimizer::OptimizeMergeProjection(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeMergeProjection(child));
-  }
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-
-  if (optimized_plan->GetType() == PlanType::Projection) {
-    const auto &projection_plan = dynamic_cast<const ProjectionPlanNode &>(*optimized_plan);
+  if (plan->GetType() == PlanType::Projection) {
+    const auto &projection_plan = dynamic_cast<const ProjectionPlanNode &>(*plan);
     // Has exactly one child
-    BUSTUB_ENSURE(optimized_plan->children_.size() == 1, "Projection with multiple children?? That's weird!");
+    BUSTUB_ENSURE(plan->children_.size() == 1, "Projection with multiple children?? That's weird!");
     // If the schema is the same (except column name)
-    const auto &child_plan = optimized_plan->children_[0];
+    const auto &child_plan = plan->children_[0];
     const auto &child_schema = child_plan->OutputSchema();
     const auto &projection_schema = projection_plan.OutputSchema();
     const auto &child_columns = child_schema.GetColumns();
@@ -45,13 +39,13 @@ auto Optimizer::OptimizeMergeProjection(const AbstractPlanNodeRef &plan) -> Abst
         break;
       }
       if (is_identical) {
-        auto plan = child_plan->CloneWithChildren(child_plan->GetChildren());
-        plan->output_schema_ = std::make_shared<Schema>(projection_schema);
-        return plan;
+        auto merged_plan = child_plan->CloneWithChildren(child_plan->GetChildren());
+        merged_plan->output_schema_ = std::make_shared<Schema>(projection_schema);
+        return merged_plan;
       }
     }
   }
-  return optimized_plan;
+  return plan;
 }
 
 }  // namespace bustub
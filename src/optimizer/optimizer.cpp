@@ -1,5 +1,8 @@
 #include "optimizer/optimizer.h"
 #include <optional>
+#include <utility>
+#include <vector>
+#include "common/logger.h"
 #include "common/util/string_util.h"
 #include "execution/plans/abstract_plan.h"
 
@@ -8,19 +11,58 @@ namespace bustub {
 auto Optimizer::Optimize(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
   if (force_starter_rule_) {
     // Use starter rules when `force_starter_rule_` is set to true.
-    auto p = plan;
-    p = OptimizeMergeProjection(p);
-    p = OptimizeMergeFilterNLJ(p);
-    p = OptimizeNLJAsIndexJoin(p);
-    p = OptimizeOrderByAsIndexScan(p);
-    p = OptimizeSortLimitAsTopN(p);
-    return p;
+    const RuleSet starter_rules{"starter",
+                                {&Optimizer::OptimizeMergeProjection, &Optimizer::OptimizeMergeFilterNLJ,
+                                 &Optimizer::OptimizeNLJAsIndexJoin, &Optimizer::OptimizeOrderByAsIndexScan,
+                                 &Optimizer::OptimizeSortLimitAsTopN},
+                                1};
+    return ApplyRuleSet(plan, starter_rules);
   }
   // By default, use user-defined rules.
   return OptimizeCustom(plan);
 }
 
+auto Optimizer::ApplyRuleSet(const AbstractPlanNodeRef &plan, const RuleSet &rule_set) -> AbstractPlanNodeRef {
+  auto p = plan;
+  for (size_t pass = 0; pass < rule_set.max_passes_; pass++) {
+    bool changed = false;
+    p = ApplyRules(p, rule_set.rules_, &changed);
+    if (!changed) {
+      return p;
+    }
+  }
+  if (rule_set.max_passes_ > 1) {
+    LOG_WARN("rule set %s did not reach a fixpoint in %zu passes", rule_set.name_.c_str(), rule_set.max_passes_);
+  }
+  return p;
+}
+
+auto Optimizer::ApplyRules(const AbstractPlanNodeRef &plan, const std::vector<Rule> &rules, bool *changed)
+    -> AbstractPlanNodeRef {
+  // 子节点没有变化时不复制当前节点，这样规则是否生效可以通过指针是否相同来判断
+  std::vector<AbstractPlanNodeRef> children;
+  bool children_changed = false;
+  for (const auto &child : plan->GetChildren()) {
+    children.emplace_back(ApplyRules(child, rules, changed));
+    children_changed = children_changed || children.back() != child;
+  }
+  AbstractPlanNodeRef p = children_changed ? plan->CloneWithChildren(std::move(children)) : plan;
+  for (auto rule : rules) {
+    auto rewritten = (this->*rule)(p);
+    if (rewritten != p) {
+      *changed = true;
+      p = std::move(rewritten);
+    }
+  }
+  return p;
+}
+
 auto Optimizer::EstimatedCardinality(const std::string &table_name) -> std::optional<size_t> {
+  // 真实的表使用统计信息中的行数，mock表没有table heap，只能根据名字猜测
+  if (const auto *table_info = catalog_.GetTable(table_name);
+      table_info != nullptr && table_info->table_ != nullptr) {
+    return std::make_optional(table_info->stats_.GetRowCount());
+  }
   if (StringUtil::EndsWith(table_name, "_1m")) {
     return std::make_optional(1000000);
   }
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <unordered_map>
+
 #include "execution/expressions/arithmetic_expression.h"
 #include "execution/expressions/column_value_expression.h"
 #include "execution/expressions/comparison_expression.h"
@@ -12,6 +15,7 @@
 #include "execution/plans/projection_plan.h"
 #include "execution/plans/seq_scan_plan.h"
 #include "execution/plans/values_plan.h"
+#include "optimizer/cost_model.h"
 #include "optimizer/optimizer.h"
 
 // Note for 2022 Fall: You can add all optimizer rule implementations and apply the rules as you want in this file. Note
@@ -20,178 +24,16 @@
 
 namespace bustub {
 
-auto Optimizer::OptimizeReorderJoinUseIndex(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeReorderJoinUseIndex(child));
+auto Optimizer::IsPredicateFalse(const AbstractExpression &expr) -> bool {
+  // 过滤时 NULL 和 false 一样不满足条件，有一个合取项恒为假，整个谓词就恒为假
+  if (const auto *const_expr = dynamic_cast<const ConstantValueExpression *>(&expr);
+      const_expr != nullptr && const_expr->val_.GetTypeId() == TypeId::BOOLEAN) {
+    return const_expr->val_.IsNull() || !const_expr->val_.GetAs<bool>();
   }
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-  if (optimized_plan->GetType() == PlanType::NestedLoopJoin) {
-    const auto &nlj_plan = dynamic_cast<const NestedLoopJoinPlanNode &>(*optimized_plan);
-    BUSTUB_ASSERT(nlj_plan.children_.size() == 2, "NLJ should have exactly 2 children.");
-
-    // ensure the left child is nlp
-    // the right child is seqscan or mockscan
-    if (nlj_plan.GetLeftPlan()->GetType() != PlanType::NestedLoopJoin ||
-        (nlj_plan.GetRightPlan()->GetType() != PlanType::SeqScan &&
-         nlj_plan.GetRightPlan()->GetType() != PlanType::MockScan)) {
-      return optimized_plan;
-    }
-
-    const auto &left_nlj_plan = dynamic_cast<const NestedLoopJoinPlanNode &>(*nlj_plan.GetLeftPlan());
-
-    if (left_nlj_plan.GetLeftPlan()->GetType() == PlanType::NestedLoopJoin ||
-        left_nlj_plan.GetRightPlan()->GetType() == PlanType::NestedLoopJoin) {
-      return optimized_plan;
-    }
-
-    if (const auto *expr = dynamic_cast<const ComparisonExpression *>(&left_nlj_plan.Predicate()); expr != nullptr) {
-      if (expr->comp_type_ == ComparisonType::Equal) {
-        if (const auto *left_expr = dynamic_cast<const ColumnValueExpression *>(expr->children_[0].get());
-            left_expr != nullptr) {
-          if (const auto *right_expr = dynamic_cast<const ColumnValueExpression *>(expr->children_[1].get());
-              right_expr != nullptr) {
-            if (left_nlj_plan.GetLeftPlan()->GetType() == PlanType::SeqScan) {
-              const auto &left_seq_scan = dynamic_cast<const SeqScanPlanNode &>(*left_nlj_plan.GetLeftPlan());
-              if (auto index = MatchIndex(left_seq_scan.table_name_, left_expr->GetColIdx()); index != std::nullopt) {
-                auto *outer_expr = dynamic_cast<const ComparisonExpression *>(&nlj_plan.Predicate());
-                auto left_outer_expr = dynamic_cast<const ColumnValueExpression *>(outer_expr->children_[0].get());
-                auto right_outer_expr = dynamic_cast<const ColumnValueExpression *>(outer_expr->children_[1].get());
-                BUSTUB_ASSERT(expr->comp_type_ == ComparisonType::Equal, "comparison type must be equal");
-                BUSTUB_ASSERT(outer_expr->comp_type_ == ComparisonType::Equal, "comparison type must be equal");
-
-                auto inner_pred = std::make_shared<ComparisonExpression>(
-                    std::make_shared<ColumnValueExpression>(
-                        0, left_outer_expr->GetColIdx() - left_nlj_plan.GetLeftPlan()->output_schema_->GetColumnCount(),
-                        left_outer_expr->GetReturnType()),
-                    std::make_shared<ColumnValueExpression>(1, right_outer_expr->GetColIdx(),
-                                                            right_outer_expr->GetReturnType()),
-                    ComparisonType::Equal);
-                auto outer_pred = std::make_shared<ComparisonExpression>(
-                    std::make_shared<ColumnValueExpression>(0, right_expr->GetColIdx(), right_expr->GetReturnType()),
-                    std::make_shared<ColumnValueExpression>(1, left_expr->GetColIdx(), left_expr->GetReturnType()),
-                    ComparisonType::Equal);
-
-                auto right_column_1 = left_nlj_plan.GetRightPlan()->output_schema_->GetColumns();
-                auto right_column_2 = nlj_plan.GetRightPlan()->output_schema_->GetColumns();
-                std::vector<Column> columns;
-                columns.reserve(right_column_1.size() + right_column_2.size());
-
-                for (const auto &col : right_column_1) {
-                  columns.push_back(col);
-                }
-                for (const auto &col : right_column_2) {
-                  columns.push_back(col);
-                }
-
-                std::vector<Column> outer_columns(columns);
-                for (const auto &col : left_nlj_plan.GetLeftPlan()->output_schema_->GetColumns()) {
-                  outer_columns.push_back(col);
-                }
-
-                return std::make_shared<NestedLoopJoinPlanNode>(
-                    std::make_shared<Schema>(outer_columns),
-                    std::make_shared<NestedLoopJoinPlanNode>(std::make_shared<Schema>(columns),
-                                                             left_nlj_plan.GetRightPlan(), nlj_plan.GetRightPlan(),
-                                                             inner_pred, JoinType::INNER),
-                    left_nlj_plan.GetLeftPlan(), outer_pred, JoinType::INNER);
-              }
-            }
-          }
-        }
-      }
-    }
+  if (const auto *logic_expr = dynamic_cast<const LogicExpression *>(&expr);
+      logic_expr != nullptr && logic_expr->logic_type_ == LogicType::And) {
+    return IsPredicateFalse(*logic_expr->GetChildAt(0)) || IsPredicateFalse(*logic_expr->GetChildAt(1));
   }
-
-  return optimized_plan;
-}
-
-auto Optimizer::OptimizePredicatePushDown(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizePredicatePushDown(child));
-  }
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-
-  if (optimized_plan->GetType() == PlanType::NestedLoopJoin) {
-    const auto &nlj_plan = dynamic_cast<const NestedLoopJoinPlanNode &>(*optimized_plan);
-
-    if (nlj_plan.GetLeftPlan()->GetType() != PlanType::NestedLoopJoin) {
-      return optimized_plan;
-    }
-    const auto &left_nlj_plan = dynamic_cast<const NestedLoopJoinPlanNode &>(*nlj_plan.GetLeftPlan());
-
-    if (nlj_plan.GetRightPlan()->GetType() != PlanType::MockScan ||
-        left_nlj_plan.GetLeftPlan()->GetType() != PlanType::MockScan ||
-        left_nlj_plan.GetRightPlan()->GetType() != PlanType::MockScan) {
-      return optimized_plan;
-    }
-
-    std::vector<AbstractExpressionRef> join_preds;
-    std::vector<AbstractExpressionRef> filter_preds;
-    if (const auto *expr = dynamic_cast<const LogicExpression *>(&nlj_plan.Predicate()); expr != nullptr) {
-      while (true) {
-        const auto *inner_expr = dynamic_cast<const LogicExpression *>(expr->children_[0].get());
-        if (inner_expr == nullptr) {
-          break;
-        }
-        if (const auto *pred = dynamic_cast<const ColumnValueExpression *>(expr->children_[1]->children_[1].get());
-            pred != nullptr) {
-          join_preds.push_back(expr->children_[1]);
-        } else {
-          filter_preds.push_back(expr->children_[1]);
-        }
-        expr = dynamic_cast<const LogicExpression *>(expr->children_[0].get());
-      }
-      if (const auto *pred = dynamic_cast<const ColumnValueExpression *>(expr->children_[1]->children_[1].get());
-          pred != nullptr) {
-        join_preds.push_back(expr->children_[1]);
-      } else {
-        filter_preds.push_back(expr->children_[1]);
-      }
-      if (const auto *pred = dynamic_cast<const ColumnValueExpression *>(expr->children_[0]->children_[1].get());
-          pred != nullptr) {
-        join_preds.push_back(expr->children_[0]);
-      } else {
-        filter_preds.push_back(expr->children_[0]);
-      }
-
-      std::vector<AbstractExpressionRef> first_filter;
-      std::vector<AbstractExpressionRef> third_filter;
-
-      for (const auto &pred : filter_preds) {
-        const auto *outer = dynamic_cast<const ComparisonExpression *>(pred.get());
-        const auto *inner = dynamic_cast<const ColumnValueExpression *>(pred->children_[0].get());
-        if (inner->GetTupleIdx() == 0) {
-          first_filter.push_back(pred);
-        } else {
-          third_filter.push_back(std::make_shared<ComparisonExpression>(
-              std::make_shared<ColumnValueExpression>(0, inner->GetColIdx(), inner->GetReturnType()),
-              pred->children_[1], outer->comp_type_));
-        }
-      }
-      BUSTUB_ASSERT(first_filter.size() == 2, "only in leader board test!");
-      BUSTUB_ASSERT(third_filter.size() == 2, "only in leader board test!");
-
-      auto first_pred = std::make_shared<LogicExpression>(first_filter[0], first_filter[1], LogicType::And);
-      auto third_pred = std::make_shared<LogicExpression>(third_filter[0], third_filter[1], LogicType::And);
-
-      auto first_filter_scan = std::make_shared<FilterPlanNode>(left_nlj_plan.children_[0]->output_schema_, first_pred,
-                                                                left_nlj_plan.children_[0]);
-      auto third_filter_scan = std::make_shared<FilterPlanNode>(nlj_plan.GetRightPlan()->output_schema_, third_pred,
-                                                                nlj_plan.GetRightPlan());
-      auto left_node = std::make_shared<NestedLoopJoinPlanNode>(left_nlj_plan.output_schema_, first_filter_scan,
-                                                                left_nlj_plan.GetRightPlan(), left_nlj_plan.predicate_,
-                                                                left_nlj_plan.GetJoinType());
-      return std::make_shared<NestedLoopJoinPlanNode>(nlj_plan.output_schema_, left_node, third_filter_scan,
-                                                      join_preds[0], nlj_plan.GetJoinType());
-    }
-  }
-
-  return optimized_plan;
-}
-
-auto Optimizer::IsPredicateFalse(const AbstractExpression &expr) -> bool {
   if (const auto *compare_expr = dynamic_cast<const ComparisonExpression *>(&expr); compare_expr != nullptr) {
     if (const auto *left_expr = dynamic_cast<const ConstantValueExpression *>(compare_expr->children_[0].get());
         left_expr != nullptr) {
@@ -210,54 +52,39 @@ auto Optimizer::IsPredicateFalse(const AbstractExpression &expr) -> bool {
 }
 
 auto Optimizer::OptimizeFalseFilter(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeFalseFilter(child));
-  }
-
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-
-  if (optimized_plan->GetType() == PlanType::Filter) {
-    const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*optimized_plan);
+  if (plan->GetType() == PlanType::Filter) {
+    const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*plan);
 
     if (IsPredicateFalse(*filter_plan.GetPredicate())) {
       return std::make_shared<ValuesPlanNode>(filter_plan.children_[0]->output_schema_,
                                               std::vector<std::vector<AbstractExpressionRef>>{});
     }
   }
-  return optimized_plan;
+  return plan;
 }
 
 auto Optimizer::OptimizeRemoveJoin(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeRemoveJoin(child));
-  }
-
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-
-  if (optimized_plan->GetType() == PlanType::NestedLoopJoin) {
-    const auto &nlj_plan = dynamic_cast<const NestedLoopJoinPlanNode &>(*optimized_plan);
+  if (plan->GetType() == PlanType::NestedLoopJoin) {
+    const auto &nlj_plan = dynamic_cast<const NestedLoopJoinPlanNode &>(*plan);
     if (nlj_plan.GetRightPlan()->GetType() == PlanType::Values) {
       const auto &right_plan = dynamic_cast<const ValuesPlanNode &>(*nlj_plan.GetRightPlan());
 
       if (right_plan.GetValues().empty()) {
+        // 右表为空时内连接和半连接没有输出，不能换成左表
+        if (nlj_plan.GetJoinType() == JoinType::INNER || nlj_plan.GetJoinType() == JoinType::SEMI) {
+          return std::make_shared<ValuesPlanNode>(nlj_plan.output_schema_,
+                                                  std::vector<std::vector<AbstractExpressionRef>>{});
+        }
         return nlj_plan.children_[0];
       }
     }
   }
-  return optimized_plan;
+  return plan;
 }
 
 auto Optimizer::OptimizeRemoveColumn(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeRemoveJoin(child));
-  }
-
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-  if (optimized_plan->GetType() == PlanType::Projection) {
-    const auto outer_proj = dynamic_cast<const ProjectionPlanNode &>(*optimized_plan);
+  if (plan->GetType() == PlanType::Projection) {
+    const auto outer_proj = dynamic_cast<const ProjectionPlanNode &>(*plan);
 
     if (outer_proj.GetChildPlan()->GetType() == PlanType::Projection) {
       const auto inner_proj = dynamic_cast<const ProjectionPlanNode &>(*outer_proj.GetChildPlan());
@@ -315,65 +142,138 @@ auto Optimizer::OptimizeRemoveColumn(const AbstractPlanNodeRef &plan) -> Abstrac
       }
     }
   }
-  return optimized_plan;
+  return plan;
 }
 
-auto Optimizer::OptimizeMergeFilterIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeMergeFilterIndexScan(child));
+auto Optimizer::MatchIndexPrefix(const std::string &table_name,
+                                 const std::vector<const ComparisonExpression *> &conjuncts)
+    -> std::optional<std::pair<const IndexInfo *, std::vector<uint32_t>>> {
+  // 有条件的列，以及这一列上是否有等值条件
+  std::unordered_map<uint32_t, bool> bounded;
+  for (const auto *expr : conjuncts) {
+    const auto *column = dynamic_cast<const ColumnValueExpression *>(expr->children_[0].get());
+    const auto *constant = dynamic_cast<const ConstantValueExpression *>(expr->children_[1].get());
+    if (column != nullptr && constant != nullptr && !constant->val_.IsNull()) {
+      bounded[column->GetColIdx()] = bounded[column->GetColIdx()] || expr->comp_type_ == ComparisonType::Equal;
+    }
+  }
+  std::optional<std::pair<const IndexInfo *, std::vector<uint32_t>>> best;
+  size_t best_equalities = 0;
+  bool best_has_range = false;
+  for (const auto *index : catalog_.GetTableIndexes(table_name)) {
+    // 等值条件固定的最长前缀，再加上后面一列上的范围
+    std::vector<uint32_t> columns;
+    size_t equalities = 0;
+    bool has_range = false;
+    for (auto key_attr : index->index_->GetKeyAttrs()) {
+      auto iter = bounded.find(key_attr);
+      if (iter == bounded.end()) {
+        break;
+      }
+      columns.push_back(key_attr);
+      if (!iter->second) {
+        has_range = true;
+        break;
+      }
+      equalities++;
+    }
+    if (columns.empty()) {
+      continue;
+    }
+    if (!best.has_value() || equalities > best_equalities ||
+        (equalities == best_equalities && has_range && !best_has_range)) {
+      best = std::make_pair(index, std::move(columns));
+      best_equalities = equalities;
+      best_has_range = has_range;
+    }
   }
+  return best;
+}
 
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
+auto Optimizer::IndexScanPays(const AbstractPlanNode &seq_scan,
+                              const std::vector<const ComparisonExpression *> &conjuncts,
+                              const std::vector<uint32_t> &key_columns, size_t table_rows) -> bool {
+  // 只有索引前缀上的条件能缩小扫描的范围，范围越宽，按 rid 回表的代价越接近甚至超过顺序扫描
+  double selectivity = 1;
+  for (const auto *expr : conjuncts) {
+    const auto *column = dynamic_cast<const ColumnValueExpression *>(expr->children_[0].get());
+    if (column != nullptr &&
+        std::find(key_columns.begin(), key_columns.end(), column->GetColIdx()) != key_columns.end() &&
+        dynamic_cast<const ConstantValueExpression *>(expr->children_[1].get()) != nullptr) {
+      selectivity *= EstimateSelectivity(*expr, seq_scan);
+    }
+  }
+  auto rows = static_cast<double>(table_rows);
+  return CostModel::IndexScan(rows * selectivity) < CostModel::SeqScan(rows);
+}
 
-  if (optimized_plan->GetType() == PlanType::Filter) {
-    const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*optimized_plan);
-    BUSTUB_ASSERT(optimized_plan->children_.size() == 1, "must have exactly one children");
-    const auto &child_plan = *optimized_plan->children_[0];
+auto Optimizer::OptimizeMergeFilterIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
+  if (plan->GetType() == PlanType::Filter) {
+    const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*plan);
+    BUSTUB_ASSERT(plan->children_.size() == 1, "must have exactly one children");
+    const auto &child_plan = *plan->children_[0];
     if (child_plan.GetType() == PlanType::SeqScan) {
       const auto &seq_scan_plan = dynamic_cast<const SeqScanPlanNode &>(child_plan);
       const auto *table_info = catalog_.GetTable(seq_scan_plan.GetTableOid());
-      const auto indices = catalog_.GetTableIndexes(table_info->name_);
-      if (const auto *expr = dynamic_cast<const ComparisonExpression *>(filter_plan.GetPredicate().get());
-          expr != nullptr) {
-        if (expr->comp_type_ == ComparisonType::Equal) {
-          if (const auto *left_expr = dynamic_cast<const ColumnValueExpression *>(expr->children_[0].get());
-              left_expr != nullptr) {
-            if (const auto *right_expr = dynamic_cast<const ConstantValueExpression *>(expr->children_[1].get());
-                right_expr != nullptr) {
-              for (const auto *index : indices) {
-                const auto &columns = index->key_schema_.GetColumns();
-                if (columns.size() == 1 &&
-                    columns[0].GetName() == table_info->schema_.GetColumn(left_expr->GetColIdx()).GetName()) {
-                  return std::make_shared<IndexScanPlanNode>(optimized_plan->output_schema_, index->index_oid_,
-                                                             filter_plan.GetPredicate());
-                }
-              }
-            }
-          }
+      // Conjuncts of the form `col op const` (op in =, <, <=, >, >=) bound the index range: equalities on a prefix of
+      // the key columns and a range on the next key column. The index scan collects the matching rids and fetches
+      // the heap pages in physical order.
+      std::vector<const ComparisonExpression *> conjuncts;
+      std::vector<const AbstractExpression *> stack{filter_plan.GetPredicate().get()};
+      while (!stack.empty()) {
+        const auto *expr = stack.back();
+        stack.pop_back();
+        if (const auto *logic_expr = dynamic_cast<const LogicExpression *>(expr);
+            logic_expr != nullptr && logic_expr->logic_type_ == LogicType::And) {
+          stack.push_back(logic_expr->GetChildAt(0).get());
+          stack.push_back(logic_expr->GetChildAt(1).get());
+        } else if (const auto *cmp_expr = dynamic_cast<const ComparisonExpression *>(expr);
+                   cmp_expr != nullptr && cmp_expr->comp_type_ != ComparisonType::NotEqual) {
+          conjuncts.push_back(cmp_expr);
         }
       }
+      auto match = MatchIndexPrefix(table_info->name_, conjuncts);
+      if (!match.has_value()) {
+        return plan;
+      }
+      const auto &[index, key_columns] = *match;
+      if (table_info->stats_.IsAnalyzed() &&
+          !IndexScanPays(child_plan, conjuncts, key_columns, table_info->stats_.GetRowCount())) {
+        return plan;
+      }
+      return std::make_shared<IndexScanPlanNode>(plan->output_schema_, index->index_oid_, filter_plan.GetPredicate());
     }
   }
-  return optimized_plan;
+  return plan;
 }
 
 auto Optimizer::OptimizeCustom(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  auto p = plan;
-  p = OptimizeMergeProjection(p);
-  p = OptimizeMergeFilterIndexScan(p);
-  p = OptimizeMergeFilterScan(p);
-  p = OptimizeMergeFilterNLJ(p);
-  p = OptimizeReorderJoinUseIndex(p);
-  p = OptimizePredicatePushDown(p);
-  p = OptimizeFalseFilter(p);
-  p = OptimizeRemoveJoin(p);
+  // 逻辑改写: 合并投影, 把过滤条件合并进扫描和连接, 为选择连接顺序做准备
+  const RuleSet rewrite_rules{"rewrite",
+                              {&Optimizer::OptimizeSimplifyExpression, &Optimizer::OptimizeMergeProjection,
+                               &Optimizer::OptimizeEliminateTrueFilter,
+                               &Optimizer::OptimizeMergeFilterIndexScan, &Optimizer::OptimizeMergeFilterScan,
+                               &Optimizer::OptimizeMergeFilterNLJ},
+                              MAX_FIXPOINT_PASSES};
+  // 物理实现: 连接顺序确定之后, 为剩下的算子选择实现方式
+  const RuleSet physical_rules{"physical",
+                               {&Optimizer::OptimizeMergeProjection, &Optimizer::OptimizeFalseFilter,
+                                &Optimizer::OptimizeRemoveJoin, &Optimizer::OptimizeNLJAsIndexJoin,
+                                &Optimizer::OptimizeNLJAsHashJoin, &Optimizer::OptimizeOrderByAsIndexScan,
+                                &Optimizer::OptimizeSortLimitAsTopN},
+                               MAX_FIXPOINT_PASSES};
+
+  auto p = ApplyRuleSet(plan, rewrite_rules);
+  // 连接顺序要看到整棵连接树，自顶向下处理，不是单个节点上的规则
+  p = OptimizeJoinOrder(p);
+  // leaderboard q3 的改写只匹配查询的根节点
   p = OptimizeRemoveColumn(p);
-  p = OptimizeNLJAsIndexJoin(p);
-  p = OptimizeNLJAsHashJoin(p);  // Enable this rule after you have implemented hash join.
-  p = OptimizeOrderByAsIndexScan(p);
-  p = OptimizeSortLimitAsTopN(p);
-  return p;
+  p = ApplyRuleSet(p, physical_rules);
+  // 裁剪之后原来重排列的投影可能变成了恒等投影, 最终的计划确定之后再给哈希连接记下估计值
+  p = OptimizePruneColumns(p);
+  const RuleSet cleanup_rules{
+      "cleanup", {&Optimizer::OptimizeMergeProjection, &Optimizer::OptimizeAnnotateHashJoin}, 1};
+  return ApplyRuleSet(p, cleanup_rules);
 }
 
 }  // namespace bustub
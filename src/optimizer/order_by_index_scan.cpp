@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 #include "binder/bound_order_by.h"
 #include "catalog/catalog.h"
@@ -8,7 +9,9 @@
 #include "common/exception.h"
 #include "common/macros.h"
 #include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
 #include "execution/expressions/constant_value_expression.h"
+#include "execution/expressions/logic_expression.h"
 #include "execution/plans/abstract_plan.h"
 #include "execution/plans/filter_plan.h"
 #include "execution/plans/index_scan_plan.h"
@@ -21,57 +24,113 @@
 
 namespace bustub {
 
-auto Optimizer::OptimizeOrderByAsIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeOrderByAsIndexScan(child));
-  }
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-
-  if (optimized_plan->GetType() == PlanType::Sort) {
-    const auto &sort_plan = dynamic_cast<const SortPlanNode &>(*optimized_plan);
-    const auto &order_bys = sort_plan.GetOrderBy();
+namespace {
 
-    // Has exactly one order by column
-    if (order_bys.size() != 1) {
-      return optimized_plan;
+/** @return the columns a scan predicate fixes to a constant with `col = const` conjuncts */
+auto FixedColumns(const AbstractExpression *predicate) -> std::vector<uint32_t> {
+  std::vector<uint32_t> columns;
+  if (predicate == nullptr) {
+    return columns;
+  }
+  std::vector<const AbstractExpression *> stack{predicate};
+  while (!stack.empty()) {
+    const auto *expr = stack.back();
+    stack.pop_back();
+    if (const auto *logic_expr = dynamic_cast<const LogicExpression *>(expr);
+        logic_expr != nullptr && logic_expr->logic_type_ == LogicType::And) {
+      stack.push_back(logic_expr->GetChildAt(0).get());
+      stack.push_back(logic_expr->GetChildAt(1).get());
+    } else if (const auto *cmp_expr = dynamic_cast<const ComparisonExpression *>(expr);
+               cmp_expr != nullptr && cmp_expr->comp_type_ == ComparisonType::Equal) {
+      const auto *column = dynamic_cast<const ColumnValueExpression *>(cmp_expr->GetChildAt(0).get());
+      const auto *constant = dynamic_cast<const ConstantValueExpression *>(cmp_expr->GetChildAt(1).get());
+      if (column != nullptr && constant != nullptr && !constant->val_.IsNull()) {
+        columns.push_back(column->GetColIdx());
+      }
     }
+  }
+  return columns;
+}
 
-    // Order type is asc or default
-    const auto &[order_type, expr] = order_bys[0];
-    if (!(order_type == OrderByType::ASC || order_type == OrderByType::DEFAULT)) {
-      return optimized_plan;
+/**
+ * 按索引键的顺序扫描时，被等值条件固定的键列不影响顺序，跳过它们之后排序列是索引键的前缀，扫描的结果就已经有序
+ */
+auto ProvidesOrder(const std::vector<uint32_t> &key_attrs, const std::vector<uint32_t> &order_columns,
+                   const std::vector<uint32_t> &fixed_columns) -> bool {
+  auto is_fixed = [&](uint32_t column) {
+    return std::find(fixed_columns.begin(), fixed_columns.end(), column) != fixed_columns.end();
+  };
+  size_t next = 0;
+  for (auto key_attr : key_attrs) {
+    while (next < order_columns.size() && is_fixed(order_columns[next])) {
+      next++;
     }
-
-    // Order expression is a column value expression
-    const auto *column_value_expr = dynamic_cast<ColumnValueExpression *>(expr.get());
-    if (column_value_expr == nullptr) {
-      return optimized_plan;
+    if (next == order_columns.size()) {
+      break;
     }
+    if (key_attr == order_columns[next]) {
+      next++;
+    } else if (!is_fixed(key_attr)) {
+      return false;
+    }
+  }
+  while (next < order_columns.size() && is_fixed(order_columns[next])) {
+    next++;
+  }
+  return next == order_columns.size();
+}
+
+}  // namespace
+
+auto Optimizer::OptimizeOrderByAsIndexScan(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
+  if (plan->GetType() == PlanType::Sort) {
+    const auto &sort_plan = dynamic_cast<const SortPlanNode &>(*plan);
 
-    auto order_by_column_id = column_value_expr->GetColIdx();
+    // Every order by is an ascending column value expression
+    std::vector<uint32_t> order_columns;
+    for (const auto &[order_type, expr] : sort_plan.GetOrderBy()) {
+      const auto *column_value_expr = dynamic_cast<ColumnValueExpression *>(expr.get());
+      if (!(order_type == OrderByType::ASC || order_type == OrderByType::DEFAULT) || column_value_expr == nullptr) {
+        return plan;
+      }
+      order_columns.push_back(column_value_expr->GetColIdx());
+    }
 
     // Has exactly one child
-    BUSTUB_ENSURE(optimized_plan->children_.size() == 1, "Sort with multiple children?? Impossible!");
-    const auto &child_plan = optimized_plan->children_[0];
+    BUSTUB_ENSURE(plan->children_.size() == 1, "Sort with multiple children?? Impossible!");
+    const auto &child_plan = plan->children_[0];
 
     if (child_plan->GetType() == PlanType::SeqScan) {
       const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(*child_plan);
       const auto *table_info = catalog_.GetTable(seq_scan.GetTableOid());
       const auto indices = catalog_.GetTableIndexes(table_info->name_);
+      auto fixed_columns = FixedColumns(seq_scan.filter_predicate_.get());
 
       for (const auto *index : indices) {
-        const auto &columns = index->key_schema_.GetColumns();
-        if (columns.size() == 1 &&
-            columns[0].GetName() == table_info->schema_.GetColumn(order_by_column_id).GetName()) {
-          // Index matched, return index scan instead
-          return std::make_shared<IndexScanPlanNode>(optimized_plan->output_schema_, index->index_oid_);
+        if (ProvidesOrder(index->index_->GetKeyAttrs(), order_columns, fixed_columns)) {
+          // Index matched, return index scan instead. A filtered scan must keep the key order of the index.
+          if (seq_scan.filter_predicate_ == nullptr) {
+            return std::make_shared<IndexScanPlanNode>(plan->output_schema_, index->index_oid_);
+          }
+          return std::make_shared<IndexScanPlanNode>(plan->output_schema_, index->index_oid_,
+                                                     seq_scan.filter_predicate_, true);
         }
       }
     }
+
+    if (child_plan->GetType() == PlanType::IndexScan) {
+      // The filter was already turned into an index range scan, the sort goes away if the same index gives the order
+      const auto &index_scan = dynamic_cast<const IndexScanPlanNode &>(*child_plan);
+      const auto *index = catalog_.GetIndex(index_scan.GetIndexOid());
+      const auto &predicate = index_scan.filter_predicate_;
+      const auto &key_attrs = index->index_->GetKeyAttrs();
+      if (predicate != nullptr && ProvidesOrder(key_attrs, order_columns, FixedColumns(predicate.get()))) {
+        return std::make_shared<IndexScanPlanNode>(plan->output_schema_, index_scan.GetIndexOid(), predicate, true);
+      }
+    }
   }
 
-  return optimized_plan;
+  return plan;
 }
 
 }  // namespace bustub
@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <limits>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "execution/plans/aggregation_plan.h"
+#include "execution/plans/filter_plan.h"
+#include "execution/plans/hash_join_plan.h"
+#include "execution/plans/limit_plan.h"
+#include "execution/plans/nested_index_join_plan.h"
+#include "execution/plans/nested_loop_join_plan.h"
+#include "execution/plans/projection_plan.h"
+#include "execution/plans/seq_scan_plan.h"
+#include "execution/plans/sort_plan.h"
+#include "execution/plans/topn_plan.h"
+#include "optimizer/expression_util.h"
+#include "optimizer/optimizer.h"
+
+namespace bustub {
+
+namespace {
+
+/** 被裁剪掉的列在映射中的值 */
+constexpr uint32_t PRUNED = std::numeric_limits<uint32_t>::max();
+
+/** 裁剪之后的计划，以及原来的每一个输出列在新计划的输出中的下标 */
+struct PrunedPlan {
+  AbstractPlanNodeRef plan_;
+  std::vector<uint32_t> mapping_;
+};
+
+auto Identity(const AbstractPlanNodeRef &plan) -> PrunedPlan {
+  std::vector<uint32_t> mapping(plan->OutputSchema().GetColumnCount());
+  for (uint32_t i = 0; i < mapping.size(); i++) {
+    mapping[i] = i;
+  }
+  return {plan, std::move(mapping)};
+}
+
+auto AllColumns(const AbstractPlanNode &plan) -> std::vector<bool> {
+  return std::vector<bool>(plan.OutputSchema().GetColumnCount(), true);
+}
+
+/** 把 expr 从第 tuple_idx 个输入读取的列标记为需要 */
+void Require(const AbstractExpression &expr, uint32_t tuple_idx, std::vector<bool> *required) {
+  std::vector<uint32_t> columns;
+  CollectColumns(expr, tuple_idx, &columns);
+  for (auto column : columns) {
+    (*required)[column] = true;
+  }
+}
+
+/** 按照子节点裁剪之后的映射改写表达式，join 的表达式用 tuple_idx 区分左右两个子节点 */
+auto Remap(const AbstractExpressionRef &expr, const std::vector<uint32_t> &left,
+           const std::vector<uint32_t> &right = {}) -> AbstractExpressionRef {
+  return RemapColumns(expr, [&](uint32_t tuple_idx, uint32_t col_idx) {
+    return std::make_pair(tuple_idx, tuple_idx == 0 ? left[col_idx] : right[col_idx]);
+  });
+}
+
+auto RemapOrderBys(const std::vector<std::pair<OrderByType, AbstractExpressionRef>> &order_bys,
+                   const std::vector<uint32_t> &mapping) -> std::vector<std::pair<OrderByType, AbstractExpressionRef>> {
+  std::vector<std::pair<OrderByType, AbstractExpressionRef>> remapped;
+  remapped.reserve(order_bys.size());
+  for (const auto &[type, expr] : order_bys) {
+    remapped.emplace_back(type, Remap(expr, mapping));
+  }
+  return remapped;
+}
+
+auto ConcatSchemas(const Schema &left, const Schema &right) -> SchemaRef {
+  auto columns = left.GetColumns();
+  columns.insert(columns.end(), right.GetColumns().begin(), right.GetColumns().end());
+  return std::make_shared<Schema>(columns);
+}
+
+/** 连接的输出是左右两侧的列拼接起来，右侧的映射要加上左侧裁剪之后的列数 */
+auto ConcatMappings(const PrunedPlan &left, const std::vector<uint32_t> &right_mapping) -> std::vector<uint32_t> {
+  auto mapping = left.mapping_;
+  auto left_column_cnt = static_cast<uint32_t>(left.plan_->OutputSchema().GetColumnCount());
+  for (auto column : right_mapping) {
+    mapping.push_back(column == PRUNED ? PRUNED : column + left_column_cnt);
+  }
+  return mapping;
+}
+
+/** 把连接输出列上的需求拆到两侧。半连接和反连接只输出左侧的列，右侧只需要连接条件读取的列 */
+auto SplitRequired(const AbstractPlanNode &join, JoinType join_type, const std::vector<bool> &required)
+    -> std::pair<std::vector<bool>, std::vector<bool>> {
+  auto left_column_cnt = join.GetChildAt(0)->OutputSchema().GetColumnCount();
+  auto right_column_cnt = join.GetChildAt(1)->OutputSchema().GetColumnCount();
+  if (IsSemiOrAntiJoin(join_type)) {
+    return {required, std::vector<bool>(right_column_cnt, false)};
+  }
+  return {{required.begin(), required.begin() + left_column_cnt}, {required.begin() + left_column_cnt, required.end()}};
+}
+
+/** @return the output schema of the pruned join, and where its output columns moved to */
+auto JoinOutput(JoinType join_type, const PrunedPlan &left, const PrunedPlan &right)
+    -> std::pair<SchemaRef, std::vector<uint32_t>> {
+  if (IsSemiOrAntiJoin(join_type)) {
+    return {left.plan_->output_schema_, left.mapping_};
+  }
+  return {ConcatSchemas(left.plan_->OutputSchema(), right.plan_->OutputSchema()), ConcatMappings(left, right.mapping_)};
+}
+
+auto PruneColumns(const AbstractPlanNodeRef &plan, std::vector<bool> required) -> PrunedPlan;
+
+auto PruneSeqScan(const AbstractPlanNodeRef &plan, const std::vector<bool> &required) -> PrunedPlan {
+  const auto &seq_scan = dynamic_cast<const SeqScanPlanNode &>(*plan);
+  std::vector<uint32_t> mapping(required.size(), PRUNED);
+  std::vector<uint32_t> column_ids;
+  std::vector<Column> columns;
+  for (uint32_t i = 0; i < required.size(); i++) {
+    if (required[i]) {
+      mapping[i] = static_cast<uint32_t>(column_ids.size());
+      column_ids.push_back(seq_scan.column_ids_.empty() ? i : seq_scan.column_ids_[i]);
+      columns.push_back(seq_scan.OutputSchema().GetColumn(i));
+    }
+  }
+  if (column_ids.size() == required.size()) {
+    return Identity(plan);
+  }
+  return {std::make_shared<SeqScanPlanNode>(std::make_shared<Schema>(columns), seq_scan.table_oid_,
+                                            seq_scan.table_name_, seq_scan.filter_predicate_, std::move(column_ids)),
+          std::move(mapping)};
+}
+
+auto PruneProjection(const AbstractPlanNodeRef &plan, const std::vector<bool> &required) -> PrunedPlan {
+  const auto &projection = dynamic_cast<const ProjectionPlanNode &>(*plan);
+  const auto &exprs = projection.GetExpressions();
+  std::vector<bool> child_required(projection.GetChildPlan()->OutputSchema().GetColumnCount(), false);
+  for (uint32_t i = 0; i < exprs.size(); i++) {
+    if (required[i]) {
+      Require(*exprs[i], 0, &child_required);
+    }
+  }
+  auto child = PruneColumns(projection.GetChildPlan(), std::move(child_required));
+  std::vector<uint32_t> mapping(exprs.size(), PRUNED);
+  std::vector<AbstractExpressionRef> pruned_exprs;
+  std::vector<Column> columns;
+  for (uint32_t i = 0; i < exprs.size(); i++) {
+    if (required[i]) {
+      mapping[i] = static_cast<uint32_t>(pruned_exprs.size());
+      pruned_exprs.push_back(Remap(exprs[i], child.mapping_));
+      columns.push_back(projection.OutputSchema().GetColumn(i));
+    }
+  }
+  return {std::make_shared<ProjectionPlanNode>(std::make_shared<Schema>(columns), std::move(pruned_exprs),
+                                               std::move(child.plan_)),
+          std::move(mapping)};
+}
+
+auto PruneAggregation(const AbstractPlanNodeRef &plan, const std::vector<bool> &required) -> PrunedPlan {
+  // group by 决定了分组，全部保留，没有用到的聚合函数不再计算
+  const auto &aggregation = dynamic_cast<const AggregationPlanNode &>(*plan);
+  auto group_by_cnt = static_cast<uint32_t>(aggregation.GetGroupBys().size());
+  std::vector<bool> child_required(aggregation.GetChildPlan()->OutputSchema().GetColumnCount(), false);
+  for (const auto &group_by : aggregation.GetGroupBys()) {
+    Require(*group_by, 0, &child_required);
+  }
+  for (uint32_t i = 0; i < aggregation.GetAggregates().size(); i++) {
+    if (required[group_by_cnt + i]) {
+      Require(*aggregation.GetAggregateAt(i), 0, &child_required);
+    }
+  }
+  auto child = PruneColumns(aggregation.GetChildPlan(), std::move(child_required));
+  std::vector<uint32_t> mapping(required.size(), PRUNED);
+  std::vector<AbstractExpressionRef> group_bys;
+  std::vector<AbstractExpressionRef> aggregates;
+  std::vector<AggregationType> agg_types;
+  std::vector<Column> columns;
+  for (uint32_t i = 0; i < group_by_cnt; i++) {
+    mapping[i] = i;
+    group_bys.push_back(Remap(aggregation.GetGroupByAt(i), child.mapping_));
+    columns.push_back(aggregation.OutputSchema().GetColumn(i));
+  }
+  for (uint32_t i = 0; i < aggregation.GetAggregates().size(); i++) {
+    if (required[group_by_cnt + i]) {
+      mapping[group_by_cnt + i] = static_cast<uint32_t>(columns.size());
+      aggregates.push_back(Remap(aggregation.GetAggregateAt(i), child.mapping_));
+      agg_types.push_back(aggregation.GetAggregateTypes()[i]);
+      columns.push_back(aggregation.OutputSchema().GetColumn(group_by_cnt + i));
+    }
+  }
+  return {std::make_shared<AggregationPlanNode>(std::make_shared<Schema>(columns), std::move(child.plan_),
+                                                std::move(group_bys), std::move(aggregates), std::move(agg_types)),
+          std::move(mapping)};
+}
+
+auto PruneNestedLoopJoin(const AbstractPlanNodeRef &plan, const std::vector<bool> &required) -> PrunedPlan {
+  const auto &nlj = dynamic_cast<const NestedLoopJoinPlanNode &>(*plan);
+  auto [left_required, right_required] = SplitRequired(nlj, nlj.GetJoinType(), required);
+  Require(nlj.Predicate(), 0, &left_required);
+  Require(nlj.Predicate(), 1, &right_required);
+  auto left = PruneColumns(nlj.GetLeftPlan(), std::move(left_required));
+  auto right = PruneColumns(nlj.GetRightPlan(), std::move(right_required));
+  auto predicate = Remap(nlj.predicate_, left.mapping_, right.mapping_);
+  auto [schema, mapping] = JoinOutput(nlj.GetJoinType(), left, right);
+  return {std::make_shared<NestedLoopJoinPlanNode>(std::move(schema), std::move(left.plan_), std::move(right.plan_),
+                                                   std::move(predicate), nlj.GetJoinType()),
+          std::move(mapping)};
+}
+
+auto PruneHashJoin(const AbstractPlanNodeRef &plan, const std::vector<bool> &required) -> PrunedPlan {
+  // 两侧的连接键都只读取各自的子节点
+  const auto &hash_join = dynamic_cast<const HashJoinPlanNode &>(*plan);
+  auto [left_required, right_required] = SplitRequired(hash_join, hash_join.GetJoinType(), required);
+  Require(hash_join.LeftJoinKeyExpression(), 0, &left_required);
+  Require(hash_join.RightJoinKeyExpression(), 0, &right_required);
+  auto left = PruneColumns(hash_join.GetLeftPlan(), std::move(left_required));
+  auto right = PruneColumns(hash_join.GetRightPlan(), std::move(right_required));
+  auto left_key = Remap(hash_join.left_key_expression_, left.mapping_);
+  auto right_key = Remap(hash_join.right_key_expression_, right.mapping_);
+  auto [schema, mapping] = JoinOutput(hash_join.GetJoinType(), left, right);
+  return {std::make_shared<HashJoinPlanNode>(std::move(schema), std::move(left.plan_), std::move(right.plan_),
+                                             std::move(left_key), std::move(right_key), hash_join.GetJoinType()),
+          std::move(mapping)};
+}
+
+auto PruneNestedIndexJoin(const AbstractPlanNodeRef &plan, const std::vector<bool> &required) -> PrunedPlan {
+  // 内表的列直接从 table heap 读取，只需要记住输出哪些列
+  const auto &nij = dynamic_cast<const NestedIndexJoinPlanNode &>(*plan);
+  auto outer_column_cnt = nij.GetChildPlan()->OutputSchema().GetColumnCount();
+  std::vector<bool> outer_required(required.begin(), required.begin() + outer_column_cnt);
+  Require(*nij.KeyPredicate(), 0, &outer_required);
+  auto outer = PruneColumns(nij.GetChildPlan(), std::move(outer_required));
+
+  std::vector<uint32_t> inner_mapping(required.size() - outer_column_cnt, PRUNED);
+  std::vector<uint32_t> inner_column_ids;
+  std::vector<Column> inner_columns;
+  for (uint32_t i = 0; i < inner_mapping.size(); i++) {
+    if (required[outer_column_cnt + i]) {
+      inner_mapping[i] = static_cast<uint32_t>(inner_column_ids.size());
+      inner_column_ids.push_back(nij.inner_column_ids_.empty() ? i : nij.inner_column_ids_[i]);
+      inner_columns.push_back(nij.OutputSchema().GetColumn(outer_column_cnt + i));
+    }
+  }
+  if (inner_column_ids.size() == inner_mapping.size()) {
+    inner_column_ids = nij.inner_column_ids_;
+  }
+  auto schema = ConcatSchemas(outer.plan_->OutputSchema(), Schema(inner_columns));
+  auto mapping = ConcatMappings(outer, inner_mapping);
+  auto pruned = std::make_shared<NestedIndexJoinPlanNode>(
+      std::move(schema), std::move(outer.plan_), Remap(nij.KeyPredicate(), outer.mapping_), nij.GetInnerTableOid(),
+      nij.GetIndexOid(), nij.index_name_, nij.index_table_name_, nij.inner_table_schema_, nij.GetJoinType());
+  pruned->inner_column_ids_ = std::move(inner_column_ids);
+  return {std::move(pruned), std::move(mapping)};
+}
+
+/**
+ * @param required the output columns of plan its parent reads
+ * @return plan without the columns nobody above reads, and where the remaining columns moved to
+ */
+auto PruneColumns(const AbstractPlanNodeRef &plan, std::vector<bool> required) -> PrunedPlan {
+  // COUNT(*) 之类的父节点不读任何列，至少保留一列，避免出现没有列的 tuple
+  if (!required.empty() && std::find(required.begin(), required.end(), true) == required.end()) {
+    required[0] = true;
+  }
+  switch (plan->GetType()) {
+    case PlanType::SeqScan:
+      return PruneSeqScan(plan, required);
+    case PlanType::Projection:
+      return PruneProjection(plan, required);
+    case PlanType::Aggregation:
+      return PruneAggregation(plan, required);
+    case PlanType::NestedLoopJoin:
+      return PruneNestedLoopJoin(plan, required);
+    case PlanType::HashJoin:
+      return PruneHashJoin(plan, required);
+    case PlanType::NestedIndexJoin:
+      return PruneNestedIndexJoin(plan, required);
+    case PlanType::Filter: {
+      // 过滤条件用到的列即使父节点不需要也要保留，Filter 的输出和子节点相同
+      const auto &filter = dynamic_cast<const FilterPlanNode &>(*plan);
+      Require(*filter.GetPredicate(), 0, &required);
+      auto child = PruneColumns(filter.GetChildPlan(), std::move(required));
+      auto predicate = Remap(filter.GetPredicate(), child.mapping_);
+      auto schema = child.plan_->output_schema_;
+      return {std::make_shared<FilterPlanNode>(std::move(schema), std::move(predicate), std::move(child.plan_)),
+              std::move(child.mapping_)};
+    }
+    case PlanType::Sort: {
+      const auto &sort = dynamic_cast<const SortPlanNode &>(*plan);
+      for (const auto &[type, expr] : sort.GetOrderBy()) {
+        Require(*expr, 0, &required);
+      }
+      auto child = PruneColumns(sort.GetChildPlan(), std::move(required));
+      auto order_bys = RemapOrderBys(sort.GetOrderBy(), child.mapping_);
+      auto schema = child.plan_->output_schema_;
+      return {std::make_shared<SortPlanNode>(std::move(schema), std::move(child.plan_), std::move(order_bys)),
+              std::move(child.mapping_)};
+    }
+    case PlanType::TopN: {
+      const auto &top_n = dynamic_cast<const TopNPlanNode &>(*plan);
+      for (const auto &[type, expr] : top_n.GetOrderBy()) {
+        Require(*expr, 0, &required);
+      }
+      auto child = PruneColumns(top_n.GetChildPlan(), std::move(required));
+      auto order_bys = RemapOrderBys(top_n.GetOrderBy(), child.mapping_);
+      auto schema = child.plan_->output_schema_;
+      return {std::make_shared<TopNPlanNode>(std::move(schema), std::move(child.plan_), std::move(order_bys),
+                                             top_n.GetN()),
+              std::move(child.mapping_)};
+    }
+    case PlanType::Limit: {
+      const auto &limit = dynamic_cast<const LimitPlanNode &>(*plan);
+      auto child = PruneColumns(limit.GetChildPlan(), std::move(required));
+      auto schema = child.plan_->output_schema_;
+      return {std::make_shared<LimitPlanNode>(std::move(schema), std::move(child.plan_), limit.GetLimit()),
+              std::move(child.mapping_)};
+    }
+    default: {
+      // 其余的节点 (insert, delete, values, mock scan, index scan ...) 需要子节点的全部列，只在子树内部裁剪
+      std::vector<AbstractPlanNodeRef> children;
+      for (const auto &child : plan->GetChildren()) {
+        children.push_back(PruneColumns(child, AllColumns(*child)).plan_);
+      }
+      return Identity(plan->CloneWithChildren(std::move(children)));
+    }
+  }
+}
+
+}  // namespace
+
+auto Optimizer::OptimizePruneColumns(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
+  return PruneColumns(plan, AllColumns(*plan)).plan_;
+}
+
+}  // namespace bustub
@@ -0,0 +1,449 @@
+#include <algorithm>
+#include <map>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "catalog/schema.h"
+#include "common/exception.h"
+#include "execution/expressions/arithmetic_expression.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/expressions/comparison_expression.h"
+#include "execution/expressions/constant_value_expression.h"
+#include "execution/expressions/logic_expression.h"
+#include "execution/plans/filter_plan.h"
+#include "execution/plans/nested_loop_join_plan.h"
+#include "execution/plans/projection_plan.h"
+#include "execution/plans/seq_scan_plan.h"
+#include "execution/plans/values_plan.h"
+#include "optimizer/expression_util.h"
+#include "optimizer/optimizer.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+
+auto MakeBoolean(bool value) -> AbstractExpressionRef {
+  return std::make_shared<ConstantValueExpression>(ValueFactory::GetBooleanValue(value));
+}
+
+auto IsConstant(const AbstractExpression &expr) -> bool {
+  return dynamic_cast<const ConstantValueExpression *>(&expr) != nullptr;
+}
+
+auto IsNullConstant(const AbstractExpression &expr) -> bool {
+  const auto *constant = dynamic_cast<const ConstantValueExpression *>(&expr);
+  return constant != nullptr && constant->val_.IsNull();
+}
+
+/** @return the value of a non-null boolean constant */
+auto AsBoolean(const AbstractExpression &expr) -> std::optional<bool> {
+  const auto *constant = dynamic_cast<const ConstantValueExpression *>(&expr);
+  if (constant == nullptr || constant->val_.GetTypeId() != TypeId::BOOLEAN || constant->val_.IsNull()) {
+    return std::nullopt;
+  }
+  return constant->val_.GetAs<bool>();
+}
+
+/** `a op b` 等价于 `b Flip(op) a` */
+auto Flip(ComparisonType comp_type) -> ComparisonType {
+  switch (comp_type) {
+    case ComparisonType::LessThan:
+      return ComparisonType::GreaterThan;
+    case ComparisonType::LessThanOrEqual:
+      return ComparisonType::GreaterThanOrEqual;
+    case ComparisonType::GreaterThan:
+      return ComparisonType::LessThan;
+    case ComparisonType::GreaterThanOrEqual:
+      return ComparisonType::LessThanOrEqual;
+    default:
+      return comp_type;
+  }
+}
+
+/** A comparison `column op constant` with a non-null constant. */
+struct ColumnComparison {
+  const ColumnValueExpression *column_;
+  ComparisonType comp_type_;
+  Value value_;
+};
+
+auto AsColumnComparison(const AbstractExpression &expr) -> std::optional<ColumnComparison> {
+  const auto *cmp_expr = dynamic_cast<const ComparisonExpression *>(&expr);
+  if (cmp_expr == nullptr) {
+    return std::nullopt;
+  }
+  const auto *column = dynamic_cast<const ColumnValueExpression *>(cmp_expr->GetChildAt(0).get());
+  const auto *constant = dynamic_cast<const ConstantValueExpression *>(cmp_expr->GetChildAt(1).get());
+  if (column == nullptr || constant == nullptr || constant->val_.IsNull()) {
+    return std::nullopt;
+  }
+  return ColumnComparison{column, cmp_expr->comp_type_, constant->val_};
+}
+
+auto ColumnKey(const ColumnValueExpression &column) -> std::pair<uint32_t, uint32_t> {
+  return {column.GetTupleIdx(), column.GetColIdx()};
+}
+
+auto MakeComparison(const ColumnValueExpression &column, ComparisonType comp_type, const Value &value)
+    -> AbstractExpressionRef {
+  return std::make_shared<ComparisonExpression>(
+      std::make_shared<ColumnValueExpression>(column.GetTupleIdx(), column.GetColIdx(), column.GetReturnType()),
+      std::make_shared<ConstantValueExpression>(value), comp_type);
+}
+
+/** 一列上所有 `col op const` 合取项的交集，没有下界或上界时对应的 optional 为空 */
+struct Range {
+  Range(const ColumnValueExpression *column, TypeId type) : column_(column), type_(type) {}
+
+  const ColumnValueExpression *column_;
+  TypeId type_;
+  std::optional<Value> lower_;
+  bool lower_inclusive_{true};
+  std::optional<Value> upper_;
+  bool upper_inclusive_{true};
+  /** number of conjuncts merged into the range */
+  size_t conjuncts_{0};
+
+  void AddLower(const Value &value, bool inclusive) {
+    if (!lower_.has_value() || value.CompareGreaterThan(*lower_) == CmpBool::CmpTrue ||
+        (value.CompareEquals(*lower_) == CmpBool::CmpTrue && !inclusive)) {
+      lower_ = value;
+      lower_inclusive_ = inclusive;
+    }
+  }
+
+  void AddUpper(const Value &value, bool inclusive) {
+    if (!upper_.has_value() || value.CompareLessThan(*upper_) == CmpBool::CmpTrue ||
+        (value.CompareEquals(*upper_) == CmpBool::CmpTrue && !inclusive)) {
+      upper_ = value;
+      upper_inclusive_ = inclusive;
+    }
+  }
+
+  void Add(const ColumnComparison &cmp) {
+    conjuncts_++;
+    switch (cmp.comp_type_) {
+      case ComparisonType::Equal:
+        AddLower(cmp.value_, true);
+        AddUpper(cmp.value_, true);
+        break;
+      case ComparisonType::GreaterThan:
+      case ComparisonType::GreaterThanOrEqual:
+        AddLower(cmp.value_, cmp.comp_type_ == ComparisonType::GreaterThanOrEqual);
+        break;
+      case ComparisonType::LessThan:
+      case ComparisonType::LessThanOrEqual:
+        AddUpper(cmp.value_, cmp.comp_type_ == ComparisonType::LessThanOrEqual);
+        break;
+      default:
+        UNREACHABLE("not a range comparison");
+    }
+  }
+
+  auto IsPoint() const -> bool {
+    return lower_.has_value() && upper_.has_value() && lower_inclusive_ && upper_inclusive_ &&
+           lower_->CompareEquals(*upper_) == CmpBool::CmpTrue;
+  }
+
+  auto IsEmpty() const -> bool {
+    if (!lower_.has_value() || !upper_.has_value()) {
+      return false;
+    }
+    if (lower_->CompareGreaterThan(*upper_) == CmpBool::CmpTrue) {
+      return true;
+    }
+    return lower_->CompareEquals(*upper_) == CmpBool::CmpTrue && !(lower_inclusive_ && upper_inclusive_);
+  }
+
+  /** @return the fewest comparisons that express the range */
+  auto ToConjuncts() const -> std::vector<AbstractExpressionRef> {
+    if (IsPoint()) {
+      return {MakeComparison(*column_, ComparisonType::Equal, *lower_)};
+    }
+    std::vector<AbstractExpressionRef> conjuncts;
+    if (lower_.has_value()) {
+      conjuncts.push_back(MakeComparison(
+          *column_, lower_inclusive_ ? ComparisonType::GreaterThanOrEqual : ComparisonType::GreaterThan, *lower_));
+    }
+    if (upper_.has_value()) {
+      conjuncts.push_back(MakeComparison(
+          *column_, upper_inclusive_ ? ComparisonType::LessThanOrEqual : ComparisonType::LessThan, *upper_));
+    }
+    return conjuncts;
+  }
+};
+
+auto IsRangeComparison(ComparisonType comp_type) -> bool { return comp_type != ComparisonType::NotEqual; }
+
+void SplitDisjuncts(const AbstractExpressionRef &expr, std::vector<AbstractExpressionRef> *disjuncts) {
+  if (const auto *logic_expr = dynamic_cast<const LogicExpression *>(expr.get());
+      logic_expr != nullptr && logic_expr->logic_type_ == LogicType::Or) {
+    SplitDisjuncts(logic_expr->GetChildAt(0), disjuncts);
+    SplitDisjuncts(logic_expr->GetChildAt(1), disjuncts);
+    return;
+  }
+  disjuncts->push_back(expr);
+}
+
+/** 去掉重复的项，返回是否有重复 */
+auto RemoveDuplicates(std::vector<AbstractExpressionRef> *exprs) -> bool {
+  std::unordered_set<std::string> seen;
+  auto size = exprs->size();
+  exprs->erase(std::remove_if(exprs->begin(), exprs->end(),
+                              [&](const AbstractExpressionRef &expr) { return !seen.insert(expr->ToString()).second; }),
+               exprs->end());
+  return exprs->size() != size;
+}
+
+auto SimplifyConjunction(const AbstractExpressionRef &expr, bool is_predicate) -> AbstractExpressionRef {
+  std::vector<AbstractExpressionRef> conjuncts;
+  SplitConjuncts(expr, &conjuncts);
+  bool changed = false;
+  std::vector<AbstractExpressionRef> simplified;
+  for (const auto &conjunct : conjuncts) {
+    auto result = SimplifyExpression(conjunct, is_predicate);
+    changed = changed || result != conjunct;
+    std::vector<AbstractExpressionRef> pieces;
+    SplitConjuncts(result, &pieces);
+    for (auto &piece : pieces) {
+      if (auto value = AsBoolean(*piece); value.has_value()) {
+        if (!*value) {
+          return MakeBoolean(false);
+        }
+        changed = true;
+        continue;
+      }
+      simplified.push_back(std::move(piece));
+    }
+  }
+  changed = RemoveDuplicates(&simplified) || changed;
+
+  // 同一列上的范围条件求交集：交集为空时整个合取恒为假，否则只保留最紧的上下界。
+  // 列为 NULL 时空范围的值是 NULL 而不是 false，只有在谓词里两者才没有区别
+  std::map<std::pair<uint32_t, uint32_t>, Range> ranges;
+  std::vector<std::optional<std::pair<uint32_t, uint32_t>>> keys;
+  for (const auto &conjunct : simplified) {
+    auto cmp = AsColumnComparison(*conjunct);
+    if (!cmp.has_value() || !IsRangeComparison(cmp->comp_type_)) {
+      keys.emplace_back(std::nullopt);
+      continue;
+    }
+    auto key = ColumnKey(*cmp->column_);
+    auto [it, _] = ranges.emplace(key, Range(cmp->column_, cmp->value_.GetTypeId()));
+    if (it->second.type_ != cmp->value_.GetTypeId()) {
+      keys.emplace_back(std::nullopt);
+      continue;
+    }
+    it->second.Add(*cmp);
+    keys.emplace_back(key);
+  }
+  for (const auto &[_, range] : ranges) {
+    if (range.IsEmpty()) {
+      if (is_predicate) {
+        return MakeBoolean(false);
+      }
+      // 保留原来的比较，不合并这一列的范围
+      return changed ? MakeConjunction(simplified) : expr;
+    }
+  }
+
+  std::vector<AbstractExpressionRef> result;
+  std::set<std::pair<uint32_t, uint32_t>> emitted;
+  for (size_t i = 0; i < simplified.size(); i++) {
+    if (!keys[i].has_value()) {
+      result.push_back(simplified[i]);
+      continue;
+    }
+    const auto &range = ranges.at(*keys[i]);
+    auto tightened = range.ToConjuncts();
+    if (tightened.size() == range.conjuncts_) {
+      result.push_back(simplified[i]);
+      continue;
+    }
+    // 合并后的范围放在这一列第一次出现的位置
+    changed = true;
+    if (emitted.insert(*keys[i]).second) {
+      result.insert(result.end(), tightened.begin(), tightened.end());
+    }
+  }
+  return changed ? MakeConjunction(result) : expr;
+}
+
+auto SimplifyDisjunction(const AbstractExpressionRef &expr, bool is_predicate) -> AbstractExpressionRef {
+  std::vector<AbstractExpressionRef> disjuncts;
+  SplitDisjuncts(expr, &disjuncts);
+  bool changed = false;
+  std::vector<AbstractExpressionRef> simplified;
+  for (const auto &disjunct : disjuncts) {
+    auto result = SimplifyExpression(disjunct, is_predicate);
+    changed = changed || result != disjunct;
+    std::vector<AbstractExpressionRef> pieces;
+    SplitDisjuncts(result, &pieces);
+    for (auto &piece : pieces) {
+      if (auto value = AsBoolean(*piece); value.has_value()) {
+        if (*value) {
+          return MakeBoolean(true);
+        }
+        changed = true;
+        continue;
+      }
+      simplified.push_back(std::move(piece));
+    }
+  }
+  changed = RemoveDuplicates(&simplified) || changed;
+  if (simplified.empty()) {
+    return MakeBoolean(false);
+  }
+
+  // IN 列表 `x = 1 OR x = 2 OR x = 3` 的整数值连续时改写成范围，这样可以使用索引扫描
+  std::vector<int32_t> values;
+  const ColumnValueExpression *column = nullptr;
+  for (const auto &disjunct : simplified) {
+    auto cmp = AsColumnComparison(*disjunct);
+    if (!cmp.has_value() || cmp->comp_type_ != ComparisonType::Equal || cmp->value_.GetTypeId() != TypeId::INTEGER ||
+        (column != nullptr && ColumnKey(*column) != ColumnKey(*cmp->column_))) {
+      values.clear();
+      break;
+    }
+    column = cmp->column_;
+    values.push_back(cmp->value_.GetAs<int32_t>());
+  }
+  if (values.size() > 1) {
+    auto [min, max] = std::minmax_element(values.begin(), values.end());
+    if (static_cast<int64_t>(*max) - *min + 1 == static_cast<int64_t>(values.size())) {
+      return std::make_shared<LogicExpression>(
+          MakeComparison(*column, ComparisonType::GreaterThanOrEqual, ValueFactory::GetIntegerValue(*min)),
+          MakeComparison(*column, ComparisonType::LessThanOrEqual, ValueFactory::GetIntegerValue(*max)),
+          LogicType::And);
+    }
+  }
+
+  if (!changed) {
+    return expr;
+  }
+  auto result = simplified[0];
+  for (size_t i = 1; i < simplified.size(); i++) {
+    result = std::make_shared<LogicExpression>(result, simplified[i], LogicType::Or);
+  }
+  return result;
+}
+
+}  // namespace
+
+auto SimplifyExpression(const AbstractExpressionRef &expr, bool is_predicate) -> AbstractExpressionRef {
+  if (const auto *logic_expr = dynamic_cast<const LogicExpression *>(expr.get()); logic_expr != nullptr) {
+    return logic_expr->logic_type_ == LogicType::And ? SimplifyConjunction(expr, is_predicate)
+                                                     : SimplifyDisjunction(expr, is_predicate);
+  }
+  if (expr->GetChildren().empty()) {
+    return expr;
+  }
+  std::vector<AbstractExpressionRef> children;
+  bool changed = false;
+  // 比较等表达式的操作数不是谓词，NULL 和 false 的结果不同
+  for (const auto &child : expr->GetChildren()) {
+    children.emplace_back(SimplifyExpression(child, false));
+    changed = changed || children.back() != child;
+  }
+
+  // 常量折叠：子表达式都是常量时在规划时求值一次，而不是对每一行求值
+  if (std::all_of(children.begin(), children.end(), [](const auto &child) { return IsConstant(*child); })) {
+    try {
+      auto value = expr->CloneWithChildren(children)->Evaluate(nullptr, Schema(std::vector<Column>{}));
+      return std::make_shared<ConstantValueExpression>(value);
+    } catch (const Exception &) {
+      // 类型不兼容等错误留到执行时报告
+    }
+  }
+  const bool is_comparison = dynamic_cast<const ComparisonExpression *>(expr.get()) != nullptr;
+  const bool is_arithmetic = dynamic_cast<const ArithmeticExpression *>(expr.get()) != nullptr;
+  if ((is_comparison || is_arithmetic) &&
+      std::any_of(children.begin(), children.end(), [](const auto &child) { return IsNullConstant(*child); })) {
+    return std::make_shared<ConstantValueExpression>(ValueFactory::GetNullValueByType(expr->GetReturnType()));
+  }
+  // 常量放到比较的右边，`5 < x` 改写成 `x > 5`，后面的规则只需要匹配 `col op const`
+  if (is_comparison && IsConstant(*children[0]) && !IsConstant(*children[1])) {
+    const auto &cmp_expr = dynamic_cast<const ComparisonExpression &>(*expr);
+    return std::make_shared<ComparisonExpression>(children[1], children[0], Flip(cmp_expr.comp_type_));
+  }
+  return changed ? expr->CloneWithChildren(std::move(children)) : expr;
+}
+
+auto Optimizer::OptimizeSimplifyExpression(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
+  auto empty = [&plan]() {
+    return std::make_shared<ValuesPlanNode>(plan->output_schema_, std::vector<std::vector<AbstractExpressionRef>>{});
+  };
+  switch (plan->GetType()) {
+    case PlanType::Filter: {
+      const auto &filter_plan = dynamic_cast<const FilterPlanNode &>(*plan);
+      auto predicate = SimplifyExpression(filter_plan.GetPredicate(), true);
+      if (IsPredicateFalse(*predicate)) {
+        return empty();
+      }
+      if (predicate != filter_plan.GetPredicate()) {
+        return std::make_shared<FilterPlanNode>(plan->output_schema_, std::move(predicate),
+                                                filter_plan.GetChildPlan());
+      }
+      return plan;
+    }
+    case PlanType::SeqScan: {
+      const auto &seq_scan_plan = dynamic_cast<const SeqScanPlanNode &>(*plan);
+      if (seq_scan_plan.filter_predicate_ == nullptr) {
+        return plan;
+      }
+      auto predicate = SimplifyExpression(seq_scan_plan.filter_predicate_, true);
+      if (IsPredicateFalse(*predicate)) {
+        return empty();
+      }
+      if (predicate != seq_scan_plan.filter_predicate_) {
+        return std::make_shared<SeqScanPlanNode>(plan->output_schema_, seq_scan_plan.table_oid_,
+                                                 seq_scan_plan.table_name_, std::move(predicate),
+                                                 seq_scan_plan.column_ids_);
+      }
+      return plan;
+    }
+    case PlanType::NestedLoopJoin: {
+      const auto &nlj_plan = dynamic_cast<const NestedLoopJoinPlanNode &>(*plan);
+      auto predicate = SimplifyExpression(nlj_plan.predicate_, true);
+      if (IsPredicateFalse(*predicate)) {
+        // 连接条件恒为假：内连接和半连接没有输出，反连接输出左表的所有行，左外连接仍然要补 NULL
+        if (nlj_plan.GetJoinType() == JoinType::INNER || nlj_plan.GetJoinType() == JoinType::SEMI) {
+          return empty();
+        }
+        if (nlj_plan.GetJoinType() == JoinType::ANTI) {
+          return nlj_plan.GetLeftPlan();
+        }
+      }
+      if (predicate != nlj_plan.predicate_) {
+        return std::make_shared<NestedLoopJoinPlanNode>(plan->output_schema_, nlj_plan.GetLeftPlan(),
+                                                        nlj_plan.GetRightPlan(), std::move(predicate),
+                                                        nlj_plan.GetJoinType());
+      }
+      return plan;
+    }
+    case PlanType::Projection: {
+      const auto &projection_plan = dynamic_cast<const ProjectionPlanNode &>(*plan);
+      std::vector<AbstractExpressionRef> exprs;
+      bool changed = false;
+      for (const auto &expr : projection_plan.GetExpressions()) {
+        exprs.emplace_back(SimplifyExpression(expr, false));
+        changed = changed || exprs.back() != expr;
+      }
+      if (changed) {
+        return std::make_shared<ProjectionPlanNode>(plan->output_schema_, std::move(exprs),
+                                                    projection_plan.GetChildPlan());
+      }
+      return plan;
+    }
+    default:
+      return plan;
+  }
+}
+
+}  // namespace bustub
@@ -6,20 +6,13 @@
 namespace bustub {
 
 auto Optimizer::OptimizeSortLimitAsTopN(const AbstractPlanNodeRef &plan) -> AbstractPlanNodeRef {
-  // TODO(student): implement sort + limit -> top N optimizer rule
-  std::vector<AbstractPlanNodeRef> children;
-  for (const auto &child : plan->GetChildren()) {
-    children.emplace_back(OptimizeSortLimitAsTopN(child));
-  }
-  auto optimized_plan = plan->CloneWithChildren(std::move(children));
-
-  if (optimized_plan->GetType() == PlanType::Limit) {
-    const auto &limit_plan = dynamic_cast<const LimitPlanNode &>(*optimized_plan);
+  if (plan->GetType() == PlanType::Limit) {
+    const auto &limit_plan = dynamic_cast<const LimitPlanNode &>(*plan);
     const auto &limit = limit_plan.GetLimit();
 
     BUSTUB_ENSURE(limit_plan.children_.size() == 1, "Limit Plan should have exactly 1 child.");
-    if (optimized_plan->GetChildAt(0)->GetType() == PlanType::Sort) {
-      const auto &sort_plan = dynamic_cast<const SortPlanNode &>(*optimized_plan->GetChildAt(0));
+    if (plan->GetChildAt(0)->GetType() == PlanType::Sort) {
+      const auto &sort_plan = dynamic_cast<const SortPlanNode &>(*plan->GetChildAt(0));
       const auto &order_bys = sort_plan.GetOrderBy();
 
       BUSTUB_ENSURE(sort_plan.children_.size() == 1, "Sort Plan should have exactly 1 child.");
@@ -27,7 +20,7 @@ auto Optimizer::OptimizeSortLimitAsTopN(const AbstractPlanNodeRef &plan) -> Abst
       return std::make_shared<TopNPlanNode>(limit_plan.output_schema_, sort_plan.GetChildAt(0), order_bys, limit);
     }
   }
-  return optimized_plan;
+  return plan;
 }
 
 }  // namespace bustub
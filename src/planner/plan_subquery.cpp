@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "binder/bound_expression.h"
+#include "binder/bound_table_ref.h"
+#include "binder/expressions/bound_agg_call.h"
+#include "binder/expressions/bound_alias.h"
+#include "binder/expressions/bound_binary_op.h"
+#include "binder/expressions/bound_column_ref.h"
+#include "binder/expressions/bound_subquery_expr.h"
+#include "binder/expressions/bound_unary_op.h"
+#include "binder/statement/select_statement.h"
+#include "binder/table_ref/bound_join_ref.h"
+#include "catalog/schema.h"
+#include "common/exception.h"
+#include "execution/expressions/column_value_expression.h"
+#include "execution/plans/filter_plan.h"
+#include "execution/plans/nested_loop_join_plan.h"
+#include "optimizer/expression_util.h"
+#include "planner/planner.h"
+
+namespace bustub {
+
+namespace {
+
+/** 把 AND 树拆成合取项 */
+void SplitConjuncts(const BoundExpression &expr, std::vector<const BoundExpression *> *conjuncts) {
+  if (expr.type_ == ExpressionType::BINARY_OP) {
+    const auto &binary_op = dynamic_cast<const BoundBinaryOp &>(expr);
+    if (binary_op.op_name_ == "and") {
+      SplitConjuncts(*binary_op.larg_, conjuncts);
+      SplitConjuncts(*binary_op.rarg_, conjuncts);
+      return;
+    }
+  }
+  conjuncts->push_back(&expr);
+}
+
+/** @return the subquery and whether it is negated, if expr is `subquery` or `NOT subquery` */
+auto AsSubqueryPredicate(const BoundExpression &expr) -> std::optional<std::pair<const BoundSubqueryExpr *, bool>> {
+  if (expr.type_ == ExpressionType::SUBQUERY) {
+    return std::make_pair(&dynamic_cast<const BoundSubqueryExpr &>(expr), false);
+  }
+  if (expr.type_ == ExpressionType::UNARY_OP) {
+    const auto &unary_op = dynamic_cast<const BoundUnaryOp &>(expr);
+    if (unary_op.op_name_ == "not" && unary_op.arg_->type_ == ExpressionType::SUBQUERY) {
+      return std::make_pair(&dynamic_cast<const BoundSubqueryExpr &>(*unary_op.arg_), true);
+    }
+  }
+  return std::nullopt;
+}
+
+/**
+ * @return whether expr contains a subquery. 如果 names 不为 nullptr，把 expr 读取的列名追加进去，
+ * 子查询内部的列不属于当前查询，不会被收集。
+ */
+auto VisitBoundExpression(const BoundExpression &expr, std::vector<std::string> *names) -> bool {
+  switch (expr.type_) {
+    case ExpressionType::COLUMN_REF:
+      if (names != nullptr) {
+        names->push_back(expr.ToString());
+      }
+      return false;
+    case ExpressionType::BINARY_OP: {
+      const auto &binary_op = dynamic_cast<const BoundBinaryOp &>(expr);
+      auto left = VisitBoundExpression(*binary_op.larg_, names);
+      return VisitBoundExpression(*binary_op.rarg_, names) || left;
+    }
+    case ExpressionType::UNARY_OP:
+      return VisitBoundExpression(*dynamic_cast<const BoundUnaryOp &>(expr).arg_, names);
+    case ExpressionType::ALIAS:
+      return VisitBoundExpression(*dynamic_cast<const BoundAlias &>(expr).child_, names);
+    case ExpressionType::AGG_CALL: {
+      bool found = false;
+      for (const auto &arg : dynamic_cast<const BoundAggCall &>(expr).args_) {
+        found = VisitBoundExpression(*arg, names) || found;
+      }
+      return found;
+    }
+    case ExpressionType::SUBQUERY:
+      return true;
+    default:
+      return false;
+  }
+}
+
+auto ContainsSubquery(const BoundExpression &expr) -> bool { return VisitBoundExpression(expr, nullptr); }
+
+/** @return whether every column expr reads is in schema */
+auto ReadsOnly(const BoundExpression &expr, const Schema &schema) -> bool {
+  std::vector<std::string> names;
+  VisitBoundExpression(expr, &names);
+  return std::all_of(names.begin(), names.end(),
+                     [&](const std::string &name) { return schema.TryGetColIdx(name).has_value(); });
+}
+
+/** 不带聚合、分组和 LIMIT 的子查询。DISTINCT 和 ORDER BY 不影响半连接的结果，直接忽略 */
+auto IsSimpleSelect(const SelectStatement &subquery) -> bool {
+  if (subquery.table_->type_ == TableReferenceType::EMPTY || !subquery.group_by_.empty() ||
+      !subquery.having_->IsInvalid() || !subquery.limit_count_->IsInvalid() || !subquery.limit_offset_->IsInvalid()) {
+    return false;
+  }
+  return std::none_of(subquery.select_list_.begin(), subquery.select_list_.end(),
+                      [](const auto &item) { return item->HasAggregation(); });
+}
+
+/** 单个子节点上规划出来的表达式改为读取连接的右侧 */
+auto ToRightSide(const AbstractExpressionRef &expr) -> AbstractExpressionRef {
+  return RemapColumns(expr, [](uint32_t /* tuple_idx */, uint32_t col_idx) { return std::make_pair(1U, col_idx); });
+}
+
+}  // namespace
+
+auto Planner::PlanWhere(const BoundExpression &where, AbstractPlanNodeRef child) -> AbstractPlanNodeRef {
+  auto plan = std::move(child);
+  if (!ContainsSubquery(where)) {
+    auto schema = plan->OutputSchema();
+    auto [_, expr] = PlanExpression(where, {plan});
+    return std::make_shared<FilterPlanNode>(std::make_shared<Schema>(schema), std::move(expr), std::move(plan));
+  }
+
+  std::vector<const BoundExpression *> conjuncts;
+  SplitConjuncts(where, &conjuncts);
+  std::vector<std::pair<const BoundSubqueryExpr *, bool>> subqueries;
+  AbstractExpressionRef predicate = nullptr;
+  for (const auto *conjunct : conjuncts) {
+    if (auto subquery = AsSubqueryPredicate(*conjunct); subquery.has_value()) {
+      subqueries.push_back(*subquery);
+      continue;
+    }
+    if (ContainsSubquery(*conjunct)) {
+      throw NotImplementedException("subquery is only supported as a conjunct of WHERE");
+    }
+    auto [_, expr] = PlanExpression(*conjunct, {plan});
+    predicate = predicate == nullptr ? std::move(expr)
+                                     : GetBinaryExpressionFromFactory("and", std::move(predicate), std::move(expr));
+  }
+  if (predicate != nullptr) {
+    auto schema = plan->OutputSchema();
+    plan = std::make_shared<FilterPlanNode>(std::make_shared<Schema>(schema), std::move(predicate), std::move(plan));
+  }
+  // 每个子查询是外层查询上的一个半连接或反连接
+  for (const auto &[subquery, negated] : subqueries) {
+    plan = PlanSubqueryExpr(*subquery, negated, std::move(plan));
+  }
+  return plan;
+}
+
+auto Planner::PlanSubqueryExpr(const BoundSubqueryExpr &expr, bool negated, AbstractPlanNodeRef outer)
+    -> AbstractPlanNodeRef {
+  const auto &subquery = *expr.subquery_;
+  if (negated && expr.subquery_type_ == SubqueryType::IN) {
+    // 子查询结果中有 NULL 时 NOT IN 不返回任何行，和反连接的语义不同
+    throw NotImplementedException("NOT IN subquery is not supported");
+  }
+  if (!subquery.ctes_.empty()) {
+    throw NotImplementedException("WITH in subquery is not supported");
+  }
+  if (expr.child_ != nullptr && !ReadsOnly(*expr.child_, outer->OutputSchema())) {
+    throw NotImplementedException("the left side of IN must read the columns of the enclosing query");
+  }
+
+  std::vector<AbstractExpressionRef> predicates;
+  AbstractPlanNodeRef inner = nullptr;
+  if (IsSimpleSelect(subquery)) {
+    // 去相关：只读子查询自己的列的条件留在子查询中，读外层查询的列的条件和 IN 的比较一起成为连接条件
+    inner = PlanTableRef(*subquery.table_);
+    std::vector<const BoundExpression *> conjuncts;
+    if (!subquery.where_->IsInvalid()) {
+      SplitConjuncts(*subquery.where_, &conjuncts);
+    }
+    AbstractExpressionRef filter = nullptr;
+    for (const auto *conjunct : conjuncts) {
+      if (ContainsSubquery(*conjunct)) {
+        throw NotImplementedException("nested subquery is not supported");
+      }
+      if (ReadsOnly(*conjunct, inner->OutputSchema())) {
+        auto [_, pred] = PlanExpression(*conjunct, {inner});
+        filter = filter == nullptr ? std::move(pred)
+                                   : GetBinaryExpressionFromFactory("and", std::move(filter), std::move(pred));
+      } else {
+        auto [_, pred] = PlanExpression(*conjunct, {outer, inner});
+        predicates.push_back(std::move(pred));
+      }
+    }
+    if (filter != nullptr) {
+      auto schema = inner->OutputSchema();
+      inner = std::make_shared<FilterPlanNode>(std::make_shared<Schema>(schema), std::move(filter), std::move(inner));
+    }
+    if (expr.subquery_type_ == SubqueryType::IN) {
+      const auto &item = *subquery.select_list_[0];
+      if (!ReadsOnly(item, inner->OutputSchema())) {
+        throw NotImplementedException("the select list of an IN subquery must read its own columns");
+      }
+      auto [_1, left] = PlanExpression(*expr.child_, {outer});
+      auto [_2, right] = PlanExpression(item, {inner});
+      predicates.insert(predicates.begin(), GetBinaryExpressionFromFactory("=", std::move(left), ToRightSide(right)));
+    }
+  } else {
+    // 带聚合、分组或 LIMIT 的子查询整体规划，它的结果不能随外层查询的行变化
+    auto from_schema = Schema(std::vector<Column>{});
+    if (subquery.table_->type_ != TableReferenceType::EMPTY) {
+      from_schema = PlanTableRef(*subquery.table_)->OutputSchema();
+    }
+    std::vector<const BoundExpression *> exprs{subquery.where_.get(), subquery.having_.get()};
+    for (const auto &item : subquery.select_list_) {
+      exprs.push_back(item.get());
+    }
+    for (const auto &group_by : subquery.group_by_) {
+      exprs.push_back(group_by.get());
+    }
+    auto correlated = std::any_of(exprs.begin(), exprs.end(),
+                                  [&](const BoundExpression *e) { return !ReadsOnly(*e, from_schema); });
+    if (correlated) {
+      throw NotImplementedException("correlated subquery with aggregation or LIMIT is not supported");
+    }
+    inner = PlanSelect(subquery);
+    if (expr.subquery_type_ == SubqueryType::IN) {
+      auto [_, left] = PlanExpression(*expr.child_, {outer});
+      auto right = std::make_shared<ColumnValueExpression>(1, 0, inner->OutputSchema().GetColumn(0).GetType());
+      predicates.push_back(GetBinaryExpressionFromFactory("=", std::move(left), std::move(right)));
+    }
+  }
+
+  // 半连接和反连接只输出外层查询的列
+  auto schema = std::make_shared<Schema>(outer->OutputSchema());
+  auto join_type = negated ? JoinType::ANTI : JoinType::SEMI;
+  return std::make_shared<NestedLoopJoinPlanNode>(std::move(schema), std::move(outer), std::move(inner),
+                                                  MakeConjunction(predicates), join_type);
+}
+
+}  // namespace bustub
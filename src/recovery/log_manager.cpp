@@ -12,6 +12,9 @@
 
 #include "recovery/log_manager.h"
 
+#include <cstring>
+#include <utility>
+
 namespace bustub {
 /*
  * set enable_logging = true
@@ -22,12 +25,80 @@ namespace bustub {
  *
  * This thread runs forever until system shutdown/StopFlushThread
  */
-void LogManager::RunFlushThread() {}
+void LogManager::RunFlushThread() {
+  if (enable_logging) {
+    return;
+  }
+  stop_flush_ = false;
+  enable_logging = true;
+  flush_thread_ = new std::thread(&LogManager::FlushLoop, this);
+}
+
+void LogManager::FlushLoop() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    cv_.wait_for(lock, log_timeout, [this] { return stop_flush_ || force_flush_ || waiting_commits_ > 0; });
+    // 第一个提交到了之后再等一会儿，让这段时间里提交的事务共用一次刷盘，凑够一批就不再等
+    if (!stop_flush_ && !force_flush_ && waiting_commits_ > 0) {
+      cv_.wait_until(lock, group_start_ + group_commit_delay, [this] {
+        return stop_flush_ || force_flush_ || waiting_commits_ >= group_commit_batch_size;
+      });
+    }
+
+    // 换出缓冲区之后就可以放开锁，写盘的时候别的事务继续往新的缓冲区里追加
+    std::swap(log_buffer_, flush_buffer_);
+    const int size = offset_;
+    offset_ = 0;
+    flushing_lsn_ = next_lsn_ - 1;
+    waiting_commits_ = 0;
+    force_flush_ = false;
+    const bool stop = stop_flush_;
+    lock.unlock();
+    disk_manager_->WriteLog(flush_buffer_, size);
+    lock.lock();
+    persistent_lsn_ = flushing_lsn_;
+    flushed_cv_.notify_all();
+    if (stop) {
+      return;
+    }
+  }
+}
 
 /*
  * Stop and join the flush thread, set enable_logging = false
  */
-void LogManager::StopFlushThread() {}
+void LogManager::StopFlushThread() {
+  if (!enable_logging) {
+    return;
+  }
+  {
+    std::scoped_lock lock(latch_);
+    stop_flush_ = true;
+  }
+  cv_.notify_one();
+  // 刷盘线程退出之前会把缓冲区里剩下的日志写完
+  flush_thread_->join();
+  delete flush_thread_;
+  flush_thread_ = nullptr;
+  enable_logging = false;
+}
+
+void LogManager::WaitForCommit(lsn_t commit_lsn) {
+  std::unique_lock<std::mutex> lock(latch_);
+  if (persistent_lsn_ >= commit_lsn) {
+    return;
+  }
+  // 提交记录已经被换出正在写盘的话等这次写完就行，否则加入下一批
+  if (commit_lsn > flushing_lsn_) {
+    if (waiting_commits_++ == 0) {
+      group_start_ = std::chrono::steady_clock::now();
+      cv_.notify_one();
+    } else if (waiting_commits_ >= group_commit_batch_size) {
+      cv_.notify_one();
+    }
+  }
+  flushed_cv_.wait(lock, [this, commit_lsn] { return persistent_lsn_ >= commit_lsn; });
+}
 
 /*
  * append a log record into log buffer
@@ -49,6 +120,48 @@ void LogManager::StopFlushThread() {}
  *  }
  *
  */
-auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t { return INVALID_LSN; }
+auto LogManager::AppendLogRecord(LogRecord *log_record) -> lsn_t {
+  std::unique_lock<std::mutex> lock(latch_);
+  // 缓冲区放不下这条记录时叫醒刷盘线程，等它把缓冲区换出去
+  while (offset_ + log_record->size_ > LOG_BUFFER_SIZE) {
+    force_flush_ = true;
+    cv_.notify_one();
+    flushed_cv_.wait(lock);
+  }
+
+  log_record->lsn_ = next_lsn_++;
+  memcpy(log_buffer_ + offset_, log_record, LogRecord::HEADER_SIZE);
+  int pos = offset_ + LogRecord::HEADER_SIZE;
+  switch (log_record->log_record_type_) {
+    case LogRecordType::INSERT:
+      memcpy(log_buffer_ + pos, &log_record->insert_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->insert_tuple_.SerializeTo(log_buffer_ + pos);
+      break;
+    case LogRecordType::MARKDELETE:
+    case LogRecordType::APPLYDELETE:
+    case LogRecordType::ROLLBACKDELETE:
+      memcpy(log_buffer_ + pos, &log_record->delete_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->delete_tuple_.SerializeTo(log_buffer_ + pos);
+      break;
+    case LogRecordType::UPDATE:
+      memcpy(log_buffer_ + pos, &log_record->update_rid_, sizeof(RID));
+      pos += sizeof(RID);
+      log_record->old_tuple_.SerializeTo(log_buffer_ + pos);
+      pos += sizeof(int32_t) + log_record->old_tuple_.GetLength();
+      log_record->new_tuple_.SerializeTo(log_buffer_ + pos);
+      break;
+    case LogRecordType::NEWPAGE:
+      memcpy(log_buffer_ + pos, &log_record->prev_page_id_, sizeof(page_id_t));
+      pos += sizeof(page_id_t);
+      memcpy(log_buffer_ + pos, &log_record->page_id_, sizeof(page_id_t));
+      break;
+    default:
+      break;
+  }
+  offset_ += log_record->size_;
+  return log_record->lsn_;
+}
 
 }  // namespace bustub
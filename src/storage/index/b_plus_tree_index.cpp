@@ -9,6 +9,8 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+
 #include "storage/index/b_plus_tree_index.h"
 
 namespace bustub {
@@ -48,6 +50,46 @@ void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, T
   container_.GetValue(index_key, result, transaction);
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::SortedKeys(const std::vector<std::pair<Tuple, RID>> &entries) const
+    -> std::vector<std::pair<KeyType, RID>> {
+  std::vector<std::pair<KeyType, RID>> keys(entries.size());
+  for (size_t i = 0; i < entries.size(); i++) {
+    keys[i].first.SetFromKey(entries[i].first);
+    keys[i].second = entries[i].second;
+  }
+  std::sort(keys.begin(), keys.end(),
+            [this](const auto &lhs, const auto &rhs) { return comparator_(lhs.first, rhs.first) < 0; });
+  return keys;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::InsertEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction) {
+  // in key order, consecutive inserts descend to the same or the next leaf, which is most likely still buffered
+  for (const auto &[index_key, rid] : SortedKeys(entries)) {
+    container_.Insert(index_key, rid, transaction);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::DeleteEntries(const std::vector<std::pair<Tuple, RID>> &entries, Transaction *transaction) {
+  for (const auto &entry : SortedKeys(entries)) {
+    container_.Remove(entry.first, transaction);
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_INDEX_TYPE::GetNextRid(const Tuple &key) -> RID {
+  KeyType index_key;
+  index_key.SetFromKey(key);
+  // 迭代器析构时才放开叶子节点的读锁，返回之前就会析构
+  auto iter = container_.Begin(index_key);
+  while (!iter.IsEnd() && comparator_((*iter).first, index_key) <= 0) {
+    ++iter;
+  }
+  return iter.IsEnd() ? RID() : (*iter).second;
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_INDEX_TYPE::GetBeginIterator() -> INDEXITERATOR_TYPE { return container_.Begin(); }
 
@@ -20,6 +20,19 @@ INDEXITERATOR_TYPE::IndexIterator(BufferPoolManager *bpm, Page *page, int index)
   } else {
     leaf_ = nullptr;
   }
+  // Begin(key) may land one past the last slot of a leaf when the key is larger than every key in it,
+  // move on to the first slot of the next leaf so that operator* never reads past the end.
+  while (leaf_ != nullptr && index_ >= leaf_->GetSize() && leaf_->GetNextPageId() != INVALID_PAGE_ID) {
+    auto next_page = buffer_pool_manager_->FetchPage(leaf_->GetNextPageId());
+
+    next_page->RLatch();
+    page_->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_->GetPageId(), false);
+
+    page_ = next_page;
+    leaf_ = reinterpret_cast<LeafPage *>(page_->GetData());
+    index_ = 0;
+  }
 }
 
 INDEX_TEMPLATE_ARGUMENTS
@@ -32,6 +45,9 @@ INDEXITERATOR_TYPE::~IndexIterator() {
 
 INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::IsEnd() -> bool {
+  if (leaf_ == nullptr) {
+    return true;
+  }
   return leaf_->GetNextPageId() == INVALID_PAGE_ID && index_ == leaf_->GetSize();
 }
 
@@ -82,6 +82,7 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
       cur_page = new_page;
     }
   }
+  versions_.RecordInsert(*rid, txn);
   // This line has caused most of us to double-take and "whoa double unlatch".
   // We are not, in fact, double unlatching. See the invariant above.
   cur_page->WUnlatch();
@@ -91,6 +92,64 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
   return true;
 }
 
+auto TableHeap::InsertTuples(const std::vector<Tuple> &tuples, std::vector<RID> *rids, Transaction *txn) -> bool {
+  if (tuples.empty()) {
+    return true;
+  }
+
+  auto cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(first_page_id_));
+  if (cur_page == nullptr) {
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+
+  cur_page->WLatch();
+  bool is_dirty = false;
+
+  // INVARIANT: cur_page is WLatched at the top of every iteration, the walk never goes back to an earlier page.
+  for (const auto &tuple : tuples) {
+    if (tuple.size_ + 32 > BUSTUB_PAGE_SIZE) {  // larger than one page size
+      txn->SetState(TransactionState::ABORTED);
+      break;
+    }
+    RID rid;
+    while (!cur_page->InsertTuple(tuple, &rid, txn, lock_manager_, log_manager_)) {
+      auto next_page_id = cur_page->GetNextPageId();
+      if (next_page_id != INVALID_PAGE_ID) {
+        auto next_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
+        next_page->WLatch();
+        cur_page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), is_dirty);
+        cur_page = next_page;
+      } else {
+        auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id));
+        if (new_page == nullptr) {
+          cur_page->WUnlatch();
+          buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), is_dirty);
+          txn->SetState(TransactionState::ABORTED);
+          return false;
+        }
+        new_page->WLatch();
+        cur_page->SetNextPageId(next_page_id);
+        new_page->Init(next_page_id, BUSTUB_PAGE_SIZE, cur_page->GetTablePageId(), log_manager_, txn);
+        cur_page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), true);
+        cur_page = new_page;
+      }
+      is_dirty = false;
+    }
+    is_dirty = true;
+    versions_.RecordInsert(rid, txn);
+    rids->push_back(rid);
+    // Update the transaction's write set.
+    txn->GetWriteSet()->emplace_back(rid, WType::INSERT, Tuple{}, this);
+  }
+
+  cur_page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(cur_page->GetTablePageId(), is_dirty);
+  return rids->size() == tuples.size();
+}
+
 auto TableHeap::MarkDelete(const RID &rid, Transaction *txn) -> bool {
   // TODO(Amadou): remove empty page
   // Find the page which contains the tuple.
@@ -100,9 +159,18 @@ auto TableHeap::MarkDelete(const RID &rid, Transaction *txn) -> bool {
     txn->SetState(TransactionState::ABORTED);
     return false;
   }
-  // Otherwise, mark the tuple as deleted.
+  // Otherwise, mark the tuple as deleted, keeping its image for snapshot reads.
   page->WLatch();
-  page->MarkDelete(rid, txn, lock_manager_, log_manager_);
+  if (!versions_.CanWrite(rid, txn)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
+  Tuple old_tuple;
+  if (page->GetTuple(rid, &old_tuple, txn, lock_manager_) && page->MarkDelete(rid, txn, lock_manager_, log_manager_)) {
+    versions_.RecordWrite(rid, old_tuple, txn);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), true);
   // Update the transaction's write set.
@@ -110,6 +178,41 @@ auto TableHeap::MarkDelete(const RID &rid, Transaction *txn) -> bool {
   return true;
 }
 
+auto TableHeap::MarkDeletes(const std::vector<RID> &rids, Transaction *txn) -> size_t {
+  size_t marked = 0;
+  while (marked < rids.size()) {
+    const auto page_id = rids[marked].GetPageId();
+    auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    // If the page could not be found, then abort the transaction.
+    if (page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return marked;
+    }
+    // Mark every tuple living on this page while holding the latch once.
+    page->WLatch();
+    for (; marked < rids.size() && rids[marked].GetPageId() == page_id; ++marked) {
+      const auto &rid = rids[marked];
+      // A write-write conflict under snapshot isolation aborts the transaction.
+      if (!versions_.CanWrite(rid, txn)) {
+        page->WUnlatch();
+        buffer_pool_manager_->UnpinPage(page_id, true);
+        txn->SetState(TransactionState::ABORTED);
+        return marked;
+      }
+      Tuple old_tuple;
+      if (page->GetTuple(rid, &old_tuple, txn, lock_manager_) &&
+          page->MarkDelete(rid, txn, lock_manager_, log_manager_)) {
+        versions_.RecordWrite(rid, old_tuple, txn);
+      }
+      // Update the transaction's write set.
+      txn->GetWriteSet()->emplace_back(rid, WType::DELETE, Tuple{}, this);
+    }
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, true);
+  }
+  return marked;
+}
+
 auto TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn) -> bool {
   // Find the page which contains the tuple.
   auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
@@ -121,7 +224,16 @@ auto TableHeap::UpdateTuple(const Tuple &tuple, const RID &rid, Transaction *txn
   // Update the tuple; but first save the old value for rollbacks.
   Tuple old_tuple;
   page->WLatch();
+  if (!versions_.CanWrite(rid, txn)) {
+    page->WUnlatch();
+    buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    txn->SetState(TransactionState::ABORTED);
+    return false;
+  }
   bool is_updated = page->UpdateTuple(tuple, &old_tuple, rid, txn, lock_manager_, log_manager_);
+  if (is_updated) {
+    versions_.RecordWrite(rid, old_tuple, txn);
+  }
   page->WUnlatch();
   buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_updated);
   // Update the transaction's write set.
@@ -168,7 +280,7 @@ auto TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, bool ac
   if (acquire_read_lock) {
     page->RLatch();
   }
-  bool res = page->GetTuple(rid, tuple, txn, lock_manager_);
+  bool res = ReadTuple(page, rid, tuple, txn);
   if (acquire_read_lock) {
     page->RUnlatch();
   }
@@ -176,7 +288,79 @@ auto TableHeap::GetTuple(const RID &rid, Tuple *tuple, Transaction *txn, bool ac
   return res;
 }
 
+void TableHeap::GetTuples(const std::vector<RID> &rids, std::vector<Tuple> *tuples, Transaction *txn) {
+  auto iter = rids.cbegin();
+  while (iter != rids.cend()) {
+    // Fetch the page once and read every requested slot on it before moving on.
+    const auto page_id = iter->GetPageId();
+    auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
+    // If the page could not be found, then abort the transaction.
+    if (page == nullptr) {
+      txn->SetState(TransactionState::ABORTED);
+      return;
+    }
+    page->RLatch();
+    for (; iter != rids.cend() && iter->GetPageId() == page_id; ++iter) {
+      tuples->emplace_back();
+      if (!ReadTuple(page, *iter, &tuples->back(), txn)) {
+        tuples->pop_back();
+      }
+    }
+    page->RUnlatch();
+    buffer_pool_manager_->UnpinPage(page_id, false);
+  }
+}
+
+auto TableHeap::ReadTuple(TablePage *page, const RID &rid, Tuple *tuple, Transaction *txn) -> bool {
+  if (!IsSnapshotRead(txn)) {
+    return page->GetTuple(rid, tuple, txn, lock_manager_);
+  }
+  // A whole table scan is validated at table granularity, only the tuples read through an index are recorded.
+  if (txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC && txn->GetTableScanSet()->count(this) == 0) {
+    (*txn->GetReadSet())[this].insert(rid);
+  }
+  // Tuples marked as deleted may still be visible to the snapshot.
+  bool is_deleted = false;
+  return page->GetTupleVersion(rid, tuple, &is_deleted) && versions_.GetVisible(rid, txn, is_deleted, tuple);
+}
+
+void TableHeap::CommitVersion(const RID &rid, txn_id_t txn_id, timestamp_t commit_ts) {
+  versions_.Commit(rid, txn_id, commit_ts);
+  last_commit_ts_ = commit_ts;
+}
+
+void TableHeap::RollbackVersion(const RID &rid, txn_id_t txn_id) { versions_.Rollback(rid, txn_id); }
+
+auto TableHeap::IsPhantom(const RID &rid, Transaction *txn) -> bool {
+  auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  page->RLatch();
+  Tuple tuple;
+  bool is_deleted = false;
+  bool is_phantom = page->GetTupleVersion(rid, &tuple, &is_deleted) && versions_.IsPhantom(rid, txn, is_deleted);
+  page->RUnlatch();
+  buffer_pool_manager_->UnpinPage(rid.GetPageId(), false);
+  return is_phantom;
+}
+
+void TableHeap::PruneVersions(const RID &rid, timestamp_t watermark) {
+  auto page = reinterpret_cast<TablePage *>(buffer_pool_manager_->FetchPage(rid.GetPageId()));
+  BUSTUB_ASSERT(page != nullptr, "Couldn't find a page containing that RID.");
+  // The delete is applied under the same latch, so the slot is not reused before the chain is gone.
+  page->WLatch();
+  bool is_removed = versions_.Prune(rid, watermark) && page->IsMarkedDeleted(rid);
+  if (is_removed) {
+    page->ApplyDelete(rid, nullptr, log_manager_);
+  }
+  page->WUnlatch();
+  buffer_pool_manager_->UnpinPage(page->GetTablePageId(), is_removed);
+}
+
 auto TableHeap::Begin(Transaction *txn) -> TableIterator {
+  // An OPTIMISTIC transaction validates a whole table scan against any write committed to the table.
+  if (txn != nullptr && txn->GetIsolationLevel() == IsolationLevel::OPTIMISTIC) {
+    txn->GetTableScanSet()->insert(this);
+  }
   // Start an iterator from the first page.
   // TODO(Wuwen): Hacky fix for now. Removing empty pages is a better way to handle this.
   RID rid;
@@ -185,7 +369,7 @@ auto TableHeap::Begin(Transaction *txn) -> TableIterator {
     auto page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(page_id));
     page->RLatch();
     // If this fails because there is no tuple, then RID will be the default-constructed value, which means EOF.
-    auto found_tuple = page->GetFirstTupleRid(&rid);
+    auto found_tuple = page->GetFirstTupleRid(&rid, IsSnapshotRead(txn));
     page->RUnlatch();
     buffer_pool_manager_->UnpinPage(page_id, false);
     if (found_tuple) {
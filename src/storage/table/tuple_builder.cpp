@@ -0,0 +1,118 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tuple_builder.cpp
+//
+// Identification: src/storage/table/tuple_builder.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/tuple_builder.h"
+
+#include <array>
+#include <cstring>
+
+#include "common/macros.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+namespace {
+// VARCHAR 的 payload 格式为 size + data，NULL 的 size 为 BUSTUB_VALUE_NULL 且没有 data
+auto PayloadLength(const char *payload) -> uint32_t {
+  auto len = *reinterpret_cast<const uint32_t *>(payload);
+  return sizeof(uint32_t) + (len == BUSTUB_VALUE_NULL ? 0 : len);
+}
+}  // namespace
+
+TupleBuilder::TupleBuilder(const Schema *output_schema, const std::vector<const Schema *> &input_schemas,
+                           const std::vector<ColumnSource> &sources)
+    : fixed_length_(output_schema->GetLength()) {
+  BUSTUB_ASSERT(input_schemas.size() <= 2, "at most two inputs are supported");
+  BUSTUB_ASSERT(sources.size() == output_schema->GetColumnCount(), "every output column needs a source");
+  for (uint32_t i = 0; i < sources.size(); i++) {
+    const auto &source = sources[i];
+    const auto &dst = output_schema->GetColumn(i);
+    const auto &src = input_schemas[source.input_idx_]->GetColumn(source.column_idx_);
+    BUSTUB_ASSERT(CanCopy(dst, src), "the output column must have the type of its source");
+    if (!dst.IsInlined()) {
+      payloads_.push_back({source.input_idx_, src.GetOffset(), dst.GetOffset()});
+    }
+    // 和前一段在输入和输出中都相邻时合并成一次memcpy
+    if (!segments_.empty()) {
+      auto &last = segments_.back();
+      if (last.input_idx_ == source.input_idx_ && last.src_offset_ + last.length_ == src.GetOffset() &&
+          last.dst_offset_ + last.length_ == dst.GetOffset()) {
+        last.length_ += dst.GetFixedLength();
+        continue;
+      }
+    }
+    segments_.push_back({source.input_idx_, src.GetOffset(), dst.GetOffset(), dst.GetFixedLength()});
+  }
+}
+
+auto TupleBuilder::ForJoin(const Schema *output_schema, const Schema *left_schema, const Schema *right_schema)
+    -> TupleBuilder {
+  std::vector<ColumnSource> sources;
+  sources.reserve(left_schema->GetColumnCount() + right_schema->GetColumnCount());
+  for (uint32_t i = 0; i < left_schema->GetColumnCount(); i++) {
+    sources.push_back({0, i});
+  }
+  for (uint32_t i = 0; i < right_schema->GetColumnCount(); i++) {
+    sources.push_back({1, i});
+  }
+  return {output_schema, {left_schema, right_schema}, sources};
+}
+
+auto TupleBuilder::NullTuple(const Schema *schema) -> Tuple {
+  std::vector<Value> values;
+  values.reserve(schema->GetColumnCount());
+  for (const auto &column : schema->GetColumns()) {
+    values.push_back(ValueFactory::GetNullValueByType(column.GetType()));
+  }
+  return {values, schema};
+}
+
+auto TupleBuilder::Build(const Tuple &input) const -> Tuple {
+  std::array<const Tuple *, 1> inputs{&input};
+  return Build(inputs.data());
+}
+
+auto TupleBuilder::Build(const Tuple &left, const Tuple &right) const -> Tuple {
+  std::array<const Tuple *, 2> inputs{&left, &right};
+  return Build(inputs.data());
+}
+
+auto TupleBuilder::Build(const Tuple *const *inputs) const -> Tuple {
+  auto slot_payload = [inputs](uint32_t input_idx, uint32_t slot) -> const char * {
+    const auto *data = inputs[input_idx]->GetData();
+    return data + *reinterpret_cast<const uint32_t *>(data + slot);
+  };
+
+  uint32_t size = fixed_length_;
+  for (const auto &payload : payloads_) {
+    size += PayloadLength(slot_payload(payload.input_idx_, payload.src_slot_));
+  }
+
+  Tuple tuple;
+  tuple.allocated_ = true;
+  tuple.size_ = size;
+  tuple.data_ = new char[size];
+  for (const auto &segment : segments_) {
+    memcpy(tuple.data_ + segment.dst_offset_, inputs[segment.input_idx_]->GetData() + segment.src_offset_,
+           segment.length_);
+  }
+  // 变长字段的payload依次追加在定长区域之后，并改写定长区域中的偏移量
+  uint32_t offset = fixed_length_;
+  for (const auto &payload : payloads_) {
+    const auto *src = slot_payload(payload.input_idx_, payload.src_slot_);
+    auto len = PayloadLength(src);
+    memcpy(tuple.data_ + offset, src, len);
+    *reinterpret_cast<uint32_t *>(tuple.data_ + payload.dst_slot_) = offset;
+    offset += len;
+  }
+  return tuple;
+}
+
+}  // namespace bustub
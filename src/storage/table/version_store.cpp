@@ -0,0 +1,153 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// version_store.cpp
+//
+// Identification: src/storage/table/version_store.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/table/version_store.h"
+
+namespace bustub {
+
+auto VersionStore::CanWrite(const RID &rid, Transaction *txn) -> bool {
+  if (txn->GetIsolationLevel() != IsolationLevel::SNAPSHOT_ISOLATION &&
+      txn->GetIsolationLevel() != IsolationLevel::OPTIMISTIC) {
+    return true;
+  }
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  if (iter == chains_.end() || iter->second.writer_ == txn->GetTransactionId()) {
+    return true;
+  }
+  // 别的事务还没提交，或者在这个事务开始之后提交了新的版本，后写的事务 abort
+  return iter->second.writer_ == INVALID_TXN_ID && iter->second.ts_ <= txn->GetReadTs();
+}
+
+void VersionStore::RecordInsert(const RID &rid, Transaction *txn) {
+  std::scoped_lock lock(latch_);
+  // 插入到空闲的槽里，之前的元组已经被物理删除，它的版本链也不会再被读到
+  auto &chain = chains_[rid];
+  chain.writer_ = txn->GetTransactionId();
+  chain.ts_ = 0;
+  chain.undo_.clear();
+  chain.undo_.push_back({0, true, Tuple{}});
+}
+
+void VersionStore::RecordWrite(const RID &rid, const Tuple &old_tuple, Transaction *txn) {
+  std::scoped_lock lock(latch_);
+  auto &chain = chains_[rid];
+  if (chain.writer_ == txn->GetTransactionId()) {
+    return;
+  }
+  chain.undo_.push_back({chain.ts_, false, old_tuple});
+  chain.writer_ = txn->GetTransactionId();
+}
+
+void VersionStore::Commit(const RID &rid, txn_id_t txn_id, timestamp_t commit_ts) {
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  if (iter != chains_.end() && iter->second.writer_ == txn_id) {
+    iter->second.writer_ = INVALID_TXN_ID;
+    iter->second.ts_ = commit_ts;
+  }
+}
+
+void VersionStore::Rollback(const RID &rid, txn_id_t txn_id) {
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  if (iter == chains_.end() || iter->second.writer_ != txn_id) {
+    return;
+  }
+  auto &chain = iter->second;
+  chain.ts_ = chain.undo_.back().ts_;
+  chain.undo_.pop_back();
+  chain.writer_ = INVALID_TXN_ID;
+  if (chain.undo_.empty() && chain.ts_ == 0) {
+    chains_.erase(iter);
+  }
+}
+
+auto VersionStore::GetVisible(const RID &rid, Transaction *txn, bool is_deleted, Tuple *tuple) -> bool {
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  if (iter == chains_.end()) {
+    return !is_deleted;
+  }
+  const auto &chain = iter->second;
+  if (chain.writer_ == txn->GetTransactionId() ||
+      (chain.writer_ == INVALID_TXN_ID && chain.ts_ <= txn->GetReadTs())) {
+    return !is_deleted;
+  }
+  // 从新到旧找第一个在快照之前提交的版本
+  for (auto version = chain.undo_.rbegin(); version != chain.undo_.rend(); ++version) {
+    if (version->ts_ <= txn->GetReadTs()) {
+      if (version->is_deleted_) {
+        return false;
+      }
+      *tuple = version->tuple_;
+      return true;
+    }
+  }
+  return false;
+}
+
+auto VersionStore::Validate(const RID &rid, Transaction *txn) -> bool {
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  // 事务开始之后提交的版本在它结束之前不会被清理，没有版本链说明元组在快照之后没有被提交过修改
+  return iter == chains_.end() || iter->second.ts_ <= txn->GetReadTs();
+}
+
+auto VersionStore::IsPhantom(const RID &rid, Transaction *txn, bool is_deleted) -> bool {
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  if (iter == chains_.end()) {
+    return !is_deleted;
+  }
+  const auto &chain = iter->second;
+  if (chain.writer_ == txn->GetTransactionId()) {
+    return false;
+  }
+  if (chain.ts_ > txn->GetReadTs()) {
+    return true;
+  }
+  // 快照里可见却没有被读到，说明查找的时候索引项被还没提交的删除拿掉了
+  for (auto version = chain.undo_.rbegin(); version != chain.undo_.rend(); ++version) {
+    if (version->ts_ <= txn->GetReadTs()) {
+      return !version->is_deleted_;
+    }
+  }
+  return false;
+}
+
+auto VersionStore::Prune(const RID &rid, timestamp_t watermark) -> bool {
+  std::scoped_lock lock(latch_);
+  auto iter = chains_.find(rid);
+  if (iter == chains_.end()) {
+    return true;
+  }
+  auto &chain = iter->second;
+  if (chain.writer_ == INVALID_TXN_ID && chain.ts_ <= watermark) {
+    chains_.erase(iter);
+    return true;
+  }
+  // 快照至少是 watermark，比 watermark 之前最新的版本更老的版本都不会再被读到
+  auto &undo = chain.undo_;
+  for (auto i = undo.size(); i-- > 0;) {
+    if (undo[i].ts_ <= watermark) {
+      undo.erase(undo.begin(), undo.begin() + i);
+      break;
+    }
+  }
+  return false;
+}
+
+auto VersionStore::GetChainCount() -> size_t {
+  std::scoped_lock lock(latch_);
+  return chains_.size();
+}
+
+}  // namespace bustub
@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_stats_test.cpp
+//
+// Identification: test/catalog/table_stats_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include <memory>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "catalog/table_stats.h"
+#include "concurrency/transaction.h"
+#include "gtest/gtest.h"
+#include "storage/table/table_heap.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(TableStatsTest, HyperLogLogTest) {
+  for (int32_t n : {10, 1000, 100000}) {
+    HyperLogLog hll;
+    for (int32_t round = 0; round < 2; round++) {
+      for (int32_t i = 0; i < n; i++) {
+        hll.Add(static_cast<hash_t>(i));
+      }
+    }
+    auto estimate = static_cast<double>(hll.Estimate());
+    EXPECT_NEAR(estimate, n, n * 0.1) << "n = " << n;
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(TableStatsTest, CollectTest) {
+  auto disk_manager = std::make_unique<DiskManager>("table_stats_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(256, disk_manager.get());
+  Transaction txn(0);
+  TableHeap heap(bpm.get(), nullptr, nullptr, &txn);
+
+  // 超过采样大小, ndv 来自 HyperLogLog, 其余来自采样
+  Schema schema({Column{"a", TypeId::INTEGER}, Column{"b", TypeId::INTEGER}});
+  const int32_t n = STATS_SAMPLE_SIZE + 10000;
+  for (int32_t i = 0; i < n; i++) {
+    std::vector<Value> values{ValueFactory::GetIntegerValue(i),
+                              i % 2 == 0 ? ValueFactory::GetIntegerValue(i % 10)
+                                         : ValueFactory::GetNullValueByType(TypeId::INTEGER)};
+    RID rid;
+    ASSERT_TRUE(heap.InsertTuple(Tuple(values, &schema), &rid, &txn));
+  }
+
+  auto collected = TableStats::Collect(&heap, schema, &txn);
+  auto rows = collected.row_count_;
+  auto &columns = collected.columns_;
+  ASSERT_EQ(n, rows);
+  ASSERT_EQ(2, columns.size());
+
+  EXPECT_NEAR(static_cast<double>(columns[0].ndv_), n, n * 0.1);
+  EXPECT_DOUBLE_EQ(0, columns[0].null_fraction_);
+  EXPECT_TRUE(columns[0].mcvs_.empty());
+  ASSERT_EQ(STATS_HISTOGRAM_BUCKETS + 1, columns[0].histogram_.size());
+  for (size_t i = 1; i < columns[0].histogram_.size(); i++) {
+    EXPECT_EQ(CmpBool::CmpTrue, columns[0].histogram_[i - 1].CompareLessThan(columns[0].histogram_[i]));
+  }
+
+  // b 只有 5 个不同的值, 全部是最常见值
+  EXPECT_EQ(5, columns[1].ndv_);
+  EXPECT_NEAR(columns[1].null_fraction_, 0.5, 0.02);
+  EXPECT_EQ(5, columns[1].mcvs_.size());
+  for (const auto &[value, fraction] : columns[1].mcvs_) {
+    EXPECT_EQ(0, value.GetAs<int32_t>() % 2);
+    EXPECT_NEAR(fraction, 0.1, 0.02);
+  }
+  EXPECT_TRUE(columns[1].histogram_.empty());
+
+  // a 决定了 b, 组合的数量和 a 的 NDV 差不多
+  ASSERT_EQ(1, collected.pair_ndv_.size());
+  EXPECT_NEAR(static_cast<double>(collected.pair_ndv_.at({0, 1})), n, n * 0.1);
+
+  TableStats stats;
+  EXPECT_FALSE(stats.IsAnalyzed());
+  stats.Install(std::move(collected));
+  stats.RecordInsert(5);
+  stats.RecordDelete(10);
+  EXPECT_TRUE(stats.IsAnalyzed());
+  EXPECT_EQ(n - 5, stats.GetRowCount());
+  EXPECT_EQ(15, stats.GetModifiedRowCount());
+  EXPECT_TRUE(stats.GetPairDistinct(1, 0).has_value());
+  EXPECT_FALSE(stats.GetPairDistinct(0, 2).has_value());
+
+  disk_manager->ShutDown();
+  remove("table_stats_test.db");
+}
+
+}  // namespace bustub
@@ -2,13 +2,18 @@
  * deadlock_detection_test.cpp
  */
 
+#include <array>
 #include <atomic>
+#include <memory>
 #include <random>
+#include <sstream>
 #include <thread>  // NOLINT
 
+#include "common/bustub_instance.h"
 #include "common/config.h"
 #include "concurrency/lock_manager.h"
 #include "concurrency/transaction_manager.h"
+#include "fmt/core.h"
 #include "gtest/gtest.h"
 #define TEST_TIMEOUT_BEGIN                           \
   std::promise<bool> promisedFinished;               \
@@ -122,4 +127,214 @@ TEST(LockManagerDeadlockDetectionTest, BasicDeadlockDetectionTest) {
   delete txn0;
   delete txn1;
 }
+
+/** The waits-for graph is kept up to date while requests wait, and a cycle of three transactions aborts the newest */
+TEST(LockManagerDeadlockDetectionTest, IncrementalWaitsForTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+
+  table_oid_t toid{0};
+  const int num_txns = 3;
+  std::vector<Transaction *> txns;
+  for (int i = 0; i < num_txns; i++) {
+    txns.push_back(txn_mgr.Begin());
+    EXPECT_TRUE(lock_mgr.LockTable(txns[i], LockManager::LockMode::INTENTION_EXCLUSIVE, toid));
+    EXPECT_TRUE(lock_mgr.LockRow(txns[i], LockManager::LockMode::EXCLUSIVE, toid, RID{i, 0}));
+  }
+  EXPECT_TRUE(lock_mgr.GetEdgeList().empty());
+
+  // Transaction i waits for the row of transaction i + 1, the last one closes the cycle
+  std::vector<std::thread> threads;
+  std::array<bool, num_txns> results{};
+  for (int i = 0; i < num_txns - 1; i++) {
+    threads.emplace_back([&, i] {
+      results[i] = lock_mgr.LockRow(txns[i], LockManager::LockMode::EXCLUSIVE, toid, RID{i + 1, 0});
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  auto edges = lock_mgr.GetEdgeList();
+  std::sort(edges.begin(), edges.end());
+  EXPECT_EQ((std::vector<std::pair<txn_id_t, txn_id_t>>{{0, 1}, {1, 2}}), edges);
+
+  threads.emplace_back([&] {
+    results[num_txns - 1] = lock_mgr.LockRow(txns[num_txns - 1], LockManager::LockMode::EXCLUSIVE, toid, RID{0, 0});
+    // The newest transaction is the victim, releasing its locks lets the others finish
+    txn_mgr.Abort(txns[num_txns - 1]);
+  });
+  threads[num_txns - 2].join();
+  threads[num_txns - 1].join();
+  EXPECT_FALSE(results[num_txns - 1]);
+  EXPECT_EQ(TransactionState::ABORTED, txns[num_txns - 1]->GetState());
+  EXPECT_TRUE(results[num_txns - 2]);
+
+  txn_mgr.Commit(txns[num_txns - 2]);
+  threads[0].join();
+  EXPECT_TRUE(results[0]);
+  txn_mgr.Commit(txns[0]);
+  EXPECT_TRUE(lock_mgr.GetEdgeList().empty());
+
+  for (auto *txn : txns) {
+    delete txn;
+  }
+}
+
+/** Deadlock prevention policies decide by transaction id whether a blocked request waits or aborts */
+TEST(LockManagerDeadlockDetectionTest, DeadlockPreventionTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t toid{0};
+  RID rid0{0, 0};
+  RID rid1{1, 1};
+
+  // txn0 is older than txn1, txn0 holds rid0 and txn1 holds rid1
+  auto begin = [&](DeadlockPolicy policy) {
+    txn_mgr.SetDeadlockPolicy(policy);
+    auto *txn0 = txn_mgr.Begin();
+    auto *txn1 = txn_mgr.Begin();
+    EXPECT_EQ(policy, txn0->GetDeadlockPolicy());
+    for (auto [txn, rid] : {std::make_pair(txn0, rid0), std::make_pair(txn1, rid1)}) {
+      EXPECT_TRUE(lock_mgr.LockTable(txn, LockManager::LockMode::INTENTION_EXCLUSIVE, toid));
+      EXPECT_TRUE(lock_mgr.LockRow(txn, LockManager::LockMode::EXCLUSIVE, toid, rid));
+    }
+    return std::make_pair(txn0, txn1);
+  };
+  auto finish = [&](Transaction *txn0, Transaction *txn1) {
+    txn_mgr.Commit(txn0);
+    EXPECT_TRUE(lock_mgr.GetEdgeList().empty());
+    delete txn0;
+    delete txn1;
+  };
+
+  {
+    // WAIT_DIE: the older txn0 waits for txn1, the younger txn1 dies instead of waiting for txn0
+    auto [txn0, txn1] = begin(DeadlockPolicy::WAIT_DIE);
+    bool granted = false;
+    std::thread t0(
+        [&, txn0 = txn0] { granted = lock_mgr.LockRow(txn0, LockManager::LockMode::EXCLUSIVE, toid, rid1); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_FALSE(lock_mgr.LockRow(txn1, LockManager::LockMode::EXCLUSIVE, toid, rid0));
+    EXPECT_EQ(TransactionState::ABORTED, txn1->GetState());
+    txn_mgr.Abort(txn1);
+    t0.join();
+    EXPECT_TRUE(granted);
+    finish(txn0, txn1);
+  }
+
+  {
+    // WOUND_WAIT: the younger txn1 waits for txn0, the older txn0 wounds txn1 instead of waiting for it
+    auto [txn0, txn1] = begin(DeadlockPolicy::WOUND_WAIT);
+    bool granted = true;
+    std::thread t1([&, txn1 = txn1] {
+      granted = lock_mgr.LockRow(txn1, LockManager::LockMode::EXCLUSIVE, toid, rid0);
+      txn_mgr.Abort(txn1);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_TRUE(lock_mgr.LockRow(txn0, LockManager::LockMode::EXCLUSIVE, toid, rid1));
+    t1.join();
+    EXPECT_FALSE(granted);
+    EXPECT_EQ(TransactionState::ABORTED, txn1->GetState());
+    finish(txn0, txn1);
+  }
+
+  {
+    // NO_WAIT: any request that has to block aborts, even for the older transaction
+    auto [txn0, txn1] = begin(DeadlockPolicy::DETECTION);
+    txn0->SetDeadlockPolicy(DeadlockPolicy::NO_WAIT);
+    EXPECT_FALSE(lock_mgr.LockRow(txn0, LockManager::LockMode::EXCLUSIVE, toid, rid1));
+    EXPECT_EQ(TransactionState::ABORTED, txn0->GetState());
+    txn_mgr.Abort(txn0);
+    txn_mgr.Commit(txn1);
+    delete txn0;
+    delete txn1;
+  }
+
+  {
+    // TIMEOUT: a request aborts after waiting for lock_wait_timeout
+    auto [txn0, txn1] = begin(DeadlockPolicy::TIMEOUT);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_FALSE(lock_mgr.LockRow(txn1, LockManager::LockMode::EXCLUSIVE, toid, rid0));
+    EXPECT_GE(std::chrono::steady_clock::now() - start, lock_wait_timeout);
+    EXPECT_EQ(TransactionState::ABORTED, txn1->GetState());
+    txn_mgr.Abort(txn1);
+    finish(txn0, txn1);
+  }
+}
+
+/** A WOUND_WAIT holder that is already committing keeps its commit, one wounded before it commits is aborted */
+TEST(LockManagerDeadlockDetectionTest, WoundCommittingTest) {
+  auto bustub = std::make_unique<BustubInstance>("wound_test.db");
+  bustub->log_manager_->RunFlushThread();
+  auto default_delay = group_commit_delay;
+  group_commit_delay = std::chrono::milliseconds(200);
+  auto noop_writer = NoopWriter();
+  bustub->ExecuteSql("CREATE TABLE t (a int)", noop_writer);
+  auto toid = bustub->catalog_->GetTable("t")->oid_;
+  auto *txn_mgr = bustub->txn_manager_;
+  auto *lock_mgr = bustub->lock_manager_;
+  txn_mgr->SetDeadlockPolicy(DeadlockPolicy::WOUND_WAIT);
+
+  {
+    // The younger txn1 keeps its locks while it waits in Commit for the commit record to be flushed, the older txn0
+    // cannot wound it any more and waits for the locks instead.
+    auto *txn0 = txn_mgr->Begin();
+    auto *txn1 = txn_mgr->Begin();
+    bustub->ExecuteSqlTxn("INSERT INTO t VALUES (1)", noop_writer, txn1);
+    bool committed = false;
+    std::thread t1([&] { committed = txn_mgr->Commit(txn1); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(TransactionState::COMMITTED, txn1->GetState());
+    EXPECT_TRUE(lock_mgr->LockTable(txn0, LockManager::LockMode::EXCLUSIVE, toid));
+    t1.join();
+    EXPECT_TRUE(committed);
+    EXPECT_EQ(TransactionState::COMMITTED, txn1->GetState());
+    txn_mgr->Commit(txn0);
+    delete txn0;
+    delete txn1;
+  }
+
+  {
+    // Wounded before its commit point, txn1 is aborted by Commit and its insert is rolled back.
+    auto *txn0 = txn_mgr->Begin();
+    auto *txn1 = txn_mgr->Begin();
+    bustub->ExecuteSqlTxn("INSERT INTO t VALUES (2)", noop_writer, txn1);
+    bool granted = false;
+    std::thread t0([&] { granted = lock_mgr->LockTable(txn0, LockManager::LockMode::EXCLUSIVE, toid); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(TransactionState::ABORTED, txn1->GetState());
+    EXPECT_FALSE(txn_mgr->Commit(txn1));
+    t0.join();
+    EXPECT_TRUE(granted);
+    txn_mgr->Commit(txn0);
+    delete txn0;
+    delete txn1;
+  }
+
+  // Race the wound against the commit, Commit reports exactly the state the transaction ends in.
+  group_commit_delay = std::chrono::microseconds(100);
+  int num_committed = 1;
+  for (int i = 0; i < 50; i++) {
+    auto *txn0 = txn_mgr->Begin();
+    auto *txn1 = txn_mgr->Begin();
+    bustub->ExecuteSqlTxn(fmt::format("INSERT INTO t VALUES ({})", i + 3), noop_writer, txn1);
+    bool committed = false;
+    std::thread t1([&] { committed = txn_mgr->Commit(txn1); });
+    EXPECT_TRUE(lock_mgr->LockTable(txn0, LockManager::LockMode::EXCLUSIVE, toid));
+    t1.join();
+    EXPECT_EQ(committed ? TransactionState::COMMITTED : TransactionState::ABORTED, txn1->GetState());
+    num_committed += static_cast<int>(committed);
+    txn_mgr->Commit(txn0);
+    delete txn0;
+    delete txn1;
+  }
+
+  std::stringstream ss;
+  auto writer = SimpleStreamWriter(ss, true);
+  bustub->ExecuteSql("SELECT count(*) FROM t", writer);
+  EXPECT_EQ(fmt::format("{}\t\n", num_committed), ss.str());
+
+  group_commit_delay = default_delay;
+  bustub.reset();
+  remove("wound_test.db");
+  remove("wound_test.log");
+}
 }  // namespace bustub
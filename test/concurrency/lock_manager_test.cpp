@@ -4,9 +4,11 @@
 
 #include "concurrency/lock_manager.h"
 
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <random>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/bustub_instance.h"
 #include "common/config.h"
@@ -208,6 +210,184 @@ void RowLockTest1() {
 
 TEST(LockManagerTest, RowLockTest1) { RowLockTest1(); }  // NOLINT
 
+/** Row lock queues live in a partitioned table and are reclaimed once their last request is gone */
+TEST(LockManagerTest, RowLockQueueReclaimTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+
+  int num_txns = 4;
+  int rows_per_txn = 50;
+  std::vector<Transaction *> txns;
+  for (int i = 0; i < num_txns; i++) {
+    txns.push_back(txn_mgr.Begin());
+  }
+
+  /** Every transaction X-locks its own rows, spread over all the partitions */
+  auto task = [&](int txn_id) {
+    EXPECT_TRUE(lock_mgr.LockTable(txns[txn_id], LockManager::LockMode::INTENTION_EXCLUSIVE, oid));
+    for (int i = 0; i < rows_per_txn; i++) {
+      RID rid{txn_id, static_cast<uint32_t>(i)};
+      EXPECT_TRUE(lock_mgr.LockRow(txns[txn_id], LockManager::LockMode::EXCLUSIVE, oid, rid));
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_txns);
+  for (int i = 0; i < num_txns; i++) {
+    threads.emplace_back(std::thread{task, i});
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_txns * rows_per_txn, lock_mgr.GetRowLockQueueCount());
+
+  /** Releasing the row locks leaves no queue behind */
+  for (int i = 0; i < num_txns; i++) {
+    for (int j = 0; j < rows_per_txn; j++) {
+      EXPECT_TRUE(lock_mgr.UnlockRow(txns[i], oid, RID{i, static_cast<uint32_t>(j)}));
+    }
+    CheckTxnRowLockSize(txns[i], oid, 0, 0);
+    txn_mgr.Commit(txns[i]);
+    delete txns[i];
+  }
+  EXPECT_EQ(0, lock_mgr.GetRowLockQueueCount());
+}
+
+/** Past LOCK_ESCALATION_THRESHOLD row locks, a transaction's row locks on a table become one table lock */
+TEST(LockManagerTest, LockEscalationTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+  auto *reader = txn_mgr.Begin();
+  auto *writer = txn_mgr.Begin();
+
+  /** The escalation to S waits for no one, so it is skipped while another transaction holds IX */
+  EXPECT_TRUE(lock_mgr.LockTable(writer, LockManager::LockMode::INTENTION_EXCLUSIVE, oid));
+  EXPECT_TRUE(lock_mgr.LockTable(reader, LockManager::LockMode::INTENTION_SHARED, oid));
+  for (int i = 0; i <= LOCK_ESCALATION_THRESHOLD; i++) {
+    EXPECT_TRUE(lock_mgr.LockRow(reader, LockManager::LockMode::SHARED, oid, RID{i, 0}));
+  }
+  EXPECT_TRUE(reader->IsTableIntentionSharedLocked(oid));
+  CheckTxnRowLockSize(reader, oid, LOCK_ESCALATION_THRESHOLD + 1, 0);
+
+  /** Once the table lock can be upgraded, the next row lock escalates and releases every row lock */
+  txn_mgr.Commit(writer);
+  EXPECT_TRUE(lock_mgr.LockRow(reader, LockManager::LockMode::SHARED, oid, RID{0, 1}));
+  EXPECT_TRUE(reader->IsTableSharedLocked(oid));
+  EXPECT_TRUE(reader->IsTableLockEscalated(oid));
+  EXPECT_FALSE(reader->IsTableIntentionSharedLocked(oid));
+  CheckTxnRowLockSize(reader, oid, 0, 0);
+  EXPECT_EQ(0, lock_mgr.GetRowLockQueueCount());
+  EXPECT_EQ(TransactionState::GROWING, reader->GetState());
+
+  /** Rows covered by the table lock need no row lock of their own */
+  EXPECT_TRUE(lock_mgr.LockRow(reader, LockManager::LockMode::SHARED, oid, RID{0, 0}));
+  CheckTxnRowLockSize(reader, oid, 0, 0);
+  EXPECT_TRUE(lock_mgr.UnlockRow(reader, oid, RID{0, 0}));
+
+  txn_mgr.Commit(reader);
+  delete reader;
+  delete writer;
+}
+
+/** Readers and writers keep queueing on one row, every waiter has to be woken by the request granted before it */
+TEST(LockManagerTest, HotRowTest) {
+  TEST_TIMEOUT_BEGIN
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  table_oid_t oid = 0;
+  RID rid{0, 0};
+  const int num_threads = 8;
+  const int num_iters = 100;
+  int value = 0;
+  std::atomic<int> writers{0};
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i] {
+      bool is_writer = i % 2 == 0;
+      for (int j = 0; j < num_iters; j++) {
+        auto *txn = txn_mgr.Begin();
+        auto table_mode = is_writer ? LockManager::LockMode::INTENTION_EXCLUSIVE
+                                    : LockManager::LockMode::INTENTION_SHARED;
+        auto row_mode = is_writer ? LockManager::LockMode::EXCLUSIVE : LockManager::LockMode::SHARED;
+        EXPECT_TRUE(lock_mgr.LockTable(txn, table_mode, oid));
+        EXPECT_TRUE(lock_mgr.LockRow(txn, row_mode, oid, rid));
+        if (is_writer) {
+          EXPECT_EQ(0, writers.fetch_add(1));
+          value++;
+          writers--;
+        } else {
+          EXPECT_EQ(0, writers.load());
+        }
+        txn_mgr.Commit(txn);
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_threads / 2 * num_iters, value);
+  EXPECT_EQ(0, lock_mgr.GetRowLockQueueCount());
+  TEST_TIMEOUT_FAIL_END(60000)
+}
+
+/** Inserts into a gap do not block each other, a scan of the gap waits for them and then blocks new ones */
+TEST(LockManagerTest, KeyRangeLockTest) {
+  LockManager lock_mgr{};
+  TransactionManager txn_mgr{&lock_mgr};
+  index_oid_t index_oid = 0;
+  RID next{0, 1};
+  auto *inserter1 = txn_mgr.Begin();
+  auto *inserter2 = txn_mgr.Begin();
+  auto *scanner = txn_mgr.Begin();
+
+  EXPECT_TRUE(lock_mgr.LockKeyRange(inserter1, LockManager::LockMode::INTENTION_EXCLUSIVE, index_oid, next));
+  EXPECT_TRUE(lock_mgr.LockKeyRange(inserter2, LockManager::LockMode::INTENTION_EXCLUSIVE, index_oid, next));
+  std::atomic<bool> scanned{false};
+  std::thread scan([&] {
+    EXPECT_TRUE(lock_mgr.LockKeyRange(scanner, LockManager::LockMode::SHARED, index_oid, next));
+    scanned = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(scanned);
+  txn_mgr.Commit(inserter1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(scanned);
+  txn_mgr.Commit(inserter2);
+  scan.join();
+  EXPECT_TRUE(scanned);
+
+  /** The scanner inserting into the gap it read upgrades to SIX, which also covers a later S request */
+  EXPECT_TRUE(lock_mgr.LockKeyRange(scanner, LockManager::LockMode::INTENTION_EXCLUSIVE, index_oid, next));
+  EXPECT_TRUE(lock_mgr.LockKeyRange(scanner, LockManager::LockMode::SHARED, index_oid, next));
+  EXPECT_TRUE(lock_mgr.LockKeyRange(scanner, LockManager::LockMode::SHARED, index_oid, RID()));
+  EXPECT_EQ(2, scanner->GetKeyRangeLockSet()->at(index_oid).size());
+  EXPECT_EQ(2, lock_mgr.GetKeyRangeLockQueueCount());
+
+  auto *inserter3 = txn_mgr.Begin();
+  std::atomic<bool> inserted{false};
+  std::thread insert([&] {
+    EXPECT_TRUE(lock_mgr.LockKeyRange(inserter3, LockManager::LockMode::INTENTION_EXCLUSIVE, index_oid, next));
+    inserted = true;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  EXPECT_FALSE(inserted);
+  txn_mgr.Commit(scanner);
+  insert.join();
+  EXPECT_TRUE(inserted);
+  txn_mgr.Commit(inserter3);
+  EXPECT_EQ(0, lock_mgr.GetKeyRangeLockQueueCount());
+
+  delete inserter1;
+  delete inserter2;
+  delete inserter3;
+  delete scanner;
+}
+
 void TwoPLTest1() {
   LockManager lock_mgr{};
   TransactionManager txn_mgr{&lock_mgr};
@@ -13,10 +13,12 @@
 #include "concurrency/transaction.h"
 
 #include <atomic>
+#include <chrono>  // NOLINT
 #include <cstdio>
 #include <memory>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -173,4 +175,233 @@ TEST_F(TransactionTest, ReadCommitedTest) {
   delete txn1;
 }
 
+TEST_F(TransactionTest, SnapshotIsolationTest) {
+  auto noop_writer = NoopWriter();
+  bustub_->ExecuteSql("CREATE TABLE t (a int, b int)", noop_writer);
+  bustub_->ExecuteSql("INSERT INTO t VALUES (1, 10), (2, 20)", noop_writer);
+  auto *table = bustub_->catalog_->GetTable("t")->table_.get();
+  auto select = [&](Transaction *txn) {
+    std::stringstream ss;
+    auto writer = SimpleStreamWriter(ss, true);
+    bustub_->ExecuteSqlTxn("SELECT * FROM t", writer, txn);
+    return ss.str();
+  };
+
+  auto *reader = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  EXPECT_EQ(select(reader), "1\t10\t\n2\t20\t\n");
+
+  // The reader holds no lock, so the writer does not wait for it.
+  auto *writer = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::REPEATABLE_READ);
+  bustub_->ExecuteSqlTxn("DELETE FROM t WHERE a = 1", noop_writer, writer);
+  bustub_->ExecuteSqlTxn("INSERT INTO t VALUES (3, 30)", noop_writer, writer);
+  EXPECT_EQ(select(reader), "1\t10\t\n2\t20\t\n");
+  bustub_->txn_manager_->Commit(writer);
+  delete writer;
+
+  // The deleted tuple is kept for the running snapshot, a new snapshot sees the writes.
+  EXPECT_EQ(select(reader), "1\t10\t\n2\t20\t\n");
+  auto *new_reader = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::SNAPSHOT_ISOLATION);
+  EXPECT_EQ(select(new_reader), "2\t20\t\n3\t30\t\n");
+  bustub_->txn_manager_->Commit(new_reader);
+  delete new_reader;
+  EXPECT_EQ(2, table->GetVersionChainCount());
+
+  // Deleting the tuple the committed writer already deleted is a write-write conflict.
+  bustub_->ExecuteSqlTxn("DELETE FROM t WHERE a = 1", noop_writer, reader);
+  CheckAborted(reader);
+  bustub_->txn_manager_->Abort(reader);
+  delete reader;
+
+  // Once no snapshot is running, the older versions are reclaimed.
+  EXPECT_EQ(0, table->GetVersionChainCount());
+  auto *txn = bustub_->txn_manager_->Begin();
+  EXPECT_EQ(select(txn), "2\t20\t\n3\t30\t\n");
+  bustub_->txn_manager_->Commit(txn);
+  delete txn;
+}
+
+TEST_F(TransactionTest, OptimisticConcurrencyControlTest) {
+  auto noop_writer = NoopWriter();
+  bustub_->ExecuteSql("CREATE TABLE t (a int, b int)", noop_writer);
+  bustub_->ExecuteSql("CREATE INDEX t_a ON t(a)", noop_writer);
+  bustub_->ExecuteSql("INSERT INTO t VALUES (1, 10), (2, 20)", noop_writer);
+  auto select = [&](Transaction *txn) {
+    std::stringstream ss;
+    auto writer = SimpleStreamWriter(ss, true);
+    bustub_->ExecuteSqlTxn("SELECT * FROM t", writer, txn);
+    return ss.str();
+  };
+  auto execute = [&](const std::string &sql, IsolationLevel isolation_level) {
+    auto *txn = bustub_->txn_manager_->Begin(nullptr, isolation_level);
+    bustub_->ExecuteSqlTxn(sql, noop_writer, txn);
+    bustub_->txn_manager_->Commit(txn);
+    delete txn;
+  };
+
+  // A read-only transaction reads its snapshot and always commits.
+  auto *reader = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  EXPECT_EQ(select(reader), "1\t10\t\n2\t20\t\n");
+  execute("INSERT INTO t VALUES (3, 30)", IsolationLevel::REPEATABLE_READ);
+  EXPECT_EQ(select(reader), "1\t10\t\n2\t20\t\n");
+  EXPECT_TRUE(bustub_->txn_manager_->Commit(reader));
+  delete reader;
+
+  // A write committed to a table scanned as a whole fails the validation, the writes are rolled back.
+  auto *scanner = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  EXPECT_EQ(select(scanner), "1\t10\t\n2\t20\t\n3\t30\t\n");
+  bustub_->ExecuteSqlTxn("INSERT INTO t VALUES (5, 50)", noop_writer, scanner);
+  execute("DELETE FROM t WHERE a = 3", IsolationLevel::REPEATABLE_READ);
+  EXPECT_FALSE(bustub_->txn_manager_->Commit(scanner));
+  CheckAborted(scanner);
+  delete scanner;
+
+  // Point lookups are validated per key, writes under other keys do not conflict.
+  auto *updater = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  bustub_->ExecuteSqlTxn("DELETE FROM t WHERE a = 1", noop_writer, updater);
+  execute("INSERT INTO t VALUES (4, 40)", IsolationLevel::REPEATABLE_READ);
+  EXPECT_TRUE(bustub_->txn_manager_->Commit(updater));
+  delete updater;
+
+  // A tuple inserted under a key that was looked up is a phantom.
+  auto *phantom = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  bustub_->ExecuteSqlTxn("DELETE FROM t WHERE a = 7", noop_writer, phantom);
+  bustub_->ExecuteSqlTxn("INSERT INTO t VALUES (8, 80)", noop_writer, phantom);
+  execute("INSERT INTO t VALUES (7, 70)", IsolationLevel::OPTIMISTIC);
+  EXPECT_FALSE(bustub_->txn_manager_->Commit(phantom));
+  delete phantom;
+
+  // A tuple read through the index that another transaction deleted and committed fails the validation.
+  auto *stale = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::OPTIMISTIC);
+  bustub_->ExecuteSqlTxn("SELECT * FROM t WHERE a = 2", noop_writer, stale);
+  bustub_->ExecuteSqlTxn("INSERT INTO t VALUES (6, 60)", noop_writer, stale);
+  execute("DELETE FROM t WHERE a = 2", IsolationLevel::REPEATABLE_READ);
+  EXPECT_FALSE(bustub_->txn_manager_->Commit(stale));
+  delete stale;
+
+  auto *txn = bustub_->txn_manager_->Begin();
+  EXPECT_EQ(select(txn), "4\t40\t\n7\t70\t\n");
+  bustub_->txn_manager_->Commit(txn);
+  delete txn;
+}
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, KeyRangeLockTest) {
+  auto noop_writer = NoopWriter();
+  bustub_->ExecuteSql("CREATE TABLE t (a int, b int)", noop_writer);
+  bustub_->ExecuteSql("CREATE INDEX t_a ON t(a)", noop_writer);
+  bustub_->ExecuteSql("INSERT INTO t VALUES (1, 10), (3, 30), (5, 50), (9, 90)", noop_writer);
+  auto select = [&](const std::string &sql, Transaction *txn) {
+    std::stringstream ss;
+    auto writer = SimpleStreamWriter(ss, true);
+    bustub_->ExecuteSqlTxn(sql, writer, txn);
+    return ss.str();
+  };
+  auto insert = [&](const std::string &sql, std::atomic<bool> *done) {
+    auto *txn = bustub_->txn_manager_->Begin();
+    bustub_->ExecuteSqlTxn(sql, noop_writer, txn);
+    *done = true;
+    bustub_->txn_manager_->Commit(txn);
+    delete txn;
+  };
+
+  // A repeatable read range scan locks the keys it read and the gaps up to the next key after the range.
+  const std::string range_scan = "SELECT * FROM t WHERE a >= 2 AND a <= 6";
+  auto *scanner = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::REPEATABLE_READ);
+  EXPECT_EQ(select(range_scan, scanner), "3\t30\t\n5\t50\t\n");
+
+  // An insert into the range waits for the scanner, one past the next key does not.
+  std::atomic<bool> inside{false};
+  std::atomic<bool> outside{false};
+  std::thread insert_inside(insert, "INSERT INTO t VALUES (4, 40)", &inside);
+  std::thread insert_outside(insert, "INSERT INTO t VALUES (10, 100)", &outside);
+  insert_outside.join();
+  EXPECT_TRUE(outside);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(inside);
+  EXPECT_EQ(select(range_scan, scanner), "3\t30\t\n5\t50\t\n");
+  bustub_->txn_manager_->Commit(scanner);
+  delete scanner;
+  insert_inside.join();
+  EXPECT_TRUE(inside);
+
+  // A point lookup of a missing key locks the gap it would go into.
+  auto *lookup = bustub_->txn_manager_->Begin(nullptr, IsolationLevel::REPEATABLE_READ);
+  EXPECT_EQ(select("SELECT * FROM t WHERE a = 7", lookup), "");
+  std::atomic<bool> phantom{false};
+  std::thread insert_phantom(insert, "INSERT INTO t VALUES (7, 70)", &phantom);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(phantom);
+  EXPECT_EQ(select("SELECT * FROM t WHERE a = 7", lookup), "");
+  bustub_->txn_manager_->Commit(lookup);
+  delete lookup;
+  insert_phantom.join();
+
+  auto *txn = bustub_->txn_manager_->Begin();
+  EXPECT_EQ(select("SELECT * FROM t ORDER BY a", txn),
+            "1\t10\t\n3\t30\t\n4\t40\t\n5\t50\t\n7\t70\t\n9\t90\t\n10\t100\t\n");
+  bustub_->txn_manager_->Commit(txn);
+  delete txn;
+  EXPECT_EQ(0, bustub_->lock_manager_->GetKeyRangeLockQueueCount());
+}
+
+
+// NOLINTNEXTLINE
+TEST_F(TransactionTest, TransactionRegistryTest) {
+  auto *txn_manager = bustub_->txn_manager_;
+  const int num_threads = 8;
+  const int num_txns = 200;
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&, i] {
+      for (int j = 0; j < num_txns; j++) {
+        auto *txn = txn_manager->Begin();
+        EXPECT_EQ(TransactionManager::GetTransaction(txn->GetTransactionId()), txn);
+        if ((i + j) % 2 == 0) {
+          txn_manager->Commit(txn);
+        } else {
+          txn_manager->Abort(txn);
+        }
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // A checkpoint waits for the running transactions and holds off the new ones until it resumes them.
+  auto *running = txn_manager->Begin();
+  std::atomic<bool> blocked{false};
+  std::atomic<bool> resume{false};
+  std::thread checkpoint([&] {
+    txn_manager->BlockAllTransactions();
+    blocked = true;
+    while (!resume) {
+      std::this_thread::yield();
+    }
+    txn_manager->ResumeTransactions();
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(blocked);
+  txn_manager->Commit(running);
+  delete running;
+  while (!blocked) {
+    std::this_thread::yield();
+  }
+  std::atomic<bool> began{false};
+  std::thread begin([&] {
+    auto *txn = txn_manager->Begin();
+    began = true;
+    txn_manager->Commit(txn);
+    delete txn;
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  EXPECT_FALSE(began);
+  resume = true;
+  checkpoint.join();
+  begin.join();
+  EXPECT_TRUE(began);
+}
+
 }  // namespace bustub
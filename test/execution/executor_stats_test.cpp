@@ -0,0 +1,95 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// executor_stats_test.cpp
+//
+// Identification: test/execution/executor_stats_test.cpp
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#include "common/bustub_instance.h"
+#include "concurrency/transaction_manager.h"
+#include "execution/executor_context.h"
+#include "execution/executor_factory.h"
+#include "execution/plans/limit_plan.h"
+#include "execution/plans/seq_scan_plan.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(ExecutorStatsTest, InstrumentedExecutorTest) {
+  auto bustub = std::make_unique<BustubInstance>("executor_stats_test.db");
+  auto noop_writer = NoopWriter();
+  bustub->ExecuteSql("CREATE TABLE t1 (a int, b int);", noop_writer);
+  bustub->ExecuteSql("INSERT INTO t1 VALUES (1, 10), (2, 20), (3, 30), (4, 40), (5, 50);", noop_writer);
+
+  // Limit 2 <- SeqScan t1, the limit stops pulling from the scan once it has emitted two rows.
+  auto *table_info = bustub->catalog_->GetTable("t1");
+  auto schema = std::make_shared<const Schema>(table_info->schema_);
+  auto seq_scan = std::make_shared<SeqScanPlanNode>(schema, table_info->oid_, table_info->name_);
+  auto limit = std::make_shared<LimitPlanNode>(schema, seq_scan, 2);
+
+  auto run = [&](ExecutorContext *exec_ctx, int loops) {
+    auto executor = ExecutorFactory::CreateExecutor(exec_ctx, limit);
+    for (int i = 0; i < loops; i++) {
+      executor->Init();
+      Tuple tuple;
+      RID rid;
+      int rows = 0;
+      while (executor->Next(&tuple, &rid)) {
+        rows++;
+      }
+      EXPECT_EQ(2, rows);
+    }
+  };
+
+  auto *txn = bustub->txn_manager_->Begin();
+  {
+    // Without EXPLAIN ANALYZE the executors are not instrumented and nothing is recorded.
+    ExecutorContext exec_ctx(txn, bustub->catalog_, bustub->buffer_pool_manager_, bustub->txn_manager_,
+                             bustub->lock_manager_);
+    run(&exec_ctx, 1);
+    EXPECT_EQ(nullptr, exec_ctx.FindExecutorStats(limit.get()));
+    EXPECT_EQ(nullptr, exec_ctx.FindExecutorStats(seq_scan.get()));
+  }
+
+  {
+    // Running the plan twice counts two loops per node, rows add up over the loops.
+    ExecutorContext exec_ctx(txn, bustub->catalog_, bustub->buffer_pool_manager_, bustub->txn_manager_,
+                             bustub->lock_manager_);
+    exec_ctx.EnableAnalyze();
+    run(&exec_ctx, 2);
+    const auto *limit_stats = exec_ctx.FindExecutorStats(limit.get());
+    const auto *scan_stats = exec_ctx.FindExecutorStats(seq_scan.get());
+    ASSERT_NE(nullptr, limit_stats);
+    ASSERT_NE(nullptr, scan_stats);
+    EXPECT_EQ(2, limit_stats->loops_);
+    EXPECT_EQ(4, limit_stats->rows_);
+    EXPECT_EQ(2, scan_stats->loops_);
+    EXPECT_EQ(4, scan_stats->rows_);
+
+    // The scan reads the table pages, the counters of the limit include the work of its child.
+    EXPECT_GT(scan_stats->page_fetches_, 0);
+    EXPECT_LE(scan_stats->page_misses_, scan_stats->page_fetches_);
+    EXPECT_EQ(scan_stats->page_fetches_, limit_stats->page_fetches_);
+    EXPECT_EQ(scan_stats->page_misses_, limit_stats->page_misses_);
+    EXPECT_GE(limit_stats->init_us_ + limit_stats->next_us_, scan_stats->init_us_ + scan_stats->next_us_);
+
+    // Nothing else holds a lock on t1, so no request blocked.
+    EXPECT_EQ(0, limit_stats->lock_waits_);
+    EXPECT_EQ(0, scan_stats->lock_waits_);
+  }
+  bustub->txn_manager_->Commit(txn);
+  delete txn;
+
+  bustub.reset();
+  remove("executor_stats_test.db");
+}
+
+}  // namespace bustub
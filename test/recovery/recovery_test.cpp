@@ -10,7 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
 #include <string>
+#include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
@@ -320,4 +322,53 @@ TEST_F(RecoveryTest, DISABLED_CheckpointTest) {
   LOG_INFO("Shutdown System");
   delete bustub_instance;
 }
+
+// NOLINTNEXTLINE
+TEST_F(RecoveryTest, GroupCommitTest) {
+  auto *bustub_instance = new BustubInstance("test.db");
+  bustub_instance->log_manager_->RunFlushThread();
+  ASSERT_TRUE(enable_logging);
+  auto default_delay = group_commit_delay;
+  group_commit_delay = std::chrono::milliseconds(10);
+
+  Transaction *txn = bustub_instance->txn_manager_->Begin();
+  auto *test_table = new TableHeap(bustub_instance->buffer_pool_manager_, bustub_instance->lock_manager_,
+                                   bustub_instance->log_manager_, txn);
+  bustub_instance->txn_manager_->Commit(txn);
+  delete txn;
+
+  Column col1{"a", TypeId::VARCHAR, 20};
+  Column col2{"b", TypeId::SMALLINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+  const Tuple tuple = ConstructTuple(&schema);
+
+  const int num_threads = 8;
+  const int txns_per_thread = 20;
+  const int flushes_before = bustub_instance->disk_manager_->GetNumFlushes();
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads);
+  for (int i = 0; i < num_threads; i++) {
+    threads.emplace_back([&] {
+      for (int j = 0; j < txns_per_thread; j++) {
+        auto *txn = bustub_instance->txn_manager_->Begin();
+        RID rid;
+        EXPECT_TRUE(test_table->InsertTuple(tuple, &rid, txn));
+        bustub_instance->txn_manager_->Commit(txn);
+        // the commit returns once its commit record is durable
+        EXPECT_LE(txn->GetPrevLSN(), bustub_instance->log_manager_->GetPersistentLSN());
+        delete txn;
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  // commits arriving together share one log flush
+  EXPECT_LE(bustub_instance->disk_manager_->GetNumFlushes() - flushes_before, num_threads * txns_per_thread / 2);
+
+  group_commit_delay = default_delay;
+  delete test_table;
+  delete bustub_instance;
+}
 }  // namespace bustub
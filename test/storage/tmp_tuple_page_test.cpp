@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <string>
 #include <vector>
 
 #include "gtest/gtest.h"
@@ -19,7 +20,7 @@
 namespace bustub {
 
 // NOLINTNEXTLINE
-TEST(TmpTuplePageTest, DISABLED_BasicTest) {
+TEST(TmpTuplePageTest, BasicTest) {
   // There are many ways to do this assignment, and this is only one of them.
   // If you don't like the TmpTuplePage idea, please feel free to delete this test case entirely.
   // You will get full credit as long as you are correctly using a linear probe hash table.
@@ -46,6 +47,41 @@ TEST(TmpTuplePageTest, DISABLED_BasicTest) {
   ASSERT_EQ(*reinterpret_cast<uint32_t *>(data + sizeof(page_id_t) + sizeof(lsn_t)), BUSTUB_PAGE_SIZE - 8);
   ASSERT_EQ(*reinterpret_cast<uint32_t *>(data + BUSTUB_PAGE_SIZE - 8), 4);
   ASSERT_EQ(*reinterpret_cast<uint32_t *>(data + BUSTUB_PAGE_SIZE - 4), 123);
+  ASSERT_EQ(tmp_tuple.GetOffset(), BUSTUB_PAGE_SIZE - 8);
+
+  Tuple read_tuple;
+  page.Get(tmp_tuple, &read_tuple);
+  ASSERT_EQ(read_tuple.GetValue(&schema, 0).GetAs<int32_t>(), 123);
+}
+
+TEST(TmpTuplePageTest, FillAndReadBackTest) {
+  TmpTuplePage page{};
+  page.Init(15445, BUSTUB_PAGE_SIZE);
+
+  std::vector<Column> columns;
+  columns.emplace_back("A", TypeId::INTEGER);
+  columns.emplace_back("B", TypeId::VARCHAR, 16);
+  Schema schema(columns);
+
+  int32_t inserted = 0;
+  TmpTuple tmp_tuple(INVALID_PAGE_ID, 0);
+  while (true) {
+    std::vector<Value> values{ValueFactory::GetIntegerValue(inserted),
+                              ValueFactory::GetVarcharValue(std::string(inserted % 10, 'x'))};
+    if (!page.Insert(Tuple(values, &schema), &tmp_tuple)) {
+      break;
+    }
+    inserted++;
+  }
+  ASSERT_GT(inserted, 0);
+
+  std::vector<Tuple> tuples;
+  page.GetTuples(&tuples);
+  ASSERT_EQ(tuples.size(), inserted);
+  for (int32_t i = 0; i < inserted; i++) {
+    ASSERT_EQ(tuples[i].GetValue(&schema, 0).GetAs<int32_t>(), i);
+    ASSERT_EQ(tuples[i].GetValue(&schema, 1).ToString(), std::string(i % 10, 'x'));
+  }
 }
 
 }  // namespace bustub
@@ -21,6 +21,8 @@
 #include "logging/common.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/tuple.h"
+#include "storage/table/tuple_builder.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 // NOLINTNEXTLINE
@@ -71,4 +73,44 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, TupleBuilderTest) {
+  Schema left_schema{{Column{"a", TypeId::INTEGER}, Column{"b", TypeId::VARCHAR, 20}}};
+  Schema right_schema{
+      {Column{"c", TypeId::VARCHAR, 20}, Column{"d", TypeId::BIGINT}, Column{"e", TypeId::VARCHAR, 20}}};
+  std::vector<Column> join_cols(left_schema.GetColumns());
+  join_cols.insert(join_cols.end(), right_schema.GetColumns().begin(), right_schema.GetColumns().end());
+  Schema join_schema{join_cols};
+
+  Tuple left{{ValueFactory::GetIntegerValue(1), ValueFactory::GetVarcharValue("left")}, &left_schema};
+  Tuple right{{ValueFactory::GetVarcharValue("right"), ValueFactory::GetBigIntValue(2),
+               ValueFactory::GetNullValueByType(TypeId::VARCHAR)},
+              &right_schema};
+
+  // The output tuple must be the same as the one serialized from values
+  auto join_builder = TupleBuilder::ForJoin(&join_schema, &left_schema, &right_schema);
+  auto joined = join_builder.Build(left, right);
+  std::vector<Value> values{left.GetValue(&left_schema, 0), left.GetValue(&left_schema, 1),
+                            right.GetValue(&right_schema, 0), right.GetValue(&right_schema, 1),
+                            right.GetValue(&right_schema, 2)};
+  Tuple expected{values, &join_schema};
+  ASSERT_EQ(expected.GetLength(), joined.GetLength());
+  ASSERT_EQ(0, memcmp(expected.GetData(), joined.GetData(), joined.GetLength()));
+  ASSERT_EQ(expected.ToString(&join_schema), joined.ToString(&join_schema));
+
+  auto padded = join_builder.Build(left, TupleBuilder::NullTuple(&right_schema));
+  for (uint32_t i = 2; i < join_schema.GetColumnCount(); i++) {
+    ASSERT_TRUE(padded.IsNull(&join_schema, i));
+  }
+  ASSERT_EQ("left", padded.GetValue(&join_schema, 1).ToString());
+
+  // Projection with reordered and repeated columns
+  Schema proj_schema{{Column{"d", TypeId::BIGINT}, Column{"c", TypeId::VARCHAR, 20}, Column{"c", TypeId::VARCHAR, 20}}};
+  TupleBuilder proj_builder{&proj_schema, {&right_schema}, {{0, 1}, {0, 0}, {0, 0}}};
+  auto projected = proj_builder.Build(right);
+  ASSERT_EQ(2, projected.GetValue(&proj_schema, 0).GetAs<int64_t>());
+  ASSERT_EQ("right", projected.GetValue(&proj_schema, 1).ToString());
+  ASSERT_EQ("right", projected.GetValue(&proj_schema, 2).ToString());
+}
+
 }  // namespace bustub
@@ -11,6 +11,7 @@
 #include "argparse/argparse.hpp"
 #include "binder/binder.h"
 #include "common/bustub_instance.h"
+#include "common/config.h"
 #include "common/exception.h"
 #include "common/util/string_util.h"
 #include "concurrency/transaction.h"
@@ -63,6 +64,9 @@ struct TerrierTotalMetrics {
     fmt::print("update: {}\n", update_txn_per_sec);
     fmt::print("count: {}\n", count_txn_per_sec);
     fmt::print(">>> END\n");
+    // 比较不同死锁处理策略时关注 abort 率
+    fmt::print("x: update aborted={} committed={}, count aborted={} committed={}\n", aborted_update_txn_cnt_,
+               committed_update_txn_cnt_, aborted_count_txn_cnt_, committed_count_txn_cnt_);
   }
 };
 
@@ -114,12 +118,36 @@ auto ParseBool(const std::string &str) -> bool {
   throw bustub::Exception(fmt::format("unexpected arg: {}", str));
 }
 
+auto ParseDeadlockPolicy(const std::string &str) -> bustub::DeadlockPolicy {
+  if (str == "detection") {
+    return bustub::DeadlockPolicy::DETECTION;
+  }
+  if (str == "wait-die") {
+    return bustub::DeadlockPolicy::WAIT_DIE;
+  }
+  if (str == "wound-wait") {
+    return bustub::DeadlockPolicy::WOUND_WAIT;
+  }
+  if (str == "no-wait") {
+    return bustub::DeadlockPolicy::NO_WAIT;
+  }
+  if (str == "timeout") {
+    return bustub::DeadlockPolicy::TIMEOUT;
+  }
+  throw bustub::Exception(fmt::format("unexpected arg: {}", str));
+}
+
 // NOLINTNEXTLINE
 auto main(int argc, char **argv) -> int {
   argparse::ArgumentParser program("bustub-terrier-bench");
   program.add_argument("--duration").help("run terrier bench for n milliseconds");
   program.add_argument("--force-create-index").help("create index in terrier bench");
   program.add_argument("--force-enable-update").help("use update statement in terrier bench");
+  program.add_argument("--deadlock-policy").help("detection, wait-die, wound-wait, no-wait or timeout");
+  program.add_argument("--lock-wait-timeout").help("lock wait timeout in milliseconds of the timeout policy");
+  program.add_argument("--snapshot-count").help("run the count transactions under snapshot isolation");
+  program.add_argument("--optimistic-count").help("run the count transactions under optimistic concurrency control");
+  program.add_argument("--optimistic-update").help("run the update transactions under optimistic concurrency control");
 
   try {
     program.parse_args(argc, argv);
@@ -180,6 +208,29 @@ auto main(int argc, char **argv) -> int {
 
   std::cerr << "x: benchmark for " << duration_ms << "ms" << std::endl;
 
+  if (program.present("--deadlock-policy")) {
+    bustub->txn_manager_->SetDeadlockPolicy(ParseDeadlockPolicy(program.get("--deadlock-policy")));
+  }
+  if (program.present("--lock-wait-timeout")) {
+    bustub::lock_wait_timeout = std::chrono::milliseconds(std::stoi(program.get("--lock-wait-timeout")));
+  }
+  std::cerr << "x: deadlock policy " << program.present("--deadlock-policy").value_or("detection") << std::endl;
+
+  auto count_isolation = bustub::IsolationLevel::REPEATABLE_READ;
+  if (program.present("--snapshot-count") && ParseBool(program.get("--snapshot-count"))) {
+    count_isolation = bustub::IsolationLevel::SNAPSHOT_ISOLATION;
+    std::cerr << "x: count under snapshot isolation" << std::endl;
+  }
+  if (program.present("--optimistic-count") && ParseBool(program.get("--optimistic-count"))) {
+    count_isolation = bustub::IsolationLevel::OPTIMISTIC;
+    std::cerr << "x: count under optimistic concurrency control" << std::endl;
+  }
+  auto update_isolation = bustub::IsolationLevel::REPEATABLE_READ;
+  if (program.present("--optimistic-update") && ParseBool(program.get("--optimistic-update"))) {
+    update_isolation = bustub::IsolationLevel::OPTIMISTIC;
+    std::cerr << "x: update under optimistic concurrency control" << std::endl;
+  }
+
   // initialize data
   std::cerr << "x: initialize data" << std::endl;
   std::string query = "INSERT INTO nft VALUES ";
@@ -213,7 +264,8 @@ auto main(int argc, char **argv) -> int {
   total_metrics.Begin();
 
   for (size_t thread_id = 0; thread_id < BUSTUB_TERRIER_THREAD; thread_id++) {
-    threads.emplace_back(std::thread([thread_id, &bustub, enable_update, duration_ms, &total_metrics] {
+    threads.emplace_back(std::thread([thread_id, &bustub, enable_update, duration_ms, update_isolation,
+                                      &total_metrics] {
       const size_t nft_range_size = BUSTUB_NFT_NUM / BUSTUB_TERRIER_THREAD;
       const size_t nft_range_begin = thread_id * nft_range_size;
       const size_t nft_range_end = (thread_id + 1) * nft_range_size;
@@ -233,7 +285,7 @@ auto main(int argc, char **argv) -> int {
         bool txn_success = true;
 
         if (enable_update) {
-          auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ);
+          auto txn = bustub->txn_manager_->Begin(nullptr, update_isolation);
           std::string query = fmt::format("UPDATE nft SET terrier = {} WHERE id = {}", terrier_id, nft_id);
           if (!bustub->ExecuteSqlTxn(query, writer, txn)) {
             txn_success = false;
@@ -244,16 +296,17 @@ auto main(int argc, char **argv) -> int {
             exit(1);
           }
 
-          if (txn_success) {
-            bustub->txn_manager_->Commit(txn);
+          if (!txn_success) {
+            bustub->txn_manager_->Abort(txn);
+            metrics.TxnAborted();
+          } else if (bustub->txn_manager_->Commit(txn)) {
             metrics.TxnCommitted();
           } else {
-            bustub->txn_manager_->Abort(txn);
             metrics.TxnAborted();
           }
           delete txn;
         } else {
-          auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ);
+          auto txn = bustub->txn_manager_->Begin(nullptr, update_isolation);
 
           std::string query = fmt::format("DELETE FROM nft WHERE id = {}", nft_id);
           if (!bustub->ExecuteSqlTxn(query, writer, txn)) {
@@ -269,11 +322,14 @@ auto main(int argc, char **argv) -> int {
             bustub->txn_manager_->Abort(txn);
             metrics.TxnAborted();
             delete txn;
+          } else if (!bustub->txn_manager_->Commit(txn)) {
+            // the optimistic delete failed its validation and was rolled back, the nft is still there
+            metrics.TxnAborted();
+            delete txn;
           } else {
-            bustub->txn_manager_->Commit(txn);
             delete txn;
 
-            txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ);
+            txn = bustub->txn_manager_->Begin(nullptr, update_isolation);
 
             query = fmt::format("INSERT INTO nft VALUES ({}, {})", nft_id, terrier_id);
             if (!bustub->ExecuteSqlTxn(query, writer, txn)) {
@@ -288,9 +344,10 @@ auto main(int argc, char **argv) -> int {
             if (!txn_success) {
               bustub->txn_manager_->Abort(txn);
               metrics.TxnAborted();
-            } else {
-              bustub->txn_manager_->Commit(txn);
+            } else if (bustub->txn_manager_->Commit(txn)) {
               metrics.TxnCommitted();
+            } else {
+              metrics.TxnAborted();
             }
             delete txn;
           }
@@ -304,7 +361,7 @@ auto main(int argc, char **argv) -> int {
   }
 
   for (size_t thread_id = 0; thread_id < BUSTUB_TERRIER_THREAD; thread_id++) {
-    threads.emplace_back(std::thread([thread_id, &bustub, duration_ms, &total_metrics] {
+    threads.emplace_back(std::thread([thread_id, &bustub, duration_ms, count_isolation, &total_metrics] {
       std::random_device r;
       std::default_random_engine gen(r());
       std::uniform_int_distribution<int> terrier_uniform_dist(0, BUSTUB_TERRIER_CNT - 1);
@@ -317,7 +374,7 @@ auto main(int argc, char **argv) -> int {
         auto writer = bustub::SimpleStreamWriter(ss, true);
         auto terrier_id = terrier_uniform_dist(gen);
 
-        auto txn = bustub->txn_manager_->Begin(nullptr, bustub::IsolationLevel::REPEATABLE_READ);
+        auto txn = bustub->txn_manager_->Begin(nullptr, count_isolation);
         bool txn_success = true;
 
         std::string query = fmt::format("SELECT count(*) FROM nft WHERE terrier = {}", terrier_id);
@@ -325,11 +382,12 @@ auto main(int argc, char **argv) -> int {
           txn_success = false;
         }
 
-        if (txn_success) {
-          bustub->txn_manager_->Commit(txn);
+        if (!txn_success) {
+          bustub->txn_manager_->Abort(txn);
+          metrics.TxnAborted();
+        } else if (bustub->txn_manager_->Commit(txn)) {
           metrics.TxnCommitted();
         } else {
-          bustub->txn_manager_->Abort(txn);
           metrics.TxnAborted();
         }
         delete txn;